@@ -0,0 +1,107 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/timer.h>
+#include <string.h>
+
+#define TC_BENCH_MAX_COUNT 256
+#define TC_BENCH_MIN_SECONDS 0.1
+#define TC_BENCH_REPEATS 3
+
+struct BenchEntry {
+    const char* name;
+    BenchFunc* func;
+};
+
+TC_GLOBAL BenchEntry benchEntries[TC_BENCH_MAX_COUNT];
+TC_GLOBAL U32 benchCount;
+
+BenchRegistrar::BenchRegistrar(const char* name, BenchFunc* func) {
+    TC_ASSERT(benchCount < TC_BENCH_MAX_COUNT, "Too many benchmarks");
+    benchEntries[benchCount].name = name;
+    benchEntries[benchCount].func = func;
+    ++benchCount;
+}
+
+TC_GLOBAL volatile U8 benchSink;
+
+TC_NO_INLINE void BenchUse(const void* data) {
+    benchSink = *(const volatile U8*) data;
+}
+
+void BenchStart(BenchState* state) {
+    state->start = TimerNow();
+}
+
+void BenchStop(BenchState* state) {
+    state->stop = TimerNow();
+}
+
+static F64 BenchTime(BenchEntry* entry, BenchState* state) {
+    state->start = 0;
+    state->stop = 0;
+    entry->func(state);
+    TC_ASSERT(state->stop > state->start, "Benchmark must call BenchStart and BenchStop");
+    return TimerSeconds(state->start, state->stop);
+}
+
+// Doubles the iteration count until one run takes long enough to time
+// reliably, then reports the fastest of a few runs.
+static void BenchRun(BenchEntry* entry) {
+    BenchState state = {1, 0, 0, 0};
+    F64 seconds = BenchTime(entry, &state);
+    while (seconds < TC_BENCH_MIN_SECONDS) {
+        state.iterations *= 2;
+        seconds = BenchTime(entry, &state);
+    }
+
+    for (int i = 1; i < TC_BENCH_REPEATS; ++i) {
+        seconds = TC_MIN(seconds, BenchTime(entry, &state));
+    }
+
+    F64 nanoseconds = seconds * 1e9 / F64(state.iterations);
+    if (state.items) {
+        F64 itemsPerSecond = F64(state.items) * F64(state.iterations) / seconds;
+        printf("%-56s %14.1f ns/iter %10.2f M items/s\n", entry->name, nanoseconds, itemsPerSecond * 1e-6);
+    }
+    else {
+        printf("%-56s %14.1f ns/iter\n", entry->name, nanoseconds);
+    }
+    fflush(stdout);
+}
+
+// Runs every benchmark, or only those whose name contains argv[1]
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : "";
+
+    printf("Compiled using: %s\n", TC_COMPILER_NAME);
+    printf("SIMD instruction set: %s\n", TC_SIMD_NAME);
+
+    for (U32 i = 0; i < benchCount; ++i) {
+        if (strstr(benchEntries[i].name, filter)) {
+            BenchRun(&benchEntries[i]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_BENCH_HEADER_GUARD
+#define TC_BENCH_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <tests/tests.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmark registration
+
+struct BenchState {
+    // Number of times the benchmark body should repeat its measured work
+    U64 iterations;
+
+    // Items processed per iteration, reported as a throughput when non-zero
+    U64 items;
+
+    // Timer readings around the measured loop, see BenchStart and BenchStop
+    U64 start;
+    U64 stop;
+};
+
+typedef void BenchFunc(BenchState* state);
+
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, BenchFunc* func);
+};
+
+// Defines and registers a benchmark. Setup outside BenchStart and BenchStop
+// is not measured, e.g.
+//   BENCHMARK("Mat4 multiply") {
+//       ...
+//       BenchStart(state);
+//       for (U64 i = 0; i < state->iterations; ++i) { ... }
+//       BenchStop(state);
+//   }
+#define BENCHMARK(NAME) \
+    static void TC_CAT(BenchFunc_, __LINE__)(BenchState* state); \
+    static BenchRegistrar TC_CAT(BenchRegistrar_, __LINE__)(NAME, TC_CAT(BenchFunc_, __LINE__)); \
+    static void TC_CAT(BenchFunc_, __LINE__)(BenchState* state)
+
+void BenchStart(BenchState* state);
+void BenchStop(BenchState* state);
+
+// Forces the compiler to assume the bytes at data are read
+void BenchUse(const void* data);
+
+#endif // TC_BENCH_HEADER_GUARD
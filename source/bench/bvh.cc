@@ -0,0 +1,507 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/bvh.h>
+#include <teacup/parallel.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TC_BENCH_BVH_PRIMITIVE_COUNT (1024 * 1024)
+
+static Box3* BenchBvhBoxes(U32 count) {
+    Box3* boxes = (Box3*) malloc(count * sizeof(Box3));
+    U32 state = 5;
+    for (U32 i = 0; i < count; ++i) {
+        F32 v[6];
+        for (int k = 0; k < 6; ++k) {
+            v[k] = RandomF32(&state);
+        }
+        Vec3 p = {v[0] * 100.0f, v[1] * 100.0f, v[2] * 100.0f};
+        boxes[i] = {p, p + Vec3{v[3], v[4], v[5]}};
+    }
+    return boxes;
+}
+
+static void BenchBvhBuild(BenchState* state, const BvhBuildOptions& options, bool* reported) {
+    Box3* boxes = BenchBvhBoxes(TC_BENCH_BVH_PRIMITIVE_COUNT);
+    BvhBuildStats stats = {};
+    state->items = TC_BENCH_BVH_PRIMITIVE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        Bvh bvh;
+        BvhBuild(&bvh, boxes, 0, TC_BENCH_BVH_PRIMITIVE_COUNT, options, &stats);
+        BvhFree(&bvh);
+    }
+    BenchStop(state);
+
+    if (!*reported) {
+        *reported = true;
+        printf("    %u threads, %u nodes, depth %u, SAH cost %.2f\n", ParallelThreadCount(), stats.nodeCount, stats.maxDepth, stats.sahCost);
+    }
+    free(boxes);
+}
+
+BENCHMARK("BVH binned SAH build (1M boxes)") {
+    TC_GLOBAL bool reported = false;
+    BenchBvhBuild(state, {}, &reported);
+}
+
+BENCHMARK("BVH linear build (1M boxes)") {
+    TC_GLOBAL bool reported = false;
+    BvhBuildOptions options;
+    options.quality = BVH_BUILD_QUALITY_FAST;
+    BenchBvhBuild(state, options, &reported);
+}
+
+BENCHMARK("BVH linear build with treelets (1M boxes)") {
+    TC_GLOBAL bool reported = false;
+    BvhBuildOptions options;
+    options.quality = BVH_BUILD_QUALITY_MEDIUM;
+    BenchBvhBuild(state, options, &reported);
+}
+
+#define TC_BENCH_BVH_TRAVERSAL_COUNT (64 * 1024)
+#define TC_BENCH_BVH_RAY_COUNT 1024
+
+struct BenchBvhScene {
+    Box3* boxes;
+    Bvh bvh;
+    RaySlab rays[TC_BENCH_BVH_RAY_COUNT];
+};
+
+static void BenchBvhSceneCreate(BenchBvhScene* scene) {
+    scene->boxes = BenchBvhBoxes(TC_BENCH_BVH_TRAVERSAL_COUNT);
+    BvhBuild(&scene->bvh, scene->boxes, 0, TC_BENCH_BVH_TRAVERSAL_COUNT);
+    U32 state = 9;
+    for (U32 i = 0; i < TC_BENCH_BVH_RAY_COUNT; ++i) {
+        F32 v[3];
+        for (int k = 0; k < 3; ++k) {
+            v[k] = RandomF32(&state) - 0.5f;
+        }
+        scene->rays[i] = Precompute(Ray{{50, 50, 50}, {v[0], v[1], v[2]}, 0.0f, F32Infinity()});
+    }
+}
+
+// Closest box entry per ray, shrinking tMax as boxes are found
+template <typename B>
+static void BenchBvhTraverse(BenchState* state, const BenchBvhScene* scene, const B* bvh) {
+    state->items = TC_BENCH_BVH_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_BVH_RAY_COUNT; ++r) {
+            F32 nearest = F32Infinity();
+            Traverse(bvh, scene->rays[r], [&](U32 primitive, RaySlab* ray) {
+                F32 entry, exit;
+                if (Intersect(*ray, scene->boxes[primitive], &entry, &exit) && entry < nearest) {
+                    nearest = entry;
+                    ray->tMax = entry;
+                }
+                return true;
+            });
+            BenchUse(&nearest);
+        }
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("BVH traversal binary (64K boxes)") {
+    BenchBvhScene* scene = (BenchBvhScene*) malloc(sizeof(BenchBvhScene));
+    BenchBvhSceneCreate(scene);
+    BenchBvhTraverse(state, scene, &scene->bvh);
+    BvhFree(&scene->bvh);
+    free(scene->boxes);
+    free(scene);
+}
+
+// Boxes strung along a curve with sizes spanning six orders of magnitude, so
+// a linear build with one box per leaf goes deep
+static void BenchBvhDeepScene(BenchBvhScene* scene) {
+    scene->boxes = (Box3*) malloc(TC_BENCH_BVH_TRAVERSAL_COUNT * sizeof(Box3));
+    U32 random = 41;
+    for (U32 i = 0; i < TC_BENCH_BVH_TRAVERSAL_COUNT; ++i) {
+        F32 v[4];
+        for (int k = 0; k < 4; ++k) {
+            v[k] = RandomF32(&random);
+        }
+        F32 t = F32(i) / TC_BENCH_BVH_TRAVERSAL_COUNT * 20.0f;
+        Vec3 p = Vec3{50 + 40 * Cos(t), 50 + 40 * Sin(t), t * 5} + Vec3{v[0], v[1], v[2]} * 2.0f;
+        F32 size = F32(1u << U32(v[3] * 20.0f)) * 1e-6f;
+        scene->boxes[i] = {p, p + Vec3{size, size, size}};
+    }
+    BvhBuildOptions options;
+    options.quality = BVH_BUILD_QUALITY_FAST;
+    options.mortonBits = 63;
+    BvhBuildStats stats;
+    BvhBuild(&scene->bvh, scene->boxes, 0, TC_BENCH_BVH_TRAVERSAL_COUNT, options, &stats);
+
+    TC_GLOBAL bool reported = false;
+    if (!reported) {
+        reported = true;
+        printf("    depth %u, %u nodes\n", stats.maxDepth, stats.nodeCount);
+    }
+
+    U32 state = 9;
+    for (U32 i = 0; i < TC_BENCH_BVH_RAY_COUNT; ++i) {
+        F32 v[3];
+        for (int k = 0; k < 3; ++k) {
+            v[k] = RandomF32(&state) - 0.5f;
+        }
+        scene->rays[i] = Precompute(Ray{{50, 50, 50}, {v[0], v[1], v[2]}, 0.0f, F32Infinity()});
+    }
+}
+
+// Closest box entry per ray as in BenchBvhTraverse, walking parent links
+static void BenchBvhStackless(BenchState* state, bool deep) {
+    BenchBvhScene* scene = (BenchBvhScene*) malloc(sizeof(BenchBvhScene));
+    if (deep) {
+        BenchBvhDeepScene(scene);
+    }
+    else {
+        BenchBvhSceneCreate(scene);
+    }
+    U32* parents = (U32*) malloc(scene->bvh.nodeCount * sizeof(U32));
+    BvhParents(&scene->bvh, parents);
+
+    state->items = TC_BENCH_BVH_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_BVH_RAY_COUNT; ++r) {
+            F32 nearest = F32Infinity();
+            TraverseStackless(&scene->bvh, parents, scene->rays[r], [&](U32 primitive, RaySlab* ray) {
+                F32 entry, exit;
+                if (Intersect(*ray, scene->boxes[primitive], &entry, &exit) && entry < nearest) {
+                    nearest = entry;
+                    ray->tMax = entry;
+                }
+                return true;
+            });
+            BenchUse(&nearest);
+        }
+    }
+    BenchStop(state);
+
+    free(parents);
+    BvhFree(&scene->bvh);
+    free(scene->boxes);
+    free(scene);
+}
+
+BENCHMARK("BVH traversal stackless (64K boxes)") {
+    BenchBvhStackless(state, false);
+}
+
+BENCHMARK("BVH traversal deep tree (64K boxes)") {
+    BenchBvhScene* scene = (BenchBvhScene*) malloc(sizeof(BenchBvhScene));
+    BenchBvhDeepScene(scene);
+    BenchBvhTraverse(state, scene, &scene->bvh);
+    BvhFree(&scene->bvh);
+    free(scene->boxes);
+    free(scene);
+}
+
+BENCHMARK("BVH traversal stackless deep tree (64K boxes)") {
+    BenchBvhStackless(state, true);
+}
+
+template <int N>
+static void BenchWideBvhTraverse(BenchState* state) {
+    BenchBvhScene* scene = (BenchBvhScene*) malloc(sizeof(BenchBvhScene));
+    BenchBvhSceneCreate(scene);
+    WideBvh<N> wide;
+    WideBvhBuild(&wide, &scene->bvh);
+    BenchBvhTraverse(state, scene, &wide);
+    WideBvhFree(&wide);
+    BvhFree(&scene->bvh);
+    free(scene->boxes);
+    free(scene);
+}
+
+BENCHMARK("BVH traversal 4-wide (64K boxes)") { BenchWideBvhTraverse<4>(state); }
+BENCHMARK("BVH traversal 8-wide (64K boxes)") { BenchWideBvhTraverse<8>(state); }
+
+// Segments between random points in the scene, like shadow rays towards
+// area lights, so about half of them are blocked
+static void BenchBvhShadowRays(RaySlab* rays, U32 count) {
+    U32 state = 21;
+    for (U32 i = 0; i < count; ++i) {
+        F32 v[6];
+        for (int k = 0; k < 6; ++k) {
+            v[k] = RandomF32(&state) * 100.0f;
+        }
+        Vec3 origin = {v[0], v[1], v[2]};
+        rays[i] = Precompute(Ray{origin, Vec3{v[3], v[4], v[5]} - origin, 0.0f, 1.0f});
+    }
+}
+
+// Shadow rays answered by the closest hit traversal stopping at the first
+// hit, the way to get occlusion without a dedicated query
+template <typename B>
+static void BenchBvhShadowTraverse(BenchState* state, const BenchBvhScene* scene, const B* bvh) {
+    state->items = TC_BENCH_BVH_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_BVH_RAY_COUNT; ++r) {
+            bool blocked = false;
+            Traverse(bvh, scene->rays[r], [&](U32 primitive, RaySlab* ray) {
+                blocked = Intersect(*ray, scene->boxes[primitive]);
+                return !blocked;
+            });
+            BenchUse(&blocked);
+        }
+    }
+    BenchStop(state);
+}
+
+template <typename B>
+static void BenchBvhOccluded(BenchState* state, const BenchBvhScene* scene, const B* bvh) {
+    state->items = TC_BENCH_BVH_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_BVH_RAY_COUNT; ++r) {
+            bool blocked = Occluded(bvh, scene->rays[r], [&](U32 primitive, const RaySlab& ray) {
+                return Intersect(ray, scene->boxes[primitive]);
+            });
+            BenchUse(&blocked);
+        }
+    }
+    BenchStop(state);
+}
+
+// Occlusion with each traversal, on the binary tree or its 8-wide collapse
+static void BenchBvhShadow(BenchState* state, bool wide, bool occluded) {
+    BenchBvhScene* scene = (BenchBvhScene*) malloc(sizeof(BenchBvhScene));
+    BenchBvhSceneCreate(scene);
+    BenchBvhShadowRays(scene->rays, TC_BENCH_BVH_RAY_COUNT);
+    WideBvh8 wide8;
+    WideBvhBuild(&wide8, &scene->bvh);
+    if (wide) {
+        occluded ? BenchBvhOccluded(state, scene, &wide8) : BenchBvhShadowTraverse(state, scene, &wide8);
+    }
+    else {
+        occluded ? BenchBvhOccluded(state, scene, &scene->bvh) : BenchBvhShadowTraverse(state, scene, &scene->bvh);
+    }
+    WideBvhFree(&wide8);
+    BvhFree(&scene->bvh);
+    free(scene->boxes);
+    free(scene);
+}
+
+BENCHMARK("BVH shadow rays with Traverse (64K boxes)") { BenchBvhShadow(state, false, false); }
+BENCHMARK("BVH shadow rays with Occluded (64K boxes)") { BenchBvhShadow(state, false, true); }
+BENCHMARK("BVH shadow rays with Traverse 8-wide (64K boxes)") { BenchBvhShadow(state, true, false); }
+BENCHMARK("BVH shadow rays with Occluded 8-wide (64K boxes)") { BenchBvhShadow(state, true, true); }
+
+BENCHMARK("BVH shadow ray batch with Occluded (64K boxes)") {
+    BenchBvhScene* scene = (BenchBvhScene*) malloc(sizeof(BenchBvhScene));
+    BenchBvhSceneCreate(scene);
+    BenchBvhShadowRays(scene->rays, TC_BENCH_BVH_RAY_COUNT);
+    bool occluded[TC_BENCH_BVH_RAY_COUNT];
+
+    state->items = TC_BENCH_BVH_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        Occluded(&scene->bvh, scene->rays, TC_BENCH_BVH_RAY_COUNT, occluded, [&](U32, U32 primitive, const RaySlab& ray) {
+            return Intersect(ray, scene->boxes[primitive]);
+        });
+        BenchUse(occluded);
+    }
+    BenchStop(state);
+
+    BvhFree(&scene->bvh);
+    free(scene->boxes);
+    free(scene);
+}
+
+BENCHMARK("BVH refit (1M boxes)") {
+    Box3* boxes = BenchBvhBoxes(TC_BENCH_BVH_PRIMITIVE_COUNT);
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, TC_BENCH_BVH_PRIMITIVE_COUNT);
+    state->items = TC_BENCH_BVH_PRIMITIVE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        BvhRefit(&bvh, boxes);
+        BenchUse(bvh.nodes);
+    }
+    BenchStop(state);
+
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+#define TC_BENCH_BVH_LAYOUT_RAY_COUNT 4096
+
+// One large tree shared by the layout benchmarks and reordered in place
+// between them, since building it dominates a run. Incoherent rays from
+// random points inside the boxes' extent miss the cache on most nodes.
+struct BenchBvhLayoutScene {
+    Box3* boxes;
+    Bvh bvh;
+    S32 layout;
+    RaySlab rays[TC_BENCH_BVH_LAYOUT_RAY_COUNT];
+};
+
+TC_GLOBAL BenchBvhLayoutScene* benchBvhLayoutScene;
+
+// layout is a BvhLayout, or -1 for the order the builder left the nodes in
+static void BenchBvhLayout(BenchState* state, S32 layout) {
+    BenchBvhLayoutScene* scene = benchBvhLayoutScene;
+    if (!scene) {
+        scene = (BenchBvhLayoutScene*) malloc(sizeof(BenchBvhLayoutScene));
+        scene->boxes = BenchBvhBoxes(TC_BENCH_BVH_PRIMITIVE_COUNT);
+        BvhBuild(&scene->bvh, scene->boxes, 0, TC_BENCH_BVH_PRIMITIVE_COUNT);
+        scene->layout = -1;
+        U32 random = 3;
+        for (U32 i = 0; i < TC_BENCH_BVH_LAYOUT_RAY_COUNT; ++i) {
+            F32 v[6];
+            for (int k = 0; k < 6; ++k) {
+                v[k] = RandomF32(&random);
+            }
+            Vec3 origin = {v[0] * 100.0f, v[1] * 100.0f, v[2] * 100.0f};
+            scene->rays[i] = Precompute(Ray{origin, {v[3] - 0.5f, v[4] - 0.5f, v[5] - 0.5f}, 0.0f, F32Infinity()});
+        }
+        benchBvhLayoutScene = scene;
+    }
+    if (layout < 0 && scene->layout >= 0) {
+        BvhFree(&scene->bvh);
+        BvhBuild(&scene->bvh, scene->boxes, 0, TC_BENCH_BVH_PRIMITIVE_COUNT);
+    }
+    else if (layout >= 0 && layout != scene->layout) {
+        BvhReorder(&scene->bvh, BvhLayout(layout));
+    }
+    scene->layout = layout;
+
+    state->items = TC_BENCH_BVH_LAYOUT_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_BVH_LAYOUT_RAY_COUNT; ++r) {
+            F32 nearest = F32Infinity();
+            Traverse(&scene->bvh, scene->rays[r], [&](U32 primitive, RaySlab* ray) {
+                F32 entry, exit;
+                if (Intersect(*ray, scene->boxes[primitive], &entry, &exit) && entry < nearest) {
+                    nearest = entry;
+                    ray->tMax = entry;
+                }
+                return true;
+            });
+            BenchUse(&nearest);
+        }
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("BVH layout as built (1M boxes)") { BenchBvhLayout(state, -1); }
+BENCHMARK("BVH layout depth first (1M boxes)") { BenchBvhLayout(state, BVH_LAYOUT_DEPTH_FIRST); }
+BENCHMARK("BVH layout breadth first (1M boxes)") { BenchBvhLayout(state, BVH_LAYOUT_BREADTH_FIRST); }
+BENCHMARK("BVH layout clustered (1M boxes)") { BenchBvhLayout(state, BVH_LAYOUT_CLUSTERED); }
+
+BENCHMARK("BVH reorder clustered (1M boxes)") {
+    Box3* boxes = BenchBvhBoxes(TC_BENCH_BVH_PRIMITIVE_COUNT);
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, TC_BENCH_BVH_PRIMITIVE_COUNT);
+    state->items = TC_BENCH_BVH_PRIMITIVE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        BvhReorder(&bvh, BVH_LAYOUT_CLUSTERED);
+    }
+    BenchStop(state);
+
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+#define TC_BENCH_BVH_TRIANGLE_COUNT (256 * 1024)
+
+// Long thin triangles running diagonally through the scene, like beams and
+// cables in architectural models
+static Vec3* BenchBvhTriangles() {
+    Vec3* positions = (Vec3*) malloc(3 * TC_BENCH_BVH_TRIANGLE_COUNT * sizeof(Vec3));
+    U32 state = 17;
+    for (U32 i = 0; i < TC_BENCH_BVH_TRIANGLE_COUNT; ++i) {
+        F32 v[7];
+        for (int k = 0; k < 7; ++k) {
+            v[k] = RandomF32(&state);
+        }
+        Vec3 p = {v[0] * 100.0f, v[1] * 100.0f, v[2] * 100.0f};
+        positions[3 * i + 0] = p;
+        positions[3 * i + 1] = p + Vec3{1, 1, 0.5f} * (2.0f + v[3] * 6.0f);
+        positions[3 * i + 2] = p + Vec3{v[4], v[5], v[6]};
+    }
+    return positions;
+}
+
+static void BenchBvhTriangleTraverse(BenchState* state, BvhBuildQuality quality) {
+    Vec3* positions = BenchBvhTriangles();
+    BvhBuildOptions options;
+    options.quality = quality;
+    Bvh bvh;
+    BvhBuildStats stats;
+    BvhBuildTriangles(&bvh, positions, 0, TC_BENCH_BVH_TRIANGLE_COUNT, options, &stats);
+
+    TC_GLOBAL U32 reported = 0;
+    if (!(reported & (1u << quality))) {
+        reported |= 1u << quality;
+        printf("    build %.3f s, SAH cost %.2f, %u references, %u spatial splits\n", stats.seconds, stats.sahCost, stats.referenceCount, stats.spatialSplitCount);
+    }
+
+    Vec3 directions[TC_BENCH_BVH_RAY_COUNT];
+    RaySlab rays[TC_BENCH_BVH_RAY_COUNT];
+    U32 random = 9;
+    for (U32 i = 0; i < TC_BENCH_BVH_RAY_COUNT; ++i) {
+        F32 v[3];
+        for (int k = 0; k < 3; ++k) {
+            v[k] = RandomF32(&random) - 0.5f;
+        }
+        directions[i] = {v[0], v[1], v[2]};
+        rays[i] = Precompute(Ray{{50, 50, 50}, directions[i], 0.0f, F32Infinity()});
+    }
+
+    state->items = TC_BENCH_BVH_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_BVH_RAY_COUNT; ++r) {
+            Traverse(&bvh, rays[r], [&](U32 primitive, RaySlab* ray) {
+                const Vec3* corners = positions + 3 * primitive;
+                F32 t, u, v;
+                if (MollerTrumbore(Ray{ray->origin, directions[r], ray->tMin, ray->tMax}, Triangle{corners[0], corners[1], corners[2]}, &t, &u, &v)) {
+                    ray->tMax = t;
+                }
+                return true;
+            });
+        }
+    }
+    BenchStop(state);
+
+    BvhFree(&bvh);
+    free(positions);
+}
+
+BENCHMARK("BVH traversal object splits (256K long triangles)") {
+    BenchBvhTriangleTraverse(state, BVH_BUILD_QUALITY_HIGH);
+}
+
+BENCHMARK("BVH traversal spatial splits (256K long triangles)") {
+    BenchBvhTriangleTraverse(state, BVH_BUILD_QUALITY_SPATIAL);
+}
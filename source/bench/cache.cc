@@ -0,0 +1,88 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/cache.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TC_BENCH_CACHE_TRIANGLE_COUNT (1024 * 1024)
+#define TC_BENCH_CACHE_PATH "teacup_bench_bvh.cache"
+
+static Vec3* BenchCacheTriangles(U32 count) {
+    Vec3* positions = (Vec3*) malloc(3 * U64(count) * sizeof(Vec3));
+    U32 state = 9;
+    for (U64 i = 0; i < 3 * U64(count); i += 3) {
+        F32 v[5];
+        for (int k = 0; k < 5; ++k) {
+            v[k] = RandomF32(&state);
+        }
+        Vec3 p = {v[0] * 100.0f, v[1] * 100.0f, v[2] * 100.0f};
+        positions[i + 0] = p;
+        positions[i + 1] = p + Vec3{v[3], 0, 0};
+        positions[i + 2] = p + Vec3{0, v[4], v[3]};
+    }
+    return positions;
+}
+
+// Startup cost with a cache hit: hashing the input to find the key, then
+// mapping and validating the file. Node pages are read in on first touch, so
+// the sum over all nodes stands in for the first frame's traversal.
+BENCHMARK("BVH cache load (1M triangles)") {
+    Vec3* positions = BenchCacheTriangles(TC_BENCH_CACHE_TRIANGLE_COUNT);
+    BvhBuildOptions options;
+    Bvh bvh;
+    BvhBuildStats stats;
+    BvhBuildTriangles(&bvh, positions, 0, TC_BENCH_CACHE_TRIANGLE_COUNT, options, &stats);
+    U64 key = BvhCacheKey(positions, 3 * TC_BENCH_CACHE_TRIANGLE_COUNT, 0, TC_BENCH_CACHE_TRIANGLE_COUNT, options);
+    if (!BvhCacheWrite(TC_BENCH_CACHE_PATH, key, &bvh, positions)) {
+        printf("    failed to write %s\n", TC_BENCH_CACHE_PATH);
+        BvhFree(&bvh);
+        free(positions);
+        return;
+    }
+
+    TC_GLOBAL bool reported = false;
+    if (!reported) {
+        reported = true;
+        printf("    %.1f ms to build\n", stats.seconds * 1000.0);
+    }
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        U64 loadKey = BvhCacheKey(positions, 3 * TC_BENCH_CACHE_TRIANGLE_COUNT, 0, TC_BENCH_CACHE_TRIANGLE_COUNT, options);
+        BvhCache cache;
+        if (BvhCacheLoad(TC_BENCH_CACHE_PATH, loadKey, &cache)) {
+            U32 sum = 0;
+            for (U32 n = 0; n < cache.bvh.nodeCount; ++n) {
+                sum += cache.bvh.nodes[n].count;
+            }
+            BenchUse(&sum);
+        }
+        BvhCacheClose(&cache);
+    }
+    BenchStop(state);
+
+    remove(TC_BENCH_CACHE_PATH);
+    BvhFree(&bvh);
+    free(positions);
+}
@@ -0,0 +1,108 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/fastmath.h>
+
+#define TC_BENCH_ANGLE_COUNT 4096
+
+static void BenchAngles(F32* angles, U32 count) {
+    U32 state = 1;
+    for (U32 i = 0; i < count; ++i) {
+        angles[i] = RandomF32(&state) * (4.0f * TC_PI_F32) - 2.0f * TC_PI_F32;
+    }
+}
+
+BENCHMARK("Sin (libm)") {
+    alignas(32) F32 angles[TC_BENCH_ANGLE_COUNT];
+    alignas(32) F32 out[TC_BENCH_ANGLE_COUNT];
+    BenchAngles(angles, TC_BENCH_ANGLE_COUNT);
+    state->items = TC_BENCH_ANGLE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_ANGLE_COUNT; ++k) {
+            out[k] = Sin(angles[k]);
+        }
+        BenchUse(out);
+    }
+    BenchStop(state);
+}
+
+template <MathAccuracy A, typename T>
+static void BenchFastSin(BenchState* state) {
+    alignas(32) F32 angles[TC_BENCH_ANGLE_COUNT];
+    alignas(32) F32 out[TC_BENCH_ANGLE_COUNT];
+    BenchAngles(angles, TC_BENCH_ANGLE_COUNT);
+    state->items = TC_BENCH_ANGLE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_ANGLE_COUNT; k += TC_LANES(T)) {
+            Store(out + k, FastSin<A>(Load<T>(angles + k)));
+        }
+        BenchUse(out);
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("FastSin high") { BenchFastSin<MATH_ACCURACY_HIGH, F32>(state); }
+BENCHMARK("FastSin high x4") { BenchFastSin<MATH_ACCURACY_HIGH, F32x4>(state); }
+BENCHMARK("FastSin high x8") { BenchFastSin<MATH_ACCURACY_HIGH, F32x8>(state); }
+BENCHMARK("FastSin low x8") { BenchFastSin<MATH_ACCURACY_LOW, F32x8>(state); }
+
+BENCHMARK("Pow (libm)") {
+    alignas(32) F32 bases[TC_BENCH_ANGLE_COUNT];
+    alignas(32) F32 out[TC_BENCH_ANGLE_COUNT];
+    BenchAngles(bases, TC_BENCH_ANGLE_COUNT);
+    state->items = TC_BENCH_ANGLE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_ANGLE_COUNT; ++k) {
+            out[k] = Pow(Abs(bases[k]), 2.2f);
+        }
+        BenchUse(out);
+    }
+    BenchStop(state);
+}
+
+template <MathAccuracy A, typename T>
+static void BenchFastPow(BenchState* state) {
+    alignas(32) F32 bases[TC_BENCH_ANGLE_COUNT];
+    alignas(32) F32 out[TC_BENCH_ANGLE_COUNT];
+    BenchAngles(bases, TC_BENCH_ANGLE_COUNT);
+    state->items = TC_BENCH_ANGLE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_ANGLE_COUNT; k += TC_LANES(T)) {
+            Store(out + k, FastPow<A>(Abs(Load<T>(bases + k)), Splat<T>(2.2f)));
+        }
+        BenchUse(out);
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("FastPow high") { BenchFastPow<MATH_ACCURACY_HIGH, F32>(state); }
+BENCHMARK("FastPow high x8") { BenchFastPow<MATH_ACCURACY_HIGH, F32x8>(state); }
+BENCHMARK("FastPow low x8") { BenchFastPow<MATH_ACCURACY_LOW, F32x8>(state); }
@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/kernels.h>
+#include <stdlib.h>
+
+#define TC_BENCH_KERNEL_MATRIX_COUNT 1024
+#define TC_BENCH_KERNEL_BOX_COUNT (64 * 1024)
+
+static void BenchMultiplyMat4s(BenchState* state, CpuTier tier) {
+    const Kernels* kernels = KernelsGet(tier);
+    if (!kernels) {
+        BenchStart(state);
+        BenchStop(state);
+        return;
+    }
+
+    Mat4* mats = (Mat4*) malloc(3 * TC_BENCH_KERNEL_MATRIX_COUNT * sizeof(Mat4));
+    U32 seed = 3;
+    for (U32 i = 0; i < 2 * TC_BENCH_KERNEL_MATRIX_COUNT; ++i) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                mats[i].raw[r][c] = RandomF32(&seed);
+            }
+        }
+    }
+    Mat4* a = mats;
+    Mat4* b = mats + TC_BENCH_KERNEL_MATRIX_COUNT;
+    Mat4* out = mats + 2 * TC_BENCH_KERNEL_MATRIX_COUNT;
+    state->items = TC_BENCH_KERNEL_MATRIX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        kernels->multiplyMat4s(a, b, out, TC_BENCH_KERNEL_MATRIX_COUNT);
+        BenchUse(out);
+    }
+    BenchStop(state);
+    free(mats);
+}
+
+// Boxes scattered in the unit cube against a query covering about 10% of them
+static void BenchOverlapBoxes(BenchState* state, CpuTier tier) {
+    const Kernels* kernels = KernelsGet(tier);
+    if (!kernels) {
+        BenchStart(state);
+        BenchStop(state);
+        return;
+    }
+
+    Box3* boxes = (Box3*) malloc(TC_BENCH_KERNEL_BOX_COUNT * sizeof(Box3));
+    U32* hits = (U32*) malloc(TC_BENCH_KERNEL_BOX_COUNT * sizeof(U32));
+    U32 seed = 5;
+    for (U32 i = 0; i < TC_BENCH_KERNEL_BOX_COUNT; ++i) {
+        Vec3 p = {RandomF32(&seed), RandomF32(&seed), RandomF32(&seed)};
+        boxes[i] = {p, p + Vec3{0.05f, 0.05f, 0.05f}};
+    }
+    Box3 query = {{0.25f, 0.25f, 0.25f}, {0.7f, 0.7f, 0.7f}};
+    state->items = TC_BENCH_KERNEL_BOX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        U64 count = kernels->overlapBoxes(boxes, TC_BENCH_KERNEL_BOX_COUNT, query, hits);
+        BenchUse(&count);
+    }
+    BenchStop(state);
+    free(boxes);
+    free(hits);
+}
+
+BENCHMARK("Kernel Mat4 multiply (baseline)") { BenchMultiplyMat4s(state, CPU_TIER_BASELINE); }
+BENCHMARK("Kernel Mat4 multiply (AVX2)") { BenchMultiplyMat4s(state, CPU_TIER_AVX2); }
+BENCHMARK("Kernel Mat4 multiply (AVX-512)") { BenchMultiplyMat4s(state, CPU_TIER_AVX512); }
+BENCHMARK("Kernel box overlaps (baseline)") { BenchOverlapBoxes(state, CPU_TIER_BASELINE); }
+BENCHMARK("Kernel box overlaps (AVX2)") { BenchOverlapBoxes(state, CPU_TIER_AVX2); }
+BENCHMARK("Kernel box overlaps (AVX-512)") { BenchOverlapBoxes(state, CPU_TIER_AVX512); }
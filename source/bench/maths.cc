@@ -0,0 +1,203 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/maths.h>
+
+#define TC_BENCH_MATRIX_COUNT 1024
+
+// Gauss-Jordan elimination with full pivoting, the implementation Inverse used
+// before the closed-form version. Kept as a baseline to measure against.
+// https://github.com/mmp/pbrt-v3/blob/aaa552a4b9cbf9dccb71450f47b268e0ed6370e2/src/core/transform.cpp#L82
+static Mat4 InverseGaussJordan(Mat4 a) {
+    S32 indxc[4] = {0, 0, 0, 0};
+    S32 indxr[4] = {0, 0, 0, 0};
+    S32 ipiv[4] = {0, 0, 0, 0};
+    F32 temp = 0;
+    Mat4 mat = a;
+
+    for (S32 i = 0; i < 4; i++) {
+        S32 irow = 0;
+        S32 icol = 0;
+        F32 big = 0;
+
+        for (S32 j = 0; j < 4; j++) {
+            if (ipiv[j] != 1) {
+                for (S32 k = 0; k < 4; k++) {
+                    if (ipiv[k] == 0) {
+                        if (Abs(mat.raw[j][k]) >= big) {
+                            big = F32(Abs(mat.raw[j][k]));
+                            irow = j;
+                            icol = k;
+                        }
+                    }
+                }
+            }
+        }
+
+        ++ipiv[icol];
+
+        if (irow != icol) {
+            for (S32 k = 0; k < 4; ++k) {
+                temp = mat.raw[irow][k];
+                mat.raw[irow][k] = mat.raw[icol][k];
+                mat.raw[icol][k] = temp;
+            }
+        }
+
+        indxr[i] = irow;
+        indxc[i] = icol;
+
+        F32 pivinv = 1.0f / mat.raw[icol][icol];
+        mat.raw[icol][icol] = 1.0f;
+
+        for (S32 j = 0; j < 4; j++) {
+            mat.raw[icol][j] *= pivinv;
+        }
+
+        for (S32 j = 0; j < 4; j++) {
+            if (j != icol) {
+                F32 save = mat.raw[j][icol];
+                mat.raw[j][icol] = 0;
+
+                for (S32 k = 0; k < 4; k++) {
+                    mat.raw[j][k] -= mat.raw[icol][k] * save;
+                }
+            }
+        }
+    }
+
+    for (S32 j = 3; j >= 0; j--) {
+        if (indxr[j] != indxc[j]) {
+            for (S32 k = 0; k < 4; k++) {
+                temp = mat.raw[k][indxr[j]];
+                mat.raw[k][indxr[j]] = mat.raw[k][indxc[j]];
+                mat.raw[k][indxc[j]] = temp;
+            }
+        }
+    }
+
+    return mat;
+}
+
+// Random rotation, scale and translation, invertible by construction
+static void BenchAffineMatrices(Mat4* mats, U32 count) {
+    U32 state = 1;
+    for (U32 i = 0; i < count; ++i) {
+        F32 v[7];
+        for (int k = 0; k < 7; ++k) {
+            v[k] = RandomF32(&state);
+        }
+
+        Quat q = Normalize(Quat{v[0] - 0.5f, v[1] - 0.5f, v[2] - 0.5f, v[3] - 0.5f});
+        F32 s = 0.5f + v[4];
+        F32 xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+        F32 xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+        F32 wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+
+        mats[i] = {
+            s*(1 - 2*(yy + zz)), s*(2*(xy - wz)), s*(2*(xz + wy)), 10*v[4],
+            s*(2*(xy + wz)), s*(1 - 2*(xx + zz)), s*(2*(yz - wx)), 10*v[5],
+            s*(2*(xz - wy)), s*(2*(yz + wx)), s*(1 - 2*(xx + yy)), 10*v[6],
+            0, 0, 0, 1
+        };
+    }
+}
+
+BENCHMARK("Mat4 multiply") {
+    Mat4 mats[TC_BENCH_MATRIX_COUNT];
+    BenchAffineMatrices(mats, TC_BENCH_MATRIX_COUNT);
+    state->items = TC_BENCH_MATRIX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        Mat4 acc = Mat4Identity();
+        for (U32 k = 0; k < TC_BENCH_MATRIX_COUNT; ++k) {
+            acc = mats[k] * acc;
+        }
+        BenchUse(&acc);
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("Mat4 transpose") {
+    Mat4 mats[TC_BENCH_MATRIX_COUNT];
+    BenchAffineMatrices(mats, TC_BENCH_MATRIX_COUNT);
+    state->items = TC_BENCH_MATRIX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_MATRIX_COUNT; ++k) {
+            mats[k] = Transpose(mats[k]);
+        }
+        BenchUse(mats);
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("Mat4 inverse (Gauss-Jordan baseline)") {
+    Mat4 mats[TC_BENCH_MATRIX_COUNT];
+    Mat4 out[TC_BENCH_MATRIX_COUNT];
+    BenchAffineMatrices(mats, TC_BENCH_MATRIX_COUNT);
+    state->items = TC_BENCH_MATRIX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_MATRIX_COUNT; ++k) {
+            out[k] = InverseGaussJordan(mats[k]);
+        }
+        BenchUse(out);
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("Mat4 inverse") {
+    Mat4 mats[TC_BENCH_MATRIX_COUNT];
+    Mat4 out[TC_BENCH_MATRIX_COUNT];
+    BenchAffineMatrices(mats, TC_BENCH_MATRIX_COUNT);
+    state->items = TC_BENCH_MATRIX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_MATRIX_COUNT; ++k) {
+            out[k] = Inverse(mats[k]);
+        }
+        BenchUse(out);
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("Mat4 inverse affine") {
+    Mat4 mats[TC_BENCH_MATRIX_COUNT];
+    Mat4 out[TC_BENCH_MATRIX_COUNT];
+    BenchAffineMatrices(mats, TC_BENCH_MATRIX_COUNT);
+    state->items = TC_BENCH_MATRIX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_MATRIX_COUNT; ++k) {
+            out[k] = InverseAffine(mats[k]);
+        }
+        BenchUse(out);
+    }
+    BenchStop(state);
+}
@@ -0,0 +1,141 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/motion.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TC_BENCH_MOTION_BOX_COUNT (64 * 1024)
+#define TC_BENCH_MOTION_SEGMENT_COUNT 2
+#define TC_BENCH_MOTION_RAY_COUNT 1024
+
+// Boxes moving up to a few times their size over the shutter, traversed by
+// rays spread over the shutter interval
+BENCHMARK("Motion BVH traversal (64K moving boxes)") {
+    const U32 keyCount = TC_BENCH_MOTION_SEGMENT_COUNT + 1;
+    Box3* bounds = (Box3*) malloc(TC_BENCH_MOTION_BOX_COUNT * keyCount * sizeof(Box3));
+    U32 random = 5;
+    for (U32 i = 0; i < TC_BENCH_MOTION_BOX_COUNT; ++i) {
+        Vec3 p = {RandomF32(&random) * 100, RandomF32(&random) * 100, RandomF32(&random) * 100};
+        Vec3 velocity = Vec3{RandomF32(&random) - 0.5f, RandomF32(&random) - 0.5f, RandomF32(&random) - 0.5f} * 2.0f;
+        for (U32 k = 0; k < keyCount; ++k) {
+            Vec3 q = p + velocity * (F32(k) / F32(TC_BENCH_MOTION_SEGMENT_COUNT));
+            bounds[i * keyCount + k] = {q, q + Vec3{0.5f, 0.5f, 0.5f}};
+        }
+    }
+    MotionBvh bvh;
+    MotionBvhBuild(&bvh, bounds, TC_BENCH_MOTION_BOX_COUNT, TC_BENCH_MOTION_SEGMENT_COUNT);
+
+    RaySlab rays[TC_BENCH_MOTION_RAY_COUNT];
+    F32 times[TC_BENCH_MOTION_RAY_COUNT];
+    for (U32 i = 0; i < TC_BENCH_MOTION_RAY_COUNT; ++i) {
+        Vec3 direction = {RandomF32(&random) - 0.5f, RandomF32(&random) - 0.5f, RandomF32(&random) - 0.5f};
+        rays[i] = Precompute(Ray{{50, 50, 50}, direction, 0.0f, F32Infinity()});
+        times[i] = RandomF32(&random);
+    }
+
+    state->items = TC_BENCH_MOTION_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_MOTION_RAY_COUNT; ++r) {
+            F32 fraction;
+            U32 segment = MotionSegment(TC_BENCH_MOTION_SEGMENT_COUNT, times[r], &fraction);
+            F32 nearest = F32Infinity();
+            Traverse(&bvh, rays[r], times[r], [&](U32 primitive, RaySlab* ray) {
+                const Box3* keys = bounds + primitive * keyCount + segment;
+                Box3 box = {Lerp(keys[0].min, keys[1].min, fraction), Lerp(keys[0].max, keys[1].max, fraction)};
+                F32 entry, exit;
+                if (Intersect(*ray, box, &entry, &exit) && entry < nearest) {
+                    nearest = entry;
+                    ray->tMax = entry;
+                }
+                return true;
+            });
+            BenchUse(&nearest);
+        }
+    }
+    BenchStop(state);
+
+    MotionBvhFree(&bvh);
+    free(bounds);
+}
+
+#define TC_BENCH_MOTION_INSTANCE_COUNT (16 * 1024)
+
+BENCHMARK("Motion TLAS traversal (16K rotating instances)") {
+    U32 random = 7;
+    Box3* boxes = (Box3*) malloc(1024 * sizeof(Box3));
+    for (U32 i = 0; i < 1024; ++i) {
+        Vec3 p = {RandomF32(&random) * 4 - 2, RandomF32(&random) * 4 - 2, RandomF32(&random) * 4 - 2};
+        boxes[i] = {p, p + Vec3{0.1f, 0.1f, 0.1f}};
+    }
+    Bvh blas;
+    BvhBuild(&blas, boxes, 0, 1024);
+
+    TransformDecomposition* keys = (TransformDecomposition*) malloc(2 * TC_BENCH_MOTION_INSTANCE_COUNT * sizeof(TransformDecomposition));
+    MotionInstance* instances = (MotionInstance*) malloc(TC_BENCH_MOTION_INSTANCE_COUNT * sizeof(MotionInstance));
+    for (U32 i = 0; i < TC_BENCH_MOTION_INSTANCE_COUNT; ++i) {
+        Vec3 p = {RandomF32(&random) * 500, 0, RandomF32(&random) * 500};
+        F32 yaw = RandomF32(&random) * 6.0f;
+        for (U32 k = 0; k < 2; ++k) {
+            F32 angle = 0.5f * (yaw + F32(k) * 0.5f);
+            keys[2 * i + k] = {p + Vec3{F32(k), 0, 0}, Quat{0, Sin(angle), 0, Cos(angle)}, Mat4Identity()};
+        }
+        instances[i] = {keys + 2 * i, 2, 0};
+    }
+    MotionTlas tlas;
+    MotionTlasBuild(&tlas, &blas, 1, instances, TC_BENCH_MOTION_INSTANCE_COUNT, 4);
+
+    Ray rays[TC_BENCH_MOTION_RAY_COUNT];
+    F32 times[TC_BENCH_MOTION_RAY_COUNT];
+    for (U32 i = 0; i < TC_BENCH_MOTION_RAY_COUNT; ++i) {
+        Vec3 target = {RandomF32(&random) * 500, 0, RandomF32(&random) * 500};
+        Vec3 origin = {250, 30, -50};
+        rays[i] = {origin, target - origin, 0.0f, F32Infinity()};
+        times[i] = RandomF32(&random);
+    }
+
+    state->items = TC_BENCH_MOTION_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_MOTION_RAY_COUNT; ++r) {
+            F32 nearest = F32Infinity();
+            Traverse(&tlas, rays[r], times[r], [&](U32, U32 primitive, const Ray&, RaySlab* slab) {
+                F32 entry, exit;
+                if (Intersect(*slab, boxes[primitive], &entry, &exit) && entry < nearest) {
+                    nearest = entry;
+                    slab->tMax = entry;
+                }
+                return true;
+            });
+            BenchUse(&nearest);
+        }
+    }
+    BenchStop(state);
+
+    MotionTlasFree(&tlas);
+    free(instances);
+    free(keys);
+    BvhFree(&blas);
+    free(boxes);
+}
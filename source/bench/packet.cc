@@ -0,0 +1,149 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/packet.h>
+#include <stdlib.h>
+
+#define TC_BENCH_PACKET_BOX_COUNT (64 * 1024)
+#define TC_BENCH_PACKET_IMAGE_SIZE 256
+#define TC_BENCH_PACKET_RAY_COUNT (TC_BENCH_PACKET_IMAGE_SIZE * TC_BENCH_PACKET_IMAGE_SIZE)
+
+struct BenchPacketScene {
+    Box3* boxes;
+    Bvh bvh;
+    Ray* cameraRays;
+    Ray* randomRays;
+    RaySlab* cameraSlabs;
+    RaySlab* randomSlabs;
+};
+
+// Boxes filling a 100 unit cube, a pinhole camera looking at it from the
+// front, and as many rays scattered in every direction from inside it
+static BenchPacketScene* BenchPacketSceneGet() {
+    TC_GLOBAL BenchPacketScene* scene = 0;
+    if (scene) {
+        return scene;
+    }
+    scene = (BenchPacketScene*) malloc(sizeof(BenchPacketScene));
+    scene->boxes = (Box3*) malloc(TC_BENCH_PACKET_BOX_COUNT * sizeof(Box3));
+    U32 random = 31;
+    for (U32 i = 0; i < TC_BENCH_PACKET_BOX_COUNT; ++i) {
+        Vec3 p = {RandomF32(&random) * 100, RandomF32(&random) * 100, RandomF32(&random) * 100};
+        scene->boxes[i] = {p, p + Vec3{1, 1, 1}};
+    }
+    BvhBuild(&scene->bvh, scene->boxes, 0, TC_BENCH_PACKET_BOX_COUNT);
+
+    // Row by row, as an image is usually laid out
+    scene->cameraRays = (Ray*) malloc(TC_BENCH_PACKET_RAY_COUNT * sizeof(Ray));
+    scene->randomRays = (Ray*) malloc(TC_BENCH_PACKET_RAY_COUNT * sizeof(Ray));
+    for (U32 y = 0; y < TC_BENCH_PACKET_IMAGE_SIZE; ++y) {
+        for (U32 x = 0; x < TC_BENCH_PACKET_IMAGE_SIZE; ++x) {
+            Vec3 direction = {(F32(x) + 0.5f) / TC_BENCH_PACKET_IMAGE_SIZE - 0.5f, (F32(y) + 0.5f) / TC_BENCH_PACKET_IMAGE_SIZE - 0.5f, 1.0f};
+            scene->cameraRays[y * TC_BENCH_PACKET_IMAGE_SIZE + x] = {{50, 50, -50}, direction, 0.0f, F32Infinity()};
+        }
+    }
+    for (U32 i = 0; i < TC_BENCH_PACKET_RAY_COUNT; ++i) {
+        Vec3 origin = {RandomF32(&random) * 100, RandomF32(&random) * 100, RandomF32(&random) * 100};
+        Vec3 direction = {RandomF32(&random) - 0.5f, RandomF32(&random) - 0.5f, RandomF32(&random) - 0.5f};
+        scene->randomRays[i] = {origin, direction, 0.0f, F32Infinity()};
+    }
+
+    scene->cameraSlabs = (RaySlab*) malloc(TC_BENCH_PACKET_RAY_COUNT * sizeof(RaySlab));
+    scene->randomSlabs = (RaySlab*) malloc(TC_BENCH_PACKET_RAY_COUNT * sizeof(RaySlab));
+    for (U32 i = 0; i < TC_BENCH_PACKET_RAY_COUNT; ++i) {
+        scene->cameraSlabs[i] = Precompute(scene->cameraRays[i]);
+        scene->randomSlabs[i] = Precompute(scene->randomRays[i]);
+    }
+    return scene;
+}
+
+// Closest box hit for every ray of one set
+template <int N>
+static void BenchPacketStream(BenchState* state, bool camera, RayStreamMode mode) {
+    BenchPacketScene* scene = BenchPacketSceneGet();
+    const Ray* rays = camera ? scene->cameraRays : scene->randomRays;
+    const RaySlab* slabs = camera ? scene->cameraSlabs : scene->randomSlabs;
+    RayStreamOptions options;
+    options.mode = mode;
+
+    state->items = TC_BENCH_PACKET_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        TraverseStream<N>(&scene->bvh, rays, TC_BENCH_PACKET_RAY_COUNT, [&](U32 ray, U32 primitive, F32* tMax) {
+            RaySlab slab = slabs[ray];
+            slab.tMax = *tMax;
+            F32 entry, exit;
+            if (Intersect(slab, scene->boxes[primitive], &entry, &exit)) {
+                *tMax = entry;
+            }
+        }, options);
+    }
+    BenchStop(state);
+}
+
+// Single rays in the order they come, the baseline the stream modes improve on
+BENCHMARK("Ray stream camera rays unsorted single (64K boxes)") {
+    BenchPacketScene* scene = BenchPacketSceneGet();
+    state->items = TC_BENCH_PACKET_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_PACKET_RAY_COUNT; ++r) {
+            Traverse(&scene->bvh, scene->cameraSlabs[r], [&](U32 primitive, RaySlab* ray) {
+                F32 entry, exit;
+                if (Intersect(*ray, scene->boxes[primitive], &entry, &exit)) {
+                    ray->tMax = entry;
+                }
+                return true;
+            });
+        }
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("Ray stream camera rays single (64K boxes)") {
+    BenchPacketStream<8>(state, true, RAY_STREAM_SINGLE);
+}
+
+BENCHMARK("Ray stream camera rays 4-wide packets (64K boxes)") {
+    BenchPacketStream<4>(state, true, RAY_STREAM_PACKETS);
+}
+
+BENCHMARK("Ray stream camera rays 8-wide packets (64K boxes)") {
+    BenchPacketStream<8>(state, true, RAY_STREAM_PACKETS);
+}
+
+BENCHMARK("Ray stream camera rays auto (64K boxes)") {
+    BenchPacketStream<8>(state, true, RAY_STREAM_AUTO);
+}
+
+BENCHMARK("Ray stream random rays single (64K boxes)") {
+    BenchPacketStream<8>(state, false, RAY_STREAM_SINGLE);
+}
+
+BENCHMARK("Ray stream random rays 8-wide packets (64K boxes)") {
+    BenchPacketStream<8>(state, false, RAY_STREAM_PACKETS);
+}
+
+BENCHMARK("Ray stream random rays auto (64K boxes)") {
+    BenchPacketStream<8>(state, false, RAY_STREAM_AUTO);
+}
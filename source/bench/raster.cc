@@ -0,0 +1,128 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/raster.h>
+#include <stdlib.h>
+
+#define TC_BENCH_RASTER_GRID 256
+#define TC_BENCH_RASTER_SOUP (64 * 1024)
+#define TC_BENCH_RASTER_WIDTH 640
+#define TC_BENCH_RASTER_HEIGHT 360
+
+// Rolling terrain of 128K triangles under 64K small scattered triangles,
+// seen from just above the ground
+struct BenchRasterScene {
+    Vec3* positions;
+    U32* triangles;
+    U32 triangleCount;
+    Camera camera;
+};
+
+static void BenchRasterSceneCreate(BenchRasterScene* scene) {
+    U32 gridVertices = (TC_BENCH_RASTER_GRID + 1) * (TC_BENCH_RASTER_GRID + 1);
+    scene->triangleCount = 2 * TC_BENCH_RASTER_GRID * TC_BENCH_RASTER_GRID + TC_BENCH_RASTER_SOUP;
+    scene->positions = (Vec3*) malloc((gridVertices + 3 * TC_BENCH_RASTER_SOUP) * sizeof(Vec3));
+    scene->triangles = (U32*) malloc(3 * U64(scene->triangleCount) * sizeof(U32));
+
+    U32 random = 7;
+    Vec3* vertex = scene->positions;
+    U32* index = scene->triangles;
+    for (U32 j = 0; j <= TC_BENCH_RASTER_GRID; ++j) {
+        for (U32 i = 0; i <= TC_BENCH_RASTER_GRID; ++i) {
+            F32 x = F32(i) - TC_BENCH_RASTER_GRID * 0.5f;
+            F32 z = F32(j) - TC_BENCH_RASTER_GRID * 0.5f;
+            *vertex++ = {x, Sin(x * 0.1f) * Cos(z * 0.13f) * 4.0f, z};
+        }
+    }
+    for (U32 j = 0; j < TC_BENCH_RASTER_GRID; ++j) {
+        for (U32 i = 0; i < TC_BENCH_RASTER_GRID; ++i) {
+            U32 a = j * (TC_BENCH_RASTER_GRID + 1) + i;
+            U32 quad[6] = {a, a + 1, a + TC_BENCH_RASTER_GRID + 2, a, a + TC_BENCH_RASTER_GRID + 2, a + TC_BENCH_RASTER_GRID + 1};
+            for (U32 k = 0; k < 6; ++k) {
+                *index++ = quad[k];
+            }
+        }
+    }
+    for (U32 t = 0; t < TC_BENCH_RASTER_SOUP; ++t) {
+        Vec3 center = {(RandomF32(&random) - 0.5f) * TC_BENCH_RASTER_GRID, 4.0f + RandomF32(&random) * 4.0f, (RandomF32(&random) - 0.5f) * TC_BENCH_RASTER_GRID};
+        for (U32 k = 0; k < 3; ++k) {
+            *index++ = U32(vertex - scene->positions);
+            *vertex++ = center + Vec3{RandomF32(&random) - 0.5f, RandomF32(&random) - 0.5f, RandomF32(&random) - 0.5f};
+        }
+    }
+    scene->camera = CameraLookAt({-100, 12, -100}, {0, 0, 0}, {0, 1, 0}, 1.0f, TC_BENCH_RASTER_WIDTH, TC_BENCH_RASTER_HEIGHT);
+}
+
+static void BenchRasterSceneFree(BenchRasterScene* scene) {
+    free(scene->positions);
+    free(scene->triangles);
+}
+
+template <int N>
+static void BenchTracePrimary(BenchState* state) {
+    BenchRasterScene scene;
+    BenchRasterSceneCreate(&scene);
+    TriangleBvh<N> bvh;
+    BvhBuildOptions options;
+    options.maxLeafSize = N;
+    options.intersectionCost = 1.0f / N;
+    TriangleBvhBuild(&bvh, scene.positions, scene.triangles, scene.triangleCount, options);
+    TriangleHit* hits = (TriangleHit*) malloc(TC_BENCH_RASTER_WIDTH * TC_BENCH_RASTER_HEIGHT * sizeof(TriangleHit));
+
+    state->items = TC_BENCH_RASTER_WIDTH * TC_BENCH_RASTER_HEIGHT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        TracePrimary(&scene.camera, &bvh, hits);
+        BenchUse(hits);
+    }
+    BenchStop(state);
+
+    free(hits);
+    TriangleBvhFree(&bvh);
+    BenchRasterSceneFree(&scene);
+}
+
+BENCHMARK("Primary visibility traced, 4 wide packs (192K triangles)") {
+    BenchTracePrimary<4>(state);
+}
+
+BENCHMARK("Primary visibility traced, 8 wide packs (192K triangles)") {
+    BenchTracePrimary<8>(state);
+}
+
+BENCHMARK("Primary visibility rasterized (192K triangles)") {
+    BenchRasterScene scene;
+    BenchRasterSceneCreate(&scene);
+    TriangleHit* hits = (TriangleHit*) malloc(TC_BENCH_RASTER_WIDTH * TC_BENCH_RASTER_HEIGHT * sizeof(TriangleHit));
+
+    state->items = TC_BENCH_RASTER_WIDTH * TC_BENCH_RASTER_HEIGHT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        RasterizePrimary(&scene.camera, scene.positions, scene.triangles, scene.triangleCount, hits);
+        BenchUse(hits);
+    }
+    BenchStop(state);
+
+    free(hits);
+    BenchRasterSceneFree(&scene);
+}
@@ -0,0 +1,124 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/ray.h>
+#include <teacup/quantized.h>
+
+#define TC_BENCH_RAY_BOX_COUNT 4096
+#define TC_BENCH_RAY_COUNT 64
+
+static void BenchRayBoxes(Box3* boxes, RaySlab* rays) {
+    U32 seed = 7;
+    for (U32 i = 0; i < TC_BENCH_RAY_BOX_COUNT; ++i) {
+        Vec3 p = {RandomF32(&seed), RandomF32(&seed), RandomF32(&seed)};
+        boxes[i] = {p, p + Vec3{0.1f, 0.1f, 0.1f}};
+    }
+    for (U32 i = 0; i < TC_BENCH_RAY_COUNT; ++i) {
+        Vec3 d = {RandomF32(&seed) - 0.5f, RandomF32(&seed) - 0.5f, RandomF32(&seed) - 0.5f};
+        rays[i] = Precompute(Ray{{0.5f, 0.5f, 0.5f}, d, 0.0f, F32Infinity()});
+    }
+}
+
+BENCHMARK("Ray box slab test") {
+    Box3 boxes[TC_BENCH_RAY_BOX_COUNT];
+    RaySlab rays[TC_BENCH_RAY_COUNT];
+    BenchRayBoxes(boxes, rays);
+    state->items = TC_BENCH_RAY_BOX_COUNT * TC_BENCH_RAY_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        U32 hits = 0;
+        for (U32 r = 0; r < TC_BENCH_RAY_COUNT; ++r) {
+            for (U32 k = 0; k < TC_BENCH_RAY_BOX_COUNT; ++k) {
+                hits += Intersect(rays[r], boxes[k]);
+            }
+        }
+        BenchUse(&hits);
+    }
+    BenchStop(state);
+}
+
+template <typename T>
+static void BenchRayBoxPackets(BenchState* state) {
+    const int lanes = TC_LANES(T);
+    Box3 boxes[TC_BENCH_RAY_BOX_COUNT];
+    Box3Packet<T> packets[TC_BENCH_RAY_BOX_COUNT / 8 * (8 / TC_LANES(T))];
+    RaySlab rays[TC_BENCH_RAY_COUNT];
+    BenchRayBoxes(boxes, rays);
+    for (U32 k = 0; k < TC_BENCH_RAY_BOX_COUNT / lanes; ++k) {
+        packets[k] = Gather<T>(boxes + k * lanes);
+    }
+    state->items = TC_BENCH_RAY_BOX_COUNT * TC_BENCH_RAY_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        U32 hits = 0;
+        for (U32 r = 0; r < TC_BENCH_RAY_COUNT; ++r) {
+            for (U32 k = 0; k < TC_BENCH_RAY_BOX_COUNT / lanes; ++k) {
+                T tEntry, tExit;
+                hits += MoveMask(Intersect(rays[r], packets[k], &tEntry, &tExit));
+            }
+        }
+        BenchUse(&hits);
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("Ray box slab test x4") { BenchRayBoxPackets<F32x4>(state); }
+BENCHMARK("Ray box slab test x8") { BenchRayBoxPackets<F32x8>(state); }
+
+// Same boxes decoded from 8-bit planes, eight children per node
+template <typename T>
+static void BenchRayQuantizedBoxes(BenchState* state) {
+    const int lanes = TC_LANES(T);
+    Box3 boxes[TC_BENCH_RAY_BOX_COUNT];
+    QuantizedBoxes8 nodes[TC_BENCH_RAY_BOX_COUNT / 8];
+    RaySlab rays[TC_BENCH_RAY_COUNT];
+    BenchRayBoxes(boxes, rays);
+    for (U32 k = 0; k < TC_BENCH_RAY_BOX_COUNT / 8; ++k) {
+        Box3 parent = boxes[k * 8];
+        for (U32 i = 1; i < 8; ++i) {
+            parent = {Min(parent.min, boxes[k * 8 + i].min), Max(parent.max, boxes[k * 8 + i].max)};
+        }
+        Quantize(parent, boxes + k * 8, 8, nodes + k);
+    }
+    state->items = TC_BENCH_RAY_BOX_COUNT * TC_BENCH_RAY_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        U32 hits = 0;
+        for (U32 r = 0; r < TC_BENCH_RAY_COUNT; ++r) {
+            for (U32 k = 0; k < TC_BENCH_RAY_BOX_COUNT / 8; ++k) {
+                for (U32 first = 0; first < 8; first += lanes) {
+                    T tEntry, tExit;
+                    hits += MoveMask(Intersect(rays[r], nodes + k, first, &tEntry, &tExit));
+                }
+            }
+        }
+        BenchUse(&hits);
+    }
+    BenchStop(state);
+}
+
+BENCHMARK("Ray quantized box slab test x4") { BenchRayQuantizedBoxes<F32x4>(state); }
+BENCHMARK("Ray quantized box slab test x8") { BenchRayQuantizedBoxes<F32x8>(state); }
@@ -0,0 +1,62 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/sort.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TC_BENCH_SORT_COUNT (1024 * 1024)
+
+// Keys restore from a copy each iteration, which the timing includes
+template <typename K>
+static void BenchRadixSort(BenchState* state, U32 keyBits) {
+    K* source = (K*) malloc(TC_BENCH_SORT_COUNT * sizeof(K));
+    K* keys = (K*) malloc(TC_BENCH_SORT_COUNT * sizeof(K));
+    K* scratchKeys = (K*) malloc(TC_BENCH_SORT_COUNT * sizeof(K));
+    U32* values = (U32*) malloc(TC_BENCH_SORT_COUNT * sizeof(U32));
+    U32* scratchValues = (U32*) malloc(TC_BENCH_SORT_COUNT * sizeof(U32));
+    U64 seed = 3;
+    for (U32 i = 0; i < TC_BENCH_SORT_COUNT; ++i) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        source[i] = K(seed >> (64 - keyBits));
+        values[i] = i;
+    }
+    state->items = TC_BENCH_SORT_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        memcpy(keys, source, TC_BENCH_SORT_COUNT * sizeof(K));
+        RadixSort(keys, values, scratchKeys, scratchValues, TC_BENCH_SORT_COUNT, keyBits);
+        BenchUse(keys);
+    }
+    BenchStop(state);
+
+    free(source);
+    free(keys);
+    free(scratchKeys);
+    free(values);
+    free(scratchValues);
+}
+
+BENCHMARK("RadixSort 30-bit keys (1M)") { BenchRadixSort<U32>(state, 30); }
+BENCHMARK("RadixSort 63-bit keys (1M)") { BenchRadixSort<U64>(state, 63); }
@@ -0,0 +1,184 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/tlas.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TC_BENCH_TLAS_MESH_COUNT 16
+#define TC_BENCH_TLAS_BOX_COUNT (16 * 1024)
+#define TC_BENCH_TLAS_INSTANCE_COUNT (64 * 1024)
+#define TC_BENCH_TLAS_RAY_COUNT 1024
+#define TC_BENCH_TLAS_EDIT_COUNT 100
+
+// Random yaw and scale somewhere on a 1000 x 1000 plane
+static Transform BenchTlasPlacement(U32* random) {
+    F32 yaw = RandomF32(random) * 6.28f;
+    F32 s = 0.5f + RandomF32(random);
+    F32 c = Cos(yaw) * s;
+    F32 n = Sin(yaw) * s;
+    Mat4 mat = {
+        c, 0, n, RandomF32(random) * 1000,
+        0, s, 0, 0,
+        -n, 0, c, RandomF32(random) * 1000,
+        0, 0, 0, 1
+    };
+    return TransformFromMatrix(mat);
+}
+
+// A forest: a few meshes of unit-sized boxes scattered over a 1000 x 1000
+// plane with random yaw and scale
+BENCHMARK("TLAS traversal (64K instances of 16 meshes)") {
+    U32 random = 11;
+    Box3* boxes[TC_BENCH_TLAS_MESH_COUNT];
+    Bvh blases[TC_BENCH_TLAS_MESH_COUNT];
+    for (U32 m = 0; m < TC_BENCH_TLAS_MESH_COUNT; ++m) {
+        boxes[m] = (Box3*) malloc(TC_BENCH_TLAS_BOX_COUNT * sizeof(Box3));
+        for (U32 i = 0; i < TC_BENCH_TLAS_BOX_COUNT; ++i) {
+            Vec3 p = {RandomF32(&random) * 4 - 2, RandomF32(&random) * 10, RandomF32(&random) * 4 - 2};
+            boxes[m][i] = {p, p + Vec3{0.05f, 0.05f, 0.05f}};
+        }
+        BvhBuild(blases + m, boxes[m], 0, TC_BENCH_TLAS_BOX_COUNT);
+    }
+
+    Instance* instances = (Instance*) malloc(TC_BENCH_TLAS_INSTANCE_COUNT * sizeof(Instance));
+    for (U32 i = 0; i < TC_BENCH_TLAS_INSTANCE_COUNT; ++i) {
+        instances[i] = {BenchTlasPlacement(&random), i % TC_BENCH_TLAS_MESH_COUNT};
+    }
+    Tlas tlas;
+    TlasBuild(&tlas, blases, TC_BENCH_TLAS_MESH_COUNT, instances, TC_BENCH_TLAS_INSTANCE_COUNT);
+
+    Ray rays[TC_BENCH_TLAS_RAY_COUNT];
+    for (U32 i = 0; i < TC_BENCH_TLAS_RAY_COUNT; ++i) {
+        Vec3 target = {RandomF32(&random) * 1000, 0, RandomF32(&random) * 1000};
+        Vec3 origin = {500, 50, -100};
+        rays[i] = {origin, target - origin, 0.0f, F32Infinity()};
+    }
+
+    TC_GLOBAL bool reported = false;
+    if (!reported) {
+        reported = true;
+        U64 bytes = U64(TC_BENCH_TLAS_INSTANCE_COUNT) * sizeof(Instance) + U64(tlas.bvh.nodeCount) * sizeof(BvhNode) + U64(tlas.bvh.primitiveCount) * sizeof(U32);
+        printf("    %.1f MB for instances and TLAS, %.1f M instanced boxes\n", F64(bytes) / (1024 * 1024), F64(TC_BENCH_TLAS_INSTANCE_COUNT) * TC_BENCH_TLAS_BOX_COUNT / 1e6);
+    }
+
+    state->items = TC_BENCH_TLAS_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_TLAS_RAY_COUNT; ++r) {
+            F32 nearest = F32Infinity();
+            Traverse(&tlas, rays[r], [&](U32 instance, U32 primitive, const Ray&, RaySlab* slab) {
+                F32 entry, exit;
+                if (Intersect(*slab, boxes[instances[instance].blas][primitive], &entry, &exit) && entry < nearest) {
+                    nearest = entry;
+                    slab->tMax = entry;
+                }
+                return true;
+            });
+            BenchUse(&nearest);
+        }
+    }
+    BenchStop(state);
+
+    TlasFree(&tlas);
+    free(instances);
+    for (U32 m = 0; m < TC_BENCH_TLAS_MESH_COUNT; ++m) {
+        BvhFree(blases + m);
+        free(boxes[m]);
+    }
+}
+
+// One mesh per placement is enough here, only the root boxes matter
+static void BenchTlasEdits(BenchState* state, bool dynamic) {
+    U32 random = 11;
+    Box3 boxes[TC_BENCH_TLAS_MESH_COUNT];
+    Bvh blases[TC_BENCH_TLAS_MESH_COUNT];
+    for (U32 m = 0; m < TC_BENCH_TLAS_MESH_COUNT; ++m) {
+        boxes[m] = {{-2, 0, -2}, {2, 10, 2}};
+        BvhBuild(blases + m, boxes + m, 0, 1);
+    }
+    Instance* instances = (Instance*) malloc(TC_BENCH_TLAS_INSTANCE_COUNT * sizeof(Instance));
+    for (U32 i = 0; i < TC_BENCH_TLAS_INSTANCE_COUNT; ++i) {
+        instances[i] = {BenchTlasPlacement(&random), i % TC_BENCH_TLAS_MESH_COUNT};
+    }
+
+    // Each frame a few instances nudge, one jumps across the scene and one
+    // is swapped for a new one
+    DynamicTlas tlas;
+    DynamicTlasBuild(&tlas, blases, TC_BENCH_TLAS_MESH_COUNT, instances, TC_BENCH_TLAS_INSTANCE_COUNT);
+    state->items = TC_BENCH_TLAS_EDIT_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 e = 0; e < TC_BENCH_TLAS_EDIT_COUNT - 3; ++e) {
+            U32 pick = U32(RandomF32(&random) * TC_BENCH_TLAS_INSTANCE_COUNT);
+            Mat4 mat = instances[pick].transform.matrix;
+            mat.raw[0][3] += RandomF32(&random) - 0.5f;
+            mat.raw[2][3] += RandomF32(&random) - 0.5f;
+            instances[pick].transform = TransformFromMatrix(mat);
+            if (dynamic) {
+                DynamicTlasUpdate(&tlas, pick, instances[pick].transform);
+            }
+        }
+        U32 pick = U32(RandomF32(&random) * TC_BENCH_TLAS_INSTANCE_COUNT);
+        instances[pick].transform = BenchTlasPlacement(&random);
+        U32 removed = U32(RandomF32(&random) * TC_BENCH_TLAS_INSTANCE_COUNT);
+        instances[removed] = {BenchTlasPlacement(&random), (removed + 1) % TC_BENCH_TLAS_MESH_COUNT};
+        if (dynamic) {
+            DynamicTlasUpdate(&tlas, pick, instances[pick].transform);
+            DynamicTlasRemove(&tlas, removed);
+            DynamicTlasInsert(&tlas, instances[removed]);
+        }
+        else {
+            Tlas rebuilt;
+            TlasBuild(&rebuilt, blases, TC_BENCH_TLAS_MESH_COUNT, instances, TC_BENCH_TLAS_INSTANCE_COUNT);
+            BenchUse(rebuilt.bvh.nodes);
+            TlasFree(&rebuilt);
+        }
+    }
+    BenchStop(state);
+
+    TC_GLOBAL bool reported = false;
+    if (dynamic && !reported) {
+        reported = true;
+        BvhBuildOptions options;
+        options.maxLeafSize = 1;
+        Tlas built;
+        TlasBuild(&built, blases, TC_BENCH_TLAS_MESH_COUNT, tlas.instances, tlas.tlas.instanceCount, options);
+        printf("    SAH cost %.1f after the edits, %.1f for a full build\n", BvhSahCost(&tlas.tlas.bvh, options), BvhSahCost(&built.bvh, options));
+        TlasFree(&built);
+    }
+
+    DynamicTlasFree(&tlas);
+    free(instances);
+    for (U32 m = 0; m < TC_BENCH_TLAS_MESH_COUNT; ++m) {
+        BvhFree(blases + m);
+    }
+}
+
+BENCHMARK("TLAS edits, dynamic (64K instances, 100 per frame)") {
+    BenchTlasEdits(state, true);
+}
+
+BENCHMARK("TLAS edits, full rebuild (64K instances, 100 per frame)") {
+    BenchTlasEdits(state, false);
+}
@@ -0,0 +1,169 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/transform.h>
+#include <string.h>
+
+#define TC_BENCH_VERTEX_COUNT (4 * 1024 * 1024)
+
+static Vec3* BenchVertices() {
+    Vec3* vertices = (Vec3*) malloc(TC_BENCH_VERTEX_COUNT * sizeof(Vec3));
+    U32 state = 1;
+    for (U32 i = 0; i < TC_BENCH_VERTEX_COUNT; ++i) {
+        F32 v[3];
+        for (int k = 0; k < 3; ++k) {
+            v[k] = RandomF32(&state);
+        }
+        vertices[i] = {v[0], v[1], v[2]};
+    }
+    return vertices;
+}
+
+static Mat4 BenchMatrix() {
+    Mat4 mat = {
+        0.8f, -0.6f, 0.0f, 10.0f,
+        0.6f,  0.8f, 0.0f, 20.0f,
+        0.0f,  0.0f, 2.0f, 30.0f,
+        0.0f,  0.0f, 0.0f,  1.0f
+    };
+    return mat;
+}
+
+BENCHMARK("TransformPoint loop (4M vertices)") {
+    Vec3* in = BenchVertices();
+    Vec3* out = (Vec3*) malloc(TC_BENCH_VERTEX_COUNT * sizeof(Vec3));
+    Mat4 a = BenchMatrix();
+    memcpy(out, in, TC_BENCH_VERTEX_COUNT * sizeof(Vec3));
+    state->items = TC_BENCH_VERTEX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_VERTEX_COUNT; ++k) {
+            out[k] = TransformPoint(a, in[k]);
+        }
+        BenchUse(out);
+    }
+    BenchStop(state);
+
+    free(in);
+    free(out);
+}
+
+BENCHMARK("TransformPoints (4M vertices)") {
+    Vec3* in = BenchVertices();
+    Vec3* out = (Vec3*) malloc(TC_BENCH_VERTEX_COUNT * sizeof(Vec3));
+    Mat4 a = BenchMatrix();
+    memcpy(out, in, TC_BENCH_VERTEX_COUNT * sizeof(Vec3));
+    state->items = TC_BENCH_VERTEX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        TransformPoints(a, in, out, TC_BENCH_VERTEX_COUNT);
+        BenchUse(out);
+    }
+    BenchStop(state);
+
+    free(in);
+    free(out);
+}
+
+BENCHMARK("TransformPoints streaming (4M vertices)") {
+    Vec3* in = BenchVertices();
+    Vec3* out = (Vec3*) malloc(TC_BENCH_VERTEX_COUNT * sizeof(Vec3));
+    Mat4 a = BenchMatrix();
+    memcpy(out, in, TC_BENCH_VERTEX_COUNT * sizeof(Vec3));
+    state->items = TC_BENCH_VERTEX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        TransformPoints(a, in, out, TC_BENCH_VERTEX_COUNT, TRANSFORM_FLAGS_STREAM);
+        BenchUse(out);
+    }
+    BenchStop(state);
+
+    free(in);
+    free(out);
+}
+
+BENCHMARK("TransformPoints in place (4M vertices)") {
+    Vec3* in = BenchVertices();
+    Mat4 a = BenchMatrix();
+    state->items = TC_BENCH_VERTEX_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        TransformPoints(a, in, in, TC_BENCH_VERTEX_COUNT);
+        BenchUse(in);
+    }
+    BenchStop(state);
+
+    free(in);
+}
+
+#define TC_BENCH_INSTANCE_COUNT 4096
+
+// Object space rays for many instances, inverting each matrix per ray versus
+// reading the inverse cached in a Transform
+BENCHMARK("Ray to object space, Inverse per ray (4K instances)") {
+    Mat4* matrices = (Mat4*) malloc(TC_BENCH_INSTANCE_COUNT * sizeof(Mat4));
+    for (U32 k = 0; k < TC_BENCH_INSTANCE_COUNT; ++k) {
+        matrices[k] = BenchMatrix();
+        matrices[k].raw[0][3] = F32(k);
+    }
+    Ray ray = {{1, 2, 3}, {0.5f, 0.5f, 0.7f}, 0.0f, F32Infinity()};
+    state->items = TC_BENCH_INSTANCE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_INSTANCE_COUNT; ++k) {
+            Mat4 inverse = Inverse(matrices[k]);
+            Ray local = {TransformPoint(inverse, ray.origin), TransformVector(inverse, ray.direction), ray.tMin, ray.tMax};
+            BenchUse(&local);
+        }
+    }
+    BenchStop(state);
+
+    free(matrices);
+}
+
+BENCHMARK("Ray to object space, TransformAffine (4K instances)") {
+    TransformAffine* transforms = (TransformAffine*) malloc(TC_BENCH_INSTANCE_COUNT * sizeof(TransformAffine));
+    for (U32 k = 0; k < TC_BENCH_INSTANCE_COUNT; ++k) {
+        Mat4 a = BenchMatrix();
+        a.raw[0][3] = F32(k);
+        transforms[k] = Compact(TransformFromMatrix(a));
+    }
+    Ray ray = {{1, 2, 3}, {0.5f, 0.5f, 0.7f}, 0.0f, F32Infinity()};
+    state->items = TC_BENCH_INSTANCE_COUNT;
+
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_INSTANCE_COUNT; ++k) {
+            Ray local = InverseTransformRay(transforms[k], ray);
+            BenchUse(&local);
+        }
+    }
+    BenchStop(state);
+
+    free(transforms);
+}
@@ -0,0 +1,226 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <bench/bench.h>
+#include <teacup/triangle.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TC_BENCH_TRIANGLE_COUNT (256 * 1024)
+#define TC_BENCH_TRIANGLE_TEST_COUNT 4096
+#define TC_BENCH_TRIANGLE_RAY_COUNT 1024
+
+// Small triangles around random points of a 100 unit cube, three corners
+// each, in the order BvhBuildTriangles takes with null indices
+static Triangle* BenchTriangleScene(U32 count) {
+    Triangle* triangles = (Triangle*) malloc(count * sizeof(Triangle));
+    U32 random = 17;
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 p = RandomVec3(&random) * 100.0f;
+        Vec3 offset = {0.5f, 0.5f, 0.5f};
+        triangles[i] = {p, p + RandomVec3(&random) * 2.0f - offset, p + RandomVec3(&random) * 2.0f - offset};
+    }
+    return triangles;
+}
+
+static void BenchTriangleRays(Ray* rays, U32 count) {
+    U32 random = 23;
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 direction = RandomVec3(&random) - Vec3{0.5f, 0.5f, 0.5f};
+        rays[i] = {{50, 50, 50}, direction, 0.0f, F32Infinity()};
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// One ray against many triangles
+
+// One ray through the middle of a block of triangles, so about half of them
+// are hit and neither branch is predictable
+static Triangle* BenchTriangleBlock(Ray* ray) {
+    Triangle* triangles = (Triangle*) malloc(TC_BENCH_TRIANGLE_TEST_COUNT * sizeof(Triangle));
+    U32 random = 29;
+    for (U32 i = 0; i < TC_BENCH_TRIANGLE_TEST_COUNT; ++i) {
+        F32 z = RandomF32(&random) * 10.0f + 1.0f;
+        Vec3 a = {RandomF32(&random) - 1.0f, RandomF32(&random) - 1.0f, z};
+        Vec3 b = {RandomF32(&random) + 0.5f, RandomF32(&random) - 1.0f, z};
+        Vec3 c = {RandomF32(&random) - 0.5f, RandomF32(&random) + 0.5f, z};
+        triangles[i] = {a, b, c};
+    }
+    *ray = {{0.1f, 0.1f, 0}, {0.01f, 0.02f, 1}, 0.0f, F32Infinity()};
+    return triangles;
+}
+
+BENCHMARK("Ray triangle Moller-Trumbore scalar") {
+    Ray ray;
+    Triangle* triangles = BenchTriangleBlock(&ray);
+    U32 hits = 0;
+    state->items = TC_BENCH_TRIANGLE_TEST_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_TRIANGLE_TEST_COUNT; ++k) {
+            F32 t, u, v;
+            hits += MollerTrumbore(ray, triangles[k], &t, &u, &v);
+        }
+    }
+    BenchStop(state);
+    BenchUse(&hits);
+    free(triangles);
+}
+
+BENCHMARK("Ray triangle watertight scalar") {
+    Ray ray;
+    Triangle* triangles = BenchTriangleBlock(&ray);
+    RayShear shear = PrecomputeShear(ray);
+    U32 hits = 0;
+    state->items = TC_BENCH_TRIANGLE_TEST_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < TC_BENCH_TRIANGLE_TEST_COUNT; ++k) {
+            TriangleHit hit;
+            hits += Intersect(shear, triangles[k], &hit);
+        }
+    }
+    BenchStop(state);
+    BenchUse(&hits);
+    free(triangles);
+}
+
+template <int N>
+static void BenchTrianglePacks(BenchState* state) {
+    Ray ray;
+    Triangle* triangles = BenchTriangleBlock(&ray);
+    const U32 packCount = TC_BENCH_TRIANGLE_TEST_COUNT / N;
+    TrianglePack<N>* packs = (TrianglePack<N>*) malloc(packCount * sizeof(TrianglePack<N>));
+    for (U32 i = 0; i < TC_BENCH_TRIANGLE_TEST_COUNT; ++i) {
+        const Vec3* corners = &triangles[i].v0;
+        for (U32 k = 0; k < 3; ++k) {
+            for (U32 axis = 0; axis < 3; ++axis) {
+                packs[i / N].corners[k][axis][i % N] = corners[k].raw[axis];
+            }
+        }
+        packs[i / N].primitive[i % N] = i;
+    }
+
+    RayShear shear = PrecomputeShear(ray);
+    U32 hits = 0;
+    state->items = TC_BENCH_TRIANGLE_TEST_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 k = 0; k < packCount; ++k) {
+            TriangleHit hit;
+            hits += Intersect(shear, packs[k], &hit);
+        }
+    }
+    BenchStop(state);
+    BenchUse(&hits);
+    free(packs);
+    free(triangles);
+}
+
+BENCHMARK("Ray triangle watertight 4-wide packs") {
+    BenchTrianglePacks<4>(state);
+}
+
+BENCHMARK("Ray triangle watertight 8-wide packs") {
+    BenchTrianglePacks<8>(state);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Closest hit through a tree
+
+// Binary tree with leaves of up to 4 triangles, tested one at a time
+BENCHMARK("Triangle BVH Moller-Trumbore leaves (256K triangles)") {
+    Triangle* triangles = BenchTriangleScene(TC_BENCH_TRIANGLE_COUNT);
+    BvhBuildOptions options;
+    options.maxLeafSize = 4;
+    Bvh bvh;
+    BvhBuildTriangles(&bvh, &triangles[0].v0, 0, TC_BENCH_TRIANGLE_COUNT, options);
+
+    Ray rays[TC_BENCH_TRIANGLE_RAY_COUNT];
+    BenchTriangleRays(rays, TC_BENCH_TRIANGLE_RAY_COUNT);
+    U32 hits = 0;
+    state->items = TC_BENCH_TRIANGLE_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_TRIANGLE_RAY_COUNT; ++r) {
+            Ray ray = rays[r];
+            bool found = false;
+            Traverse(&bvh, Precompute(ray), [&](U32 primitive, RaySlab* slab) {
+                F32 t, u, v;
+                ray.tMax = slab->tMax;
+                if (MollerTrumbore(ray, triangles[primitive], &t, &u, &v)) {
+                    slab->tMax = t;
+                    found = true;
+                }
+                return true;
+            });
+            hits += found;
+        }
+    }
+    BenchStop(state);
+    BenchUse(&hits);
+
+    BvhFree(&bvh);
+    free(triangles);
+}
+
+// Leaves of up to N triangles, built with the pack cost so they fill up
+template <int N>
+static void BenchTriangleBvh(BenchState* state) {
+    Triangle* triangles = BenchTriangleScene(TC_BENCH_TRIANGLE_COUNT);
+    BvhBuildOptions options;
+    options.maxLeafSize = N;
+    options.intersectionCost = 1.0f / N;
+    TriangleBvh<N> bvh;
+    TriangleBvhBuild(&bvh, &triangles[0].v0, 0, TC_BENCH_TRIANGLE_COUNT, options);
+
+    TC_GLOBAL U32 reported = 0;
+    if (!(reported & N)) {
+        reported |= N;
+        printf("    %u packs, %.2f triangles per pack\n", bvh.packCount, F32(TC_BENCH_TRIANGLE_COUNT) / F32(bvh.packCount));
+    }
+
+    Ray rays[TC_BENCH_TRIANGLE_RAY_COUNT];
+    BenchTriangleRays(rays, TC_BENCH_TRIANGLE_RAY_COUNT);
+    U32 hits = 0;
+    state->items = TC_BENCH_TRIANGLE_RAY_COUNT;
+    BenchStart(state);
+    for (U64 i = 0; i < state->iterations; ++i) {
+        for (U32 r = 0; r < TC_BENCH_TRIANGLE_RAY_COUNT; ++r) {
+            TriangleHit hit;
+            hits += Intersect(&bvh, rays[r], &hit);
+        }
+    }
+    BenchStop(state);
+    BenchUse(&hits);
+
+    TriangleBvhFree(&bvh);
+    free(triangles);
+}
+
+BENCHMARK("Triangle BVH 4-wide packs (256K triangles)") {
+    BenchTriangleBvh<4>(state);
+}
+
+BENCHMARK("Triangle BVH 8-wide packs (256K triangles)") {
+    BenchTriangleBvh<8>(state);
+}
@@ -0,0 +1,1584 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/bvh.h>
+#include <teacup/parallel.h>
+#include <teacup/timer.h>
+#include <teacup/simd.h>
+#include <teacup/sort.h>
+#include <algorithm>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+#if TC_OS_WINDOWS
+#   include <malloc.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Node memory
+
+// Node arrays start on a cache line, so a laid out tree can line up sibling
+// pairs with cache lines
+BvhNode* BvhAllocateNodes(U64 count) {
+#if TC_OS_WINDOWS
+    return (BvhNode*) _aligned_malloc(TC_MAX(count, U64(1)) * sizeof(BvhNode), TC_CACHE_LINE_SIZE);
+#else
+    void* nodes = 0;
+    if (posix_memalign(&nodes, TC_CACHE_LINE_SIZE, TC_MAX(count, U64(1)) * sizeof(BvhNode)) != 0) {
+        return 0;
+    }
+    return (BvhNode*) nodes;
+#endif
+}
+
+void BvhFreeNodes(BvhNode* nodes) {
+#if TC_OS_WINDOWS
+    _aligned_free(nodes);
+#else
+    free(nodes);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Binned SAH builder
+
+// Subtrees with at least this many primitives are built as separate tasks
+#define TC_BVH_TASK_SIZE 1024
+
+// Past this depth splits fall back to halving the range, so the tree never
+// outgrows the traversal stack
+#define TC_BVH_MEDIAN_DEPTH (TC_BVH_STACK_SIZE - 34)
+
+// Bin bounds are kept in the first three lanes of F32x4 registers, a union
+// is one Min and one Max. The last lane holds whatever followed the Vec3 in
+// memory and is never read back.
+struct BvhBin {
+    F32x4 min;
+    F32x4 max;
+    F32x4 centroidMin;
+    F32x4 centroidMax;
+    U32 count;
+};
+
+struct BvhBins {
+    BvhBin bins[3][TC_BVH_MAX_BINS];
+};
+
+// Copy of the primitive inputs that is partitioned in place, so binning and
+// partitioning stream through memory instead of gathering through indices
+struct BvhReference {
+    Box3 bounds;
+    Vec3 centroid;
+    U32 index;
+};
+
+// positions is null unless spatial splits may clip triangles, see
+// BvhBuildTriangles for how triangles index it
+struct BvhBuilder {
+    BvhReference* references;
+    BvhReference* scratch;
+    BvhNode* nodes;
+    std::atomic<U32> nodeCount;
+    std::atomic<U32> spatialSplitCount;
+    const Vec3* positions;
+    const U32* triangles;
+    F32 rootArea;
+    BvhBuildOptions options;
+};
+
+// Primitives references[begin, end) below nodes[node]. references[end, limit)
+// is room for the references spatial splits in the subtree add.
+struct BvhRange {
+    BvhBuilder* builder;
+    U32 node;
+    U32 begin;
+    U32 end;
+    U32 limit;
+    U32 depth;
+    Box3 bounds;
+    Box3 centroidBounds;
+};
+
+struct BvhSplit {
+    int axis;
+    U32 bin;
+    F32 cost;
+};
+
+static void BinsClear(BvhBins* bins, U32 binCount) {
+    F32x4 infinity = F32x4Splat(F32Infinity());
+    F32x4 negInfinity = F32x4Splat(F32NegInfinity());
+    for (int axis = 0; axis < 3; ++axis) {
+        for (U32 i = 0; i < binCount; ++i) {
+            bins->bins[axis][i] = {infinity, negInfinity, infinity, negInfinity, 0};
+        }
+    }
+}
+
+static void BinsMerge(BvhBins* a, const BvhBins* b, U32 binCount) {
+    for (int axis = 0; axis < 3; ++axis) {
+        for (U32 i = 0; i < binCount; ++i) {
+            BvhBin* bin = &a->bins[axis][i];
+            const BvhBin* other = &b->bins[axis][i];
+            bin->min = Min(bin->min, other->min);
+            bin->max = Max(bin->max, other->max);
+            bin->centroidMin = Min(bin->centroidMin, other->centroidMin);
+            bin->centroidMax = Max(bin->centroidMax, other->centroidMax);
+            bin->count += other->count;
+        }
+    }
+}
+
+static Box3 BinBox(F32x4 min, F32x4 max) {
+    return {{Extract<0>(min), Extract<1>(min), Extract<2>(min)}, {Extract<0>(max), Extract<1>(max), Extract<2>(max)}};
+}
+
+// Zero for empty boxes, like SurfaceArea
+static F32 BinArea(F32x4 min, F32x4 max) {
+    F32 extent[4];
+    F32x4Store(extent, max - min);
+    if (extent[0] < 0 || extent[1] < 0 || extent[2] < 0) {
+        return 0;
+    }
+    return 2.0f * (extent[0]*extent[1] + extent[1]*extent[2] + extent[2]*extent[0]);
+}
+
+// Maps centroids to bins. Binning and partitioning both go through this so a
+// primitive always lands on the side its bin was counted on.
+struct BvhBinMapping {
+    Vec3 min;
+    Vec3 scale;
+    U32 binCount;
+};
+
+static BvhBinMapping BinMapping(Box3 centroidBounds, U32 binCount) {
+    BvhBinMapping mapping = {centroidBounds.min, {0, 0, 0}, binCount};
+    for (int axis = 0; axis < 3; ++axis) {
+        F32 extent = centroidBounds.max.raw[axis] - centroidBounds.min.raw[axis];
+        mapping.scale.raw[axis] = extent > 0 ? F32(binCount) / extent : 0;
+    }
+    return mapping;
+}
+
+static inline U32 BinIndex(const BvhBinMapping& mapping, Vec3 centroid, int axis) {
+    F32 bin = (centroid.raw[axis] - mapping.min.raw[axis]) * mapping.scale.raw[axis];
+    return U32(TC_CLAMP(bin, 0.0f, F32(mapping.binCount - 1)));
+}
+
+static void BinPrimitives(const BvhBuilder* builder, const BvhBinMapping& mapping, U32 begin, U32 end, BvhBins* bins) {
+    for (U32 i = begin; i < end; ++i) {
+        const BvhReference* reference = builder->references + i;
+        F32x4 min = F32x4Load(reference->bounds.min.raw);
+        F32x4 max = F32x4Load(reference->bounds.max.raw);
+        F32x4 centroid = F32x4Load(reference->centroid.raw);
+        for (int axis = 0; axis < 3; ++axis) {
+            BvhBin* bin = &bins->bins[axis][BinIndex(mapping, reference->centroid, axis)];
+            bin->min = Min(bin->min, min);
+            bin->max = Max(bin->max, max);
+            bin->centroidMin = Min(bin->centroidMin, centroid);
+            bin->centroidMax = Max(bin->centroidMax, centroid);
+            bin->count++;
+        }
+    }
+}
+
+static void BinRange(const BvhRange* range, const BvhBinMapping& mapping, BvhBins* bins) {
+    const BvhBuilder* builder = range->builder;
+    BinsClear(bins, mapping.binCount);
+    U32 count = range->end - range->begin;
+    if (count < builder->options.parallelThreshold) {
+        BinPrimitives(builder, mapping, range->begin, range->end, bins);
+        return;
+    }
+
+    std::mutex mutex;
+    ParallelFor(count, TC_BVH_TASK_SIZE * 4, [&](U64 begin, U64 end) {
+        BvhBins local;
+        BinsClear(&local, mapping.binCount);
+        BinPrimitives(builder, mapping, range->begin + U32(begin), range->begin + U32(end), &local);
+        std::lock_guard<std::mutex> lock(mutex);
+        BinsMerge(bins, &local, mapping.binCount);
+    });
+}
+
+// Sweeps the bins of each axis from both ends. Splitting after bin i puts
+// bins [0, i] on the left.
+static BvhSplit FindSplit(const BvhRange* range, const BvhBins* bins, U32 binCount) {
+    const BvhBuildOptions& options = range->builder->options;
+    BvhSplit best = {-1, 0, F32Infinity()};
+    F32 area = SurfaceArea(range->bounds);
+    F32 inverseArea = area > 0 ? 1.0f / area : 0;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (range->centroidBounds.max.raw[axis] <= range->centroidBounds.min.raw[axis]) {
+            continue;
+        }
+
+        F32 rightCost[TC_BVH_MAX_BINS];
+        F32x4 min = F32x4Splat(F32Infinity());
+        F32x4 max = F32x4Splat(F32NegInfinity());
+        U32 count = 0;
+        for (U32 i = binCount - 1; i > 0; --i) {
+            min = Min(min, bins->bins[axis][i].min);
+            max = Max(max, bins->bins[axis][i].max);
+            count += bins->bins[axis][i].count;
+            rightCost[i - 1] = BinArea(min, max) * F32(count);
+        }
+
+        min = F32x4Splat(F32Infinity());
+        max = F32x4Splat(F32NegInfinity());
+        count = 0;
+        for (U32 i = 0; i + 1 < binCount; ++i) {
+            min = Min(min, bins->bins[axis][i].min);
+            max = Max(max, bins->bins[axis][i].max);
+            count += bins->bins[axis][i].count;
+            F32 cost = options.traversalCost + options.intersectionCost * (BinArea(min, max) * F32(count) + rightCost[i]) * inverseArea;
+            if (cost < best.cost) {
+                best = {axis, i, cost};
+            }
+        }
+    }
+    return best;
+}
+
+static void BoundsOfPrimitives(const BvhBuilder* builder, U32 begin, U32 end, Box3* bounds, Box3* centroidBounds) {
+    *bounds = Box3Empty();
+    *centroidBounds = Box3Empty();
+    for (U32 i = begin; i < end; ++i) {
+        *bounds = Union(*bounds, builder->references[i].bounds);
+        *centroidBounds = Union(*centroidBounds, builder->references[i].centroid);
+    }
+}
+
+static void BoundsOfRange(BvhRange* range) {
+    const BvhBuilder* builder = range->builder;
+    U32 count = range->end - range->begin;
+    if (count < builder->options.parallelThreshold) {
+        BoundsOfPrimitives(builder, range->begin, range->end, &range->bounds, &range->centroidBounds);
+        return;
+    }
+
+    std::mutex mutex;
+    range->bounds = Box3Empty();
+    range->centroidBounds = Box3Empty();
+    ParallelFor(count, TC_BVH_TASK_SIZE * 4, [&](U64 begin, U64 end) {
+        Box3 bounds, centroidBounds;
+        BoundsOfPrimitives(builder, range->begin + U32(begin), range->begin + U32(end), &bounds, &centroidBounds);
+        std::lock_guard<std::mutex> lock(mutex);
+        range->bounds = Union(range->bounds, bounds);
+        range->centroidBounds = Union(range->centroidBounds, centroidBounds);
+    });
+}
+
+// Moves primitives whose bin is at most split in front and returns the first
+// index of the right side. Large ranges count each chunk's left primitives,
+// scatter both sides to the scratch array and copy back.
+static U32 Partition(const BvhRange* range, const BvhBinMapping& mapping, int axis, U32 split) {
+    BvhBuilder* builder = range->builder;
+    BvhReference* references = builder->references;
+    U32 count = range->end - range->begin;
+
+    if (count < builder->options.parallelThreshold) {
+        U32 left = range->begin;
+        U32 right = range->end;
+        while (left < right) {
+            if (BinIndex(mapping, references[left].centroid, axis) <= split) {
+                ++left;
+            }
+            else {
+                BvhReference swap = references[left];
+                references[left] = references[--right];
+                references[right] = swap;
+            }
+        }
+        return left;
+    }
+
+    const U64 grain = TC_BVH_TASK_SIZE * 4;
+    U64 chunkCount = (count + grain - 1) / grain;
+    U32* leftCounts = (U32*) malloc(chunkCount * sizeof(U32));
+    U32* leftOffsets = (U32*) malloc(chunkCount * sizeof(U32));
+
+    ParallelFor(count, grain, [&](U64 begin, U64 end) {
+        U32 left = 0;
+        for (U64 i = begin; i < end; ++i) {
+            left += BinIndex(mapping, references[range->begin + i].centroid, axis) <= split;
+        }
+        leftCounts[begin / grain] = left;
+    });
+
+    U32 leftTotal = 0;
+    for (U64 chunk = 0; chunk < chunkCount; ++chunk) {
+        leftOffsets[chunk] = leftTotal;
+        leftTotal += leftCounts[chunk];
+    }
+
+    BvhReference* scratch = builder->scratch + range->begin;
+    ParallelFor(count, grain, [&](U64 begin, U64 end) {
+        U32 left = leftOffsets[begin / grain];
+        U32 right = leftTotal + U32(begin) - left;
+        for (U64 i = begin; i < end; ++i) {
+            const BvhReference* reference = references + range->begin + i;
+            if (BinIndex(mapping, reference->centroid, axis) <= split) {
+                scratch[left++] = *reference;
+            }
+            else {
+                scratch[right++] = *reference;
+            }
+        }
+    });
+
+    ParallelFor(count, grain, [&](U64 begin, U64 end) {
+        memcpy(references + range->begin + begin, scratch + begin, (end - begin) * sizeof(BvhReference));
+    });
+
+    free(leftCounts);
+    free(leftOffsets);
+    return range->begin + leftTotal;
+}
+
+// Spatial splits follow "Spatial Splits in Bounding Volume Hierarchies". They
+// only run when the builder has triangles.
+
+struct BvhSpatialBin {
+    Box3 bounds;
+    U32 entries;
+    U32 exits;
+};
+
+// Side bounds and counts with every straddling reference split, which the
+// partition uses to decide which ones to keep whole
+struct BvhSpatialSplit {
+    BvhSplit split;
+    Box3 left;
+    Box3 right;
+    U32 leftCount;
+    U32 rightCount;
+};
+
+// Spatial bins divide the range's bounds rather than its centroid bounds.
+// Bin i ends at the plane where bin i + 1 starts.
+static inline F32 SpatialPlane(const BvhBinMapping& mapping, int axis, U32 bin) {
+    return mapping.min.raw[axis] + F32(bin) / mapping.scale.raw[axis];
+}
+
+static void TriangleOf(const Vec3* positions, const U32* triangles, U32 triangle, Vec3 corners[3]) {
+    for (U32 k = 0; k < 3; ++k) {
+        U32 index = 3 * triangle + k;
+        corners[k] = positions[triangles ? triangles[index] : index];
+    }
+}
+
+// Boxes of the parts of the reference's triangle on either side of the
+// plane, within the reference's current bounds. Either may come back empty.
+static void SplitReference(const BvhBuilder* builder, const BvhReference* reference, Box3 bounds, int axis, F32 plane, Box3* left, Box3* right) {
+    Vec3 corners[3];
+    TriangleOf(builder->positions, builder->triangles, reference->index, corners);
+    *left = Box3Empty();
+    *right = Box3Empty();
+    for (int k = 0; k < 3; ++k) {
+        Vec3 a = corners[k];
+        Vec3 b = corners[(k + 1) % 3];
+        F32 da = a.raw[axis];
+        F32 db = b.raw[axis];
+        if (da <= plane) {
+            *left = Union(*left, a);
+        }
+        if (da >= plane) {
+            *right = Union(*right, a);
+        }
+        if ((da < plane && db > plane) || (da > plane && db < plane)) {
+            F32 t = TC_CLAMP((plane - da) / (db - da), 0.0f, 1.0f);
+            Vec3 point = a + (b - a) * t;
+            point.raw[axis] = plane;
+            *left = Union(*left, point);
+            *right = Union(*right, point);
+        }
+    }
+    *left = Intersect(*left, bounds);
+    *right = Intersect(*right, bounds);
+}
+
+static void SpatialBinsClear(BvhSpatialBin* bins, U32 binCount) {
+    for (U32 i = 0; i < binCount; ++i) {
+        bins[i] = {Box3Empty(), 0, 0};
+    }
+}
+
+// Chops each reference at the bin planes it crosses, adding every piece to
+// the bounds of its bin. The reference counts as entering its first bin and
+// leaving its last.
+static void SpatialBinReferences(const BvhRange* range, const BvhBinMapping& mapping, int axis, U32 begin, U32 end, BvhSpatialBin* bins) {
+    const BvhBuilder* builder = range->builder;
+    for (U32 r = begin; r < end; ++r) {
+        const BvhReference* reference = builder->references + r;
+        U32 first = BinIndex(mapping, reference->bounds.min, axis);
+        U32 last = BinIndex(mapping, reference->bounds.max, axis);
+        Box3 rest = reference->bounds;
+        for (U32 i = first; i < last && !IsEmpty(rest); ++i) {
+            Box3 part;
+            SplitReference(builder, reference, rest, axis, SpatialPlane(mapping, axis, i + 1), &part, &rest);
+            if (!IsEmpty(part)) {
+                bins[i].bounds = Union(bins[i].bounds, part);
+            }
+        }
+        if (!IsEmpty(rest)) {
+            bins[last].bounds = Union(bins[last].bounds, rest);
+        }
+        bins[first].entries++;
+        bins[last].exits++;
+    }
+}
+
+// Sweeps the spatial bins of each axis for the cheapest plane whose
+// straddling references fit in the range's spare room
+static BvhSpatialSplit FindSpatialSplit(const BvhRange* range, const BvhBinMapping& mapping) {
+    const BvhBuilder* builder = range->builder;
+    const BvhBuildOptions& options = builder->options;
+    U32 count = range->end - range->begin;
+    U32 spare = range->limit - range->end;
+    U32 binCount = mapping.binCount;
+    BvhSpatialSplit best = {{-1, 0, F32Infinity()}, {}, {}, 0, 0};
+    F32 area = SurfaceArea(range->bounds);
+    F32 inverseArea = area > 0 ? 1.0f / area : 0;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (mapping.scale.raw[axis] == 0) {
+            continue;
+        }
+
+        BvhSpatialBin bins[TC_BVH_MAX_BINS];
+        SpatialBinsClear(bins, binCount);
+        if (count < options.parallelThreshold) {
+            SpatialBinReferences(range, mapping, axis, range->begin, range->end, bins);
+        }
+        else {
+            std::mutex mutex;
+            ParallelFor(count, TC_BVH_TASK_SIZE * 4, [&](U64 begin, U64 end) {
+                BvhSpatialBin local[TC_BVH_MAX_BINS];
+                SpatialBinsClear(local, binCount);
+                SpatialBinReferences(range, mapping, axis, range->begin + U32(begin), range->begin + U32(end), local);
+                std::lock_guard<std::mutex> lock(mutex);
+                for (U32 i = 0; i < binCount; ++i) {
+                    bins[i].bounds = Union(bins[i].bounds, local[i].bounds);
+                    bins[i].entries += local[i].entries;
+                    bins[i].exits += local[i].exits;
+                }
+            });
+        }
+
+        Box3 rightBounds[TC_BVH_MAX_BINS];
+        U32 rightCount[TC_BVH_MAX_BINS];
+        Box3 box = Box3Empty();
+        U32 exits = 0;
+        for (U32 i = binCount - 1; i > 0; --i) {
+            box = Union(box, bins[i].bounds);
+            exits += bins[i].exits;
+            rightBounds[i - 1] = box;
+            rightCount[i - 1] = exits;
+        }
+
+        box = Box3Empty();
+        U32 entries = 0;
+        for (U32 i = 0; i + 1 < binCount; ++i) {
+            box = Union(box, bins[i].bounds);
+            entries += bins[i].entries;
+            U32 duplicates = entries + rightCount[i] - count;
+            if (entries == 0 || rightCount[i] == 0 || duplicates > spare) {
+                continue;
+            }
+            F32 cost = options.traversalCost + options.intersectionCost * (SurfaceArea(box) * F32(entries) + SurfaceArea(rightBounds[i]) * F32(rightCount[i])) * inverseArea;
+            if (cost < best.split.cost) {
+                best = {{axis, i, cost}, box, rightBounds[i], entries, rightCount[i]};
+            }
+        }
+    }
+    return best;
+}
+
+static void BoundsOfRange(BvhRange* range);
+
+// Sends references entirely below the split plane left, those entirely above
+// it right, and splits the ones in between unless keeping one whole on a
+// side is cheaper. Children are laid out with the remaining room shared in
+// proportion to their sizes. Returns false and leaves the range alone if
+// clipping emptied a side.
+static bool SpatialPartition(const BvhRange* range, const BvhBinMapping& mapping, const BvhSpatialSplit& spatial, BvhRange* left, BvhRange* right) {
+    BvhBuilder* builder = range->builder;
+    BvhReference* references = builder->references;
+    BvhSplit split = spatial.split;
+    int axis = split.axis;
+    F32 plane = SpatialPlane(mapping, axis, split.bin + 1);
+    F32 leftArea = SurfaceArea(spatial.left);
+    F32 rightArea = SurfaceArea(spatial.right);
+    F32 splitCost = leftArea * F32(spatial.leftCount) + rightArea * F32(spatial.rightCount);
+
+    U32 straddling = 0;
+    for (U32 r = range->begin; r < range->end; ++r) {
+        U32 first = BinIndex(mapping, references[r].bounds.min, axis);
+        U32 last = BinIndex(mapping, references[r].bounds.max, axis);
+        straddling += first <= split.bin && last > split.bin;
+    }
+    U32 spare = range->limit - range->end;
+    U32 size = range->end - range->begin + TC_MIN(straddling, spare);
+    U32 duplicates = 0;
+
+    // Left side fills from the front and right side from the back
+    BvhReference* sorted = (BvhReference*) malloc(size * sizeof(BvhReference));
+    U32 leftCount = 0;
+    U32 rightCount = 0;
+    for (U32 r = range->begin; r < range->end; ++r) {
+        const BvhReference* reference = references + r;
+        U32 first = BinIndex(mapping, reference->bounds.min, axis);
+        U32 last = BinIndex(mapping, reference->bounds.max, axis);
+        if (last <= split.bin) {
+            sorted[leftCount++] = *reference;
+            continue;
+        }
+        if (first > split.bin) {
+            sorted[size - ++rightCount] = *reference;
+            continue;
+        }
+
+        // Reference unsplitting from the same paper keeps a reference whole
+        // on one side where that is cheaper, or once the room is used up
+        F32 leftCost = SurfaceArea(Union(spatial.left, reference->bounds)) * F32(spatial.leftCount) + rightArea * F32(spatial.rightCount - 1);
+        F32 rightCost = leftArea * F32(spatial.leftCount - 1) + SurfaceArea(Union(spatial.right, reference->bounds)) * F32(spatial.rightCount);
+        if (duplicates == spare || TC_MIN(leftCost, rightCost) < splitCost) {
+            if (leftCost <= rightCost) {
+                sorted[leftCount++] = *reference;
+            }
+            else {
+                sorted[size - ++rightCount] = *reference;
+            }
+            continue;
+        }
+
+        Box3 leftBounds, rightBounds;
+        SplitReference(builder, reference, reference->bounds, axis, plane, &leftBounds, &rightBounds);
+        if (!IsEmpty(leftBounds)) {
+            sorted[leftCount++] = {leftBounds, Centroid(leftBounds), reference->index};
+        }
+        if (!IsEmpty(rightBounds)) {
+            sorted[size - ++rightCount] = {rightBounds, Centroid(rightBounds), reference->index};
+        }
+        if (IsEmpty(leftBounds) && IsEmpty(rightBounds)) {
+            sorted[leftCount++] = *reference;
+        }
+        duplicates += !IsEmpty(leftBounds) && !IsEmpty(rightBounds);
+    }
+    if (leftCount == 0 || rightCount == 0) {
+        free(sorted);
+        return false;
+    }
+
+    U32 total = leftCount + rightCount;
+    U32 leftSpare = U32(U64(range->limit - range->begin - total) * leftCount / total);
+    left->begin = range->begin;
+    left->end = left->begin + leftCount;
+    left->limit = left->end + leftSpare;
+    right->begin = left->limit;
+    right->end = right->begin + rightCount;
+    right->limit = range->limit;
+    memcpy(references + left->begin, sorted, leftCount * sizeof(BvhReference));
+    memcpy(references + right->begin, sorted + size - rightCount, rightCount * sizeof(BvhReference));
+    free(sorted);
+
+    BoundsOfRange(left);
+    BoundsOfRange(right);
+    builder->spatialSplitCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Hands the room after a range to its children in proportion to their
+// sizes, moving the right side up to make space for the left's share
+static void DistributeSpare(const BvhRange* range, BvhRange* left, BvhRange* right) {
+    U32 spare = range->limit - range->end;
+    U32 leftSpare = U32(U64(spare) * (left->end - left->begin) / (range->end - range->begin));
+    if (leftSpare > 0) {
+        BvhReference* references = range->builder->references;
+        memmove(references + right->begin + leftSpare, references + right->begin, (right->end - right->begin) * sizeof(BvhReference));
+        right->begin += leftSpare;
+        right->end += leftSpare;
+    }
+    left->limit = left->end + leftSpare;
+    right->limit = range->limit;
+}
+
+enum BvhSplitResult {
+    BVH_SPLIT_LEAF,
+    BVH_SPLIT_SAH,
+    BVH_SPLIT_MEDIAN,
+    BVH_SPLIT_SPATIAL,
+};
+
+// Picks the cheapest binned split and partitions the range for it, filling
+// in the bounds of both sides. Spatial splits also lay out the children,
+// the other results leave that to DistributeSpare. Kept out of line so the
+// bins are not on the stack during the recursion.
+TC_NO_INLINE static BvhSplitResult SplitRange(const BvhRange* range, BvhRange* left, BvhRange* right) {
+    const BvhBuilder* builder = range->builder;
+    const BvhBuildOptions& options = builder->options;
+    U32 count = range->end - range->begin;
+
+    // Small ranges gain nothing from more bins than primitives
+    U32 binCount = TC_CLAMP(TC_MIN(options.binCount, count), 2u, U32(TC_BVH_MAX_BINS));
+    BvhBinMapping mapping = BinMapping(range->centroidBounds, binCount);
+    BvhBins bins;
+    BinRange(range, mapping, &bins);
+    BvhSplit split = FindSplit(range, &bins, binCount);
+
+    // Every centroid in the same place, nothing to separate them by
+    if (split.axis < 0) {
+        return count > options.maxLeafSize ? BVH_SPLIT_MEDIAN : BVH_SPLIT_LEAF;
+    }
+    if (count <= options.maxLeafSize && options.intersectionCost * F32(count) <= split.cost) {
+        return BVH_SPLIT_LEAF;
+    }
+
+    BvhBin sides[2] = {bins.bins[split.axis][0], bins.bins[split.axis][binCount - 1]};
+    for (U32 i = 1; i + 1 < binCount; ++i) {
+        const BvhBin* bin = &bins.bins[split.axis][i];
+        BvhBin* side = sides + (i > split.bin);
+        side->min = Min(side->min, bin->min);
+        side->max = Max(side->max, bin->max);
+        side->centroidMin = Min(side->centroidMin, bin->centroidMin);
+        side->centroidMax = Max(side->centroidMax, bin->centroidMax);
+    }
+    left->bounds = BinBox(sides[0].min, sides[0].max);
+    left->centroidBounds = BinBox(sides[0].centroidMin, sides[0].centroidMax);
+    right->bounds = BinBox(sides[1].min, sides[1].max);
+    right->centroidBounds = BinBox(sides[1].centroidMin, sides[1].centroidMax);
+
+    // Only worth a look where the object split leaves the children overlapping
+    if (builder->positions && range->limit > range->end) {
+        Box3 overlap = Intersect(left->bounds, right->bounds);
+        if (!IsEmpty(overlap) && SurfaceArea(overlap) > options.spatialSplitOverlap * builder->rootArea) {
+            BvhBinMapping spatialMapping = BinMapping(range->bounds, binCount);
+            BvhSpatialSplit spatial = FindSpatialSplit(range, spatialMapping);
+            if (spatial.split.cost < split.cost && SpatialPartition(range, spatialMapping, spatial, left, right)) {
+                return BVH_SPLIT_SPATIAL;
+            }
+        }
+    }
+
+    left->end = Partition(range, mapping, split.axis, split.bin);
+    right->begin = left->end;
+    return BVH_SPLIT_SAH;
+}
+
+static void BuildRange(BvhRange* range);
+
+static void BuildRangeTask(void* context) {
+    BuildRange((BvhRange*) context);
+}
+
+static void BuildRange(BvhRange* range) {
+    BvhBuilder* builder = range->builder;
+    const BvhBuildOptions& options = builder->options;
+    BvhNode* node = builder->nodes + range->node;
+    U32 count = range->end - range->begin;
+    node->bounds = range->bounds;
+
+    BvhRange left = {builder, 0, range->begin, 0, 0, range->depth + 1, range->bounds, range->centroidBounds};
+    BvhRange right = {builder, 0, 0, range->end, 0, range->depth + 1, range->bounds, range->centroidBounds};
+
+    BvhSplitResult result = BVH_SPLIT_LEAF;
+    if (range->depth >= TC_BVH_MEDIAN_DEPTH) {
+        result = count > options.maxLeafSize ? BVH_SPLIT_MEDIAN : BVH_SPLIT_LEAF;
+    }
+    else if (count > 1) {
+        result = SplitRange(range, &left, &right);
+    }
+
+    if (result == BVH_SPLIT_LEAF) {
+        node->offset = range->begin;
+        node->count = count;
+        return;
+    }
+
+    if (result == BVH_SPLIT_MEDIAN) {
+        left.end = range->begin + count / 2;
+        right.begin = left.end;
+        DistributeSpare(range, &left, &right);
+        BoundsOfRange(&left);
+        BoundsOfRange(&right);
+    }
+    else if (result == BVH_SPLIT_SAH) {
+        DistributeSpare(range, &left, &right);
+    }
+
+    U32 first = builder->nodeCount.fetch_add(2, std::memory_order_relaxed);
+    node->offset = first;
+    node->count = 0;
+    left.node = first;
+    right.node = first + 1;
+
+    if (left.end - left.begin >= TC_BVH_TASK_SIZE && right.end - right.begin >= TC_BVH_TASK_SIZE) {
+        TaskGroup group = {{0}};
+        TaskRun(&group, BuildRangeTask, &left);
+        BuildRange(&right);
+        TaskWait(&group);
+    }
+    else {
+        BuildRange(&left);
+        BuildRange(&right);
+    }
+}
+
+static void CollectStats(const Bvh* bvh, U32 node, U32 depth, BvhBuildStats* stats) {
+    stats->maxDepth = TC_MAX(stats->maxDepth, depth);
+    if (bvh->nodes[node].count > 0) {
+        stats->leafCount++;
+        return;
+    }
+    CollectStats(bvh, bvh->nodes[node].offset, depth + 1, stats);
+    CollectStats(bvh, bvh->nodes[node].offset + 1, depth + 1, stats);
+}
+
+// positions and triangles are null for builds without spatial splits
+static void BuildBinned(Bvh* bvh, const Box3* bounds, const Vec3* centroids, U32 count, const BvhBuildOptions& options, const Vec3* positions, const U32* triangles, U32* spatialSplitCount) {
+    U32 capacity = count;
+    if (positions) {
+        capacity += U32(TC_MIN(F64(count) * TC_MAX(options.spatialSplitBudget, 0.0f), F64(TC_U32_MAX / 2 - count)));
+    }
+
+    BvhBuilder builder;
+    builder.references = (BvhReference*) malloc(capacity * sizeof(BvhReference));
+    builder.scratch = count >= options.parallelThreshold ? (BvhReference*) malloc(capacity * sizeof(BvhReference)) : 0;
+    builder.nodes = BvhAllocateNodes(2 * U64(capacity) - 1);
+    builder.nodeCount = 1;
+    builder.spatialSplitCount = 0;
+    builder.positions = positions;
+    builder.triangles = triangles;
+    builder.options = options;
+
+    ParallelFor(count, TC_BVH_TASK_SIZE * 16, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            Vec3 centroid = centroids ? centroids[i] : Centroid(bounds[i]);
+            builder.references[i] = {bounds[i], centroid, U32(i)};
+        }
+    });
+
+    BvhRange root = {&builder, 0, 0, count, capacity, 0, {}, {}};
+    BoundsOfRange(&root);
+    builder.rootArea = SurfaceArea(root.bounds);
+    BuildRange(&root);
+
+    bvh->nodeCount = builder.nodeCount.load();
+    bvh->nodes = builder.nodes;
+    if (bvh->nodeCount < 2 * U64(capacity) - 1) {
+        bvh->nodes = BvhAllocateNodes(bvh->nodeCount);
+        memcpy(bvh->nodes, builder.nodes, bvh->nodeCount * sizeof(BvhNode));
+        BvhFreeNodes(builder.nodes);
+    }
+
+    // Leaves own consecutive references, so their order is the final order
+    // of the primitive indices. With room left for spatial splits there are
+    // gaps between them to close.
+    U32* indices = (U32*) malloc(capacity * sizeof(U32));
+    U32 referenceCount = count;
+    if (capacity == count) {
+        ParallelFor(count, TC_BVH_TASK_SIZE * 16, [&](U64 begin, U64 end) {
+            for (U64 i = begin; i < end; ++i) {
+                indices[i] = builder.references[i].index;
+            }
+        });
+    }
+    else {
+        referenceCount = 0;
+        for (U32 i = 0; i < bvh->nodeCount; ++i) {
+            BvhNode* node = bvh->nodes + i;
+            if (node->count > 0) {
+                for (U32 k = 0; k < node->count; ++k) {
+                    indices[referenceCount + k] = builder.references[node->offset + k].index;
+                }
+                node->offset = referenceCount;
+                referenceCount += node->count;
+            }
+        }
+        indices = (U32*) realloc(indices, referenceCount * sizeof(U32));
+    }
+    free(builder.references);
+    free(builder.scratch);
+
+    bvh->indices = indices;
+    bvh->primitiveCount = count;
+    bvh->referenceCount = referenceCount;
+    *spatialSplitCount = builder.spatialSplitCount.load();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Linear builder
+
+// Tree in the layout of Karras 2012. Internal nodes are 0 to count - 2 with
+// the root at 0, leaf j is node count - 1 + j and holds the j-th primitive in
+// Morton order.
+struct LinearTree {
+    U32 count;
+    U32* left;
+    U32* right;
+    U32* parent;
+    U32* size;
+    Box3* bounds;
+    F32* cost;
+    std::atomic<U32>* visits;
+};
+
+static inline bool IsInternal(const LinearTree* tree, U32 node) {
+    return node < tree->count - 1;
+}
+
+// Length of the common prefix of keys i and j, with the index appended to
+// break ties between equal keys. -1 outside the key range.
+template <typename K>
+static inline S32 CommonPrefix(const K* keys, S64 count, S64 i, S64 j) {
+    if (j < 0 || j >= count) {
+        return -1;
+    }
+    K a = keys[i];
+    K b = keys[j];
+    if (a == b) {
+        return S32(sizeof(K) * 8 + CountLeadingZeros(U32(i ^ j)));
+    }
+    return S32(CountLeadingZeros(K(a ^ b)));
+}
+
+// Finds the key range internal node i covers and where it splits, see
+// "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees"
+template <typename K>
+static void LinearInternalNode(LinearTree* tree, const K* keys, S64 i) {
+    S64 count = tree->count;
+    S64 direction = CommonPrefix(keys, count, i, i + 1) > CommonPrefix(keys, count, i, i - 1) ? 1 : -1;
+    S32 minPrefix = CommonPrefix(keys, count, i, i - direction);
+
+    S64 maxLength = 2;
+    while (CommonPrefix(keys, count, i, i + maxLength * direction) > minPrefix) {
+        maxLength *= 2;
+    }
+    S64 length = 0;
+    for (S64 step = maxLength / 2; step >= 1; step /= 2) {
+        if (CommonPrefix(keys, count, i, i + (length + step) * direction) > minPrefix) {
+            length += step;
+        }
+    }
+    S64 j = i + length * direction;
+
+    S32 nodePrefix = CommonPrefix(keys, count, i, j);
+    S64 split = 0;
+    S64 step = length;
+    do {
+        step = (step + 1) / 2;
+        if (CommonPrefix(keys, count, i, i + (split + step) * direction) > nodePrefix) {
+            split += step;
+        }
+    } while (step > 1);
+    S64 gamma = i + split * direction + TC_MIN(direction, S64(0));
+
+    U32 leafBase = U32(count - 1);
+    U32 left = TC_MIN(i, j) == gamma ? leafBase + U32(gamma) : U32(gamma);
+    U32 right = TC_MAX(i, j) == gamma + 1 ? leafBase + U32(gamma + 1) : U32(gamma + 1);
+    tree->left[i] = left;
+    tree->right[i] = right;
+    tree->parent[left] = U32(i);
+    tree->parent[right] = U32(i);
+}
+
+static void LinearUpdateNode(LinearTree* tree, U32 node, const BvhBuildOptions& options) {
+    U32 left = tree->left[node];
+    U32 right = tree->right[node];
+    tree->bounds[node] = Union(tree->bounds[left], tree->bounds[right]);
+    tree->size[node] = tree->size[left] + tree->size[right];
+    tree->cost[node] = options.traversalCost * SurfaceArea(tree->bounds[node]) + tree->cost[left] + tree->cost[right];
+}
+
+struct Treelet {
+    U32 leaves[TC_BVH_TREELET_SIZE];
+    U32 internals[TC_BVH_TREELET_SIZE - 1];
+    Box3 bounds[1 << TC_BVH_TREELET_SIZE];
+    F32 cost[1 << TC_BVH_TREELET_SIZE];
+    U8 partition[1 << TC_BVH_TREELET_SIZE];
+    U32 internalsUsed;
+};
+
+// Rewires the nodes of the treelet for the leaves in subset under node,
+// taking further internal nodes from the ones the old treelet used
+static U32 TreeletEmit(LinearTree* tree, Treelet* treelet, U32 subset, U32 node) {
+    if (PopCount(subset) == 1) {
+        return treelet->leaves[CountTrailingZeros(subset)];
+    }
+    U32 children[2];
+    U32 subsets[2] = {treelet->partition[subset], subset ^ treelet->partition[subset]};
+    for (int k = 0; k < 2; ++k) {
+        U32 child = PopCount(subsets[k]) == 1 ? 0 : treelet->internals[treelet->internalsUsed++];
+        children[k] = TreeletEmit(tree, treelet, subsets[k], child);
+        tree->parent[children[k]] = node;
+    }
+    tree->left[node] = children[0];
+    tree->right[node] = children[1];
+    tree->bounds[node] = treelet->bounds[subset];
+    tree->size[node] = tree->size[children[0]] + tree->size[children[1]];
+    tree->cost[node] = treelet->cost[subset];
+    return node;
+}
+
+// Forms a treelet under root by opening the largest internal leaf until it
+// has TC_BVH_TREELET_SIZE leaves, then finds the cheapest binary tree over
+// those leaves by dynamic programming over every subset, see "Fast
+// Parallel Construction of High-Quality Bounding Volume Hierarchies"
+static void RestructureTreelet(LinearTree* tree, U32 root, const BvhBuildOptions& options) {
+    Treelet treelet;
+    U32 leafCount = 2;
+    U32 internalCount = 0;
+    treelet.leaves[0] = tree->left[root];
+    treelet.leaves[1] = tree->right[root];
+    while (leafCount < TC_BVH_TREELET_SIZE) {
+        S32 largest = -1;
+        F32 largestArea = -1;
+        for (U32 i = 0; i < leafCount; ++i) {
+            F32 area = SurfaceArea(tree->bounds[treelet.leaves[i]]);
+            if (IsInternal(tree, treelet.leaves[i]) && area > largestArea) {
+                largest = S32(i);
+                largestArea = area;
+            }
+        }
+        if (largest < 0) {
+            break;
+        }
+        U32 opened = treelet.leaves[largest];
+        treelet.internals[internalCount++] = opened;
+        treelet.leaves[largest] = tree->left[opened];
+        treelet.leaves[leafCount++] = tree->right[opened];
+    }
+    if (leafCount < 3) {
+        return;
+    }
+
+    // Subsets only split into smaller subsets, so increasing order visits
+    // both halves before the whole. Enumerating the halves that hold the
+    // lowest leaf sees every partition once.
+    U32 full = (1u << leafCount) - 1;
+    for (U32 subset = 1; subset <= full; ++subset) {
+        if (PopCount(subset) == 1) {
+            U32 leaf = treelet.leaves[CountTrailingZeros(subset)];
+            treelet.bounds[subset] = tree->bounds[leaf];
+            treelet.cost[subset] = tree->cost[leaf];
+            continue;
+        }
+        U32 lowest = subset & (0 - subset);
+        treelet.bounds[subset] = Union(treelet.bounds[lowest], treelet.bounds[subset ^ lowest]);
+
+        F32 best = F32Infinity();
+        U32 bestPartition = 0;
+        U32 rest = subset ^ lowest;
+        for (U32 other = (rest - 1) & rest;; other = (other - 1) & rest) {
+            U32 part = other | lowest;
+            F32 cost = treelet.cost[part] + treelet.cost[subset ^ part];
+            if (cost < best) {
+                best = cost;
+                bestPartition = part;
+            }
+            if (other == 0) {
+                break;
+            }
+        }
+        treelet.cost[subset] = options.traversalCost * SurfaceArea(treelet.bounds[subset]) + best;
+        treelet.partition[subset] = U8(bestPartition);
+    }
+
+    if (treelet.cost[full] < tree->cost[root]) {
+        treelet.internalsUsed = 0;
+        TreeletEmit(tree, &treelet, full, root);
+    }
+}
+
+// Walks up from every leaf in parallel. The second thread to reach a node
+// knows both subtrees are final and handles it, the first one stops. Nodes
+// over at least minTreeletSize primitives restructure their treelet first,
+// zero turns that off.
+static void LinearBottomUp(LinearTree* tree, const BvhBuildOptions& options, U32 minTreeletSize) {
+    U32 count = tree->count;
+    ParallelFor(count - 1, TC_BVH_TASK_SIZE * 16, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            tree->visits[i].store(0, std::memory_order_relaxed);
+        }
+    });
+
+    ParallelFor(count, TC_BVH_TASK_SIZE * 4, [&](U64 begin, U64 end) {
+        for (U64 leaf = begin; leaf < end; ++leaf) {
+            U32 node = tree->parent[count - 1 + leaf];
+            while (node != TC_U32_MAX && tree->visits[node].fetch_add(1, std::memory_order_acq_rel) == 1) {
+                if (minTreeletSize && tree->size[node] >= minTreeletSize) {
+                    RestructureTreelet(tree, node, options);
+                }
+                LinearUpdateNode(tree, node, options);
+                node = tree->parent[node];
+            }
+        }
+    });
+}
+
+struct LinearEmitRange {
+    const LinearTree* tree;
+    BvhNode* nodes;
+    U32 node;
+    U32 slot;
+    U32 next;
+};
+
+static void LinearEmit(LinearEmitRange* range);
+
+static void LinearEmitTask(void* context) {
+    LinearEmit((LinearEmitRange*) context);
+}
+
+// Writes node to its slot and its descendants from next onwards, children as
+// a pair followed by the left subtree and then the right one. Parents always
+// come before their children, as in the binned builder.
+static void LinearEmit(LinearEmitRange* range) {
+    const LinearTree* tree = range->tree;
+    U32 node = range->node;
+    if (!IsInternal(tree, node)) {
+        range->nodes[range->slot] = {tree->bounds[node], node - (tree->count - 1), 1};
+        return;
+    }
+    range->nodes[range->slot] = {tree->bounds[node], range->next, 0};
+
+    U32 left = tree->left[node];
+    U32 right = tree->right[node];
+    U32 leftNext = range->next + 2;
+    LinearEmitRange leftRange = {tree, range->nodes, left, range->next, leftNext};
+    LinearEmitRange rightRange = {tree, range->nodes, right, range->next + 1, leftNext + 2 * (tree->size[left] - 1)};
+    if (tree->size[left] >= TC_BVH_TASK_SIZE && tree->size[right] >= TC_BVH_TASK_SIZE) {
+        TaskGroup group = {{0}};
+        TaskRun(&group, LinearEmitTask, &leftRange);
+        LinearEmit(&rightRange);
+        TaskWait(&group);
+    }
+    else {
+        LinearEmit(&leftRange);
+        LinearEmit(&rightRange);
+    }
+}
+
+template <typename K>
+static void BuildLinearKeys(Bvh* bvh, const Box3* bounds, const Vec3* centroids, U32 count, const BvhBuildOptions& options) {
+    const U32 axisBits = sizeof(K) == 4 ? 10 : 21;
+    const F32 axisCells = F32(1u << axisBits);
+
+    Box3 centroidBounds = Box3Empty();
+    std::mutex mutex;
+    ParallelFor(count, TC_BVH_TASK_SIZE * 16, [&](U64 begin, U64 end) {
+        Box3 local = Box3Empty();
+        for (U64 i = begin; i < end; ++i) {
+            local = Union(local, centroids ? centroids[i] : Centroid(bounds[i]));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        centroidBounds = Union(centroidBounds, local);
+    });
+
+    Vec3 scale;
+    for (int axis = 0; axis < 3; ++axis) {
+        F32 extent = centroidBounds.max.raw[axis] - centroidBounds.min.raw[axis];
+        scale.raw[axis] = extent > 0 ? axisCells / extent : 0;
+    }
+
+    K* keys = (K*) malloc(count * sizeof(K));
+    K* scratchKeys = (K*) malloc(count * sizeof(K));
+    U32* indices = (U32*) malloc(count * sizeof(U32));
+    U32* scratchIndices = (U32*) malloc(count * sizeof(U32));
+    ParallelFor(count, TC_BVH_TASK_SIZE * 16, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            Vec3 centroid = centroids ? centroids[i] : Centroid(bounds[i]);
+            K key = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                F32 cell = (centroid.raw[axis] - centroidBounds.min.raw[axis]) * scale.raw[axis];
+                key |= MortonExpand(K(TC_CLAMP(cell, 0.0f, axisCells - 1.0f))) << (2 - axis);
+            }
+            keys[i] = key;
+            indices[i] = U32(i);
+        }
+    });
+    RadixSort(keys, indices, scratchKeys, scratchIndices, count, axisBits * 3);
+    free(scratchKeys);
+    free(scratchIndices);
+
+    U64 nodeCount = 2 * U64(count) - 1;
+    LinearTree tree;
+    tree.count = count;
+    tree.left = (U32*) malloc(count * sizeof(U32));
+    tree.right = (U32*) malloc(count * sizeof(U32));
+    tree.parent = (U32*) malloc(nodeCount * sizeof(U32));
+    tree.size = (U32*) malloc(nodeCount * sizeof(U32));
+    tree.bounds = (Box3*) malloc(nodeCount * sizeof(Box3));
+    tree.cost = (F32*) malloc(nodeCount * sizeof(F32));
+    tree.visits = new std::atomic<U32>[count];
+    tree.parent[0] = TC_U32_MAX;
+
+    ParallelFor(count, TC_BVH_TASK_SIZE * 16, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            U32 leaf = count - 1 + U32(i);
+            tree.bounds[leaf] = bounds[indices[i]];
+            tree.size[leaf] = 1;
+            tree.cost[leaf] = options.intersectionCost * SurfaceArea(tree.bounds[leaf]);
+        }
+    });
+    ParallelFor(count - 1, TC_BVH_TASK_SIZE * 4, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            LinearInternalNode(&tree, keys, S64(i));
+        }
+    });
+    free(keys);
+
+    // Later passes only revisit larger subtrees, where the first pass left
+    // the most to gain
+    LinearBottomUp(&tree, options, 0);
+    if (options.quality == BVH_BUILD_QUALITY_MEDIUM) {
+        for (U32 pass = 0; pass < options.treeletPasses; ++pass) {
+            LinearBottomUp(&tree, options, TC_BVH_TREELET_SIZE << pass);
+        }
+    }
+
+    bvh->nodes = BvhAllocateNodes(nodeCount);
+    // With a single primitive node 0 is its leaf rather than an internal node
+    LinearEmitRange root = {&tree, bvh->nodes, 0, 0, 1};
+    LinearEmit(&root);
+    bvh->nodeCount = U32(nodeCount);
+    bvh->indices = indices;
+    bvh->primitiveCount = count;
+    bvh->referenceCount = count;
+
+    free(tree.left);
+    free(tree.right);
+    free(tree.parent);
+    free(tree.size);
+    free(tree.bounds);
+    free(tree.cost);
+    delete[] tree.visits;
+}
+
+static void BuildLinear(Bvh* bvh, const Box3* bounds, const Vec3* centroids, U32 count, const BvhBuildOptions& options) {
+    if (options.mortonBits > 30) {
+        BuildLinearKeys<U64>(bvh, bounds, centroids, count, options);
+    }
+    else {
+        BuildLinearKeys<U32>(bvh, bounds, centroids, count, options);
+    }
+}
+
+static void FinishStats(const Bvh* bvh, const BvhBuildOptions& options, U64 start, U32 spatialSplitCount, BvhBuildStats* stats) {
+    if (!stats) {
+        return;
+    }
+    *stats = {};
+    if (bvh->nodeCount > 0) {
+        CollectStats(bvh, 0, 0, stats);
+    }
+    stats->nodeCount = bvh->nodeCount;
+    stats->sahCost = BvhSahCost(bvh, options);
+    stats->referenceCount = bvh->referenceCount;
+    stats->spatialSplitCount = spatialSplitCount;
+    stats->seconds = TimerSeconds(start, TimerNow());
+}
+
+void BvhBuild(Bvh* bvh, const Box3* bounds, const Vec3* centroids, U32 count, const BvhBuildOptions& options, BvhBuildStats* stats) {
+    U64 start = TimerNow();
+    *bvh = {};
+    if (count == 0) {
+        FinishStats(bvh, options, start, 0, stats);
+        return;
+    }
+
+    U32 spatialSplitCount = 0;
+    if (options.quality == BVH_BUILD_QUALITY_HIGH || options.quality == BVH_BUILD_QUALITY_SPATIAL) {
+        BuildBinned(bvh, bounds, centroids, count, options, 0, 0, &spatialSplitCount);
+    }
+    else {
+        BuildLinear(bvh, bounds, centroids, count, options);
+    }
+    FinishStats(bvh, options, start, spatialSplitCount, stats);
+}
+
+void BvhBuildTriangles(Bvh* bvh, const Vec3* positions, const U32* triangles, U32 count, const BvhBuildOptions& options, BvhBuildStats* stats) {
+    U64 start = TimerNow();
+    Box3* bounds = (Box3*) malloc(TC_MAX(count, 1u) * sizeof(Box3));
+    ParallelFor(count, TC_BVH_TASK_SIZE * 16, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            Vec3 triangle[3];
+            TriangleOf(positions, triangles, U32(i), triangle);
+            bounds[i] = Union(Union(Box3{triangle[0], triangle[0]}, triangle[1]), triangle[2]);
+        }
+    });
+
+    if (options.quality != BVH_BUILD_QUALITY_SPATIAL || count == 0) {
+        BvhBuild(bvh, bounds, 0, count, options, stats);
+    }
+    else {
+        *bvh = {};
+        U32 spatialSplitCount = 0;
+        BuildBinned(bvh, bounds, 0, count, options, positions, triangles, &spatialSplitCount);
+        FinishStats(bvh, options, start, spatialSplitCount, stats);
+    }
+    free(bounds);
+}
+
+void BvhFree(Bvh* bvh) {
+    BvhFreeNodes(bvh->nodes);
+    free(bvh->indices);
+    *bvh = {};
+}
+
+// Set by BvhReorder, nodes[1] of a freshly built tree is the root's first
+// child, which cannot point at the root's own children
+static bool HasRootCopy(const Bvh* bvh) {
+    return bvh->nodeCount > 2 && bvh->nodes[1].count == 0 && bvh->nodes[1].offset == bvh->nodes[0].offset;
+}
+
+void BvhParents(const Bvh* bvh, U32* parents) {
+    TC_ASSERT(bvh->nodeCount < (1u << 31), "Stackless states hold node indices in 31 bits");
+    for (U32 i = 0; i < bvh->nodeCount; ++i) {
+        parents[i] = TC_U32_MAX;
+    }
+    bool rootCopy = HasRootCopy(bvh);
+    for (U32 i = 0; i < bvh->nodeCount; ++i) {
+        const BvhNode* node = bvh->nodes + i;
+        if (node->count == 0 && !(i == 1 && rootCopy)) {
+            parents[node->offset] = i;
+            parents[node->offset + 1] = i;
+        }
+    }
+}
+
+F32 BvhSahCost(const Bvh* bvh, const BvhBuildOptions& options) {
+    if (bvh->nodeCount == 0) {
+        return 0;
+    }
+    F32 rootArea = SurfaceArea(bvh->nodes[0].bounds);
+    F64 cost = 0;
+    bool rootCopy = HasRootCopy(bvh);
+    for (U32 i = 0; i < bvh->nodeCount; ++i) {
+        if (i == 1 && rootCopy) {
+            continue;
+        }
+        const BvhNode* node = bvh->nodes + i;
+        F64 area = SurfaceArea(node->bounds);
+        if (node->count > 0) {
+            cost += options.intersectionCost * node->count * area;
+        }
+        else {
+            cost += options.traversalCost * area;
+        }
+    }
+    return rootArea > 0 ? F32(cost / rootArea) : F32(cost);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Node layout
+
+// Sibling pairs are named by the index of their first node
+struct BvhLayoutPair {
+    F32 area;
+    U32 pair;
+};
+
+static bool operator<(BvhLayoutPair a, BvhLayoutPair b) {
+    return a.area < b.area;
+}
+
+// Appends the pairs of the subtree under pair to order, each followed by the
+// subtree of its larger child. With clusters only pairs of the given cluster
+// are visited. stack has room for one entry per pair.
+static U32 LayoutDepthFirst(const Bvh* bvh, U32 pair, const U32* clusters, U32 cluster, U32* order, U32 orderCount, U32* stack) {
+    U32 stackSize = 0;
+    stack[stackSize++] = pair;
+    while (stackSize > 0) {
+        pair = stack[--stackSize];
+        order[orderCount++] = pair;
+        const BvhNode* children = bvh->nodes + pair;
+        U32 hot = SurfaceArea(children[1].bounds) > SurfaceArea(children[0].bounds);
+        for (U32 k = 0; k < 2; ++k) {
+            const BvhNode* child = children + (k ^ hot ^ 1);
+            if (child->count == 0 && (!clusters || clusters[child->offset] == cluster)) {
+                stack[stackSize++] = child->offset;
+            }
+        }
+    }
+    return orderCount;
+}
+
+static U32 LayoutBreadthFirst(const Bvh* bvh, U32* order) {
+    U32 orderCount = 0;
+    order[orderCount++] = bvh->nodes[0].offset;
+    for (U32 head = 0; head < orderCount; ++head) {
+        for (U32 k = 0; k < 2; ++k) {
+            const BvhNode* child = bvh->nodes + order[head] + k;
+            if (child->count == 0) {
+                order[orderCount++] = child->offset;
+            }
+        }
+    }
+    return orderCount;
+}
+
+// Grows each cluster from its root pair by taking the pair under the largest
+// node bordering it, the one a ray entering the cluster most likely reaches
+// next. The pairs left bordering a full cluster root the clusters after it.
+static U32 LayoutClustered(const Bvh* bvh, U32* order, U32* stack) {
+    const U32 clusterSize = TC_BVH_PAGE_SIZE / (2 * sizeof(BvhNode));
+    U32* clusters = (U32*) malloc(bvh->nodeCount * sizeof(U32));
+    U32* roots = (U32*) malloc(bvh->nodeCount * sizeof(U32));
+    memset(clusters, 0xff, bvh->nodeCount * sizeof(U32));
+    BvhLayoutPair heap[2 * clusterSize + 2];
+    U32 orderCount = 0;
+    U32 rootCount = 0;
+    roots[rootCount++] = bvh->nodes[0].offset;
+
+    // The root and its copy take the first cache line of the first page
+    for (U32 cluster = 0, size = clusterSize - 1; rootCount > 0; ++cluster, size = clusterSize) {
+        U32 root = roots[--rootCount];
+        U32 heapSize = 0;
+        heap[heapSize++] = {F32Infinity(), root};
+        for (U32 taken = 0; taken < size && heapSize > 0; ++taken) {
+            std::pop_heap(heap, heap + heapSize--);
+            U32 pair = heap[heapSize].pair;
+            clusters[pair] = cluster;
+            for (U32 k = 0; k < 2; ++k) {
+                const BvhNode* child = bvh->nodes + pair + k;
+                if (child->count == 0) {
+                    heap[heapSize++] = {SurfaceArea(child->bounds), child->offset};
+                    std::push_heap(heap, heap + heapSize);
+                }
+            }
+        }
+        orderCount = LayoutDepthFirst(bvh, root, clusters, cluster, order, orderCount, stack);
+
+        // Largest border pair on top, so its cluster follows this one
+        std::sort_heap(heap, heap + heapSize);
+        for (U32 i = 0; i < heapSize; ++i) {
+            roots[rootCount++] = heap[i].pair;
+        }
+    }
+
+    free(clusters);
+    free(roots);
+    return orderCount;
+}
+
+void BvhReorder(Bvh* bvh, BvhLayout layout) {
+    if (bvh->nodeCount < 3) {
+        return;
+    }
+
+    U32* order = (U32*) malloc(bvh->nodeCount * sizeof(U32));
+    U32* stack = (U32*) malloc(bvh->nodeCount * sizeof(U32));
+    U32 pairCount = 0;
+    switch (layout) {
+    case BVH_LAYOUT_DEPTH_FIRST:
+        pairCount = LayoutDepthFirst(bvh, bvh->nodes[0].offset, 0, 0, order, 0, stack);
+        break;
+    case BVH_LAYOUT_BREADTH_FIRST:
+        pairCount = LayoutBreadthFirst(bvh, order);
+        break;
+    case BVH_LAYOUT_CLUSTERED:
+        pairCount = LayoutClustered(bvh, order, stack);
+        break;
+    }
+
+    // The new index of every pair, kept at the index of its first node
+    U32* remap = stack;
+    for (U32 i = 0; i < pairCount; ++i) {
+        remap[order[i]] = 2 + 2 * i;
+    }
+
+    U32 nodeCount = 2 + 2 * pairCount;
+    BvhNode* nodes = BvhAllocateNodes(nodeCount);
+    nodes[0] = bvh->nodes[0];
+    nodes[0].offset = 2;
+    nodes[1] = nodes[0];
+    for (U32 i = 0; i < pairCount; ++i) {
+        for (U32 k = 0; k < 2; ++k) {
+            BvhNode node = bvh->nodes[order[i] + k];
+            if (node.count == 0) {
+                node.offset = remap[node.offset];
+            }
+            nodes[2 + 2 * i + k] = node;
+        }
+    }
+
+    BvhFreeNodes(bvh->nodes);
+    bvh->nodes = nodes;
+    bvh->nodeCount = nodeCount;
+    free(order);
+    free(stack);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Wide BVH collapse
+
+// Binary nodes that become the children of the wide node standing for the
+// binary node, found by opening the largest interior child until N are
+// reached or only leaves remain. A leaf stands for itself.
+template <int N>
+static U32 CollapseNode(const Bvh* bvh, U32 binary, U32* children) {
+    U32 count = 0;
+    const BvhNode* root = bvh->nodes + binary;
+    if (root->count > 0) {
+        children[count++] = binary;
+        return count;
+    }
+    children[count++] = root->offset;
+    children[count++] = root->offset + 1;
+
+    while (count < U32(N)) {
+        S32 largest = -1;
+        F32 largestArea = -1;
+        for (U32 i = 0; i < count; ++i) {
+            const BvhNode* node = bvh->nodes + children[i];
+            F32 area = SurfaceArea(node->bounds);
+            if (node->count == 0 && area > largestArea) {
+                largest = S32(i);
+                largestArea = area;
+            }
+        }
+        if (largest < 0) {
+            break;
+        }
+        U32 opened = children[largest];
+        children[largest] = bvh->nodes[opened].offset;
+        children[count++] = bvh->nodes[opened].offset + 1;
+    }
+    return count;
+}
+
+template <int N>
+void WideBvhBuild(WideBvh<N>* wide, const Bvh* bvh) {
+    *wide = {};
+    if (bvh->nodeCount == 0) {
+        return;
+    }
+
+    // Every wide node but the root replaces at least two binary nodes
+    U32 capacity = bvh->nodeCount / 2 + 1;
+    wide->nodes = (WideBvhNode<N>*) malloc(capacity * sizeof(WideBvhNode<N>));
+    wide->indices = (U32*) malloc(bvh->referenceCount * sizeof(U32));
+    memcpy(wide->indices, bvh->indices, bvh->referenceCount * sizeof(U32));
+    wide->primitiveCount = bvh->primitiveCount;
+    wide->referenceCount = bvh->referenceCount;
+
+    // Pairs of wide node and the binary node it stands for, in breadth first
+    // order so nodes near the root sit together in memory
+    U32* queue = (U32*) malloc(capacity * sizeof(U32));
+    U32 queueHead = 0;
+    queue[0] = 0;
+    wide->nodeCount = 1;
+
+    while (queueHead < wide->nodeCount) {
+        U32 index = queueHead;
+        U32 binary = queue[queueHead++];
+        U32 children[N];
+        U32 count = CollapseNode<N>(bvh, binary, children);
+
+        WideBvhNode<N>* node = wide->nodes + index;
+        for (U32 i = 0; i < U32(N); ++i) {
+            Box3 bounds = Box3Empty();
+            U32 child = TC_U32_MAX;
+            U32 primitives = 0;
+            if (i < count) {
+                const BvhNode* source = bvh->nodes + children[i];
+                bounds = source->bounds;
+                if (source->count > 0) {
+                    child = source->offset;
+                    primitives = source->count;
+                }
+                else {
+                    TC_ASSERT(wide->nodeCount < capacity);
+                    child = wide->nodeCount++;
+                    queue[child] = children[i];
+                }
+            }
+            node->minX[i] = bounds.min.x;
+            node->minY[i] = bounds.min.y;
+            node->minZ[i] = bounds.min.z;
+            node->maxX[i] = bounds.max.x;
+            node->maxY[i] = bounds.max.y;
+            node->maxZ[i] = bounds.max.z;
+            node->child[i] = child;
+            node->count[i] = primitives;
+        }
+    }
+
+    free(queue);
+    wide->nodes = (WideBvhNode<N>*) realloc(wide->nodes, wide->nodeCount * sizeof(WideBvhNode<N>));
+}
+
+template <int N>
+void WideBvhFree(WideBvh<N>* wide) {
+    free(wide->nodes);
+    free(wide->indices);
+    *wide = {};
+}
+
+template void WideBvhBuild<4>(WideBvh<4>* wide, const Bvh* bvh);
+template void WideBvhBuild<8>(WideBvh<8>* wide, const Bvh* bvh);
+template void WideBvhFree<4>(WideBvh<4>* wide);
+template void WideBvhFree<8>(WideBvh<8>* wide);
+
+////////////////////////////////////////////////////////////////////////////////
+// Refit
+
+// Each subtree gathers its leaves' primitive bounds, which is most of the
+// work, and unions its interior nodes on the way back up, in parallel
+void BvhRefit(Bvh* bvh, const Box3* bounds) {
+    BvhBottomUp(bvh, [&](U32 i) {
+        BvhNode* node = bvh->nodes + i;
+        Box3 box = Box3Empty();
+        for (U32 k = 0; k < node->count; ++k) {
+            box = Union(box, bounds[bvh->indices[node->offset + k]]);
+        }
+        node->bounds = box;
+    }, [&](U32 i) {
+        BvhNode* node = bvh->nodes + i;
+        node->bounds = Union(bvh->nodes[node->offset].bounds, bvh->nodes[node->offset + 1].bounds);
+    });
+}
+
+bool BvhUpdate(Bvh* bvh, const Box3* bounds, const Vec3* centroids, BvhQualityMonitor* monitor, const BvhBuildOptions& options) {
+    if (monitor->buildCost == 0) {
+        monitor->buildCost = BvhSahCost(bvh, options);
+    }
+    BvhRefit(bvh, bounds);
+    monitor->cost = BvhSahCost(bvh, options);
+    if (monitor->cost <= monitor->threshold * monitor->buildCost) {
+        monitor->refitCount++;
+        return false;
+    }
+
+    U32 count = bvh->primitiveCount;
+    BvhBuildStats stats;
+    BvhFree(bvh);
+    BvhBuild(bvh, bounds, centroids, count, options, &stats);
+    monitor->buildCost = stats.sahCost;
+    monitor->cost = stats.sahCost;
+    monitor->rebuildCount++;
+    return true;
+}
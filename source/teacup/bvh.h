@@ -0,0 +1,640 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_BVH_HEADER_GUARD
+#define TC_BVH_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+#include <teacup/parallel.h>
+#include <teacup/ray.h>
+#include <teacup/wide.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Bounding volume hierarchy
+
+// Interior nodes have count zero and their two children at nodes[offset] and
+// nodes[offset + 1]. Leaves reference count primitives starting at
+// indices[offset]. Two nodes share a 64 byte cache line.
+struct BvhNode {
+    Box3 bounds;
+    U32 offset;
+    U32 count;
+};
+
+TC_STATIC_ASSERT(sizeof(BvhNode) == 32);
+
+// Binary tree over primitives given by their bounds. nodes[0] is the root.
+// Spatial splits can place a primitive in several leaves, so indices holds
+// referenceCount entries, at least primitiveCount. nodes starts on a cache
+// line, see BvhReorder for lining up sibling pairs with cache lines.
+struct Bvh {
+    BvhNode* nodes;
+    U32* indices;
+    U32 nodeCount;
+    U32 primitiveCount;
+    U32 referenceCount;
+};
+
+// Trades build time for traversal speed, pick per asset
+enum BvhBuildQuality {
+    // Linear BVH from sorted Morton codes, for geometry rebuilt every frame
+    BVH_BUILD_QUALITY_FAST,
+
+    // Linear BVH followed by treelet restructuring towards lower SAH cost
+    BVH_BUILD_QUALITY_MEDIUM,
+
+    // Binned SAH, for static geometry
+    BVH_BUILD_QUALITY_HIGH,
+
+    // Binned SAH that may also split triangles at bin planes, for long thin
+    // triangles whose boxes overlap heavily. Only BvhBuildTriangles has the
+    // triangles to split, BvhBuild treats it as BVH_BUILD_QUALITY_HIGH.
+    BVH_BUILD_QUALITY_SPATIAL,
+};
+
+struct BvhBuildOptions {
+    BvhBuildQuality quality = BVH_BUILD_QUALITY_HIGH;
+
+    // Centroid bins per axis and split candidate, at most TC_BVH_MAX_BINS
+    U32 binCount = 16;
+
+    // Leaves never hold more primitives than this. Linear BVHs always put one
+    // primitive in each leaf.
+    U32 maxLeafSize = 8;
+
+    // Morton code length for linear BVHs, 30 or 63. Longer codes separate
+    // primitives in scenes with a large spread of sizes at the cost of twice
+    // the sorting work.
+    U32 mortonBits = 30;
+
+    // Bottom-up restructuring passes over treelets of TC_BVH_TREELET_SIZE
+    // leaves for BVH_BUILD_QUALITY_MEDIUM. Every pass after the first only
+    // visits subtrees at least twice as large as the one before.
+    U32 treeletPasses = 1;
+
+    // Relative costs of visiting a node and testing a primitive, used both
+    // to pick splits and to decide when to stop splitting
+    F32 traversalCost = 1.0f;
+    F32 intersectionCost = 1.0f;
+
+    // Ranges with at least this many primitives bin and partition in
+    // parallel, smaller ones build as a single task per subtree
+    U32 parallelThreshold = 64 * 1024;
+
+    // Spatial splits are only tried where the children of the best object
+    // split overlap by more than this fraction of the root's surface area
+    F32 spatialSplitOverlap = 1e-5f;
+
+    // Caps the references spatial splits may add, as a fraction of the
+    // primitive count. Each subtree gets a share in proportion to its size.
+    F32 spatialSplitBudget = 1.0f;
+};
+
+#define TC_BVH_MAX_BINS 64
+#define TC_BVH_TREELET_SIZE 7
+
+struct BvhBuildStats {
+    F64 seconds;
+    F32 sahCost;
+    U32 nodeCount;
+    U32 leafCount;
+    U32 maxDepth;
+
+    // Primitive references in leaves and the spatial splits that duplicated
+    // some of them. sahCost compares directly with a build without spatial
+    // splits to measure what they save.
+    U32 referenceCount;
+    U32 spatialSplitCount;
+};
+
+// Builds over count primitives with the method options.quality selects.
+// centroids may be null to use the centers of the bounds. stats is optional.
+void BvhBuild(Bvh* bvh, const Box3* bounds, const Vec3* centroids, U32 count, const BvhBuildOptions& options = {}, BvhBuildStats* stats = 0);
+
+// Builds over triangles, whose corners are positions[triangles[3 * i + k]],
+// or positions[3 * i + k] when triangles is null. Needed for
+// BVH_BUILD_QUALITY_SPATIAL, other qualities build over the triangle bounds.
+void BvhBuildTriangles(Bvh* bvh, const Vec3* positions, const U32* triangles, U32 count, const BvhBuildOptions& options = {}, BvhBuildStats* stats = 0);
+void BvhFree(Bvh* bvh);
+
+// Cache line aligned node arrays of the kind BvhFree releases, for code that
+// grows a BVH in place
+BvhNode* BvhAllocateNodes(U64 count);
+void BvhFreeNodes(BvhNode* nodes);
+
+// Expected cost of a random ray relative to testing it against the root box
+F32 BvhSahCost(const Bvh* bvh, const BvhBuildOptions& options = {});
+
+// Recomputes every node's bounds bottom-up from new primitive bounds, keeping
+// the topology. bounds holds bvh->primitiveCount boxes in the original order.
+// Leaves with split primitives get their whole boxes, which stays correct
+// but loosens what the spatial splits had tightened.
+void BvhRefit(Bvh* bvh, const Box3* bounds);
+
+#define TC_BVH_BOTTOM_UP_SUBTREES 128
+
+// Post-order walk of one subtree for BvhBottomUp
+template <typename L, typename I>
+void BvhBottomUpSubtree(const Bvh* bvh, U32 index, L& leaf, I& interior) {
+    const BvhNode* node = bvh->nodes + index;
+    if (node->count > 0) {
+        leaf(index);
+        return;
+    }
+    BvhBottomUpSubtree(bvh, node->offset, leaf, interior);
+    BvhBottomUpSubtree(bvh, node->offset + 1, leaf, interior);
+    interior(index);
+}
+
+// Calls leaf(node) for every leaf and interior(node) for every interior node
+// after both its children. The top of the tree is split breadth first into
+// up to TC_BVH_BOTTOM_UP_SUBTREES subtrees that run in parallel, then the few
+// nodes above them run on the calling thread. A root copy at nodes[1] is
+// handled last.
+template <typename L, typename I>
+void BvhBottomUp(const Bvh* bvh, L leaf, I interior) {
+    if (bvh->nodeCount == 0) {
+        return;
+    }
+
+    // list[0, top) are the nodes above the subtrees, list[top, count) the
+    // subtree roots
+    U32 list[TC_BVH_BOTTOM_UP_SUBTREES];
+    U32 count = 1;
+    U32 top = 0;
+    list[0] = 0;
+    while (top < count && count + 2 <= TC_BVH_BOTTOM_UP_SUBTREES) {
+        const BvhNode* node = bvh->nodes + list[top++];
+        if (node->count == 0) {
+            list[count++] = node->offset;
+            list[count++] = node->offset + 1;
+        }
+    }
+
+    ParallelFor(count - top, 1, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            BvhBottomUpSubtree(bvh, list[top + i], leaf, interior);
+        }
+    });
+    for (U32 i = top; i-- > 0;) {
+        if (bvh->nodes[list[i]].count > 0) {
+            leaf(list[i]);
+        }
+        else {
+            interior(list[i]);
+        }
+    }
+
+    const BvhNode* copy = bvh->nodes + 1;
+    if (bvh->nodeCount > 2 && copy->count == 0 && copy->offset == bvh->nodes[0].offset) {
+        interior(1u);
+    }
+}
+
+// Refitting keeps the neighbourhoods of the last build, so as primitives move
+// apart the SAH cost creeps up. BvhUpdate rebuilds instead of refitting once
+// the cost passes threshold times the cost right after the last build.
+struct BvhQualityMonitor {
+    F32 threshold = 1.5f;
+
+    // Zero until the first BvhUpdate, which takes the cost of the tree as it
+    // comes in
+    F32 buildCost = 0;
+    F32 cost = 0;
+    U32 refitCount = 0;
+    U32 rebuildCount = 0;
+};
+
+// Refits bvh to the new bounds, or rebuilds it with options when the monitor
+// says quality has degraded too far. Returns true after a rebuild.
+bool BvhUpdate(Bvh* bvh, const Box3* bounds, const Vec3* centroids, BvhQualityMonitor* monitor, const BvhBuildOptions& options = {});
+
+// Order of the nodes in memory. Siblings always stay side by side, the
+// layouts differ in which pairs end up near each other.
+enum BvhLayout {
+    // Each pair is followed by the subtree under the child with the larger
+    // surface area, which random rays are likelier to enter
+    BVH_LAYOUT_DEPTH_FIRST,
+
+    // Level by level, mostly as a baseline to compare against
+    BVH_LAYOUT_BREADTH_FIRST,
+
+    // Treelets grown from their root towards the nodes with the largest
+    // surface area until they fill TC_BVH_PAGE_SIZE bytes, each laid out depth
+    // first, so a ray touches few pages as well as few cache lines
+    BVH_LAYOUT_CLUSTERED,
+};
+
+#define TC_BVH_PAGE_SIZE 4096
+
+// Rewrites the nodes in the given layout. The root stays at nodes[0] and
+// nodes[1] becomes an unreachable copy of it, so every sibling pair after it
+// fills exactly one cache line. Traversal results and BvhSahCost do not
+// change.
+void BvhReorder(Bvh* bvh, BvhLayout layout);
+
+#define TC_BVH_STACK_SIZE 128
+
+// Visits the primitives of every leaf the ray reaches, nearer child first.
+// intersector(primitive, &ray) may lower ray.tMax on a hit to prune farther
+// nodes, including far children already on the stack, and returns false to
+// stop the traversal early.
+template <typename F>
+void Traverse(const Bvh* bvh, RaySlab ray, F intersector) {
+    struct Entry {
+        U32 node;
+        F32 t;
+    };
+
+    if (bvh->nodeCount == 0) {
+        return;
+    }
+
+    Entry stack[TC_BVH_STACK_SIZE];
+    U32 stackSize = 0;
+    U32 current = 0;
+    F32 tEntry, tExit;
+    if (!Intersect(ray, bvh->nodes[0].bounds, &tEntry, &tExit)) {
+        return;
+    }
+
+    for (;;) {
+        const BvhNode* node = bvh->nodes + current;
+        if (node->count > 0) {
+            for (U32 i = 0; i < node->count; ++i) {
+                if (!intersector(bvh->indices[node->offset + i], &ray)) {
+                    return;
+                }
+            }
+        }
+        else {
+            F32 entry0, entry1;
+            bool hit0 = Intersect(ray, bvh->nodes[node->offset].bounds, &entry0, &tExit);
+            bool hit1 = Intersect(ray, bvh->nodes[node->offset + 1].bounds, &entry1, &tExit);
+            if (hit0 && hit1) {
+                U32 nearChild = node->offset + (entry1 < entry0);
+                U32 farChild = node->offset + (entry1 >= entry0);
+                TC_ASSERT(stackSize < TC_BVH_STACK_SIZE);
+                stack[stackSize++] = {farChild, TC_MAX(entry0, entry1)};
+                current = nearChild;
+                continue;
+            }
+            if (hit0 || hit1) {
+                current = node->offset + hit1;
+                continue;
+            }
+        }
+
+        // Hits since the push may have moved tMax in front of a far child
+        Entry entry;
+        do {
+            if (stackSize == 0) {
+                return;
+            }
+            entry = stack[--stackSize];
+        } while (entry.t > ray.tMax);
+        current = entry.node;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Wide bounding volume hierarchy
+
+// Up to N children per node with their bounds stored plane by plane, so one
+// slab test covers every child. A child with count zero is the interior node
+// nodes[child], otherwise a leaf with count primitives from indices[child].
+// Unused slots hold inverted bounds that no ray hits.
+template <int N>
+struct WideBvhNode {
+    F32 minX[N];
+    F32 minY[N];
+    F32 minZ[N];
+    F32 maxX[N];
+    F32 maxY[N];
+    F32 maxZ[N];
+    U32 child[N];
+    U32 count[N];
+};
+
+template <int N>
+struct WideBvh {
+    WideBvhNode<N>* nodes;
+    U32* indices;
+    U32 nodeCount;
+    U32 primitiveCount;
+    U32 referenceCount;
+};
+
+typedef WideBvh<4> WideBvh4;
+typedef WideBvh<8> WideBvh8;
+
+// Lane type testing all children of a node at once. Builds without AVX2 run
+// the 8-wide tree as two 4-wide halves.
+template <int N> struct WideBvhLanes;
+template <> struct WideBvhLanes<4> { typedef F32x4 Type; };
+template <> struct WideBvhLanes<8> { typedef F32x8 Type; };
+
+// Collapses a binary tree by repeatedly opening the child with the largest
+// surface area until a node has N children. Leaves are kept as they are.
+template <int N>
+void WideBvhBuild(WideBvh<N>* wide, const Bvh* bvh);
+
+template <int N>
+void WideBvhFree(WideBvh<N>* wide);
+
+#define TC_WIDE_BVH_STACK_SIZE (TC_BVH_STACK_SIZE * 8)
+
+// Same contract as the binary Traverse. Children a ray hits are pushed far to
+// near, and entries whose distance is past the current tMax are skipped when
+// popped.
+template <int N, typename F>
+void Traverse(const WideBvh<N>* bvh, RaySlab ray, F intersector) {
+    typedef typename WideBvhLanes<N>::Type T;
+
+    struct Entry {
+        U32 child;
+        U32 count;
+        F32 t;
+    };
+
+    if (bvh->nodeCount == 0) {
+        return;
+    }
+
+    Entry stack[TC_WIDE_BVH_STACK_SIZE];
+    U32 stackSize = 0;
+    stack[stackSize++] = {0, 0, ray.tMin};
+
+    while (stackSize > 0) {
+        Entry entry = stack[--stackSize];
+        if (entry.t > ray.tMax) {
+            continue;
+        }
+
+        if (entry.count > 0) {
+            for (U32 i = 0; i < entry.count; ++i) {
+                if (!intersector(bvh->indices[entry.child + i], &ray)) {
+                    return;
+                }
+            }
+            continue;
+        }
+
+        const WideBvhNode<N>* node = bvh->nodes + entry.child;
+        Box3Packet<T> box = {
+            {Load<T>(node->minX), Load<T>(node->minY), Load<T>(node->minZ)},
+            {Load<T>(node->maxX), Load<T>(node->maxY), Load<T>(node->maxZ)},
+        };
+        T tEntry, tExit;
+        U32 mask = MoveMask(Intersect(ray, box, &tEntry, &tExit));
+        if (mask == 0) {
+            continue;
+        }
+
+        F32 entries[N];
+        Store(entries, tEntry);
+
+        // Insertion sort of the hit children, farthest first
+        U32 first = stackSize;
+        while (mask) {
+            U32 i = CountTrailingZeros(mask);
+            mask &= mask - 1;
+            Entry hit = {node->child[i], node->count[i], entries[i]};
+            U32 k = stackSize++;
+            for (; k > first && stack[k - 1].t < hit.t; --k) {
+                stack[k] = stack[k - 1];
+            }
+            stack[k] = hit;
+        }
+        TC_ASSERT(stackSize <= TC_WIDE_BVH_STACK_SIZE);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Occlusion queries
+
+// Whether anything blocks the ray between tMin and tMax, for shadow rays that
+// need no hit details. occluder(primitive, ray) returns true when the
+// primitive blocks the ray and the traversal stops right there. tMax never
+// shrinks and any blocker will do, so children are taken in the order they
+// are stored without computing or comparing entry distances. Nearer or
+// larger children first visited as many nodes on random shadow rays.
+template <typename F>
+bool Occluded(const Bvh* bvh, RaySlab ray, F occluder) {
+    if (bvh->nodeCount == 0) {
+        return false;
+    }
+
+    U32 stack[TC_BVH_STACK_SIZE];
+    U32 stackSize = 0;
+    U32 current = 0;
+    F32 tEntry, tExit;
+    if (!Intersect(ray, bvh->nodes[0].bounds, &tEntry, &tExit)) {
+        return false;
+    }
+
+    for (;;) {
+        const BvhNode* node = bvh->nodes + current;
+        if (node->count > 0) {
+            for (U32 i = 0; i < node->count; ++i) {
+                if (occluder(bvh->indices[node->offset + i], ray)) {
+                    return true;
+                }
+            }
+        }
+        else {
+            bool hit0 = Intersect(ray, bvh->nodes[node->offset].bounds, &tEntry, &tExit);
+            bool hit1 = Intersect(ray, bvh->nodes[node->offset + 1].bounds, &tEntry, &tExit);
+            if (hit0 && hit1) {
+                TC_ASSERT(stackSize < TC_BVH_STACK_SIZE);
+                stack[stackSize++] = node->offset + 1;
+                current = node->offset;
+                continue;
+            }
+            if (hit0 || hit1) {
+                current = node->offset + hit1;
+                continue;
+            }
+        }
+
+        if (stackSize == 0) {
+            return false;
+        }
+        current = stack[--stackSize];
+    }
+}
+
+// Occluded for the wide tree. Hit children are pushed as they come, with no
+// distances to sort or compare.
+template <int N, typename F>
+bool Occluded(const WideBvh<N>* bvh, RaySlab ray, F occluder) {
+    typedef typename WideBvhLanes<N>::Type T;
+
+    struct Entry {
+        U32 child;
+        U32 count;
+    };
+
+    if (bvh->nodeCount == 0) {
+        return false;
+    }
+
+    Entry stack[TC_WIDE_BVH_STACK_SIZE];
+    U32 stackSize = 0;
+    stack[stackSize++] = {0, 0};
+
+    while (stackSize > 0) {
+        Entry entry = stack[--stackSize];
+        if (entry.count > 0) {
+            for (U32 i = 0; i < entry.count; ++i) {
+                if (occluder(bvh->indices[entry.child + i], ray)) {
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        const WideBvhNode<N>* node = bvh->nodes + entry.child;
+        Box3Packet<T> box = {
+            {Load<T>(node->minX), Load<T>(node->minY), Load<T>(node->minZ)},
+            {Load<T>(node->maxX), Load<T>(node->maxY), Load<T>(node->maxZ)},
+        };
+        T tEntry, tExit;
+        U32 mask = MoveMask(Intersect(ray, box, &tEntry, &tExit));
+        while (mask) {
+            U32 i = CountTrailingZeros(mask);
+            mask &= mask - 1;
+            stack[stackSize++] = {node->child[i], node->count[i]};
+        }
+        TC_ASSERT(stackSize <= TC_WIDE_BVH_STACK_SIZE);
+    }
+    return false;
+}
+
+#define TC_OCCLUSION_BATCH_GRAIN 256
+
+// Occluded for count rays of a Bvh or WideBvh, spread over the worker
+// threads in chunks of TC_OCCLUSION_BATCH_GRAIN rays.
+// occluder(rayIndex, primitive, ray) reports whether the primitive blocks
+// rays[rayIndex], and occluded[i] receives the answer for rays[i].
+template <typename B, typename F>
+void Occluded(const B* bvh, const RaySlab* rays, U32 count, bool* occluded, F occluder) {
+    ParallelFor(count, TC_OCCLUSION_BATCH_GRAIN, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            U32 index = U32(i);
+            occluded[i] = Occluded(bvh, rays[i], [&](U32 primitive, const RaySlab& ray) {
+                return occluder(index, primitive, ray);
+            });
+        }
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Stackless traversal
+
+// Fills parents with the parent of every node, TC_U32_MAX for the root and
+// for the unreachable root copy BvhReorder leaves at nodes[1]. parents holds
+// bvh->nodeCount entries.
+void BvhParents(const Bvh* bvh, U32* parents);
+
+// A stackless traversal is one U32, node << 1 with the low bit set once
+// the node's subtree is done, see Hapala et al. 2011. It walks back up
+// through parents instead of popping a stack, so a suspended ray is only its
+// RaySlab and this state.
+#define TC_STACKLESS_START 0u
+#define TC_STACKLESS_DONE TC_U32_MAX
+
+// Child of an interior node the ray visits first: the one whose center comes
+// first along the ray's major axis. Computed the same way on the way down and
+// back up, from nothing but the two child boxes and the ray.
+inline U32 StacklessNearChild(const Bvh* bvh, U32 node, const RaySlab& ray, U32 axis) {
+    U32 first = bvh->nodes[node].offset;
+    const Box3& a = bvh->nodes[first].bounds;
+    const Box3& b = bvh->nodes[first + 1].bounds;
+    F32 d = (b.min.raw[axis] + b.max.raw[axis]) - (a.min.raw[axis] + a.max.raw[axis]);
+    bool negative = (ray.signMask >> axis) & 1;
+    return first + ((d < 0.0f) != negative);
+}
+
+// Advances the traversal to the next leaf the ray reaches and returns it, or
+// returns TC_U32_MAX once the tree is done. The caller tests the leaf's
+// primitives and may lower ray.tMax before asking for the next leaf, so the
+// loop can run in separate passes over a queue of rays. Farther children are
+// tested against the tMax at the time they are reached.
+inline U32 StacklessNext(const Bvh* bvh, const U32* parents, const RaySlab& ray, U32* state) {
+    F32 x = Abs(ray.inverseDirection.x), y = Abs(ray.inverseDirection.y), z = Abs(ray.inverseDirection.z);
+    U32 axis = x < y ? (x < z ? 0 : 2) : (y < z ? 1 : 2);
+    U32 current = *state;
+    while (current != TC_STACKLESS_DONE) {
+        U32 node = current >> 1;
+        if (current & 1) {
+            if (node == 0) {
+                break;
+            }
+            U32 parent = parents[node];
+            U32 near = StacklessNearChild(bvh, parent, ray, axis);
+            U32 sibling = 2 * bvh->nodes[parent].offset + 1 - node;
+            current = node == near ? sibling << 1 : (parent << 1) | 1;
+            continue;
+        }
+
+        const BvhNode* entered = bvh->nodes + node;
+        F32 tEntry, tExit;
+        if (!Intersect(ray, entered->bounds, &tEntry, &tExit)) {
+            current |= 1;
+            continue;
+        }
+        if (entered->count > 0) {
+            *state = current | 1;
+            return node;
+        }
+        current = StacklessNearChild(bvh, node, ray, axis) << 1;
+    }
+    *state = TC_STACKLESS_DONE;
+    return TC_U32_MAX;
+}
+
+// Same contract as Traverse, visiting leaves through StacklessNext with
+// parents from BvhParents
+template <typename F>
+void TraverseStackless(const Bvh* bvh, const U32* parents, RaySlab ray, F intersector) {
+    if (bvh->nodeCount == 0) {
+        return;
+    }
+
+    U32 state = TC_STACKLESS_START;
+    for (;;) {
+        U32 leaf = StacklessNext(bvh, parents, ray, &state);
+        if (leaf == TC_U32_MAX) {
+            return;
+        }
+        const BvhNode* node = bvh->nodes + leaf;
+        for (U32 i = 0; i < node->count; ++i) {
+            if (!intersector(bvh->indices[node->offset + i], &ray)) {
+                return;
+            }
+        }
+    }
+}
+
+#endif // TC_BVH_HEADER_GUARD
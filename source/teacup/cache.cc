@@ -0,0 +1,332 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/cache.h>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#if TC_OS_WINDOWS
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#   include <io.h>
+#   include <process.h>
+#   include <sys/stat.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Content hash
+
+// MurmurHash64A, eight bytes at a time
+static U64 HashBytes(U64 hash, const void* data, U64 size) {
+    const U64 m = 0xc6a4a7935bd1e995ull;
+    const U8* bytes = (const U8*) data;
+    hash ^= size * m;
+    for (; size >= 8; size -= 8, bytes += 8) {
+        U64 k;
+        memcpy(&k, bytes, 8);
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        hash ^= k;
+        hash *= m;
+    }
+    if (size > 0) {
+        U64 k = 0;
+        memcpy(&k, bytes, size);
+        hash ^= k;
+        hash *= m;
+    }
+    hash ^= hash >> 47;
+    hash *= m;
+    hash ^= hash >> 47;
+    return hash;
+}
+
+template <typename T>
+static U64 HashValue(U64 hash, T value) {
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+U64 BvhCacheKey(const Vec3* positions, U32 vertexCount, const U32* triangles, U32 triangleCount, const BvhBuildOptions& options) {
+    U64 hash = HashValue(0, TC_BVH_CACHE_VERSION);
+    hash = HashValue(hash, vertexCount);
+    hash = HashValue(hash, triangleCount);
+    hash = HashBytes(hash, positions, U64(vertexCount) * sizeof(Vec3));
+    if (triangles) {
+        hash = HashBytes(hash, triangles, 3 * U64(triangleCount) * sizeof(U32));
+    }
+
+    // Field by field, padding inside the struct is not guaranteed to be zero
+    hash = HashValue(hash, U32(options.quality));
+    hash = HashValue(hash, options.binCount);
+    hash = HashValue(hash, options.maxLeafSize);
+    hash = HashValue(hash, options.mortonBits);
+    hash = HashValue(hash, options.treeletPasses);
+    hash = HashValue(hash, options.traversalCost);
+    hash = HashValue(hash, options.intersectionCost);
+    hash = HashValue(hash, options.spatialSplitOverlap);
+    hash = HashValue(hash, options.spatialSplitBudget);
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Writing
+
+static U64 AlignSection(U64 offset) {
+    return (offset + TC_BVH_CACHE_ALIGNMENT - 1) & ~U64(TC_BVH_CACHE_ALIGNMENT - 1);
+}
+
+static bool WritePadded(FILE* file, const void* data, U64 size, U64* offset) {
+    static const U8 zeros[TC_BVH_CACHE_ALIGNMENT] = {};
+    U64 aligned = AlignSection(*offset);
+    if (aligned > *offset && fwrite(zeros, 1, aligned - *offset, file) != aligned - *offset) {
+        return false;
+    }
+    if (size > 0 && fwrite(data, 1, size, file) != size) {
+        return false;
+    }
+    *offset = aligned + size;
+    return true;
+}
+
+TC_GLOBAL std::atomic<U32> temporaryCounter;
+
+// Creates a file next to path under a name no other writer uses, the
+// process id and a per-process counter, so processes and threads missing
+// the cache at the same time each write their own file
+static FILE* CreateTemporary(const char* path, char** temporary) {
+    size_t size = strlen(path) + 32;
+    *temporary = (char*) malloc(size);
+    for (;;) {
+        U32 attempt = temporaryCounter.fetch_add(1);
+#if TC_OS_WINDOWS
+        snprintf(*temporary, size, "%s.%d.%u.tmp", path, _getpid(), attempt);
+        int descriptor = _open(*temporary, _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        snprintf(*temporary, size, "%s.%d.%u.tmp", path, int(getpid()), attempt);
+        int descriptor = open(*temporary, O_WRONLY | O_CREAT | O_EXCL, 0644);
+#endif
+        if (descriptor >= 0) {
+#if TC_OS_WINDOWS
+            FILE* file = _fdopen(descriptor, "wb");
+            if (!file) {
+                _close(descriptor);
+            }
+#else
+            FILE* file = fdopen(descriptor, "wb");
+            if (!file) {
+                close(descriptor);
+            }
+#endif
+            if (!file) {
+                remove(*temporary);
+            }
+            return file;
+        }
+        // Left over by a crashed process with the same id, try the next name
+        if (errno != EEXIST) {
+            return 0;
+        }
+    }
+}
+
+bool BvhCacheWrite(const char* path, U64 key, const Bvh* bvh, const Vec3* positions, const U32* triangles) {
+    BvhCacheHeader header = {};
+    header.magic = TC_BVH_CACHE_MAGIC;
+    header.version = TC_BVH_CACHE_VERSION;
+    header.key = key;
+    header.nodeCount = bvh->nodeCount;
+    header.primitiveCount = bvh->primitiveCount;
+    header.referenceCount = bvh->referenceCount;
+    header.sectionCount = positions ? 3 : 2;
+
+    U64 sizes[BVH_CACHE_SECTION_COUNT] = {
+        U64(bvh->nodeCount) * sizeof(BvhNode),
+        U64(bvh->referenceCount) * sizeof(U32),
+        U64(bvh->referenceCount) * sizeof(Triangle),
+    };
+    U64 offset = sizeof(BvhCacheHeader);
+    for (U32 i = 0; i < header.sectionCount; ++i) {
+        offset = AlignSection(offset);
+        header.sections[i] = {i, 0, offset, sizes[i]};
+        offset += sizes[i];
+    }
+
+    Triangle* leafTriangles = 0;
+    if (positions) {
+        leafTriangles = (Triangle*) malloc(TC_MAX(bvh->referenceCount, 1u) * sizeof(Triangle));
+        for (U32 i = 0; i < bvh->referenceCount; ++i) {
+            U64 base = 3 * U64(bvh->indices[i]);
+            leafTriangles[i].v0 = positions[triangles ? triangles[base + 0] : base + 0];
+            leafTriangles[i].v1 = positions[triangles ? triangles[base + 1] : base + 1];
+            leafTriangles[i].v2 = positions[triangles ? triangles[base + 2] : base + 2];
+        }
+    }
+
+    // Build the file under another name and rename it into place, which is
+    // atomic, so a process loading the cache never maps a partial file
+    char* temporary = 0;
+    FILE* file = CreateTemporary(path, &temporary);
+    bool ok = false;
+    if (file) {
+        U64 written = 0;
+        ok = WritePadded(file, &header, sizeof(header), &written)
+            && WritePadded(file, bvh->nodes, sizes[0], &written)
+            && WritePadded(file, bvh->indices, sizes[1], &written)
+            && (!positions || WritePadded(file, leafTriangles, sizes[2], &written));
+        ok = fclose(file) == 0 && ok;
+#if TC_OS_WINDOWS
+        ok = ok && MoveFileExA(temporary, path, MOVEFILE_REPLACE_EXISTING);
+#else
+        ok = ok && rename(temporary, path) == 0;
+#endif
+        if (!ok) {
+            remove(temporary);
+        }
+    }
+
+    free(temporary);
+    free(leafTriangles);
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Loading
+
+static void* MapFile(const char* path, U64* size) {
+#if TC_OS_WINDOWS
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    LARGE_INTEGER fileSize;
+    void* data = 0;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        if (mapping) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *size = U64(fileSize.QuadPart);
+    }
+    CloseHandle(file);
+    return data;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return 0;
+    }
+    struct stat status;
+    void* data = 0;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        data = mmap(0, size_t(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+        data = data == MAP_FAILED ? 0 : data;
+        *size = U64(status.st_size);
+    }
+    close(file);
+    return data;
+#endif
+}
+
+static void UnmapFile(void* data, U64 size) {
+#if TC_OS_WINDOWS
+    (void) size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size_t(size));
+#endif
+}
+
+static bool SectionValid(const BvhCacheHeader* header, U32 type, U64 size, U64 fileSize) {
+    const BvhCacheSection* section = &header->sections[type];
+    return section->type == type
+        && section->offset % TC_BVH_CACHE_ALIGNMENT == 0
+        && section->size == size
+        && section->offset <= fileSize
+        && section->size <= fileSize - section->offset;
+}
+
+// Checks everything traversal relies on that is cheap to check, without
+// touching the node and index pages so they are only read in on first use
+static bool HeaderValid(const BvhCacheHeader* header, U64 key, U64 fileSize) {
+    if (fileSize < sizeof(BvhCacheHeader) || header->magic != TC_BVH_CACHE_MAGIC || header->version != TC_BVH_CACHE_VERSION || header->key != key) {
+        return false;
+    }
+    if (header->sectionCount < 2 || header->sectionCount > BVH_CACHE_SECTION_COUNT || header->referenceCount < header->primitiveCount) {
+        return false;
+    }
+    U64 sizes[BVH_CACHE_SECTION_COUNT] = {
+        U64(header->nodeCount) * sizeof(BvhNode),
+        U64(header->referenceCount) * sizeof(U32),
+        U64(header->referenceCount) * sizeof(Triangle),
+    };
+    for (U32 i = 0; i < header->sectionCount; ++i) {
+        if (!SectionValid(header, i, sizes[i], fileSize)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BvhCacheLoad(const char* path, U64 key, BvhCache* cache) {
+    *cache = {};
+    U64 size = 0;
+    U8* data = (U8*) MapFile(path, &size);
+    if (!data) {
+        return false;
+    }
+
+    const BvhCacheHeader* header = (const BvhCacheHeader*) data;
+    if (!HeaderValid(header, key, size)) {
+        UnmapFile(data, size);
+        return false;
+    }
+
+    // The BVH is only read through these pointers, the mapping stays read
+    // only so its pages are shared between processes
+    cache->bvh.nodes = (BvhNode*) (data + header->sections[BVH_CACHE_SECTION_NODES].offset);
+    cache->bvh.indices = (U32*) (data + header->sections[BVH_CACHE_SECTION_INDICES].offset);
+    cache->bvh.nodeCount = header->nodeCount;
+    cache->bvh.primitiveCount = header->primitiveCount;
+    cache->bvh.referenceCount = header->referenceCount;
+    if (header->sectionCount > BVH_CACHE_SECTION_TRIANGLES) {
+        cache->triangles = (const Triangle*) (data + header->sections[BVH_CACHE_SECTION_TRIANGLES].offset);
+    }
+    cache->mapping = data;
+    cache->mappingSize = size;
+    return true;
+}
+
+void BvhCacheClose(BvhCache* cache) {
+    if (cache->mapping) {
+        UnmapFile(cache->mapping, cache->mappingSize);
+    }
+    *cache = {};
+}
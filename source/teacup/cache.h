@@ -0,0 +1,98 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_CACHE_HEADER_GUARD
+#define TC_CACHE_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/bvh.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// BVH cache
+
+// Files start with a header and a table of sections, each found by its byte
+// offset from the start of the file, so nothing needs fixing up after load.
+// Sections start on 64 byte boundaries.
+#define TC_BVH_CACHE_MAGIC 0x56424354u // "TCBV"
+#define TC_BVH_CACHE_VERSION 1u
+#define TC_BVH_CACHE_ALIGNMENT 64
+
+enum BvhCacheSectionType : U32 {
+    BVH_CACHE_SECTION_NODES,
+    BVH_CACHE_SECTION_INDICES,
+
+    // One Triangle per entry of indices, in leaf order, so leaves read their
+    // triangles without going through the index buffer
+    BVH_CACHE_SECTION_TRIANGLES,
+
+    BVH_CACHE_SECTION_COUNT,
+};
+
+struct BvhCacheSection {
+    U32 type;
+    U32 reserved;
+    U64 offset;
+    U64 size;
+};
+
+struct BvhCacheHeader {
+    U32 magic;
+    U32 version;
+    U64 key;
+    U32 nodeCount;
+    U32 primitiveCount;
+    U32 referenceCount;
+    U32 sectionCount;
+    BvhCacheSection sections[BVH_CACHE_SECTION_COUNT];
+};
+
+// A BVH read straight from a memory mapped cache file. Pages are mapped read
+// only and shared with every other process that has the file mapped, so the
+// BVH must not be refit or freed with BvhFree.
+struct BvhCache {
+    Bvh bvh;
+
+    // Null when the file was written without triangles
+    const Triangle* triangles;
+
+    void* mapping;
+    U64 mappingSize;
+};
+
+// Hash of the triangles and of the options that affect the built tree, for
+// telling whether a cache file still matches its source. triangles may be
+// null as for BvhBuildTriangles.
+U64 BvhCacheKey(const Vec3* positions, U32 vertexCount, const U32* triangles, U32 triangleCount, const BvhBuildOptions& options = {});
+
+// Writes to a temporary file next to path, named after the process and a
+// counter so concurrent writers never share one, and renames it into place,
+// so concurrent readers see either the old file or a complete new one.
+// positions may be null to leave out the triangle section. Returns false on
+// I/O errors.
+bool BvhCacheWrite(const char* path, U64 key, const Bvh* bvh, const Vec3* positions = 0, const U32* triangles = 0);
+
+// Returns false if the file is missing, truncated, from another version or
+// built from other input, in which case cache is zeroed
+bool BvhCacheLoad(const char* path, U64 key, BvhCache* cache);
+void BvhCacheClose(BvhCache* cache);
+
+#endif // TC_CACHE_HEADER_GUARD
@@ -0,0 +1,113 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_COLOR_HEADER_GUARD
+#define TC_COLOR_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// sRGB transfer functions
+
+// Piecewise curves of IEC 61966-2-1, mapping between linear and encoded
+// values in [0, 1]
+constexpr F32 SrgbEncode(F32 linear) {
+    if (linear <= 0.0031308f) {
+        return 12.92f * linear;
+    }
+    return 1.055f * Pow(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+constexpr F32 SrgbDecode(F32 encoded) {
+    if (encoded <= 0.04045f) {
+        return encoded * (1.0f / 12.92f);
+    }
+    return Pow((encoded + 0.055f) * (1.0f / 1.055f), 2.4f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// sRGB lookup tables
+
+// Linear values quantized to 12 bits step less than one 8-bit code even
+// where the curve is steepest, so each step of the table crosses at most one
+// code boundary and one comparison against that boundary picks the nearest
+// code exactly
+#define TC_SRGB_ENCODE_TABLE_SIZE 4096
+
+struct SrgbEncodeTable {
+    // Nearest code to the linear value at the start of each step
+    U8 values[TC_SRGB_ENCODE_TABLE_SIZE];
+
+    // Linear value from which each code rounds up to the next, above 1 for
+    // the last code
+    F64 thresholds[256];
+};
+
+struct SrgbDecodeTable {
+    F32 values[256];
+};
+
+// The tables evaluate the curves in double precision, so every entry is the
+// correctly rounded value rather than one carrying F32 intermediate error
+constexpr SrgbEncodeTable SrgbEncodeTableBuild() {
+    SrgbEncodeTable table = {};
+    for (int i = 0; i < TC_SRGB_ENCODE_TABLE_SIZE; ++i) {
+        F64 linear = F64(i) / F64(TC_SRGB_ENCODE_TABLE_SIZE - 1);
+        F64 encoded = linear <= 0.0031308 ? 12.92 * linear : 1.055 * ConstantExp(ConstantLog(linear) / 2.4) - 0.055;
+        table.values[i] = U8(encoded * 255.0 + 0.5);
+    }
+    for (int i = 0; i < 255; ++i) {
+        F64 encoded = (F64(i) + 0.5) / 255.0;
+        table.thresholds[i] = encoded <= 0.04045 ? encoded / 12.92 : ConstantExp(2.4 * ConstantLog((encoded + 0.055) / 1.055));
+    }
+    table.thresholds[255] = 2.0;
+    return table;
+}
+
+constexpr SrgbDecodeTable SrgbDecodeTableBuild() {
+    SrgbDecodeTable table = {};
+    for (int i = 0; i < 256; ++i) {
+        F64 encoded = F64(i) / 255.0;
+        F64 linear = encoded <= 0.04045 ? encoded / 12.92 : ConstantExp(2.4 * ConstantLog((encoded + 0.055) / 1.055));
+        table.values[i] = F32(linear);
+    }
+    return table;
+}
+
+// Generated at compile time into read-only data shared by every process
+inline constexpr SrgbEncodeTable srgbEncodeTable = SrgbEncodeTableBuild();
+inline constexpr SrgbDecodeTable srgbDecodeTable = SrgbDecodeTableBuild();
+
+// Nearest 8-bit code to the encoded value. Clamps to [0, 1] first, NaN
+// encodes as 255.
+inline U8 SrgbEncode8(F32 linear) {
+    F32 clamped = Max(Min(linear, 1.0f), 0.0f);
+    U32 code = srgbEncodeTable.values[U32(clamped * F32(TC_SRGB_ENCODE_TABLE_SIZE - 1))];
+    return U8(code + (F64(clamped) >= srgbEncodeTable.thresholds[code]));
+}
+
+inline F32 SrgbDecode8(U8 encoded) {
+    return srgbDecodeTable.values[encoded];
+}
+
+#endif // TC_COLOR_HEADER_GUARD
@@ -0,0 +1,159 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/cpu.h>
+#include <string.h>
+
+#if TC_ISA_X86 && TC_COMPILER_MSVC
+#   include <intrin.h>
+#elif TC_ISA_X86
+#   include <cpuid.h>
+#elif TC_ISA_ARM && TC_OS_LINUX && TC_ARCH_32_BIT
+#   include <sys/auxv.h>
+#   include <asm/hwcap.h>
+#endif
+
+#if TC_ISA_X86
+static void Cpuid(U32 leaf, U32 subleaf, U32 regs[4]) {
+#if TC_COMPILER_MSVC
+    int r[4];
+    __cpuidex(r, int(leaf), int(subleaf));
+    memcpy(regs, r, sizeof(r));
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Register state the operating system saves on context switches
+static U64 Xgetbv() {
+#if TC_COMPILER_MSVC
+    return U64(_xgetbv(0));
+#else
+    U32 eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (U64(edx) << 32) | eax;
+#endif
+}
+
+static U32 DetectX86() {
+    U32 features = CPU_FEATURE_NONE;
+    U32 regs[4];
+    Cpuid(0, 0, regs);
+    U32 maxLeaf = regs[0];
+    if (maxLeaf < 1) {
+        return features;
+    }
+
+    Cpuid(1, 0, regs);
+    U32 ecx1 = regs[2];
+    if (ecx1 & (1u << 20)) {
+        features |= CPU_FEATURE_SSE42;
+    }
+
+    // AVX registers are only usable when the OS saves them, XCR0 bits 1-2 for
+    // the SSE and AVX halves and bits 5-7 for the AVX-512 state
+    bool osxsave = ecx1 & (1u << 27);
+    U64 xcr0 = osxsave ? Xgetbv() : 0;
+    bool avxState = (xcr0 & 0x06) == 0x06;
+    bool avx512State = (xcr0 & 0xe6) == 0xe6;
+
+    if (avxState && (ecx1 & (1u << 12))) {
+        features |= CPU_FEATURE_FMA;
+    }
+
+    if (maxLeaf >= 7) {
+        Cpuid(7, 0, regs);
+        U32 ebx7 = regs[1];
+        if (avxState && (ebx7 & (1u << 5))) {
+            features |= CPU_FEATURE_AVX2;
+        }
+        if (avx512State && (ebx7 & (1u << 16))) {
+            features |= CPU_FEATURE_AVX512F;
+        }
+    }
+
+    return features;
+}
+#endif
+
+static U32 Detect() {
+#if TC_ISA_X86
+    return DetectX86();
+#elif TC_ISA_ARM && TC_ARCH_64_BIT
+    // Advanced SIMD is mandatory on AArch64
+    return CPU_FEATURE_NEON;
+#elif TC_ISA_ARM && TC_OS_LINUX
+    return (getauxval(AT_HWCAP) & HWCAP_NEON) ? CPU_FEATURE_NEON : CPU_FEATURE_NONE;
+#elif TC_SIMD_NEON
+    return CPU_FEATURE_NEON;
+#else
+    return CPU_FEATURE_NONE;
+#endif
+}
+
+U32 CpuFeaturesDetect() {
+    static U32 features = Detect();
+    return features;
+}
+
+bool CpuTierSupported(CpuTier tier) {
+    U32 features = CpuFeaturesDetect();
+    switch (tier) {
+    case CPU_TIER_BASELINE:
+        return true;
+    case CPU_TIER_AVX2:
+        return TC_CPU_X86_TIERS && (features & CPU_FEATURE_AVX2);
+    case CPU_TIER_AVX512:
+        return TC_CPU_X86_TIERS && (features & CPU_FEATURE_AVX2) && (features & CPU_FEATURE_AVX512F);
+    default:
+        return false;
+    }
+}
+
+CpuTier CpuTierBest() {
+    for (U32 tier = CPU_TIER_COUNT - 1; tier > CPU_TIER_BASELINE; --tier) {
+        if (CpuTierSupported(CpuTier(tier))) {
+            return CpuTier(tier);
+        }
+    }
+    return CPU_TIER_BASELINE;
+}
+
+const char* CpuFeatureName(CpuFeatures feature) {
+    switch (feature) {
+    case CPU_FEATURE_SSE42: return "SSE4.2";
+    case CPU_FEATURE_AVX2: return "AVX2";
+    case CPU_FEATURE_FMA: return "FMA";
+    case CPU_FEATURE_AVX512F: return "AVX-512F";
+    case CPU_FEATURE_NEON: return "NEON";
+    default: return "None";
+    }
+}
+
+const char* CpuTierName(CpuTier tier) {
+    switch (tier) {
+    case CPU_TIER_BASELINE: return "Baseline (" TC_SIMD_NAME ")";
+    case CPU_TIER_AVX2: return "AVX2";
+    case CPU_TIER_AVX512: return "AVX-512";
+    default: return "Unknown";
+    }
+}
@@ -0,0 +1,71 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_CPU_HEADER_GUARD
+#define TC_CPU_HEADER_GUARD
+
+#include <teacup/types.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// CPU feature detection
+
+// The compile time TC_SIMD_* level is the floor every build can rely on, these
+// report what the running CPU and operating system support on top of it.
+enum CpuFeatures : U32 {
+    CPU_FEATURE_NONE = 0,
+    CPU_FEATURE_SSE42 = 1 << 0,
+    CPU_FEATURE_AVX2 = 1 << 1,
+    CPU_FEATURE_FMA = 1 << 2,
+    CPU_FEATURE_AVX512F = 1 << 3,
+    CPU_FEATURE_NEON = 1 << 4,
+};
+
+// Kernel variants compiled into the binary, in increasing order of preference.
+// The baseline variant uses the compile time TC_SIMD_* level.
+enum CpuTier : U32 {
+    CPU_TIER_BASELINE,
+    CPU_TIER_AVX2,
+    CPU_TIER_AVX512,
+    CPU_TIER_COUNT,
+};
+
+// The wider x86 tiers are compiled with per-function target attributes, see
+// kernels.cc. Forcing scalar SIMD leaves only the baseline.
+#if TC_ISA_X86 && !TC_SIMD_SCALAR
+#   define TC_CPU_X86_TIERS 1
+#else
+#   define TC_CPU_X86_TIERS 0
+#endif
+
+// Bitmask of CpuFeatures, queried once and cached
+U32 CpuFeaturesDetect();
+
+// Highest tier supported by both this build and the running CPU
+CpuTier CpuTierBest();
+
+// Whether the kernels of tier can run on this CPU
+bool CpuTierSupported(CpuTier tier);
+
+const char* CpuFeatureName(CpuFeatures feature);
+const char* CpuTierName(CpuTier tier);
+
+#endif // TC_CPU_HEADER_GUARD
@@ -0,0 +1,280 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_FASTMATH_HEADER_GUARD
+#define TC_FASTMATH_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/simd.h>
+#include <teacup/maths.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Fast transcendental approximations
+
+// Polynomial approximations of the libm wrappers in maths.h. Every function is
+// a template over F32, F32x4 and F32x8, performing the same operations on each
+// lane so the wide versions match the scalar one bit for bit.
+enum MathAccuracy {
+    // Within a few ulp of the correctly rounded result, see the limits noted
+    // on each function
+    MATH_ACCURACY_HIGH,
+
+    // Relative error around 1e-3, about three significant digits
+    MATH_ACCURACY_LOW,
+};
+
+#define TC_PI_F32 3.14159265358979323846f
+#define TC_LOG2E_F32 1.44269504088896340736f
+
+template <typename T>
+inline T FastNaN() {
+    return Splat<T>(AsF32(S32(0x7fc00000)));
+}
+
+// Magnitude of a with the sign of b
+template <typename T>
+inline T FastCopySign(T a, T b) {
+    return AsF32((AsS32(a) & TC_S32_MAX) | (AsS32(b) & TC_S32_MIN));
+}
+
+// Within about 2 ulp for |a| up to 100, and within about 1e-7 of the exact
+// value for |a| up to about 8192. Further out the three part reduction by
+// pi/2 runs out of precision.
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline void FastSinCos(T a, T* sin, T* cos) {
+    T q = Floor(a * Splat<T>(0.636619772367581343f) + Splat<T>(0.5f));
+    T r = a - q * Splat<T>(1.5703125f);
+    if (A == MATH_ACCURACY_HIGH) {
+        r = r - q * Splat<T>(4.837512969970703125e-4f);
+        r = r - q * Splat<T>(7.54978995489188216e-8f);
+    }
+    else {
+        r = r - q * Splat<T>(4.8382679e-4f);
+    }
+
+    T r2 = r * r;
+    T s;
+    T c;
+    if (A == MATH_ACCURACY_HIGH) {
+        s = r + r * r2 * (Splat<T>(-1.6666654611e-1f) + r2 * (Splat<T>(8.3321608736e-3f) + r2 * Splat<T>(-1.9515295891e-4f)));
+        c = r2 * r2 * (Splat<T>(4.166664568298827e-2f) + r2 * (Splat<T>(-1.388731625493765e-3f) + r2 * Splat<T>(2.443315711809948e-5f)));
+        c = c - Splat<T>(0.5f) * r2 + Splat<T>(1.0f);
+    }
+    else {
+        s = r + r * r2 * Splat<T>(-1.6242791e-1f);
+        c = Splat<T>(1.0f) + r2 * (Splat<T>(-4.9976056e-1f) + r2 * Splat<T>(4.0458452e-2f));
+    }
+
+    // Quadrant of the reduced argument decides which polynomial and sign
+    T k = q - Splat<T>(4.0f) * Floor(q * Splat<T>(0.25f));
+    auto odd = (k == Splat<T>(1.0f)) | (k == Splat<T>(3.0f));
+    auto sinNegative = k >= Splat<T>(2.0f);
+    auto cosNegative = (k == Splat<T>(1.0f)) | (k == Splat<T>(2.0f));
+
+    T sinValue = Select(odd, c, s);
+    T cosValue = Select(odd, s, c);
+    *sin = Select(sinNegative, -sinValue, sinValue);
+    *cos = Select(cosNegative, -cosValue, cosValue);
+}
+
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastSin(T a) {
+    T s, c;
+    FastSinCos<A>(a, &s, &c);
+    return s;
+}
+
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastCos(T a) {
+    T s, c;
+    FastSinCos<A>(a, &s, &c);
+    return c;
+}
+
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastTan(T a) {
+    T s, c;
+    FastSinCos<A>(a, &s, &c);
+    return s / c;
+}
+
+// Reduces |a| to [0, tan(pi/8)] with the identities
+// atan(x) = pi/2 - atan(1/x) and atan(x) = pi/4 + atan((x-1)/(x+1))
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastATan(T a) {
+    T x = Abs(a);
+    auto big = x > Splat<T>(2.414213562373095f);
+    auto mid = x > Splat<T>(0.4142135623730950f);
+
+    T offset = Select(big, Splat<T>(0.5f * TC_PI_F32), Select(mid, Splat<T>(0.25f * TC_PI_F32), Splat<T>(0.0f)));
+    T numerator = Select(big, Splat<T>(-1.0f), Select(mid, x - Splat<T>(1.0f), x));
+    T denominator = Select(big, x, Select(mid, x + Splat<T>(1.0f), Splat<T>(1.0f)));
+    x = numerator / denominator;
+
+    T z = x * x;
+    T p;
+    if (A == MATH_ACCURACY_HIGH) {
+        p = Splat<T>(8.05374449538e-2f) * z - Splat<T>(1.38776856032e-1f);
+        p = p * z + Splat<T>(1.99777106478e-1f);
+        p = p * z - Splat<T>(3.33329491539e-1f);
+    }
+    else {
+        p = Splat<T>(-3.0762641e-1f);
+    }
+
+    T result = offset + (p * z * x + x);
+    return FastCopySign(result, a);
+}
+
+// Matches atan2f except that it returns NaN when both arguments are infinite
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastATan2(T a, T b) {
+    T zero = Splat<T>(0.0f);
+    T z = FastATan<A>(a / b);
+
+    // Left half plane, including b = -0, is offset by pi toward the sign of a
+    auto negative = FastCopySign(Splat<T>(1.0f), b) < zero;
+    T offset = Select(negative, FastCopySign(Splat<T>(TC_PI_F32), a), zero);
+    T result = z + offset;
+
+    auto origin = (a == zero) & (b == zero);
+    return Select(origin, FastCopySign(Select(negative, Splat<T>(TC_PI_F32), zero), a), result);
+}
+
+// Returns -infinity for zero and NaN for negative input
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastLogBase2(T a) {
+    T one = Splat<T>(1.0f);
+
+    // Scale denormals into the normal range first
+    auto denormal = a < Splat<T>(1.17549435e-38f);
+    T x = Select(denormal, a * Splat<T>(8388608.0f), a);
+    T exponentBias = Select(denormal, Splat<T>(150.0f), Splat<T>(127.0f));
+
+    // Split into 2^e * m with m in [sqrt(0.5), sqrt(2))
+    auto bits = AsS32(x);
+    T e = ConvertToF32(ShiftRightLogical<23>(bits)) - exponentBias;
+    T m = AsF32((bits & 0x007fffff) | 0x3f800000);
+    auto big = m > Splat<T>(1.41421356237309505f);
+    m = Select(big, m * Splat<T>(0.5f), m);
+    e = Select(big, e + one, e);
+
+    T t = m - one;
+    T result;
+    if (A == MATH_ACCURACY_HIGH) {
+        // Cephes log2f, adding log2(e) * t in two parts for precision
+        T z = t * t;
+        T p = Splat<T>(7.0376836292e-2f);
+        p = p * t - Splat<T>(1.1514610310e-1f);
+        p = p * t + Splat<T>(1.1676998740e-1f);
+        p = p * t - Splat<T>(1.2420140846e-1f);
+        p = p * t + Splat<T>(1.4249322787e-1f);
+        p = p * t - Splat<T>(1.6668057665e-1f);
+        p = p * t + Splat<T>(2.0000714765e-1f);
+        p = p * t - Splat<T>(2.4999993993e-1f);
+        p = p * t + Splat<T>(3.3333331174e-1f);
+        T y = t * (z * p) - Splat<T>(0.5f) * z;
+
+        T log2eMinusOne = Splat<T>(0.44269504088896340736f);
+        result = y * log2eMinusOne;
+        result = result + t * log2eMinusOne;
+        result = result + y;
+        result = result + t;
+        result = result + e;
+    }
+    else {
+        T p = Splat<T>(-3.2777045e-1f);
+        p = p * t + Splat<T>(5.1127268e-1f);
+        p = p * t + Splat<T>(-7.2429698e-1f);
+        p = p * t + Splat<T>(1.4422704f);
+        result = e + t * p;
+    }
+
+    T zero = Splat<T>(0.0f);
+    T infinity = Splat<T>(F32Infinity());
+    result = Select(a > zero, result, Select(a == zero, -infinity, FastNaN<T>()));
+    return Select(a == infinity, infinity, result);
+}
+
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastExp2(T a) {
+    // Clamp with the constant first so NaN passes through
+    T x = Min(Splat<T>(160.0f), Max(Splat<T>(-160.0f), a));
+    T n = Floor(x + Splat<T>(0.5f));
+    T f = x - n;
+
+    T p;
+    if (A == MATH_ACCURACY_HIGH) {
+        p = Splat<T>(1.535336188319500e-4f);
+        p = p * f + Splat<T>(1.339887440266574e-3f);
+        p = p * f + Splat<T>(9.618437357674640e-3f);
+        p = p * f + Splat<T>(5.550332471162809e-2f);
+        p = p * f + Splat<T>(2.402264791363012e-1f);
+        p = p * f + Splat<T>(6.931472028550421e-1f);
+    }
+    else {
+        p = Splat<T>(5.5008929e-2f);
+        p = p * f + Splat<T>(2.4221096e-1f);
+        p = p * f + Splat<T>(6.9328293e-1f);
+    }
+    p = Splat<T>(1.0f) + p * f;
+
+    // Scale by 2^n in two steps so both factors stay normal for results that
+    // overflow or end up denormal
+    n = Select(n == n, n, Splat<T>(0.0f));
+    T n1 = Floor(n * Splat<T>(0.5f));
+    T n2 = n - n1;
+    T scale1 = AsF32(ShiftLeft<23>(ConvertToS32(n1) + 127));
+    T scale2 = AsF32(ShiftLeft<23>(ConvertToS32(n2) + 127));
+    return p * scale1 * scale2;
+}
+
+// Computed as 2^(b * log2(a)), so the error grows with |b * log2(a)|. Defined
+// for a >= 0, negative bases return NaN.
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastPow(T a, T b) {
+    T result = FastExp2<A>(b * FastLogBase2<A>(a));
+    return Select(b == Splat<T>(0.0f), Splat<T>(1.0f), result);
+}
+
+// The high accuracy tier is the correctly rounded hardware square root. The
+// low tier refines a bit level estimate of 1/sqrt with one Newton step, see
+// Moroz et al. "Fast calculation of inverse square root with the use of magic
+// constant", which is cheaper where no sqrt instruction is pipelined.
+template <MathAccuracy A = MATH_ACCURACY_HIGH, typename T>
+inline T FastSqrt(T a) {
+    if (A == MATH_ACCURACY_HIGH) {
+        return Sqrt(a);
+    }
+
+    // The estimate assumes a normal exponent, denormals are scaled by 2^24
+    auto denormal = a < Splat<T>(1.17549435e-38f);
+    T x = Select(denormal, a * Splat<T>(16777216.0f), a);
+    T scale = Select(denormal, Splat<T>(1.0f / 4096.0f), Splat<T>(1.0f));
+
+    T y = AsF32(0x5f1ffff9 - ShiftRightLogical<1>(AsS32(x)));
+    y = y * (Splat<T>(0.703952253f) * (Splat<T>(2.38924456f) - x * y * y));
+    T result = Select(a < Splat<T>(F32Infinity()), x * y * scale, a);
+    return Select(a < Splat<T>(0.0f), FastNaN<T>(), result);
+}
+
+#endif // TC_FASTMATH_HEADER_GUARD
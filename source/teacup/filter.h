@@ -0,0 +1,82 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_FILTER_HEADER_GUARD
+#define TC_FILTER_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Reconstruction filters
+
+// Gaussian falloff shifted down so it reaches zero at the radius instead of
+// being cut off there, see pbrt "Gaussian Filter" (7.8.1)
+constexpr F32 GaussianFilter(F32 x, F32 radius, F32 sigma) {
+    F32 scale = -0.5f / (sigma * sigma);
+    return Max(0.0f, Exp(scale * x * x) - Exp(scale * radius * radius));
+}
+
+constexpr F32 GaussianFilter(Vec2 a, F32 radius, F32 sigma) {
+    return GaussianFilter(a.x, radius, sigma) * GaussianFilter(a.y, radius, sigma);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Filter tables
+
+#define TC_FILTER_TABLE_SIZE 16
+
+// Weights over one quadrant [0, radius]^2 of a symmetric filter, sampled at
+// the centers of the cells
+struct FilterTable {
+    F32 radius;
+    F32 values[TC_FILTER_TABLE_SIZE][TC_FILTER_TABLE_SIZE];
+};
+
+constexpr FilterTable FilterTableGaussian(F32 radius, F32 sigma) {
+    FilterTable table = {};
+    table.radius = radius;
+    for (int y = 0; y < TC_FILTER_TABLE_SIZE; ++y) {
+        for (int x = 0; x < TC_FILTER_TABLE_SIZE; ++x) {
+            Vec2 p = {(F32(x) + 0.5f) * radius, (F32(y) + 0.5f) * radius};
+            table.values[y][x] = GaussianFilter(p / F32(TC_FILTER_TABLE_SIZE), radius, sigma);
+        }
+    }
+    return table;
+}
+
+// Default pixel filter, generated at compile time
+inline constexpr FilterTable gaussianFilterTable = FilterTableGaussian(1.5f, 0.5f);
+
+// Weight of the sample at offset a from the pixel center, zero outside the
+// radius
+inline F32 Evaluate(const FilterTable* table, Vec2 a) {
+    F32 scale = F32(TC_FILTER_TABLE_SIZE) / table->radius;
+    F32 x = Abs(a.x) * scale;
+    F32 y = Abs(a.y) * scale;
+    if (!(x < F32(TC_FILTER_TABLE_SIZE) && y < F32(TC_FILTER_TABLE_SIZE))) {
+        return 0.0f;
+    }
+    return table->values[U32(y)][U32(x)];
+}
+
+#endif // TC_FILTER_HEADER_GUARD
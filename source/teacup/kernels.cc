@@ -0,0 +1,286 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/kernels.h>
+#include <teacup/triangle.h>
+#include <teacup/wide.h>
+
+#if TC_CPU_X86_TIERS
+#   include <immintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Baseline kernels
+
+static void MultiplyMat4sBaseline(const Mat4* a, const Mat4* b, Mat4* out, U64 count) {
+    for (U64 i = 0; i < count; ++i) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+static U64 OverlapBoxesBaseline(const Box3* boxes, U64 count, Box3 query, U32* hits) {
+    Box3x4 bound = Splat<F32x4>(query);
+    U64 hitCount = 0;
+    U64 i = 0;
+
+    // Indices are written unconditionally and kept by advancing the count,
+    // which avoids a branch per box
+    for (; i + 4 <= count; i += 4) {
+        U32 mask = MoveMask(Overlaps(Gather<F32x4>(boxes + i), bound));
+        for (U32 lane = 0; lane < 4; ++lane) {
+            hits[hitCount] = U32(i + lane);
+            hitCount += (mask >> lane) & 1;
+        }
+    }
+
+    for (; i < count; ++i) {
+        hits[hitCount] = U32(i);
+        hitCount += Overlaps(boxes[i], query);
+    }
+    return hitCount;
+}
+
+static bool IntersectTrianglePack8Baseline(const RayShear& ray, const TrianglePack8& pack, TriangleHit* hit) {
+    return Intersect(ray, pack, hit);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// x86 kernels
+
+// The wider variants live in this translation unit with target attributes
+// instead of separate files compiled with -mavx2. Header inlines are then
+// never emitted with instructions the baseline CPU lacks, which the linker
+// could otherwise pick for the whole program.
+#if TC_CPU_X86_TIERS
+
+TC_TARGET("avx2")
+static void MultiplyMat4sAvx2(const Mat4* a, const Mat4* b, Mat4* out, U64 count) {
+    for (U64 i = 0; i < count; ++i) {
+        __m256 b0 = _mm256_broadcast_ps((const __m128*) b[i].raw[0]);
+        __m256 b1 = _mm256_broadcast_ps((const __m128*) b[i].raw[1]);
+        __m256 b2 = _mm256_broadcast_ps((const __m128*) b[i].raw[2]);
+        __m256 b3 = _mm256_broadcast_ps((const __m128*) b[i].raw[3]);
+        __m256 rows01 = _mm256_loadu_ps(a[i].raw[0]);
+        __m256 rows23 = _mm256_loadu_ps(a[i].raw[2]);
+
+        __m256 acc01 = _mm256_mul_ps(_mm256_shuffle_ps(rows01, rows01, 0x00), b0);
+        __m256 acc23 = _mm256_mul_ps(_mm256_shuffle_ps(rows23, rows23, 0x00), b0);
+        acc01 = _mm256_add_ps(acc01, _mm256_mul_ps(_mm256_shuffle_ps(rows01, rows01, 0x55), b1));
+        acc23 = _mm256_add_ps(acc23, _mm256_mul_ps(_mm256_shuffle_ps(rows23, rows23, 0x55), b1));
+        acc01 = _mm256_add_ps(acc01, _mm256_mul_ps(_mm256_shuffle_ps(rows01, rows01, 0xaa), b2));
+        acc23 = _mm256_add_ps(acc23, _mm256_mul_ps(_mm256_shuffle_ps(rows23, rows23, 0xaa), b2));
+        acc01 = _mm256_add_ps(acc01, _mm256_mul_ps(_mm256_shuffle_ps(rows01, rows01, 0xff), b3));
+        acc23 = _mm256_add_ps(acc23, _mm256_mul_ps(_mm256_shuffle_ps(rows23, rows23, 0xff), b3));
+
+        _mm256_storeu_ps(out[i].raw[0], acc01);
+        _mm256_storeu_ps(out[i].raw[2], acc23);
+    }
+}
+
+// One box per iteration. A Box3 is six floats, so a single 8-wide load holds
+// min and max, and negating max turns the whole overlap test into one <=.
+TC_TARGET("avx2")
+static U64 OverlapBoxesAvx2(const Box3* boxes, U64 count, Box3 query, U32* hits) {
+    const __m256 sign = _mm256_setr_ps(0.0f, 0.0f, 0.0f, -0.0f, -0.0f, -0.0f, 0.0f, 0.0f);
+    const __m256 bound = _mm256_setr_ps(query.max.x, query.max.y, query.max.z, -query.min.x, -query.min.y, -query.min.z, 0.0f, 0.0f);
+    U64 hitCount = 0;
+    if (count == 0) {
+        return 0;
+    }
+
+    // The load of each box reads two floats of the next one, the last box
+    // masks them off instead
+    for (U64 i = 0; i + 1 < count; ++i) {
+        __m256 box = _mm256_xor_ps(_mm256_loadu_ps(&boxes[i].min.x), sign);
+        U32 mask = U32(_mm256_movemask_ps(_mm256_cmp_ps(box, bound, _CMP_LE_OQ)));
+        hits[hitCount] = U32(i);
+        hitCount += (mask & 0x3f) == 0x3f;
+    }
+
+    const __m256i lastMask = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+    __m256 box = _mm256_xor_ps(_mm256_maskload_ps(&boxes[count - 1].min.x, lastMask), sign);
+    U32 mask = U32(_mm256_movemask_ps(_mm256_cmp_ps(box, bound, _CMP_LE_OQ)));
+    hits[hitCount] = U32(count - 1);
+    hitCount += (mask & 0x3f) == 0x3f;
+    return hitCount;
+}
+
+// IntersectPermuted on one 8-wide register per value, with the operations in
+// the same order so the results match the baseline bit for bit. F32x8 is two
+// 4-wide halves below AVX2, and the header version cannot be compiled for
+// AVX2 here without emitting its inlines with AVX2 instructions.
+TC_TARGET("avx2")
+static bool IntersectTrianglePack8Avx2(const RayShear& ray, const TrianglePack8& pack, TriangleHit* hit) {
+    const U32 axes[3] = {ray.kx, ray.ky, ray.kz};
+    const __m256 origin[3] = {_mm256_set1_ps(ray.origin.x), _mm256_set1_ps(ray.origin.y), _mm256_set1_ps(ray.origin.z)};
+    __m256 corners[3][3];
+    for (int k = 0; k < 3; ++k) {
+        for (int axis = 0; axis < 3; ++axis) {
+            corners[k][axis] = _mm256_sub_ps(_mm256_loadu_ps(pack.corners[k][axes[axis]]), origin[axis]);
+        }
+    }
+
+    const __m256 sx = _mm256_set1_ps(ray.sx);
+    const __m256 sy = _mm256_set1_ps(ray.sy);
+    __m256 ax = _mm256_sub_ps(corners[0][0], _mm256_mul_ps(sx, corners[0][2]));
+    __m256 ay = _mm256_sub_ps(corners[0][1], _mm256_mul_ps(sy, corners[0][2]));
+    __m256 bx = _mm256_sub_ps(corners[1][0], _mm256_mul_ps(sx, corners[1][2]));
+    __m256 by = _mm256_sub_ps(corners[1][1], _mm256_mul_ps(sy, corners[1][2]));
+    __m256 cx = _mm256_sub_ps(corners[2][0], _mm256_mul_ps(sx, corners[2][2]));
+    __m256 cy = _mm256_sub_ps(corners[2][1], _mm256_mul_ps(sy, corners[2][2]));
+
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 edgeU = _mm256_sub_ps(_mm256_mul_ps(cx, by), _mm256_mul_ps(cy, bx));
+    __m256 edgeV = _mm256_sub_ps(_mm256_mul_ps(ax, cy), _mm256_mul_ps(ay, cx));
+    __m256 edgeW = _mm256_sub_ps(_mm256_mul_ps(bx, ay), _mm256_mul_ps(by, ax));
+    __m256 onEdge = _mm256_or_ps(_mm256_cmp_ps(edgeU, zero, _CMP_EQ_OQ), _mm256_or_ps(_mm256_cmp_ps(edgeV, zero, _CMP_EQ_OQ), _mm256_cmp_ps(edgeW, zero, _CMP_EQ_OQ)));
+    if (_mm256_movemask_ps(onEdge)) {
+        F32x8 u = Load<F32x8>((const F32*) &edgeU);
+        F32x8 v = Load<F32x8>((const F32*) &edgeV);
+        F32x8 w = Load<F32x8>((const F32*) &edgeW);
+        ShearEdgesExact(Load<F32x8>((const F32*) &ax), Load<F32x8>((const F32*) &ay), Load<F32x8>((const F32*) &bx), Load<F32x8>((const F32*) &by), Load<F32x8>((const F32*) &cx), Load<F32x8>((const F32*) &cy), &u, &v, &w);
+        Store((F32*) &edgeU, u);
+        Store((F32*) &edgeV, v);
+        Store((F32*) &edgeW, w);
+    }
+
+    __m256 negative = _mm256_or_ps(_mm256_cmp_ps(edgeU, zero, _CMP_LT_OQ), _mm256_or_ps(_mm256_cmp_ps(edgeV, zero, _CMP_LT_OQ), _mm256_cmp_ps(edgeW, zero, _CMP_LT_OQ)));
+    __m256 positive = _mm256_or_ps(_mm256_cmp_ps(edgeU, zero, _CMP_GT_OQ), _mm256_or_ps(_mm256_cmp_ps(edgeV, zero, _CMP_GT_OQ), _mm256_cmp_ps(edgeW, zero, _CMP_GT_OQ)));
+    __m256 det = _mm256_add_ps(_mm256_add_ps(edgeU, edgeV), edgeW);
+
+    const __m256 sz = _mm256_set1_ps(ray.sz);
+    __m256 scaled = _mm256_mul_ps(edgeU, _mm256_mul_ps(sz, corners[0][2]));
+    scaled = _mm256_add_ps(scaled, _mm256_mul_ps(edgeV, _mm256_mul_ps(sz, corners[1][2])));
+    scaled = _mm256_add_ps(scaled, _mm256_mul_ps(edgeW, _mm256_mul_ps(sz, corners[2][2])));
+    __m256 inverse = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+    __m256 t = _mm256_mul_ps(scaled, inverse);
+
+    __m256 valid = _mm256_andnot_ps(_mm256_and_ps(negative, positive), _mm256_cmp_ps(det, zero, _CMP_NEQ_UQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, _mm256_set1_ps(ray.tMin), _CMP_GE_OQ));
+    valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, _mm256_set1_ps(ray.tMax), _CMP_LE_OQ));
+    U32 mask = U32(_mm256_movemask_ps(valid));
+    if (mask == 0) {
+        return false;
+    }
+
+    F32 ts[8];
+    _mm256_storeu_ps(ts, t);
+    U32 nearest = CountTrailingZeros(mask);
+    for (mask &= mask - 1; mask; mask &= mask - 1) {
+        U32 i = CountTrailingZeros(mask);
+        if (ts[i] < ts[nearest]) {
+            nearest = i;
+        }
+    }
+
+    F32 us[8], vs[8];
+    _mm256_storeu_ps(us, _mm256_mul_ps(edgeV, inverse));
+    _mm256_storeu_ps(vs, _mm256_mul_ps(edgeW, inverse));
+    *hit = {ts[nearest], us[nearest], vs[nearest], pack.primitive[nearest]};
+    return true;
+}
+
+// The unmasked forms of a few AVX-512 intrinsics start from an undefined
+// register, which GCC 12 reports as maybe uninitialized. The all-lanes masked
+// forms compile to the same instructions.
+TC_TARGET("avx512f")
+static inline __m512 Gather16(__m512i offsets, const F32* base) {
+    return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xffff, offsets, base, 4);
+}
+
+// All four rows in one register, permute picks element k of every row
+TC_TARGET("avx512f")
+static void MultiplyMat4sAvx512(const Mat4* a, const Mat4* b, Mat4* out, U64 count) {
+    for (U64 i = 0; i < count; ++i) {
+        __m512 rows = _mm512_loadu_ps(a[i].raw[0]);
+        __m512 b0 = _mm512_maskz_broadcast_f32x4(0xffff, _mm_loadu_ps(b[i].raw[0]));
+        __m512 b1 = _mm512_maskz_broadcast_f32x4(0xffff, _mm_loadu_ps(b[i].raw[1]));
+        __m512 b2 = _mm512_maskz_broadcast_f32x4(0xffff, _mm_loadu_ps(b[i].raw[2]));
+        __m512 b3 = _mm512_maskz_broadcast_f32x4(0xffff, _mm_loadu_ps(b[i].raw[3]));
+
+        __m512 acc = _mm512_mul_ps(_mm512_maskz_permute_ps(0xffff, rows, 0x00), b0);
+        acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_maskz_permute_ps(0xffff, rows, 0x55), b1));
+        acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_maskz_permute_ps(0xffff, rows, 0xaa), b2));
+        acc = _mm512_add_ps(acc, _mm512_mul_ps(_mm512_maskz_permute_ps(0xffff, rows, 0xff), b3));
+        _mm512_storeu_ps(out[i].raw[0], acc);
+    }
+}
+
+// Sixteen boxes per iteration, gathered into structure of arrays form. The
+// compress store appends the indices of the overlapping lanes.
+TC_TARGET("avx512f,avx2")
+static U64 OverlapBoxesAvx512(const Box3* boxes, U64 count, Box3 query, U32* hits) {
+    const __m512i offsets = _mm512_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42, 48, 54, 60, 66, 72, 78, 84, 90);
+    __m512 minX = _mm512_set1_ps(query.min.x);
+    __m512 minY = _mm512_set1_ps(query.min.y);
+    __m512 minZ = _mm512_set1_ps(query.min.z);
+    __m512 maxX = _mm512_set1_ps(query.max.x);
+    __m512 maxY = _mm512_set1_ps(query.max.y);
+    __m512 maxZ = _mm512_set1_ps(query.max.z);
+    __m512i index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    U64 hitCount = 0;
+    U64 i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const F32* base = &boxes[i].min.x;
+        __mmask16 mask = _mm512_cmp_ps_mask(Gather16(offsets, base + 3), minX, _CMP_GE_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, Gather16(offsets, base + 4), minY, _CMP_GE_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, Gather16(offsets, base + 5), minZ, _CMP_GE_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, Gather16(offsets, base + 0), maxX, _CMP_LE_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, Gather16(offsets, base + 1), maxY, _CMP_LE_OQ);
+        mask = _mm512_mask_cmp_ps_mask(mask, Gather16(offsets, base + 2), maxZ, _CMP_LE_OQ);
+
+        _mm512_mask_compressstoreu_epi32(hits + hitCount, mask, _mm512_add_epi32(index, _mm512_set1_epi32(S32(i))));
+        hitCount += PopCount(mask);
+    }
+
+    U64 tailCount = OverlapBoxesAvx2(boxes + i, count - i, query, hits + hitCount);
+    for (U64 k = 0; k < tailCount; ++k) {
+        hits[hitCount + k] += U32(i);
+    }
+    return hitCount + tailCount;
+}
+
+#endif // TC_CPU_X86_TIERS
+
+////////////////////////////////////////////////////////////////////////////////
+// Dispatch
+
+TC_GLOBAL const Kernels kernelTable[CPU_TIER_COUNT] = {
+    {CPU_TIER_BASELINE, MultiplyMat4sBaseline, OverlapBoxesBaseline, IntersectTrianglePack8Baseline},
+#if TC_CPU_X86_TIERS
+    {CPU_TIER_AVX2, MultiplyMat4sAvx2, OverlapBoxesAvx2, IntersectTrianglePack8Avx2},
+    {CPU_TIER_AVX512, MultiplyMat4sAvx512, OverlapBoxesAvx512, IntersectTrianglePack8Avx2},
+#endif
+};
+
+const Kernels* KernelsGet(CpuTier tier) {
+    if (tier >= CPU_TIER_COUNT || !CpuTierSupported(tier)) {
+        return nullptr;
+    }
+    return &kernelTable[tier];
+}
+
+const Kernels* KernelsGet() {
+    static const Kernels* kernels = KernelsGet(CpuTierBest());
+    return kernels;
+}
@@ -0,0 +1,62 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_KERNELS_HEADER_GUARD
+#define TC_KERNELS_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/cpu.h>
+#include <teacup/maths.h>
+
+struct RayShear;
+struct TriangleHit;
+template <int N> struct TrianglePack;
+
+////////////////////////////////////////////////////////////////////////////////
+// Dispatched kernels
+
+// Hot loops compiled once per CpuTier. All variants of a kernel return the
+// same bits, fused multiply-adds are deliberately not used, so the tier a
+// machine picks never changes its results.
+struct Kernels {
+    CpuTier tier;
+
+    // out[i] = a[i] * b[i], out may be a or b
+    void (*multiplyMat4s)(const Mat4* a, const Mat4* b, Mat4* out, U64 count);
+
+    // Writes the indices of the boxes that overlap query to hits in increasing
+    // order and returns how many were written. hits must have room for count
+    // indices.
+    U64 (*overlapBoxes)(const Box3* boxes, U64 count, Box3 query, U32* hits);
+
+    // Intersect(const RayShear&, const TrianglePack8&), which TriangleBvh8
+    // calls at its leaves
+    bool (*intersectTrianglePack8)(const RayShear& ray, const TrianglePack<8>& pack, TriangleHit* hit);
+};
+
+// Kernels of CpuTierBest(), selected on the first call
+const Kernels* KernelsGet();
+
+// Kernels of a specific tier, null when the build or the CPU lacks it
+const Kernels* KernelsGet(CpuTier tier);
+
+#endif // TC_KERNELS_HEADER_GUARD
@@ -1,88 +1,159 @@
 #include <teacup/maths.h>
-#include <string.h>
 
-// Implementation taken from:
-// https://github.com/mmp/pbrt-v3/blob/aaa552a4b9cbf9dccb71450f47b268e0ed6370e2/src/core/transform.cpp#L82
+////////////////////////////////////////////////////////////////////////////////
+// Matrix 4x4 inverse
+
+// 2x2 matrix helpers for the block-wise inverse below. A 2x2 matrix [a b; c d]
+// is held in one register as (a, b, c, d), adj() is its adjugate.
+
+// a * b
+static inline F32x4 Mat2Mul(F32x4 a, F32x4 b) {
+    return a * Shuffle<0, 3, 0, 3>(b) + Shuffle<1, 0, 3, 2>(a) * Shuffle<2, 1, 2, 1>(b);
+}
+
+// adj(a) * b
+static inline F32x4 Mat2AdjMul(F32x4 a, F32x4 b) {
+    return Shuffle<3, 3, 0, 0>(a) * b - Shuffle<1, 1, 2, 2>(a) * Shuffle<2, 3, 0, 1>(b);
+}
+
+// a * adj(b)
+static inline F32x4 Mat2MulAdj(F32x4 a, F32x4 b) {
+    return a * Shuffle<3, 0, 3, 0>(b) - Shuffle<1, 0, 3, 2>(a) * Shuffle<2, 1, 2, 1>(b);
+}
+
+static inline bool IsFinite(F32 a) {
+    return a - a == 0.0f;
+}
+
+// Closed-form inverse that splits the matrix into four 2x2 blocks
+//   | A B |
+//   | C D |
+// and combines their adjugates and determinants, see
+// https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+bool TryInverse(Mat4 a, Mat4* result) {
+    F32x4 r0 = F32x4Load(a.raw[0]);
+    F32x4 r1 = F32x4Load(a.raw[1]);
+    F32x4 r2 = F32x4Load(a.raw[2]);
+    F32x4 r3 = F32x4Load(a.raw[3]);
+
+    F32x4 blockA = Shuffle<0, 1, 0, 1>(r0, r1);
+    F32x4 blockB = Shuffle<2, 3, 2, 3>(r0, r1);
+    F32x4 blockC = Shuffle<0, 1, 0, 1>(r2, r3);
+    F32x4 blockD = Shuffle<2, 3, 2, 3>(r2, r3);
+
+    // Determinants of A, B, C and D in that order
+    F32x4 detSub = Shuffle<0, 2, 0, 2>(r0, r2) * Shuffle<1, 3, 1, 3>(r1, r3) - Shuffle<1, 3, 1, 3>(r0, r2) * Shuffle<0, 2, 0, 2>(r1, r3);
+    F32x4 detA = Shuffle<0, 0, 0, 0>(detSub);
+    F32x4 detB = Shuffle<1, 1, 1, 1>(detSub);
+    F32x4 detC = Shuffle<2, 2, 2, 2>(detSub);
+    F32x4 detD = Shuffle<3, 3, 3, 3>(detSub);
+
+    F32x4 adjDC = Mat2AdjMul(blockD, blockC);
+    F32x4 adjAB = Mat2AdjMul(blockA, blockB);
+
+    F32x4 x = detD * blockA - Mat2Mul(blockB, adjDC);
+    F32x4 w = detA * blockD - Mat2Mul(blockC, adjAB);
+    F32x4 y = detB * blockC - Mat2MulAdj(blockD, adjAB);
+    F32x4 z = detC * blockB - Mat2MulAdj(blockA, adjDC);
+
+    F32x4 trace = HorizontalSum(adjAB * Shuffle<0, 2, 1, 3>(adjDC));
+    F32x4 det = detA * detD + detB * detC - trace;
+
+    F32 detScalar = Extract<0>(det);
+    if (detScalar == 0.0f || !IsFinite(1.0f / detScalar)) {
+        return false;
+    }
+
+    F32x4 invDet = F32x4Set(1.0f, -1.0f, -1.0f, 1.0f) / det;
+    x = x * invDet;
+    y = y * invDet;
+    z = z * invDet;
+    w = w * invDet;
+
+    F32x4Store(result->raw[0], Shuffle<3, 1, 3, 1>(x, y));
+    F32x4Store(result->raw[1], Shuffle<2, 0, 2, 0>(x, y));
+    F32x4Store(result->raw[2], Shuffle<3, 1, 3, 1>(z, w));
+    F32x4Store(result->raw[3], Shuffle<2, 0, 2, 0>(z, w));
+    return true;
+}
 
 Mat4 Inverse(Mat4 a) {
-    S32 indxc[4] = {0, 0, 0, 0};
-    S32 indxr[4] = {0, 0, 0, 0};
-    S32 ipiv[4] = {0, 0, 0, 0};
-    F32 temp = 0;
-    Mat4 mat = a;
-
-    for (S32 i = 0; i < 4; i++) {
-        S32 irow = 0;
-        S32 icol = 0;
-        F32 big = 0;
-
-        // Choose pivot
-        for (S32 j = 0; j < 4; j++) {
-            if (ipiv[j] != 1) {
-                for (S32 k = 0; k < 4; k++) {
-                    if (ipiv[k] == 0) {
-                        if (Abs(mat.raw[j][k]) >= big) {
-                            big = F32(Abs(mat.raw[j][k]));
-                            irow = j;
-                            icol = k;
-                        }
-                    }
-                    else if (ipiv[k] > 1) {
-                        TC_FAILURE("Inverse of singular matrix");
-                    }
-                }
-            }
-        }
-
-        ++ipiv[icol];
-
-        // Swap rows irow and icol for pivot
-        if (irow != icol) {
-            for (S32 k = 0; k < 4; ++k) {
-                temp = mat.raw[irow][k];
-                mat.raw[irow][k] = mat.raw[icol][k];
-                mat.raw[icol][k] = temp;
-            }
-        }
-
-        indxr[i] = irow;
-        indxc[i] = icol;
-
-        if (mat.raw[icol][icol] == 0) {
-            TC_FAILURE("Inverse of singular matrix");
-        }
-
-        // Set m[icol][icol] to one by scaling row icol appropriately
-        F32 pivinv = 1.0f / mat.raw[icol][icol];
-        mat.raw[icol][icol] = 1.0f;
-
-        for (S32 j = 0; j < 4; j++) {
-            mat.raw[icol][j] *= pivinv;
-        }
-
-        // Subtract this row from others to zero out their columns
-        for (S32 j = 0; j < 4; j++) {
-            if (j != icol) {
-                F32 save = mat.raw[j][icol];
-                mat.raw[j][icol] = 0;
-
-                for (S32 k = 0; k < 4; k++) {
-                    mat.raw[j][k] -= mat.raw[icol][k] * save;
-                }
-            }
-        }
+    Mat4 mat = {};
+    if (!TryInverse(a, &mat)) {
+        TC_FAILURE("Inverse of singular matrix");
     }
+    return mat;
+}
+
+static inline F32x4 Cross3(F32x4 a, F32x4 b) {
+    return Shuffle<1, 2, 0, 3>(a) * Shuffle<2, 0, 1, 3>(b) - Shuffle<2, 0, 1, 3>(a) * Shuffle<1, 2, 0, 3>(b);
+}
 
-    // Swap columns to reflect permutation
-    for (S32 j = 3; j >= 0; j--) {
-        if (indxr[j] != indxc[j]) {
-            for (S32 k = 0; k < 4; k++) {
-                temp = mat.raw[k][indxr[j]];
-                mat.raw[k][indxr[j]] = mat.raw[k][indxc[j]];
-                mat.raw[k][indxc[j]] = temp;
-            }
-        }
+// For an affine matrix [M t; 0 1] the inverse is [M^-1 -M^-1*t; 0 1]. The
+// columns of M^-1 are the cross products of the rows of M over det(M).
+bool TryInverseAffine(Mat4 a, Mat4* result) {
+    F32x4 r0 = F32x4Load(a.raw[0]);
+    F32x4 r1 = F32x4Load(a.raw[1]);
+    F32x4 r2 = F32x4Load(a.raw[2]);
+
+    // The w lanes hold the translation and cancel to zero in the cross products
+    F32x4 c0 = Cross3(r1, r2);
+    F32x4 c1 = Cross3(r2, r0);
+    F32x4 c2 = Cross3(r0, r1);
+
+    F32x4 det = HorizontalSum(r0 * c0);
+    F32 detScalar = Extract<0>(det);
+    if (detScalar == 0.0f || !IsFinite(1.0f / detScalar)) {
+        return false;
     }
 
+    F32x4 invDet = F32x4Splat(1.0f) / det;
+    c0 = c0 * invDet;
+    c1 = c1 * invDet;
+    c2 = c2 * invDet;
+
+    F32x4 t = -(c0 * F32x4Splat(a.raw[0][3]) + c1 * F32x4Splat(a.raw[1][3]) + c2 * F32x4Splat(a.raw[2][3]));
+    t = t + F32x4Set(0.0f, 0.0f, 0.0f, 1.0f);
+
+    Transpose(c0, c1, c2, t);
+    F32x4Store(result->raw[0], c0);
+    F32x4Store(result->raw[1], c1);
+    F32x4Store(result->raw[2], c2);
+    F32x4Store(result->raw[3], t);
+    return true;
+}
+
+Mat4 InverseAffine(Mat4 a) {
+    Mat4 mat = {};
+    if (!TryInverseAffine(a, &mat)) {
+        TC_FAILURE("Inverse of singular matrix");
+    }
     return mat;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Quaternion from rotation matrix
+
+// Solves for the largest component first, so the divisions are by at
+// least half, see Shepperd 1978
+Quat QuatFromMat4(Mat4 a) {
+    F32 trace = a.raw[0][0] + a.raw[1][1] + a.raw[2][2];
+    Quat quat;
+    if (trace > 0.0f) {
+        F32 s = Sqrt(trace + 1.0f) * 2.0f;
+        quat = {(a.raw[2][1] - a.raw[1][2]) / s, (a.raw[0][2] - a.raw[2][0]) / s, (a.raw[1][0] - a.raw[0][1]) / s, 0.25f * s};
+    }
+    else if (a.raw[0][0] > a.raw[1][1] && a.raw[0][0] > a.raw[2][2]) {
+        F32 s = Sqrt(1.0f + a.raw[0][0] - a.raw[1][1] - a.raw[2][2]) * 2.0f;
+        quat = {0.25f * s, (a.raw[0][1] + a.raw[1][0]) / s, (a.raw[0][2] + a.raw[2][0]) / s, (a.raw[2][1] - a.raw[1][2]) / s};
+    }
+    else if (a.raw[1][1] > a.raw[2][2]) {
+        F32 s = Sqrt(1.0f + a.raw[1][1] - a.raw[0][0] - a.raw[2][2]) * 2.0f;
+        quat = {(a.raw[0][1] + a.raw[1][0]) / s, 0.25f * s, (a.raw[1][2] + a.raw[2][1]) / s, (a.raw[0][2] - a.raw[2][0]) / s};
+    }
+    else {
+        F32 s = Sqrt(1.0f + a.raw[2][2] - a.raw[0][0] - a.raw[1][1]) * 2.0f;
+        quat = {(a.raw[0][2] + a.raw[2][0]) / s, (a.raw[1][2] + a.raw[2][1]) / s, 0.25f * s, (a.raw[1][0] - a.raw[0][1]) / s};
+    }
+    return Normalize(quat);
+}
@@ -24,7 +24,9 @@
 #define TC_MATHS_HEADER_GUARD
 
 #include <teacup/types.h>
+#include <teacup/simd.h>
 #include <math.h>
+#include <type_traits>
 
 ////////////////////////////////////////////////////////////////////////////////
 // Math primitives
@@ -50,14 +52,16 @@ union Vec2 {
     F32 raw[2];
 };
 
+// raw comes first so brace initialization activates it, constant evaluation
+// may only read the active member of a union
 union Mat4 {
+    F32 raw[4][4];
     struct {
         F32 m0,  m1,  m2,  m3;
         F32 m4,  m5,  m6,  m7;
         F32 m8,  m9,  m10, m11;
         F32 m12, m13, m14, m15;
     };
-    F32 raw[4][4];
 };
 
 union Quat {
@@ -75,6 +79,92 @@ struct Box2 {
     Vec2 min, max;
 };
 
+struct Triangle {
+    Vec3 v0, v1, v2;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Constant evaluation
+
+// Double precision series for the libm functions that are not constexpr. The
+// base functions below switch to these under std::is_constant_evaluated(), so
+// tables can be generated at compile time. Sqrt rounds to the same F32 as
+// sqrtf, Exp and Pow may differ from libm in the last place.
+
+constexpr F64 ConstantSqrt(F64 a) {
+    if (!(a > 0) || a == F64(INFINITY)) {
+        return a == 0 || a == F64(INFINITY) ? a : F64(NAN);
+    }
+
+    // Newton's method decreases monotonically from any start above the root
+    F64 x = a > 1 ? a : 1;
+    for (;;) {
+        F64 next = 0.5 * (x + a / x);
+        if (next >= x) {
+            return x;
+        }
+        x = next;
+    }
+}
+
+constexpr F64 ConstantExp(F64 a) {
+    if (a != a) {
+        return a;
+    }
+    if (a > 709.0) {
+        return F64(INFINITY);
+    }
+    if (a < -745.0) {
+        return 0;
+    }
+
+    // e^a = 2^k * e^r with |r| <= ln(2)/2
+    const F64 ln2 = 0.6931471805599453094;
+    F64 k = F64(S64(a / ln2 + (a < 0 ? -0.5 : 0.5)));
+    F64 r = a - k * ln2;
+
+    F64 term = 1;
+    F64 sum = 1;
+    for (int i = 1; i < 24; ++i) {
+        term *= r / i;
+        sum += term;
+    }
+
+    for (; k > 0; --k) {
+        sum *= 2;
+    }
+    for (; k < 0; ++k) {
+        sum *= 0.5;
+    }
+    return sum;
+}
+
+constexpr F64 ConstantLog(F64 a) {
+    if (!(a > 0) || a == F64(INFINITY)) {
+        return a == 0 ? -F64(INFINITY) : (a == F64(INFINITY) ? a : F64(NAN));
+    }
+
+    // a = 2^e * m with m in [sqrt(0.5), sqrt(2)), then
+    // log(m) = 2 * atanh((m - 1) / (m + 1))
+    F64 e = 0;
+    for (; a >= 1.4142135623730950488; a *= 0.5) {
+        ++e;
+    }
+    for (; a < 0.70710678118654752440; a *= 2) {
+        --e;
+    }
+
+    F64 t = (a - 1) / (a + 1);
+    F64 t2 = t * t;
+    F64 power = t;
+    F64 sum = 0;
+    for (int i = 1; i < 40; i += 2) {
+        sum += power / i;
+        power *= t2;
+    }
+    return 2 * sum + e * 0.6931471805599453094;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Base functions
 
@@ -118,133 +208,195 @@ inline F32 LogBase10(F32 a) {
     return log10f(a);
 }
 
-inline F32 Pow(F32 a, F32 b) {
+constexpr F32 Abs(F32 a) {
+    if (std::is_constant_evaluated()) {
+        return a < 0 ? -a : (a == 0 ? 0.0f : a);
+    }
+    return fabsf(a);
+}
+
+constexpr F32 Exp(F32 a) {
+    if (std::is_constant_evaluated()) {
+        return F32(ConstantExp(a));
+    }
+    return expf(a);
+}
+
+// Constant evaluation handles the non-negative bases that tables need
+constexpr F32 Pow(F32 a, F32 b) {
+    if (std::is_constant_evaluated()) {
+        return b == 0 ? 1.0f : F32(ConstantExp(b * ConstantLog(a)));
+    }
     return powf(a, b);
 }
 
-inline F32 Sqrt(F32 a) {
+constexpr F32 Sqrt(F32 a) {
+    if (std::is_constant_evaluated()) {
+        return F32(ConstantSqrt(a));
+    }
     return sqrtf(a);
 }
 
-inline F32 Min(F32 a, F32 b) {
+constexpr F32 Min(F32 a, F32 b) {
     return TC_MIN(a, b);
 }
 
-inline F32 Max(F32 a, F32 b) {
+constexpr F32 Max(F32 a, F32 b) {
     return TC_MAX(a, b);
 }
 
-inline F32 Floor(F32 a) {
+// Every F32 of magnitude 2^23 or more is already integral
+constexpr F32 Floor(F32 a) {
+    if (std::is_constant_evaluated()) {
+        if (!(Abs(a) < 8388608.0f)) {
+            return a;
+        }
+        F32 t = F32(S32(a));
+        return t > a ? t - 1.0f : (t == a ? a : t);
+    }
     return floorf(a);
 }
 
-inline F32 Ceil(F32 a) {
+constexpr F32 Ceil(F32 a) {
+    if (std::is_constant_evaluated()) {
+        return -Floor(-a);
+    }
     return ceilf(a);
 }
 
-inline F32 Abs(F32 a) {
-    return fabsf(a);
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 // Vector 4D functions
 
-inline Vec4 operator-(Vec4 a) {
-    return {-a.x, -a.y, -a.z, -a.w};
+inline F32x4 F32x4Load(Vec4 a) {
+    return F32x4Load(a.raw);
 }
 
-inline Vec4 operator+(Vec4 a, Vec4 b) {
-    return {a.x+b.x, a.y+b.y, a.z+b.z, a.w+b.w};
+inline Vec4 Vec4Store(F32x4 a) {
+    Vec4 vec;
+    F32x4Store(vec.raw, a);
+    return vec;
 }
 
-inline Vec4 operator-(Vec4 a, Vec4 b) {
-    return {a.x-b.x, a.y-b.y, a.z-b.z, a.w-b.w};
+// The SIMD paths perform the same IEEE operations per lane as the scalar
+// expressions used during constant evaluation.
+
+constexpr Vec4 operator-(Vec4 a) {
+    if (std::is_constant_evaluated()) {
+        return {-a.x, -a.y, -a.z, -a.w};
+    }
+    return Vec4Store(-F32x4Load(a));
+}
+
+constexpr Vec4 operator+(Vec4 a, Vec4 b) {
+    if (std::is_constant_evaluated()) {
+        return {a.x+b.x, a.y+b.y, a.z+b.z, a.w+b.w};
+    }
+    return Vec4Store(F32x4Load(a) + F32x4Load(b));
 }
 
-inline Vec4 operator*(Vec4 a, F32 b) {
-    return {a.x*b, a.y*b, a.z*b, a.w*b};
+constexpr Vec4 operator-(Vec4 a, Vec4 b) {
+    if (std::is_constant_evaluated()) {
+        return {a.x-b.x, a.y-b.y, a.z-b.z, a.w-b.w};
+    }
+    return Vec4Store(F32x4Load(a) - F32x4Load(b));
 }
 
-inline Vec4 operator*(F32 a, Vec4 b) {
-    return {a*b.x, a*b.y, a*b.z, a*b.w};
+constexpr Vec4 operator*(Vec4 a, F32 b) {
+    if (std::is_constant_evaluated()) {
+        return {a.x*b, a.y*b, a.z*b, a.w*b};
+    }
+    return Vec4Store(F32x4Load(a) * F32x4Splat(b));
 }
 
-inline Vec4 operator/(Vec4 a, F32 b) {
+constexpr Vec4 operator*(F32 a, Vec4 b) {
+    if (std::is_constant_evaluated()) {
+        return {a*b.x, a*b.y, a*b.z, a*b.w};
+    }
+    return Vec4Store(F32x4Splat(a) * F32x4Load(b));
+}
+
+constexpr Vec4 operator/(Vec4 a, F32 b) {
     F32 inv = 1.0f / b;
-    return {a.x*inv, a.y*inv, a.z*inv, a.w*inv};
+    if (std::is_constant_evaluated()) {
+        return {a.x*inv, a.y*inv, a.z*inv, a.w*inv};
+    }
+    return Vec4Store(F32x4Load(a) * F32x4Splat(inv));
 }
 
-inline Vec4 operator/(F32 a, Vec4 b) {
-    return {a/b.x, a/b.y, a/b.z, a/b.w};
+constexpr Vec4 operator/(F32 a, Vec4 b) {
+    if (std::is_constant_evaluated()) {
+        return {a/b.x, a/b.y, a/b.z, a/b.w};
+    }
+    return Vec4Store(F32x4Splat(a) / F32x4Load(b));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Vector 3D functions
 
-inline Vec3 operator-(Vec3 a) {
+constexpr Vec3 operator-(Vec3 a) {
     return {-a.x, -a.y, -a.z};
 }
 
-inline Vec3 operator+(Vec3 a, Vec3 b) {
+constexpr Vec3 operator+(Vec3 a, Vec3 b) {
     return {a.x+b.x, a.y+b.y, a.z+b.z};
 }
 
-inline Vec3 operator-(Vec3 a, Vec3 b) {
+constexpr Vec3 operator-(Vec3 a, Vec3 b) {
     return {a.x-b.x, a.y-b.y, a.z-b.z};
 }
 
-inline Vec3 operator*(Vec3 a, F32 b) {
+constexpr Vec3 operator*(Vec3 a, F32 b) {
     return {a.x*b, a.y*b, a.z*b};
 }
 
-inline Vec3 operator*(F32 a, Vec3 b) {
+constexpr Vec3 operator*(F32 a, Vec3 b) {
     return {a*b.x, a*b.y, a*b.z};
 }
 
-inline Vec3 operator/(Vec3 a, F32 b) {
+constexpr Vec3 operator/(Vec3 a, F32 b) {
     F32 inv = 1.0f / b;
     return {a.x*inv, a.y*inv, a.z*inv};
 }
 
-inline Vec3 operator/(F32 a, Vec3 b) {
+constexpr Vec3 operator/(F32 a, Vec3 b) {
     return {a/b.x, a/b.y, a/b.z};
 }
 
-inline F32 Dot(Vec3 a, Vec3 b) {
+constexpr F32 Dot(Vec3 a, Vec3 b) {
     return a.x*b.x + a.y*b.y + a.z*b.z;
 }
 
-inline Vec3 Cross(Vec3 a, Vec3 b) {
+constexpr Vec3 Cross(Vec3 a, Vec3 b) {
     F32 x = a.y*b.z - a.z*b.y;
     F32 y = a.z*b.x - a.x*b.z;
     F32 z = a.x*b.y - a.y*b.x;
     return {x, y, z};
 }
 
-inline F32 LengthSquared(Vec3 a) {
+constexpr F32 LengthSquared(Vec3 a) {
     return Dot(a, a);
 }
 
-inline F32 Length(Vec3 a) {
+constexpr F32 Length(Vec3 a) {
     return Sqrt(LengthSquared(a));
 }
 
-inline Vec3 Normalize(Vec3 a) {
+constexpr Vec3 Normalize(Vec3 a) {
     return a * (1.0f / Length(a));
 }
 
-inline Vec3 Lerp(Vec3 a, Vec3 b, F32 t) {
+constexpr Vec3 Lerp(Vec3 a, Vec3 b, F32 t) {
     return (1.0f-t)*a + t*b;
 }
 
-inline Vec3 Min(Vec3 a, Vec3 b) {
+constexpr Vec3 Min(Vec3 a, Vec3 b) {
     F32 x = Min(a.x, b.x);
     F32 y = Min(a.y, b.y);
     F32 z = Min(a.z, b.z);
     return {x, y, z};
 }
 
-inline Vec3 Max(Vec3 a, Vec3 b) {
+constexpr Vec3 Max(Vec3 a, Vec3 b) {
     F32 x = Max(a.x, b.x);
     F32 y = Max(a.y, b.y);
     F32 z = Max(a.z, b.z);
@@ -254,66 +406,66 @@ inline Vec3 Max(Vec3 a, Vec3 b) {
 ////////////////////////////////////////////////////////////////////////////////
 // Vector 2D functions
 
-inline Vec2 operator-(Vec2 a) {
+constexpr Vec2 operator-(Vec2 a) {
     return {-a.x, -a.y};
 }
 
-inline Vec2 operator+(Vec2 a, Vec2 b) {
+constexpr Vec2 operator+(Vec2 a, Vec2 b) {
     return {a.x+b.x, a.y+b.y};
 }
 
-inline Vec2 operator-(Vec2 a, Vec2 b) {
+constexpr Vec2 operator-(Vec2 a, Vec2 b) {
     return {a.x-b.x, a.y-b.y};
 }
 
-inline Vec2 operator*(Vec2 a, F32 b) {
+constexpr Vec2 operator*(Vec2 a, F32 b) {
     return {a.x*b, a.y*b};
 }
 
-inline Vec2 operator*(F32 a, Vec2 b) {
+constexpr Vec2 operator*(F32 a, Vec2 b) {
     return {a*b.x, a*b.y};
 }
 
-inline Vec2 operator/(Vec2 a, F32 b) {
+constexpr Vec2 operator/(Vec2 a, F32 b) {
     F32 inv = 1.0f / b;
     return {a.x*inv, a.y*inv};
 }
 
-inline Vec2 operator/(F32 a, Vec2 b) {
+constexpr Vec2 operator/(F32 a, Vec2 b) {
     return {a/b.x, a/b.y};
 }
 
-inline F32 Dot(Vec2 a, Vec2 b) {
+constexpr F32 Dot(Vec2 a, Vec2 b) {
     return a.x*b.x + a.y*b.y;
 }
 
-inline F32 Cross(Vec2 a, Vec2 b) {
+constexpr F32 Cross(Vec2 a, Vec2 b) {
     return a.x*b.y - a.y*b.x;
 }
 
-inline F32 LengthSquared(Vec2 a) {
+constexpr F32 LengthSquared(Vec2 a) {
     return Dot(a, a);
 }
 
-inline F32 Length(Vec2 a) {
+constexpr F32 Length(Vec2 a) {
     return Sqrt(LengthSquared(a));
 }
 
-inline Vec2 Normalize(Vec2 a) {
+constexpr Vec2 Normalize(Vec2 a) {
     return a * (1.0f / Length(a));
 }
 
-inline Vec2 Lerp(Vec2 a, Vec2 b, F32 t) {
+constexpr Vec2 Lerp(Vec2 a, Vec2 b, F32 t) {
     return (1.0f-t)*a + t*b;
 }
 
-inline Vec2 Min(Vec2 a, Vec2 b) {
+constexpr Vec2 Min(Vec2 a, Vec2 b) {
     F32 x = Min(a.x, b.x);
     F32 y = Min(a.y, b.y);
     return {x, y};
 }
 
-inline Vec2 Max(Vec2 a, Vec2 b) {
+constexpr Vec2 Max(Vec2 a, Vec2 b) {
     F32 x = Max(a.x, b.x);
     F32 y = Max(a.y, b.y);
     return {x, y};
@@ -322,7 +474,7 @@ inline Vec2 Max(Vec2 a, Vec2 b) {
 ////////////////////////////////////////////////////////////////////////////////
 // Matrix 4x4 functions
 
-inline Mat4 Mat4Identity() {
+constexpr Mat4 Mat4Identity() {
     Mat4 mat = {
         1, 0, 0, 0,
         0, 1, 0, 0,
@@ -332,215 +484,444 @@ inline Mat4 Mat4Identity() {
     return mat;
 }
 
-inline Mat4 operator+(Mat4 a, Mat4 b) {
+constexpr Mat4 operator+(Mat4 a, Mat4 b) {
     Mat4 mat = {};
-    for (int r = 0; r < 4; ++r) {
-        for (int c = 0; c < 4; ++c) {
-            mat.raw[r][c] = a.raw[r][c] + b.raw[r][c];
+    if (std::is_constant_evaluated()) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                mat.raw[r][c] = a.raw[r][c] + b.raw[r][c];
+            }
         }
+        return mat;
+    }
+    for (int r = 0; r < 4; ++r) {
+        F32x4Store(mat.raw[r], F32x4Load(a.raw[r]) + F32x4Load(b.raw[r]));
     }
     return mat;
 }
 
-inline Mat4 operator-(Mat4 a, Mat4 b) {
+constexpr Mat4 operator-(Mat4 a, Mat4 b) {
     Mat4 mat = {};
-    for (int r = 0; r < 4; ++r) {
-        for (int c = 0; c < 4; ++c) {
-            mat.raw[r][c] = a.raw[r][c] - b.raw[r][c];
+    if (std::is_constant_evaluated()) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                mat.raw[r][c] = a.raw[r][c] - b.raw[r][c];
+            }
         }
+        return mat;
+    }
+    for (int r = 0; r < 4; ++r) {
+        F32x4Store(mat.raw[r], F32x4Load(a.raw[r]) - F32x4Load(b.raw[r]));
     }
     return mat;
 }
 
-inline Mat4 operator*(Mat4 a, Mat4 b) {
+// Each row of the result is accumulated as a.raw[r][0]*b0 + ... + a.raw[r][3]*b3
+// in that order and without fused multiply-adds, so every path matches the
+// scalar definition bit for bit.
+constexpr Mat4 operator*(Mat4 a, Mat4 b) {
     Mat4 mat = {};
-    for (int r = 0; r < 4; ++r) {
-        for (int c = 0; c < 4; ++c) {
-            mat.raw[r][c] = a.raw[r][0] * b.raw[0][c] + a.raw[r][1] * b.raw[1][c] + a.raw[r][2] * b.raw[2][c] + a.raw[r][3] * b.raw[3][c];
+    if (std::is_constant_evaluated()) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                F32 acc = a.raw[r][0] * b.raw[0][c];
+                acc = acc + a.raw[r][1] * b.raw[1][c];
+                acc = acc + a.raw[r][2] * b.raw[2][c];
+                acc = acc + a.raw[r][3] * b.raw[3][c];
+                mat.raw[r][c] = acc;
+            }
         }
+        return mat;
     }
+#if TC_SIMD_AVX2
+    __m256 b0 = _mm256_broadcast_ps((const __m128*) b.raw[0]);
+    __m256 b1 = _mm256_broadcast_ps((const __m128*) b.raw[1]);
+    __m256 b2 = _mm256_broadcast_ps((const __m128*) b.raw[2]);
+    __m256 b3 = _mm256_broadcast_ps((const __m128*) b.raw[3]);
+    for (int r = 0; r < 4; r += 2) {
+        __m256 rows = _mm256_loadu_ps(a.raw[r]);
+        __m256 acc = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x00), b0);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x55), b1));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xaa), b2));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xff), b3));
+        _mm256_storeu_ps(mat.raw[r], acc);
+    }
+#else
+    F32x4 b0 = F32x4Load(b.raw[0]);
+    F32x4 b1 = F32x4Load(b.raw[1]);
+    F32x4 b2 = F32x4Load(b.raw[2]);
+    F32x4 b3 = F32x4Load(b.raw[3]);
+    for (int r = 0; r < 4; ++r) {
+        F32x4 acc = F32x4Splat(a.raw[r][0]) * b0;
+        acc = acc + F32x4Splat(a.raw[r][1]) * b1;
+        acc = acc + F32x4Splat(a.raw[r][2]) * b2;
+        acc = acc + F32x4Splat(a.raw[r][3]) * b3;
+        F32x4Store(mat.raw[r], acc);
+    }
+#endif
     return mat;
 }
 
-inline Mat4 operator*(Mat4 a, F32 b) {
+constexpr Mat4 operator*(Mat4 a, F32 b) {
     Mat4 mat = {};
-    for (int r = 0; r < 4; ++r) {
-        for (int c = 0; c < 4; ++c) {
-            mat.raw[r][c] = a.raw[r][c] * b;
+    if (std::is_constant_evaluated()) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                mat.raw[r][c] = a.raw[r][c] * b;
+            }
         }
+        return mat;
+    }
+    F32x4 s = F32x4Splat(b);
+    for (int r = 0; r < 4; ++r) {
+        F32x4Store(mat.raw[r], F32x4Load(a.raw[r]) * s);
     }
     return mat;
 }
 
-inline Mat4 operator*(F32 a, Mat4 b) {
+constexpr Mat4 operator*(F32 a, Mat4 b) {
     Mat4 mat = {};
-    for (int r = 0; r < 4; ++r) {
-        for (int c = 0; c < 4; ++c) {
-            mat.raw[r][c] = a * b.raw[r][c];
+    if (std::is_constant_evaluated()) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                mat.raw[r][c] = a * b.raw[r][c];
+            }
         }
+        return mat;
+    }
+    F32x4 s = F32x4Splat(a);
+    for (int r = 0; r < 4; ++r) {
+        F32x4Store(mat.raw[r], s * F32x4Load(b.raw[r]));
     }
     return mat;
 }
 
-inline Mat4 Transpose(Mat4 a) {
-    Mat4 mat = {
-        a.raw[0][0], a.raw[1][0], a.raw[2][0], a.raw[3][0],
-        a.raw[0][1], a.raw[1][1], a.raw[2][1], a.raw[3][1],
-        a.raw[0][2], a.raw[1][2], a.raw[2][2], a.raw[3][2],
-        a.raw[0][3], a.raw[1][3], a.raw[2][3], a.raw[3][3]
-    };
+constexpr Mat4 Transpose(Mat4 a) {
+    if (std::is_constant_evaluated()) {
+        Mat4 mat = {};
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                mat.raw[r][c] = a.raw[c][r];
+            }
+        }
+        return mat;
+    }
+
+    F32x4 r0 = F32x4Load(a.raw[0]);
+    F32x4 r1 = F32x4Load(a.raw[1]);
+    F32x4 r2 = F32x4Load(a.raw[2]);
+    F32x4 r3 = F32x4Load(a.raw[3]);
+    Transpose(r0, r1, r2, r3);
+
+    Mat4 mat = {};
+    F32x4Store(mat.raw[0], r0);
+    F32x4Store(mat.raw[1], r1);
+    F32x4Store(mat.raw[2], r2);
+    F32x4Store(mat.raw[3], r3);
     return mat;
 }
 
-inline Vec4 Diagonal(Mat4 a) {
+constexpr Vec4 Diagonal(Mat4 a) {
     return {a.raw[0][0], a.raw[1][1], a.raw[2][2], a.raw[3][3]};
 }
 
+// Inverse traps on singular input, TryInverse reports it by returning false
+// and leaves result untouched.
 Mat4 Inverse(Mat4 a);
+bool TryInverse(Mat4 a, Mat4* result);
+
+// Faster inverse for matrices whose last row is (0, 0, 0, 1), i.e. any
+// combination of rotation, scale, shear and translation.
+Mat4 InverseAffine(Mat4 a);
+bool TryInverseAffine(Mat4 a, Mat4* result);
+
+constexpr bool IsAffine(Mat4 a) {
+    return a.raw[3][0] == 0 && a.raw[3][1] == 0 && a.raw[3][2] == 0 && a.raw[3][3] == 1;
+}
+
+// Applies a to the column vector (b, 1), dividing by the resulting w unless
+// it is exactly one.
+constexpr Vec3 TransformPoint(Mat4 a, Vec3 b) {
+    F32 x = a.raw[0][0]*b.x + a.raw[0][1]*b.y + a.raw[0][2]*b.z + a.raw[0][3];
+    F32 y = a.raw[1][0]*b.x + a.raw[1][1]*b.y + a.raw[1][2]*b.z + a.raw[1][3];
+    F32 z = a.raw[2][0]*b.x + a.raw[2][1]*b.y + a.raw[2][2]*b.z + a.raw[2][3];
+    F32 w = a.raw[3][0]*b.x + a.raw[3][1]*b.y + a.raw[3][2]*b.z + a.raw[3][3];
+    if (w == 1) {
+        return {x, y, z};
+    }
+    F32 inv = 1.0f / w;
+    return {x*inv, y*inv, z*inv};
+}
+
+// Applies a to the column vector (b, 0), ignoring translation
+constexpr Vec3 TransformVector(Mat4 a, Vec3 b) {
+    F32 x = a.raw[0][0]*b.x + a.raw[0][1]*b.y + a.raw[0][2]*b.z;
+    F32 y = a.raw[1][0]*b.x + a.raw[1][1]*b.y + a.raw[1][2]*b.z;
+    F32 z = a.raw[2][0]*b.x + a.raw[2][1]*b.y + a.raw[2][2]*b.z;
+    return {x, y, z};
+}
+
+// Normals transform by the inverse transpose, so this takes the inverse of
+// the matrix that transforms the surface. The result is not normalized.
+constexpr Vec3 TransformNormal(Mat4 inverse, Vec3 b) {
+    F32 x = inverse.raw[0][0]*b.x + inverse.raw[1][0]*b.y + inverse.raw[2][0]*b.z;
+    F32 y = inverse.raw[0][1]*b.x + inverse.raw[1][1]*b.y + inverse.raw[2][1]*b.z;
+    F32 z = inverse.raw[0][2]*b.x + inverse.raw[1][2]*b.y + inverse.raw[2][2]*b.z;
+    return {x, y, z};
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // Quaternion functions
 
-inline Quat QuatIdentity() {
+constexpr Quat QuatIdentity() {
     Quat quat = {0, 0, 0, 1};
     return quat;
 }
 
-inline Quat operator+(Quat a, Quat b) {
-    return {a.x+b.x, a.y+b.y, a.z+b.z, a.w+b.w};
+inline F32x4 F32x4Load(Quat a) {
+    return F32x4Load(a.raw);
 }
 
-inline Quat operator-(Quat a, Quat b) {
-    return {a.x-b.x, a.y-b.y, a.z-b.z, a.w-b.w};
+inline Quat QuatStore(F32x4 a) {
+    Quat quat;
+    F32x4Store(quat.raw, a);
+    return quat;
 }
 
-inline Quat operator*(Quat a, Quat b) {
-    F32 x = a.x*b.w + a.w*b.x + a.y*b.w - a.z*b.y;
-    F32 y = a.y*b.w + a.w*b.y + a.z*b.x - a.x*b.z;
-    F32 z = a.z*b.w + a.w*b.z + a.x*b.y - a.y*b.x;
-    F32 w = a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z;
-    return {x, y, z, w};
+constexpr Quat operator+(Quat a, Quat b) {
+    if (std::is_constant_evaluated()) {
+        return {a.x+b.x, a.y+b.y, a.z+b.z, a.w+b.w};
+    }
+    return QuatStore(F32x4Load(a) + F32x4Load(b));
 }
 
-inline Quat operator*(Quat a, F32 b) {
-    return {a.x*b, a.y*b, a.z*b, a.w*b};
+constexpr Quat operator-(Quat a, Quat b) {
+    if (std::is_constant_evaluated()) {
+        return {a.x-b.x, a.y-b.y, a.z-b.z, a.w-b.w};
+    }
+    return QuatStore(F32x4Load(a) - F32x4Load(b));
+}
+
+// Hamilton product, evaluated lane-wise as
+//   x = a.x*b.w + a.w*b.x + a.y*b.z - a.z*b.y
+//   y = a.y*b.w + a.w*b.y + a.z*b.x - a.x*b.z
+//   z = a.z*b.w + a.w*b.z + a.x*b.y - a.y*b.x
+//   w = a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z
+constexpr Quat operator*(Quat a, Quat b) {
+    if (std::is_constant_evaluated()) {
+        F32 x = a.x*b.w + a.w*b.x + a.y*b.z - a.z*b.y;
+        F32 y = a.y*b.w + a.w*b.y + a.z*b.x - a.x*b.z;
+        F32 z = a.z*b.w + a.w*b.z + a.x*b.y - a.y*b.x;
+        F32 w = a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z;
+        return {x, y, z, w};
+    }
+
+    F32x4 qa = F32x4Load(a);
+    F32x4 qb = F32x4Load(b);
+    F32x4 sign = F32x4Set(1.0f, 1.0f, 1.0f, -1.0f);
+    F32x4 t0 = qa * Shuffle<3, 3, 3, 3>(qb);
+    F32x4 t1 = Shuffle<3, 3, 3, 0>(qa) * Shuffle<0, 1, 2, 0>(qb) * sign;
+    F32x4 t2 = Shuffle<1, 2, 0, 1>(qa) * Shuffle<2, 0, 1, 1>(qb) * sign;
+    F32x4 t3 = Shuffle<2, 0, 1, 2>(qa) * Shuffle<1, 2, 0, 2>(qb);
+    return QuatStore(t0 + t1 + t2 - t3);
+}
+
+constexpr Quat operator*(Quat a, F32 b) {
+    if (std::is_constant_evaluated()) {
+        return {a.x*b, a.y*b, a.z*b, a.w*b};
+    }
+    return QuatStore(F32x4Load(a) * F32x4Splat(b));
 }
 
-inline Quat operator*(F32 a, Quat b) {
-    return {a*b.x, a*b.y, a*b.z, a*b.w};
+constexpr Quat operator*(F32 a, Quat b) {
+    if (std::is_constant_evaluated()) {
+        return {a*b.x, a*b.y, a*b.z, a*b.w};
+    }
+    return QuatStore(F32x4Splat(a) * F32x4Load(b));
 }
 
-inline Quat operator/(Quat a, F32 b) {
+constexpr Quat operator/(Quat a, F32 b) {
     F32 inv = 1.0f / b;
-    return {a.x*inv, a.y*inv, a.z*inv, a.w*inv};
+    if (std::is_constant_evaluated()) {
+        return {a.x*inv, a.y*inv, a.z*inv, a.w*inv};
+    }
+    return QuatStore(F32x4Load(a) * F32x4Splat(inv));
 }
 
-inline Quat operator/(F32 a, Quat b) {
-    return {a/b.x, a/b.y, a/b.z, a/b.w};
+constexpr Quat operator/(F32 a, Quat b) {
+    if (std::is_constant_evaluated()) {
+        return {a/b.x, a/b.y, a/b.z, a/b.w};
+    }
+    return QuatStore(F32x4Splat(a) / F32x4Load(b));
 }
 
-inline F32 Dot(Quat a, Quat b) {
+constexpr F32 Dot(Quat a, Quat b) {
      return a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w;
 }
 
-inline F32 LengthSquared(Quat a) {
+constexpr F32 LengthSquared(Quat a) {
     return Dot(a, a);
 }
 
-inline F32 Length(Quat a) {
+constexpr F32 Length(Quat a) {
     return Sqrt(LengthSquared(a));
 }
 
-inline Quat Normalize(Quat a) {
+constexpr Quat Normalize(Quat a) {
     return a * (1.0f / Length(a));
 }
 
-inline Quat Conjugate(Quat a) {
-    return {-a.x, -a.y, -a.z, a.w};
+constexpr Quat Conjugate(Quat a) {
+    if (std::is_constant_evaluated()) {
+        return {-a.x, -a.y, -a.z, a.w};
+    }
+    return QuatStore(F32x4Load(a) * F32x4Set(-1.0f, -1.0f, -1.0f, 1.0f));
 }
 
-inline Quat Inverse(Quat a) {
+constexpr Quat Inverse(Quat a) {
     return Conjugate(a) / Dot(a, a);
 }
 
-inline Quat Lerp(Quat a, Quat b, F32 t) {
+constexpr Quat Lerp(Quat a, Quat b, F32 t) {
     return (1.0f-t)*a + t*b;
 }
 
+// Constant angular speed along the shorter arc between unit quaternions.
+// Nearly equal rotations fall back to a normalized lerp, where the sine
+// ratios lose precision.
+inline Quat Slerp(Quat a, Quat b, F32 t) {
+    F32 cosAngle = Dot(a, b);
+    if (cosAngle < 0.0f) {
+        b = b * -1.0f;
+        cosAngle = -cosAngle;
+    }
+    if (cosAngle > 0.9995f) {
+        return Normalize(Lerp(a, b, t));
+    }
+    F32 angle = ACos(cosAngle);
+    F32 invSin = 1.0f / Sin(angle);
+    return a * (Sin((1.0f - t) * angle) * invSin) + b * (Sin(t * angle) * invSin);
+}
+
+// Rotation matrix of a unit quaternion, so that Mat4FromQuat(a * b) equals
+// Mat4FromQuat(a) * Mat4FromQuat(b)
+constexpr Mat4 Mat4FromQuat(Quat a) {
+    F32 xx = a.x*a.x, yy = a.y*a.y, zz = a.z*a.z;
+    F32 xy = a.x*a.y, xz = a.x*a.z, yz = a.y*a.z;
+    F32 wx = a.w*a.x, wy = a.w*a.y, wz = a.w*a.z;
+    Mat4 mat = {
+        1 - 2*(yy + zz), 2*(xy - wz),     2*(xz + wy),     0,
+        2*(xy + wz),     1 - 2*(xx + zz), 2*(yz - wx),     0,
+        2*(xz - wy),     2*(yz + wx),     1 - 2*(xx + yy), 0,
+        0,               0,               0,               1
+    };
+    return mat;
+}
+
+// Unit quaternion of the rotation in the upper 3x3 of a, which must be
+// orthonormal with a positive determinant
+Quat QuatFromMat4(Mat4 a);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Box 3D functions
 
-inline Box3 Union(Box3 a, Vec3 b) {
+// Inverted box that any union replaces
+inline Box3 Box3Empty() {
+    return {{F32Infinity(), F32Infinity(), F32Infinity()}, {F32NegInfinity(), F32NegInfinity(), F32NegInfinity()}};
+}
+
+constexpr Vec3 Centroid(Box3 a) {
+    return (a.min + a.max) * 0.5f;
+}
+
+constexpr bool IsEmpty(Box3 a) {
+    return a.min.x > a.max.x || a.min.y > a.max.y || a.min.z > a.max.z;
+}
+
+// Zero for empty boxes
+constexpr F32 SurfaceArea(Box3 a) {
+    Vec3 d = a.max - a.min;
+    if (d.x < 0 || d.y < 0 || d.z < 0) {
+        return 0;
+    }
+    return 2.0f * (d.x*d.y + d.y*d.z + d.z*d.x);
+}
+
+constexpr Box3 Union(Box3 a, Vec3 b) {
     Box3 box = {};
     box.min = Min(a.min, b);
     box.max = Max(a.max, b);
     return box;
 }
 
-inline Box3 Union(Box3 a, Box3 b) {
+constexpr Box3 Union(Box3 a, Box3 b) {
     Box3 box = {};
     box.min = Min(a.min, b.min);
     box.max = Max(a.max, b.max);
     return box;
 }
 
-inline Box3 Intersect(Box3 a, Box3 b) {
+constexpr Box3 Intersect(Box3 a, Box3 b) {
     Box3 box = {};
     box.min = Max(a.min, b.min);
     box.max = Min(a.max, b.max);
     return box;
 }
 
-inline bool Overlaps(Box3 a, Box3 b) {
+constexpr bool Overlaps(Box3 a, Box3 b) {
     bool x = (a.max.x >= b.min.x) && (a.min.x <= b.max.x);
     bool y = (a.max.y >= b.min.y) && (a.min.y <= b.max.y);
     bool z = (a.max.z >= b.min.z) && (a.min.z <= b.max.z);
     return x && y && z;
 }
 
-inline bool Inside(Box3 a, Vec3 b) {
+constexpr bool Inside(Box3 a, Vec3 b) {
     return b.x >= a.min.x && b.x <= a.max.x && b.y >= a.min.y && b.y <= a.max.y && b.z >= a.min.z && b.z <= a.max.z;
 }
 
-inline bool InsideExclusive(Box3 a, Vec3 b) {
+constexpr bool InsideExclusive(Box3 a, Vec3 b) {
      return b.x >= a.min.x && b.x < a.max.x && b.y >= a.min.y && b.y < a.max.y && b.z >= a.min.z && b.z < a.max.z;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Box 2D functions
 
-inline Box2 Union(Box2 a, Vec2 b) {
+constexpr bool IsEmpty(Box2 a) {
+    return a.min.x > a.max.x || a.min.y > a.max.y;
+}
+
+constexpr Box2 Union(Box2 a, Vec2 b) {
     Box2 box = {};
     box.min = Min(a.min, b);
     box.max = Max(a.max, b);
     return box;
 }
 
-inline Box2 Union(Box2 a, Box2 b) {
+constexpr Box2 Union(Box2 a, Box2 b) {
     Box2 box = {};
     box.min = Min(a.min, b.min);
     box.max = Max(a.max, b.max);
     return box;
 }
 
-inline Box2 Intersect(Box2 a, Box2 b) {
+constexpr Box2 Intersect(Box2 a, Box2 b) {
     Box2 box = {};
     box.min = Max(a.min, b.min);
     box.max = Min(a.max, b.max);
     return box;
 }
 
-inline bool Overlaps(Box2 a, Box2 b) {
+constexpr bool Overlaps(Box2 a, Box2 b) {
     bool x = (a.max.x >= b.min.x) && (a.min.x <= b.max.x);
     bool y = (a.max.y >= b.min.y) && (a.min.y <= b.max.y);
     return x && y;
 }
 
-inline bool Inside(Box2 a, Vec2 b) {
+constexpr bool Inside(Box2 a, Vec2 b) {
     return b.x >= a.min.x && b.x <= a.max.x && b.y >= a.min.y && b.y <= a.max.y;
 }
 
-inline bool InsideExclusive(Box2 a, Vec2 b) {
+constexpr bool InsideExclusive(Box2 a, Vec2 b) {
      return b.x >= a.min.x && b.x < a.max.x && b.y >= a.min.y && b.y < a.max.y;
 }
 
@@ -0,0 +1,214 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/motion.h>
+#include <teacup/parallel.h>
+#include <stdlib.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Motion blur BVH
+
+void MotionBvhBuild(MotionBvh* bvh, const Box3* bounds, U32 count, U32 segmentCount, const BvhBuildOptions& options, BvhBuildStats* stats) {
+    TC_ASSERT(segmentCount > 0, "Motion needs at least one segment");
+    U32 keyCount = segmentCount + 1;
+    Box3* swept = (Box3*) malloc(TC_MAX(count, 1u) * sizeof(Box3));
+    ParallelFor(count, 4096, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            Box3 box = bounds[i * keyCount];
+            for (U32 k = 1; k < keyCount; ++k) {
+                box = Union(box, bounds[i * keyCount + k]);
+            }
+            swept[i] = box;
+        }
+    });
+
+    *bvh = {};
+    BvhBuild(&bvh->bvh, swept, 0, count, options, stats);
+    bvh->segmentCount = segmentCount;
+    bvh->keyBounds = (Box3*) malloc(TC_MAX(U64(bvh->bvh.nodeCount) * keyCount, U64(1)) * sizeof(Box3));
+    MotionBvhRefit(bvh, bounds);
+    free(swept);
+}
+
+void MotionBvhFree(MotionBvh* bvh) {
+    BvhFree(&bvh->bvh);
+    free(bvh->keyBounds);
+    *bvh = {};
+}
+
+static Box3 EncloseKeys(const Box3* keys, U32 keyCount) {
+    Box3 box = keys[0];
+    for (U32 k = 1; k < keyCount; ++k) {
+        box = Union(box, keys[k]);
+    }
+    return box;
+}
+
+// Subtrees in parallel through BvhBottomUp. The union of lerped boxes lies
+// inside the lerp of their unions, so parents stay conservative between keys.
+// Node bounds enclose the keys and with them every time in between.
+void MotionBvhRefit(MotionBvh* bvh, const Box3* bounds) {
+    U32 keyCount = bvh->segmentCount + 1;
+    BvhNode* nodes = bvh->bvh.nodes;
+    BvhBottomUp(&bvh->bvh, [&](U32 i) {
+        const BvhNode* node = nodes + i;
+        Box3* keys = bvh->keyBounds + U64(i) * keyCount;
+        for (U32 k = 0; k < keyCount; ++k) {
+            keys[k] = Box3Empty();
+        }
+        for (U32 p = 0; p < node->count; ++p) {
+            const Box3* primitive = bounds + U64(bvh->bvh.indices[node->offset + p]) * keyCount;
+            for (U32 k = 0; k < keyCount; ++k) {
+                keys[k] = Union(keys[k], primitive[k]);
+            }
+        }
+        nodes[i].bounds = EncloseKeys(keys, keyCount);
+    }, [&](U32 i) {
+        const BvhNode* node = nodes + i;
+        Box3* keys = bvh->keyBounds + U64(i) * keyCount;
+        const Box3* left = bvh->keyBounds + U64(node->offset) * keyCount;
+        const Box3* right = left + keyCount;
+        for (U32 k = 0; k < keyCount; ++k) {
+            keys[k] = Union(left[k], right[k]);
+        }
+        nodes[i].bounds = EncloseKeys(keys, keyCount);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Motion blur instances
+
+// Rotation per bounded step of an instance sweep
+#define TC_MOTION_STEP_ANGLE 0.05f
+#define TC_MOTION_MAX_STEPS 256
+
+Mat4 MotionTransformAt(const MotionInstance* instance, F32 time) {
+    if (instance->keyCount == 1) {
+        return Recompose(instance->keys[0]);
+    }
+    F32 fraction;
+    U32 key = MotionSegment(instance->keyCount - 1, time, &fraction);
+    return Recompose(Interpolate(instance->keys[key], instance->keys[key + 1], fraction));
+}
+
+// Angle the slerp between two unit quaternions turns through
+static F32 RotationAngle(Quat a, Quat b) {
+    return 2.0f * ACos(Min(Abs(Dot(a, b)), 1.0f));
+}
+
+// Within a step every point p of the box follows f(t) = T(t) + R(t) q(t)
+// with q(t) = S(t) p, where translation and stretch move linearly and R turns
+// by angle at a steady rate. The chord between the step's ends is inside the
+// union of the end boxes, and f strays from it by at most max|f''| / 8 with
+// |f''| <= angle^2 |q| + 2 angle |q'|. Both |q| and |q'| peak at a corner.
+static Box3 SweepStep(Box3 object, const TransformDecomposition& a, const TransformDecomposition& b) {
+    Box3 box = Union(TransformBox(TransformFromMatrix(Recompose(a)), object), TransformBox(TransformFromMatrix(Recompose(b)), object));
+    F32 angle = RotationAngle(a.rotation, b.rotation);
+    if (angle == 0.0f) {
+        return box;
+    }
+
+    F32 radius = 0;
+    F32 change = 0;
+    for (int i = 0; i < 8; ++i) {
+        Vec3 corner = {(i & 1) ? object.max.x : object.min.x, (i & 2) ? object.max.y : object.min.y, (i & 4) ? object.max.z : object.min.z};
+        Vec3 qa = TransformVector(a.stretch, corner);
+        Vec3 qb = TransformVector(b.stretch, corner);
+        radius = Max(radius, Max(Length(qa), Length(qb)));
+        change = Max(change, Length(qb - qa));
+    }
+
+    // A little extra for rounding and the non-uniform speed of the normalized
+    // lerp Slerp falls back to for small angles
+    F32 margin = (angle * angle * radius + 2.0f * angle * change) * (0.125f * 1.01f);
+    Vec3 pad = {margin, margin, margin};
+    return {box.min - pad, box.max + pad};
+}
+
+Box3 MotionInstanceBounds(const Bvh* blases, const MotionInstance* instance, F32 t0, F32 t1) {
+    const Bvh* blas = blases + instance->blas;
+    Box3 object = blas->nodeCount > 0 ? blas->nodes[0].bounds : Box3{{0, 0, 0}, {0, 0, 0}};
+    if (instance->keyCount == 1) {
+        return TransformBox(TransformFromMatrix(Recompose(instance->keys[0])), object);
+    }
+
+    // Walk the key segments overlapping [t0, t1], splitting each into steps
+    // that turn through at most TC_MOTION_STEP_ANGLE
+    U32 segmentCount = instance->keyCount - 1;
+    F32 f0, f1;
+    U32 first = MotionSegment(segmentCount, t0, &f0);
+    U32 last = MotionSegment(segmentCount, t1, &f1);
+    Box3 box = Box3Empty();
+    for (U32 s = first; s <= last; ++s) {
+        F32 from = s == first ? f0 : 0.0f;
+        F32 to = s == last ? f1 : 1.0f;
+        const TransformDecomposition& a = instance->keys[s];
+        const TransformDecomposition& b = instance->keys[s + 1];
+        F32 angle = RotationAngle(a.rotation, b.rotation) * (to - from);
+        U32 steps = U32(TC_MIN(Ceil(angle / TC_MOTION_STEP_ANGLE), F32(TC_MOTION_MAX_STEPS)));
+        steps = TC_MAX(steps, 1u);
+        TransformDecomposition previous = Interpolate(a, b, from);
+        for (U32 i = 1; i <= steps; ++i) {
+            TransformDecomposition next = Interpolate(a, b, from + (to - from) * F32(i) / F32(steps));
+            box = Union(box, SweepStep(object, previous, next));
+            previous = next;
+        }
+    }
+    return box;
+}
+
+void MotionTlasBuild(MotionTlas* tlas, const Bvh* blases, U32 blasCount, const MotionInstance* instances, U32 instanceCount, U32 segmentCount, const BvhBuildOptions& options, BvhBuildStats* stats) {
+    TC_ASSERT(segmentCount > 0, "Motion needs at least one segment");
+    *tlas = {};
+    tlas->blases = blases;
+    tlas->instances = instances;
+    tlas->blasCount = blasCount;
+    tlas->instanceCount = instanceCount;
+
+    // Each key encloses the sweeps of both segments it ends, so the lerp
+    // between two keys encloses the sweep of the segment between them
+    U32 keyCount = segmentCount + 1;
+    Box3* bounds = (Box3*) malloc(TC_MAX(U64(instanceCount) * keyCount, U64(1)) * sizeof(Box3));
+    ParallelFor(instanceCount, 256, [&](U64 begin, U64 end) {
+        Box3 sweeps[2];
+        for (U64 i = begin; i < end; ++i) {
+            const MotionInstance* instance = instances + i;
+            TC_ASSERT(instance->blas < blasCount, "Instance of a missing BVH");
+            TC_ASSERT(instance->keyCount > 0, "Instance without transform keys");
+            Box3* keys = bounds + i * keyCount;
+            sweeps[0] = Box3Empty();
+            for (U32 s = 0; s < segmentCount; ++s) {
+                sweeps[1] = MotionInstanceBounds(blases, instance, F32(s) / F32(segmentCount), F32(s + 1) / F32(segmentCount));
+                keys[s] = Union(sweeps[0], sweeps[1]);
+                sweeps[0] = sweeps[1];
+            }
+            keys[segmentCount] = sweeps[0];
+        }
+    });
+    MotionBvhBuild(&tlas->bvh, bounds, instanceCount, segmentCount, options, stats);
+    free(bounds);
+}
+
+void MotionTlasFree(MotionTlas* tlas) {
+    MotionBvhFree(&tlas->bvh);
+    *tlas = {};
+}
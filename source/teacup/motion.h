@@ -0,0 +1,189 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_MOTION_HEADER_GUARD
+#define TC_MOTION_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/bvh.h>
+#include <teacup/transform.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Motion blur BVH
+
+// Times run from 0 at shutter open to 1 at shutter close, split into
+// segmentCount equal segments. Every node keeps its bounds at the
+// segmentCount + 1 segment ends, and a ray tests the bounds lerped between
+// the two keys around its time, so one tree serves every time sample.
+struct MotionBvh {
+    // Topology, with node bounds enclosing the whole shutter interval
+    Bvh bvh;
+
+    // segmentCount + 1 boxes per node, node by node
+    Box3* keyBounds;
+    U32 segmentCount;
+};
+
+// bounds holds segmentCount + 1 boxes per primitive, primitive by primitive.
+// The box lerped between two neighbouring keys must enclose the primitive at
+// every time between them, as the keyed boxes of linearly moving vertices do.
+// The topology is built over each primitive's bounds across the shutter.
+void MotionBvhBuild(MotionBvh* bvh, const Box3* bounds, U32 count, U32 segmentCount, const BvhBuildOptions& options = {}, BvhBuildStats* stats = 0);
+void MotionBvhFree(MotionBvh* bvh);
+
+// Recomputes the keyed bounds of every node from new primitive bounds laid
+// out as for MotionBvhBuild, keeping the topology
+void MotionBvhRefit(MotionBvh* bvh, const Box3* bounds);
+
+// Segment holding time and how far into it time lies
+inline U32 MotionSegment(U32 segmentCount, F32 time, F32* fraction) {
+    F32 scaled = Min(Max(time, 0.0f), 1.0f) * F32(segmentCount);
+    U32 segment = TC_MIN(U32(scaled), segmentCount - 1);
+    *fraction = scaled - F32(segment);
+    return segment;
+}
+
+inline Box3 MotionBounds(const MotionBvh* bvh, U32 node, U32 segment, F32 fraction) {
+    const Box3* keys = bvh->keyBounds + U64(node) * (bvh->segmentCount + 1) + segment;
+    return {Lerp(keys[0].min, keys[1].min, fraction), Lerp(keys[0].max, keys[1].max, fraction)};
+}
+
+// Same visiting order and early exit rules as Traverse(const Bvh*), with
+// node bounds taken at time
+template <typename F>
+void Traverse(const MotionBvh* bvh, RaySlab ray, F32 time, F intersector) {
+    struct Entry {
+        U32 node;
+        F32 t;
+    };
+
+    if (bvh->bvh.nodeCount == 0) {
+        return;
+    }
+
+    F32 fraction;
+    U32 segment = MotionSegment(bvh->segmentCount, time, &fraction);
+    Entry stack[TC_BVH_STACK_SIZE];
+    U32 stackSize = 0;
+    U32 current = 0;
+    F32 tEntry, tExit;
+    if (!Intersect(ray, MotionBounds(bvh, 0, segment, fraction), &tEntry, &tExit)) {
+        return;
+    }
+
+    const BvhNode* nodes = bvh->bvh.nodes;
+    for (;;) {
+        const BvhNode* node = nodes + current;
+        if (node->count > 0) {
+            for (U32 i = 0; i < node->count; ++i) {
+                if (!intersector(bvh->bvh.indices[node->offset + i], &ray)) {
+                    return;
+                }
+            }
+        }
+        else {
+            F32 entry0, entry1;
+            bool hit0 = Intersect(ray, MotionBounds(bvh, node->offset, segment, fraction), &entry0, &tExit);
+            bool hit1 = Intersect(ray, MotionBounds(bvh, node->offset + 1, segment, fraction), &entry1, &tExit);
+            if (hit0 && hit1) {
+                U32 nearChild = node->offset + (entry1 < entry0);
+                U32 farChild = node->offset + (entry1 >= entry0);
+                TC_ASSERT(stackSize < TC_BVH_STACK_SIZE);
+                stack[stackSize++] = {farChild, TC_MAX(entry0, entry1)};
+                current = nearChild;
+                continue;
+            }
+            if (hit0 || hit1) {
+                current = node->offset + hit1;
+                continue;
+            }
+        }
+
+        // Hits since the push may have moved tMax in front of a far child
+        Entry entry;
+        do {
+            if (stackSize == 0) {
+                return;
+            }
+            entry = stack[--stackSize];
+        } while (entry.t > ray.tMax);
+        current = entry.node;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Motion blur instances
+
+// Instance whose object to world transform passes through keyCount keys
+// evenly spaced over the shutter interval. One key holds it still.
+struct MotionInstance {
+    const TransformDecomposition* keys;
+    U32 keyCount;
+    U32 blas;
+};
+
+// Object to world matrix at time, interpolated between the keys around it
+Mat4 MotionTransformAt(const MotionInstance* instance, F32 time);
+
+// World space box enclosing the root of the instance's bottom level BVH at
+// every time from t0 to t1. Sweeps are bounded segment by segment with a
+// margin for the rotation's curved path, so the box is conservative but not
+// tight.
+Box3 MotionInstanceBounds(const Bvh* blases, const MotionInstance* instance, F32 t0, F32 t1);
+
+// Motion blur BVH over instances of static bottom level BVHs. Like Tlas it
+// only points at the caller's BVHs, instances and keys.
+struct MotionTlas {
+    MotionBvh bvh;
+    const Bvh* blases;
+    const MotionInstance* instances;
+    U32 blasCount;
+    U32 instanceCount;
+};
+
+// segmentCount sets how finely the instance bounds follow the motion and
+// need not match the instances' key counts
+void MotionTlasBuild(MotionTlas* tlas, const Bvh* blases, U32 blasCount, const MotionInstance* instances, U32 instanceCount, U32 segmentCount, const BvhBuildOptions& options = {}, BvhBuildStats* stats = 0);
+void MotionTlasFree(MotionTlas* tlas);
+
+// Traverse(const Tlas*) at the given time. Each instance the ray reaches
+// costs an interpolation and an affine inverse.
+template <typename F>
+void Traverse(const MotionTlas* tlas, Ray ray, F32 time, F intersector) {
+    Traverse(&tlas->bvh, Precompute(ray), time, [&](U32 index, RaySlab* world) {
+        const MotionInstance* instance = tlas->instances + index;
+        Mat4 inverse;
+        if (!TryInverseAffine(MotionTransformAt(instance, time), &inverse)) {
+            return true;
+        }
+        Ray objectRay = {TransformPoint(inverse, ray.origin), TransformVector(inverse, ray.direction), world->tMin, world->tMax};
+        bool more = true;
+        Traverse(tlas->blases + instance->blas, Precompute(objectRay), [&](U32 primitive, RaySlab* slab) {
+            more = intersector(index, primitive, objectRay, slab);
+            world->tMax = slab->tMax;
+            return more;
+        });
+        return more;
+    });
+}
+
+#endif // TC_MOTION_HEADER_GUARD
@@ -0,0 +1,141 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/packet.h>
+#include <teacup/sort.h>
+#include <stdlib.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Ray packets
+
+template <typename T>
+void RayPacketInit(RayPacket<T>* packet, const Ray* rays, U32 count) {
+    TC_ASSERT(count <= TC_RAY_PACKET_SIZE);
+    const U32 lanes = TC_LANES(T);
+    packet->count = count;
+    packet->groupCount = (count + lanes - 1) / lanes;
+
+    Vec3 mean = {0, 0, 0};
+    Box3 origins = Box3Empty();
+    Box3 inverses = Box3Empty();
+    F32 tMin = F32Infinity();
+    F32 tMax = F32NegInfinity();
+    bool frustum = count > 0;
+    U32 signMask = 0;
+
+    // Lanes past count start at the origin with tMax below tMin
+    for (U32 group = 0; group < packet->groupCount; ++group) {
+        F32 raw[8][TC_LANES(T)];
+        for (U32 lane = 0; lane < lanes; ++lane) {
+            U32 i = group * lanes + lane;
+            RaySlab slab = {{0, 0, 0}, {1, 1, 1}, 0, 0.0f, -1.0f};
+            if (i < count) {
+                slab = Precompute(rays[i]);
+                origins = Union(origins, slab.origin);
+                inverses = Union(inverses, slab.inverseDirection);
+                tMin = Min(tMin, slab.tMin);
+                tMax = Max(tMax, slab.tMax);
+                mean = mean + Normalize(rays[i].direction);
+                signMask = i == 0 ? slab.signMask : signMask;
+                frustum = frustum && slab.signMask == signMask;
+            }
+            for (int k = 0; k < 3; ++k) {
+                raw[k][lane] = slab.origin.raw[k];
+                raw[3 + k][lane] = slab.inverseDirection.raw[k];
+            }
+            raw[6][lane] = slab.tMin;
+            raw[7][lane] = slab.tMax;
+        }
+        packet->origin[group] = {Load<T>(raw[0]), Load<T>(raw[1]), Load<T>(raw[2])};
+        packet->inverseDirection[group] = {Load<T>(raw[3]), Load<T>(raw[4]), Load<T>(raw[5])};
+        packet->tMin[group] = Load<T>(raw[6]);
+        packet->tMax[group] = Load<T>(raw[7]);
+    }
+
+    // Zero direction components invert to infinities, whose interval
+    // products can be NaN
+    for (int k = 0; k < 3 && frustum; ++k) {
+        frustum = Abs(inverses.min.raw[k]) < F32Infinity() && Abs(inverses.max.raw[k]) < F32Infinity();
+    }
+
+    packet->direction = mean;
+    packet->originMin = origins.min;
+    packet->originMax = origins.max;
+    packet->inverseMin = inverses.min;
+    packet->inverseMax = inverses.max;
+    packet->tMinBound = tMin;
+    packet->tMaxBound = tMax;
+    packet->frustum = frustum;
+
+    packet->coherence = -1.0f;
+    if (count > 0 && LengthSquared(mean) > 0.0f) {
+        Vec3 axis = Normalize(mean);
+        packet->coherence = 1.0f;
+        for (U32 i = 0; i < count; ++i) {
+            packet->coherence = Min(packet->coherence, Dot(Normalize(rays[i].direction), axis));
+        }
+    }
+}
+
+template void RayPacketInit<F32x4>(RayPacket<F32x4>* packet, const Ray* rays, U32 count);
+template void RayPacketInit<F32x8>(RayPacket<F32x8>* packet, const Ray* rays, U32 count);
+
+////////////////////////////////////////////////////////////////////////////////
+// Ray streams
+
+static U64 RayStreamMorton(Vec3 a, Vec3 min, Vec3 scale) {
+    U64 key = 0;
+    for (int k = 0; k < 3; ++k) {
+        F32 cell = (a.raw[k] - min.raw[k]) * scale.raw[k];
+        key |= U64(MortonExpand(U32(TC_CLAMP(cell, 0.0f, 1023.0f)))) << (2 - k);
+    }
+    return key;
+}
+
+void RayStreamSort(const Ray* rays, U32 count, U32* order) {
+    Box3 origins = Box3Empty();
+    for (U32 i = 0; i < count; ++i) {
+        origins = Union(origins, rays[i].origin);
+    }
+    Vec3 extent = origins.max - origins.min;
+    Vec3 originScale = {};
+    for (int k = 0; k < 3; ++k) {
+        originScale.raw[k] = extent.raw[k] > 0.0f ? 1024.0f / extent.raw[k] : 0.0f;
+    }
+
+    // Octant in bits 60 to 62, origin code in 30 to 59, direction code below
+    U64* keys = (U64*) malloc(TC_MAX(count, 1u) * 2 * sizeof(U64));
+    U32* scratch = (U32*) malloc(TC_MAX(count, 1u) * sizeof(U32));
+    ParallelFor(count, 4096, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            Vec3 direction = Normalize(rays[i].direction);
+            U64 octant = U64(direction.x < 0) | U64(direction.y < 0) << 1 | U64(direction.z < 0) << 2;
+            U64 origin = RayStreamMorton(rays[i].origin, origins.min, originScale);
+            U64 turn = RayStreamMorton(direction, Vec3{-1, -1, -1}, Vec3{512, 512, 512});
+            keys[i] = octant << 60 | origin << 30 | turn;
+            order[i] = U32(i);
+        }
+    });
+    RadixSort(keys, order, keys + count, scratch, count, 63);
+    free(scratch);
+    free(keys);
+}
@@ -0,0 +1,347 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_PACKET_HEADER_GUARD
+#define TC_PACKET_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+#include <teacup/bvh.h>
+#include <teacup/parallel.h>
+#include <teacup/ray.h>
+#include <teacup/wide.h>
+#include <atomic>
+#include <stdlib.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Ray packets
+
+#define TC_RAY_PACKET_SIZE 64
+#define TC_RAY_PACKET_GROUPS(T) (TC_RAY_PACKET_SIZE / TC_LANES(T))
+
+// Up to TC_RAY_PACKET_SIZE rays that traverse a tree together, in groups of
+// one ray per lane of T. Lanes past count never hit anything. The bounds
+// over all rays let a single interval test cull a node for the whole packet,
+// see Wald et al. 2007.
+template <typename T>
+struct RayPacket {
+    Vec3Packet<T> origin[TC_RAY_PACKET_GROUPS(T)];
+    Vec3Packet<T> inverseDirection[TC_RAY_PACKET_GROUPS(T)];
+    T tMin[TC_RAY_PACKET_GROUPS(T)];
+    T tMax[TC_RAY_PACKET_GROUPS(T)];
+    U32 count;
+    U32 groupCount;
+
+    // Sum of the directions, which orders the children
+    Vec3 direction;
+
+    // Interval bounds over every ray, only valid for culling when frustum
+    // is set: all rays point into the same octant with no zero components.
+    // tMaxBound follows the rays' tMax as hits lower it.
+    Vec3 originMin, originMax;
+    Vec3 inverseMin, inverseMax;
+    F32 tMinBound, tMaxBound;
+    bool frustum;
+
+    // Smallest cosine between a ray and the mean direction, 1 for parallel
+    // rays and -1 when two rays point apart
+    F32 coherence;
+};
+
+// Fills the packet from count rays, at most TC_RAY_PACKET_SIZE, precomputed
+// as Precompute does for a single ray
+template <typename T>
+void RayPacketInit(RayPacket<T>* packet, const Ray* rays, U32 count);
+
+// Slab test of every ray of one group against one box, with the same
+// rounding slack as the single ray test
+template <typename T>
+inline auto Intersect(const RayPacket<T>& packet, U32 group, Box3 box) {
+    Vec3Packet<T> origin = packet.origin[group];
+    Vec3Packet<T> inverse = packet.inverseDirection[group];
+    T scale = Splat<T>(TC_RAY_SLAB_FAR_SCALE);
+
+    T x0 = (Splat<T>(box.min.x) - origin.x) * inverse.x;
+    T x1 = (Splat<T>(box.max.x) - origin.x) * inverse.x;
+    T y0 = (Splat<T>(box.min.y) - origin.y) * inverse.y;
+    T y1 = (Splat<T>(box.max.y) - origin.y) * inverse.y;
+    T z0 = (Splat<T>(box.min.z) - origin.z) * inverse.z;
+    T z1 = (Splat<T>(box.max.z) - origin.z) * inverse.z;
+
+    T entry = Max(Min(x0, x1), packet.tMin[group]);
+    entry = Max(Min(y0, y1), entry);
+    entry = Max(Min(z0, z1), entry);
+    T exit = Min(Max(x0, x1) * scale, packet.tMax[group]);
+    exit = Min(Max(y0, y1) * scale, exit);
+    exit = Min(Max(z0, z1) * scale, exit);
+    return entry <= exit;
+}
+
+// Whether the box lies outside the interval bounds of the packet, so that no
+// ray of it can hit the box. Interval products bound every ray's slab
+// distances, and rounding is monotonic, so no hit is ever culled.
+template <typename T>
+inline bool FrustumMisses(const RayPacket<T>& packet, Box3 box) {
+    F32 entry = packet.tMinBound;
+    F32 exit = packet.tMaxBound;
+    for (int i = 0; i < 3; ++i) {
+        bool positive = packet.inverseMin.raw[i] > 0.0f;
+        F32 nearPlane = positive ? box.min.raw[i] : box.max.raw[i];
+        F32 farPlane = positive ? box.max.raw[i] : box.min.raw[i];
+        F32 inverseMin = packet.inverseMin.raw[i];
+        F32 inverseMax = packet.inverseMax.raw[i];
+
+        F32 nearLow = nearPlane - packet.originMax.raw[i];
+        F32 nearHigh = nearPlane - packet.originMin.raw[i];
+        F32 near = Min(Min(nearLow * inverseMin, nearLow * inverseMax), Min(nearHigh * inverseMin, nearHigh * inverseMax));
+
+        F32 farLow = farPlane - packet.originMax.raw[i];
+        F32 farHigh = farPlane - packet.originMin.raw[i];
+        F32 far = Max(Max(farLow * inverseMin, farLow * inverseMax), Max(farHigh * inverseMin, farHigh * inverseMax));
+
+        entry = Max(entry, near);
+        exit = Min(exit, far * TC_RAY_SLAB_FAR_SCALE);
+    }
+    return entry > exit;
+}
+
+// First group at or after first with a ray that hits the box, or groupCount.
+// Tests the first group before the frustum, since a hit there is the common
+// case deep in a coherent traversal.
+template <typename T>
+inline U32 FirstHitGroup(const RayPacket<T>& packet, U32 first, Box3 box) {
+    if (Any(Intersect(packet, first, box))) {
+        return first;
+    }
+    if (packet.frustum && FrustumMisses(packet, box)) {
+        return packet.groupCount;
+    }
+    for (U32 group = first + 1; group < packet.groupCount; ++group) {
+        if (Any(Intersect(packet, group, box))) {
+            return group;
+        }
+    }
+    return packet.groupCount;
+}
+
+// Traverses the tree with every ray of the packet at once. Each node is
+// fetched once for the packet and only groups from the first one that hits
+// it on are tested further down. intersector(primitive, packet, group, mask)
+// tests the lanes set in mask of one group against a primitive and may lower
+// their tMax. Children are visited nearer first along the packet direction.
+template <typename T, typename F>
+void Traverse(const Bvh* bvh, RayPacket<T>* packet, F intersector) {
+    struct Entry {
+        U32 node;
+        U32 first;
+    };
+
+    if (bvh->nodeCount == 0 || packet->groupCount == 0) {
+        return;
+    }
+
+    Entry stack[TC_BVH_STACK_SIZE];
+    U32 stackSize = 0;
+    U32 current = 0;
+    U32 first = FirstHitGroup(*packet, 0, bvh->nodes[0].bounds);
+    if (first == packet->groupCount) {
+        return;
+    }
+
+    for (;;) {
+        const BvhNode* node = bvh->nodes + current;
+        if (node->count > 0) {
+            for (U32 group = first; group < packet->groupCount; ++group) {
+                U32 mask = MoveMask(Intersect(*packet, group, node->bounds));
+                if (mask == 0) {
+                    continue;
+                }
+                for (U32 i = 0; i < node->count; ++i) {
+                    intersector(bvh->indices[node->offset + i], packet, group, mask);
+                }
+            }
+
+            // Entries on the stack may start from earlier groups, so the
+            // bound covers every ray
+            T tMax = packet->tMax[0];
+            for (U32 group = 1; group < packet->groupCount; ++group) {
+                tMax = Max(tMax, packet->tMax[group]);
+            }
+            F32 lanes[TC_LANES(T)];
+            Store(lanes, tMax);
+            F32 bound = lanes[0];
+            for (int i = 1; i < TC_LANES(T); ++i) {
+                bound = Max(bound, lanes[i]);
+            }
+            packet->tMaxBound = bound;
+        }
+        else {
+            const BvhNode* children = bvh->nodes + node->offset;
+            U32 first0 = FirstHitGroup(*packet, first, children[0].bounds);
+            U32 first1 = FirstHitGroup(*packet, first, children[1].bounds);
+            bool hit0 = first0 < packet->groupCount;
+            bool hit1 = first1 < packet->groupCount;
+            if (hit0 && hit1) {
+                bool swap = Dot(Centroid(children[1].bounds) - Centroid(children[0].bounds), packet->direction) < 0.0f;
+                TC_ASSERT(stackSize < TC_BVH_STACK_SIZE);
+                stack[stackSize++] = swap ? Entry{node->offset, first0} : Entry{node->offset + 1, first1};
+                current = swap ? node->offset + 1 : node->offset;
+                first = swap ? first1 : first0;
+                continue;
+            }
+            if (hit0 || hit1) {
+                current = node->offset + hit1;
+                first = hit1 ? first1 : first0;
+                continue;
+            }
+        }
+
+        if (stackSize == 0) {
+            return;
+        }
+        Entry entry = stack[--stackSize];
+        current = entry.node;
+        first = entry.first;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Ray streams
+
+enum RayStreamMode {
+    // Packets as coherent as options ask for are traced together, the rest
+    // one ray at a time
+    RAY_STREAM_AUTO,
+    RAY_STREAM_PACKETS,
+    RAY_STREAM_SINGLE,
+};
+
+struct RayStreamOptions {
+    RayStreamMode mode = RAY_STREAM_AUTO;
+
+    // A packet is coherent when all its rays share an octant, none is farther
+    // than this cosine from their mean direction, and their origins span at
+    // most originSpread times the diagonal of the root bounds
+    F32 minCoherence = 0.95f;
+    F32 originSpread = 0.05f;
+
+    // Batches smaller than this keep their order instead of being sorted
+    U32 sortThreshold = 4 * TC_RAY_PACKET_SIZE;
+};
+
+// Sorts the rays by direction octant, then by the Morton code of their origin
+// within the bounds of all origins, then by the Morton code of their
+// direction, so neighbours in order start close together and run alike.
+// order receives count ray indices.
+void RayStreamSort(const Ray* rays, U32 count, U32* order);
+
+// Whether the packet meets the coherence options for the tree
+template <typename T>
+inline bool IsCoherent(const RayPacket<T>& packet, const Bvh* bvh, const RayStreamOptions& options) {
+    if (!packet.frustum || packet.coherence < options.minCoherence || bvh->nodeCount == 0) {
+        return false;
+    }
+    Box3 root = bvh->nodes[0].bounds;
+    return Length(packet.originMax - packet.originMin) <= options.originSpread * Length(root.max - root.min);
+}
+
+#define TC_RAY_STREAM_GRAIN 4
+
+// The two paths of TraverseStream, kept out of line so each traversal loop
+// is compiled on its own rather than inside the chunk loop
+template <typename F>
+TC_NO_INLINE void TraverseStreamRay(const Bvh* bvh, const Ray& ray, U32 index, F& intersector) {
+    Traverse(bvh, Precompute(ray), [&](U32 primitive, RaySlab* slab) {
+        intersector(index, primitive, &slab->tMax);
+        return true;
+    });
+}
+
+template <typename T, typename F>
+TC_NO_INLINE void TraverseStreamPacket(const Bvh* bvh, RayPacket<T>* packet, const U32* indices, F& intersector) {
+    Traverse(bvh, packet, [&](U32 primitive, RayPacket<T>* p, U32 group, U32 mask) {
+        F32 tMax[TC_LANES(T)];
+        Store(tMax, p->tMax[group]);
+        for (; mask; mask &= mask - 1) {
+            U32 lane = CountTrailingZeros(mask);
+            intersector(indices[group * TC_LANES(T) + lane], primitive, tMax + lane);
+        }
+        p->tMax[group] = Load<T>(tMax);
+    });
+}
+
+// Traverses count rays, sorted into packets of TC_RAY_PACKET_SIZE spread
+// over the worker threads. Each packet takes the packet or the single ray
+// path as options.mode and its measured coherence decide.
+// intersector(ray, primitive, &tMax) tests rays[ray] against a primitive and
+// may lower tMax on a hit, it runs concurrently for different rays. Returns
+// how many packets took the packet path.
+template <int N, typename F>
+U32 TraverseStream(const Bvh* bvh, const Ray* rays, U32 count, F intersector, const RayStreamOptions& options = {}) {
+    typedef typename WideBvhLanes<N>::Type T;
+
+    U32* order = (U32*) malloc(TC_MAX(count, 1u) * sizeof(U32));
+    if (count >= options.sortThreshold) {
+        RayStreamSort(rays, count, order);
+    }
+    else {
+        for (U32 i = 0; i < count; ++i) {
+            order[i] = i;
+        }
+    }
+
+    std::atomic<U32> packetCount = {0};
+    U32 chunkCount = (count + TC_RAY_PACKET_SIZE - 1) / TC_RAY_PACKET_SIZE;
+    ParallelFor(chunkCount, TC_RAY_STREAM_GRAIN, [&](U64 begin, U64 end) {
+        Ray chunk[TC_RAY_PACKET_SIZE];
+        RayPacket<T> packet;
+        U32 packets = 0;
+        for (U64 c = begin; c < end; ++c) {
+            const U32* indices = order + c * TC_RAY_PACKET_SIZE;
+            U32 size = TC_MIN(count - U32(c) * TC_RAY_PACKET_SIZE, U32(TC_RAY_PACKET_SIZE));
+            for (U32 i = 0; i < size; ++i) {
+                chunk[i] = rays[indices[i]];
+            }
+
+            bool coherent = false;
+            if (options.mode != RAY_STREAM_SINGLE) {
+                RayPacketInit(&packet, chunk, size);
+                coherent = options.mode == RAY_STREAM_PACKETS || IsCoherent(packet, bvh, options);
+            }
+            if (!coherent) {
+                for (U32 i = 0; i < size; ++i) {
+                    TraverseStreamRay(bvh, chunk[i], indices[i], intersector);
+                }
+                continue;
+            }
+
+            ++packets;
+            TraverseStreamPacket(bvh, &packet, indices, intersector);
+        }
+        packetCount += packets;
+    });
+
+    free(order);
+    return packetCount;
+}
+
+#endif // TC_PACKET_HEADER_GUARD
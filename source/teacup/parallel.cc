@@ -0,0 +1,152 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/parallel.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////
+// Task pool
+
+#define TC_TASK_QUEUE_SIZE 4096
+
+struct Task {
+    TaskFunction function;
+    void* context;
+    TaskGroup* group;
+};
+
+// Single queue shared by all threads. Tasks here are coarse (subtrees and
+// loop chunks), so contention on the lock stays low.
+struct TaskPool {
+    std::mutex mutex;
+    std::condition_variable wake;
+    Task tasks[TC_TASK_QUEUE_SIZE];
+    U32 head;
+    U32 count;
+    U32 threadCount;
+};
+
+TC_GLOBAL TaskPool pool;
+TC_GLOBAL std::once_flag poolOnce;
+TC_GLOBAL U32 poolRequestedThreads;
+
+static void TaskExecute(Task task) {
+    task.function(task.context);
+    task.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+// Idle workers take the oldest task, which for recursive work is the largest.
+// Caller holds the lock.
+static bool TaskPopOldest(Task* task) {
+    if (pool.count == 0) {
+        return false;
+    }
+    *task = pool.tasks[pool.head];
+    pool.head = (pool.head + 1) % TC_TASK_QUEUE_SIZE;
+    --pool.count;
+    return true;
+}
+
+// Waiting threads take the newest task, usually the one they are waiting on,
+// so tasks run inside a wait nest no deeper than the recursion that spawned
+// them. Caller holds the lock.
+static bool TaskPopNewest(Task* task) {
+    if (pool.count == 0) {
+        return false;
+    }
+    --pool.count;
+    *task = pool.tasks[(pool.head + pool.count) % TC_TASK_QUEUE_SIZE];
+    return true;
+}
+
+static void TaskWorker() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.wake.wait(lock, [] { return pool.count > 0; });
+            TaskPopOldest(&task);
+        }
+        TaskExecute(task);
+    }
+}
+
+// Workers run until the process exits
+static void PoolStart() {
+    U32 threadCount = poolRequestedThreads;
+    if (threadCount == 0) {
+        threadCount = TC_MAX(std::thread::hardware_concurrency(), 1u);
+    }
+    pool.threadCount = threadCount;
+    for (U32 i = 1; i < threadCount; ++i) {
+        std::thread(TaskWorker).detach();
+    }
+}
+
+void ParallelInitialize(U32 threadCount) {
+    poolRequestedThreads = threadCount;
+    std::call_once(poolOnce, PoolStart);
+}
+
+U32 ParallelThreadCount() {
+    std::call_once(poolOnce, PoolStart);
+    return pool.threadCount;
+}
+
+void TaskRun(TaskGroup* group, TaskFunction function, void* context) {
+    std::call_once(poolOnce, PoolStart);
+    group->pending.fetch_add(1, std::memory_order_relaxed);
+    Task task = {function, context, group};
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.count < TC_TASK_QUEUE_SIZE) {
+            pool.tasks[(pool.head + pool.count) % TC_TASK_QUEUE_SIZE] = task;
+            ++pool.count;
+            task.function = 0;
+        }
+    }
+    if (task.function) {
+        TaskExecute(task);
+    }
+    else {
+        pool.wake.notify_one();
+    }
+}
+
+void TaskWait(TaskGroup* group) {
+    while (group->pending.load(std::memory_order_acquire) > 0) {
+        Task task;
+        bool popped;
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            popped = TaskPopNewest(&task);
+        }
+        if (popped) {
+            TaskExecute(task);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,99 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_PARALLEL_HEADER_GUARD
+#define TC_PARALLEL_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <atomic>
+
+////////////////////////////////////////////////////////////////////////////////
+// Tasks
+
+typedef void (*TaskFunction)(void* context);
+
+// Counts the tasks run through it that have not finished yet
+struct TaskGroup {
+    std::atomic<U32> pending;
+};
+
+// Starts the worker threads, threadCount including the calling thread. Zero
+// uses one thread per hardware thread. Called implicitly on first use with
+// zero, later calls have no effect.
+void ParallelInitialize(U32 threadCount = 0);
+U32 ParallelThreadCount();
+
+// Queues function(context) to run on any thread. Runs it immediately on the
+// calling thread if the queue is full.
+void TaskRun(TaskGroup* group, TaskFunction function, void* context);
+
+// Returns once every task run through group has finished, running queued
+// tasks on the calling thread while waiting
+void TaskWait(TaskGroup* group);
+
+////////////////////////////////////////////////////////////////////////////////
+// Parallel loops
+
+template <typename F>
+struct ParallelForContext {
+    F* function;
+    std::atomic<U64> next;
+    U64 count;
+    U64 grain;
+};
+
+template <typename F>
+inline void ParallelForTask(void* context) {
+    ParallelForContext<F>* loop = (ParallelForContext<F>*) context;
+    for (;;) {
+        U64 begin = loop->next.fetch_add(loop->grain);
+        if (begin >= loop->count) {
+            break;
+        }
+        U64 end = TC_MIN(begin + loop->grain, loop->count);
+        (*loop->function)(begin, end);
+    }
+}
+
+// Calls function(begin, end) over [0, count) in chunks of grain elements,
+// spread over all threads. Chunks are claimed in order but may run in any
+// order and concurrently.
+template <typename F>
+void ParallelFor(U64 count, U64 grain, F function) {
+    grain = TC_MAX(grain, U64(1));
+    if (count <= grain) {
+        function(U64(0), count);
+        return;
+    }
+
+    ParallelForContext<F> loop = {&function, {0}, count, grain};
+    TaskGroup group = {{0}};
+    U64 chunks = (count + grain - 1) / grain;
+    U64 helpers = TC_MIN(U64(ParallelThreadCount()), chunks) - 1;
+    for (U64 i = 0; i < helpers; ++i) {
+        TaskRun(&group, ParallelForTask<F>, &loop);
+    }
+    ParallelForTask<F>(&loop);
+    TaskWait(&group);
+}
+
+#endif // TC_PARALLEL_HEADER_GUARD
@@ -0,0 +1,92 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/quantized.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Quantized boxes
+
+static inline F32 Decode(F32 origin, U32 q, F32 step) {
+    return origin + F32(q) * step;
+}
+
+// Smallest power of two step whose 255th multiple reaches the parent maximum
+// when decoded, starting from the exponent of extent / 255
+static U8 QuantizeExponent(F32 origin, F32 max) {
+    F32 estimate = (max - origin) * (1.0f / 255.0f);
+    S32 exponent = (AsS32(estimate) >> 23) & 0xff;
+    exponent = TC_MAX(exponent, 1);
+    while (exponent < 254 && Decode(origin, 255, QuantizedStep(U8(exponent))) < max) {
+        ++exponent;
+    }
+    return U8(exponent);
+}
+
+static U8 QuantizeMin(F32 origin, F32 step, F32 min) {
+    F32 estimate = Floor((min - origin) / step);
+    U32 q = U32(TC_CLAMP(estimate, 0.0f, 255.0f));
+    while (q > 0 && Decode(origin, q, step) > min) {
+        --q;
+    }
+    while (q < 255 && Decode(origin, q + 1, step) <= min) {
+        ++q;
+    }
+    return U8(q);
+}
+
+static U8 QuantizeMax(F32 origin, F32 step, F32 max) {
+    F32 estimate = Ceil((max - origin) / step);
+    U32 q = U32(TC_CLAMP(estimate, 0.0f, 255.0f));
+    while (q < 255 && Decode(origin, q, step) < max) {
+        ++q;
+    }
+    while (q > 0 && Decode(origin, q - 1, step) >= max) {
+        --q;
+    }
+    return U8(q);
+}
+
+template <int N>
+void Quantize(Box3 parent, const Box3* children, U32 count, QuantizedBoxes<N>* result) {
+    TC_ASSERT(count <= U32(N));
+    *result = {};
+    result->origin = parent.min;
+    result->count = U8(count);
+
+    for (int axis = 0; axis < 3; ++axis) {
+        F32 origin = parent.min.raw[axis];
+        U8 exponent = QuantizeExponent(origin, parent.max.raw[axis]);
+        F32 step = QuantizedStep(exponent);
+        result->exponent[axis] = exponent;
+
+        for (U32 i = 0; i < count; ++i) {
+            F32 min = children[i].min.raw[axis];
+            F32 max = children[i].max.raw[axis];
+            TC_ASSERT(min >= origin && max <= parent.max.raw[axis], "Child outside parent box");
+            result->min[axis][i] = QuantizeMin(origin, step, min);
+            result->max[axis][i] = QuantizeMax(origin, step, max);
+        }
+    }
+}
+
+template void Quantize<4>(Box3 parent, const Box3* children, U32 count, QuantizedBoxes<4>* result);
+template void Quantize<8>(Box3 parent, const Box3* children, U32 count, QuantizedBoxes<8>* result);
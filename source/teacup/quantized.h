@@ -0,0 +1,99 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_QUANTIZED_HEADER_GUARD
+#define TC_QUANTIZED_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+#include <teacup/wide.h>
+#include <teacup/ray.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Quantized boxes
+
+// Bounds of up to N child boxes stored as 8-bit offsets from the parent box
+// minimum. Each axis has a power of two step, held as the biased exponent of
+// an F32 so decoding is one multiply and one add per plane:
+//   min = origin + F32(qmin) * step
+// Encoding rounds minimums down and maximums up, checked against this exact
+// decode, so decoded boxes always contain the originals. The planes are laid
+// out axis by axis so lanes load straight into SIMD registers. Eight children
+// fit in one 64 byte cache line.
+template <int N>
+struct QuantizedBoxes {
+    Vec3 origin;
+    U8 exponent[3];
+    U8 count;
+    U8 min[3][N];
+    U8 max[3][N];
+};
+
+typedef QuantizedBoxes<4> QuantizedBoxes4;
+typedef QuantizedBoxes<8> QuantizedBoxes8;
+
+TC_STATIC_ASSERT(sizeof(QuantizedBoxes8) == TC_CACHE_LINE_SIZE);
+
+// Encodes count <= N children, each of which must lie inside parent. Slots
+// past count are left empty and never reported as hit.
+template <int N>
+void Quantize(Box3 parent, const Box3* children, U32 count, QuantizedBoxes<N>* result);
+
+inline F32 QuantizedStep(U8 exponent) {
+    return AsF32(S32(exponent) << 23);
+}
+
+// Decodes TC_LANES(T) children starting at first, which must be a multiple of
+// the lane count
+template <typename T, int N>
+inline Box3Packet<T> Dequantize(const QuantizedBoxes<N>* boxes, U32 first) {
+    Box3Packet<T> box;
+    Vec3Packet<T> origin = Splat<T>(boxes->origin);
+    T stepX = Splat<T>(QuantizedStep(boxes->exponent[0]));
+    T stepY = Splat<T>(QuantizedStep(boxes->exponent[1]));
+    T stepZ = Splat<T>(QuantizedStep(boxes->exponent[2]));
+    box.min.x = origin.x + Load<T>(boxes->min[0] + first) * stepX;
+    box.min.y = origin.y + Load<T>(boxes->min[1] + first) * stepY;
+    box.min.z = origin.z + Load<T>(boxes->min[2] + first) * stepZ;
+    box.max.x = origin.x + Load<T>(boxes->max[0] + first) * stepX;
+    box.max.y = origin.y + Load<T>(boxes->max[1] + first) * stepY;
+    box.max.z = origin.z + Load<T>(boxes->max[2] + first) * stepZ;
+    return box;
+}
+
+template <int N>
+inline Box3 Dequantize(const QuantizedBoxes<N>* boxes, U32 index) {
+    Box3Packet<F32> box = Dequantize<F32>(boxes, index);
+    return {{box.min.x, box.min.y, box.min.z}, {box.max.x, box.max.y, box.max.z}};
+}
+
+inline constexpr F32 quantizedLaneIndex[8] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f};
+
+// Slab test of one ray against TC_LANES(T) decoded children starting at
+// first. Lanes past the child count are masked off.
+template <typename T, int N>
+inline auto Intersect(RaySlab ray, const QuantizedBoxes<N>* boxes, U32 first, T* tEntry, T* tExit) {
+    auto valid = Load<T>(quantizedLaneIndex) < Splat<T>(F32(S32(boxes->count) - S32(first)));
+    return Intersect(ray, Dequantize<T>(boxes, first), tEntry, tExit) & valid;
+}
+
+#endif // TC_QUANTIZED_HEADER_GUARD
@@ -0,0 +1,327 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/raster.h>
+#include <teacup/sort.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Pinhole camera
+
+Camera CameraLookAt(Vec3 eye, Vec3 target, Vec3 up, F32 verticalFov, U32 width, U32 height) {
+    Vec3 forward = Normalize(target - eye);
+    Vec3 right = Normalize(Cross(forward, up));
+    Vec3 trueUp = Cross(right, forward);
+    F32 tanHalf = Tan(verticalFov * 0.5f);
+    F32 aspect = F32(width) / F32(height);
+
+    Camera camera = {};
+    camera.eye = eye;
+    camera.forward = forward;
+    camera.right = right * (tanHalf * aspect);
+    camera.up = trueUp * tanHalf;
+    camera.width = width;
+    camera.height = height;
+
+    // A point eye + s * CameraRay(...).direction lands on x = s * nx, y =
+    // s * ny and w = s
+    Vec3 cx = right * (1.0f / (tanHalf * aspect));
+    Vec3 cy = trueUp * (1.0f / tanHalf);
+    camera.worldToClip = {
+        cx.x,      cx.y,      cx.z,      -Dot(cx, eye),
+        cy.x,      cy.y,      cy.z,      -Dot(cy, eye),
+        forward.x, forward.y, forward.z, -Dot(forward, eye),
+        forward.x, forward.y, forward.z, -Dot(forward, eye)
+    };
+    return camera;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Primary visibility
+
+// Screen space setup of one triangle. Pixels in [x0, x1] x [y0, y1] whose
+// centers have a x + b y + c >= 0 for every edge are candidates. depth is a
+// lower bound on the t of any camera ray hitting the triangle.
+struct RasterTriangle {
+    Triangle corners;
+    F32 edges[3][3];
+    F32 depth;
+    U32 primitive;
+    S32 x0, y0, x1, y1;
+};
+
+// Both the projection of the corners and the watertight test round. The
+// margin covers the projection, and the test, whose error grows with how far
+// the corners are from the eye relative to how near the triangle comes.
+#define TC_RASTER_MARGIN (1.0 / 16.0)
+#define TC_RASTER_TEST_ERROR (64.0 * 1.1920929e-7)
+
+// Whether the triangle can cover any pixel
+static bool RasterSetup(const Camera* camera, const Triangle& corners, U32 primitive, RasterTriangle* triangle) {
+    const Mat4& m = camera->worldToClip;
+    F64 width = camera->width;
+    F64 height = camera->height;
+    F64 x[3], y[3], w[3];
+    F64 minW = 0, maxW = 0, maxDistance = 0;
+    const Vec3* points = &corners.v0;
+    for (int k = 0; k < 3; ++k) {
+        F64 p[3] = {points[k].x, points[k].y, points[k].z};
+        F64 clip[4];
+        for (int r = 0; r < 4; ++r) {
+            clip[r] = F64(m.raw[r][0]) * p[0] + F64(m.raw[r][1]) * p[1] + F64(m.raw[r][2]) * p[2] + F64(m.raw[r][3]);
+        }
+        x[k] = clip[0];
+        y[k] = clip[1];
+        w[k] = clip[3];
+        minW = k == 0 ? w[k] : TC_MIN(minW, w[k]);
+        maxW = k == 0 ? w[k] : TC_MAX(maxW, w[k]);
+        F64 dx = p[0] - camera->eye.x, dy = p[1] - camera->eye.y, dz = p[2] - camera->eye.z;
+        maxDistance = TC_MAX(maxDistance, sqrt(dx * dx + dy * dy + dz * dz));
+    }
+    if (maxW <= 0) {
+        return false;
+    }
+
+    triangle->corners = corners;
+    triangle->primitive = primitive;
+    for (int e = 0; e < 3; ++e) {
+        triangle->edges[e][0] = 0;
+        triangle->edges[e][1] = 0;
+        triangle->edges[e][2] = 1;
+    }
+
+    // Triangles reaching behind the eye are clipped at w = 0. Where an edge
+    // crosses it the triangle runs off to infinity in the direction of the
+    // crossing's x and y, and the bounds open up on those sides. Such
+    // triangles only get the bounds and the ray test.
+    F64 focal = 0.5 * height / sqrt(F64(Dot(camera->up, camera->up)));
+    F64 front = maxDistance * 1e-20;
+    if (minW <= front) {
+        F64 infinity = F32Infinity();
+        F64 bounds[4] = {infinity, infinity, -infinity, -infinity};
+        F64 nearest = maxW;
+        for (int k = 0; k < 3; ++k) {
+            int next = k == 2 ? 0 : k + 1;
+            if (w[k] > front) {
+                F64 sx = (x[k] / w[k] + 1.0) * 0.5 * width;
+                F64 sy = (1.0 - y[k] / w[k]) * 0.5 * height;
+                bounds[0] = TC_MIN(bounds[0], sx);
+                bounds[1] = TC_MIN(bounds[1], sy);
+                bounds[2] = TC_MAX(bounds[2], sx);
+                bounds[3] = TC_MAX(bounds[3], sy);
+                nearest = TC_MIN(nearest, w[k]);
+            }
+            if ((w[k] > front) != (w[next] > front)) {
+                F64 s = (w[k] - front) / (w[k] - w[next]);
+                F64 cx = x[k] + (x[next] - x[k]) * s;
+                F64 cy = y[k] + (y[next] - y[k]) * s;
+                F64 tolerance = (fabs(x[k]) + fabs(x[next]) + fabs(y[k]) + fabs(y[next])) * 1e-9;
+                bounds[0] = cx < tolerance ? -infinity : bounds[0];
+                bounds[2] = cx > -tolerance ? infinity : bounds[2];
+                bounds[1] = cy > -tolerance ? -infinity : bounds[1];
+                bounds[3] = cy < tolerance ? infinity : bounds[3];
+            }
+        }
+        F64 margin = TC_RASTER_MARGIN + TC_RASTER_TEST_ERROR * focal * maxDistance / nearest;
+        triangle->depth = 0;
+
+        // Bounds clamped to just outside the screen on both sides, as an
+        // edge far off screen would otherwise overflow the conversions
+        triangle->x0 = S32(Ceil(F32(TC_CLAMP(bounds[0] - margin, -1.0, width + 1.0) - 0.5)));
+        triangle->y0 = S32(Ceil(F32(TC_CLAMP(bounds[1] - margin, -1.0, height + 1.0) - 0.5)));
+        triangle->x1 = S32(Floor(F32(TC_CLAMP(bounds[2] + margin, -1.0, width + 1.0) - 0.5)));
+        triangle->y1 = S32(Floor(F32(TC_CLAMP(bounds[3] + margin, -1.0, height + 1.0) - 0.5)));
+        triangle->x0 = TC_MAX(triangle->x0, 0);
+        triangle->y0 = TC_MAX(triangle->y0, 0);
+        triangle->x1 = TC_MIN(triangle->x1, S32(camera->width) - 1);
+        triangle->y1 = TC_MIN(triangle->y1, S32(camera->height) - 1);
+        return triangle->x0 <= triangle->x1 && triangle->y0 <= triangle->y1;
+    }
+
+    F64 px[3], py[3];
+    for (int k = 0; k < 3; ++k) {
+        px[k] = (x[k] / w[k] + 1.0) * 0.5 * width;
+        py[k] = (1.0 - y[k] / w[k]) * 0.5 * height;
+    }
+    F64 margin = TC_RASTER_MARGIN + TC_RASTER_TEST_ERROR * focal * maxDistance / minW;
+
+    Box2 bounds = {{F32(TC_MIN(px[0], TC_MIN(px[1], px[2])) - margin), F32(TC_MIN(py[0], TC_MIN(py[1], py[2])) - margin)},
+                   {F32(TC_MAX(px[0], TC_MAX(px[1], px[2])) + margin), F32(TC_MAX(py[0], TC_MAX(py[1], py[2])) + margin)}};
+    bounds = Intersect(bounds, Box2{{0, 0}, {F32(width), F32(height)}});
+    if (IsEmpty(bounds)) {
+        return false;
+    }
+
+    // Pixels whose centers fall in the bounds
+    triangle->x0 = S32(Ceil(bounds.min.x - 0.5f));
+    triangle->y0 = S32(Ceil(bounds.min.y - 0.5f));
+    triangle->x1 = S32(Floor(bounds.max.x - 0.5f));
+    triangle->y1 = S32(Floor(bounds.max.y - 0.5f));
+    if (triangle->x0 > triangle->x1 || triangle->y0 > triangle->y1) {
+        return false;
+    }
+    triangle->depth = F32(minW * (1.0 - 1e-4));
+
+    // Edges as distances in pixels, positive inside. Triangles seen edge on
+    // keep the bounds alone.
+    F64 area = (px[1] - px[0]) * (py[2] - py[0]) - (py[1] - py[0]) * (px[2] - px[0]);
+    if (area != 0) {
+        F64 side = area > 0 ? 1.0 : -1.0;
+        for (int e = 0; e < 3; ++e) {
+            int next = e == 2 ? 0 : e + 1;
+            F64 dx = px[next] - px[e];
+            F64 dy = py[next] - py[e];
+            F64 scale = side / sqrt(dx * dx + dy * dy);
+            triangle->edges[e][0] = F32(-dy * scale);
+            triangle->edges[e][1] = F32(dx * scale);
+            triangle->edges[e][2] = F32((dy * px[e] - dx * py[e]) * scale + margin);
+        }
+    }
+    return true;
+}
+
+static void RasterTile(const Camera* camera, const RasterTriangle* setups, const U32* bin, U32 binCount, U32 tileX, U32 tileY, TriangleHit* hits) {
+    S32 x0 = S32(tileX * TC_RASTER_TILE_SIZE);
+    S32 y0 = S32(tileY * TC_RASTER_TILE_SIZE);
+    S32 x1 = TC_MIN(x0 + TC_RASTER_TILE_SIZE, S32(camera->width)) - 1;
+    S32 y1 = TC_MIN(y0 + TC_RASTER_TILE_SIZE, S32(camera->height)) - 1;
+
+    RayShear shears[TC_RASTER_TILE_SIZE * TC_RASTER_TILE_SIZE];
+    TriangleHit best[TC_RASTER_TILE_SIZE * TC_RASTER_TILE_SIZE];
+    for (S32 y = y0; y <= y1; ++y) {
+        for (S32 x = x0; x <= x1; ++x) {
+            U32 pixel = U32(y - y0) * TC_RASTER_TILE_SIZE + U32(x - x0);
+            shears[pixel] = PrecomputeShear(CameraRay(camera, U32(x), U32(y)));
+            best[pixel] = {F32Infinity(), 0.0f, 0.0f, TC_U32_MAX};
+        }
+    }
+
+    for (U32 i = 0; i < binCount; ++i) {
+        const RasterTriangle* triangle = setups + bin[i];
+        S32 bx0 = TC_MAX(x0, triangle->x0), bx1 = TC_MIN(x1, triangle->x1);
+        S32 by0 = TC_MAX(y0, triangle->y0), by1 = TC_MIN(y1, triangle->y1);
+        for (S32 y = by0; y <= by1; ++y) {
+            F32 cy = F32(y) + 0.5f;
+            for (S32 x = bx0; x <= bx1; ++x) {
+                F32 cx = F32(x) + 0.5f;
+                bool outside = false;
+                for (int e = 0; e < 3; ++e) {
+                    outside |= triangle->edges[e][0] * cx + triangle->edges[e][1] * cy + triangle->edges[e][2] < 0.0f;
+                }
+                U32 pixel = U32(y - y0) * TC_RASTER_TILE_SIZE + U32(x - x0);
+                TriangleHit* hit = best + pixel;
+                if (outside || triangle->depth > hit->t) {
+                    continue;
+                }
+                RayShear* shear = shears + pixel;
+                shear->tMax = hit->t;
+                TriangleHit candidate;
+                if (Intersect(*shear, triangle->corners, &candidate) && (candidate.t < hit->t || triangle->primitive < hit->primitive)) {
+                    candidate.primitive = triangle->primitive;
+                    *hit = candidate;
+                }
+            }
+        }
+    }
+
+    for (S32 y = y0; y <= y1; ++y) {
+        memcpy(hits + U64(y) * camera->width + x0, best + U32(y - y0) * TC_RASTER_TILE_SIZE, U32(x1 - x0 + 1) * sizeof(TriangleHit));
+    }
+}
+
+void RasterizePrimary(const Camera* camera, const Vec3* positions, const U32* triangles, U32 count, TriangleHit* hits) {
+    U32 tilesX = (camera->width + TC_RASTER_TILE_SIZE - 1) / TC_RASTER_TILE_SIZE;
+    U32 tilesY = (camera->height + TC_RASTER_TILE_SIZE - 1) / TC_RASTER_TILE_SIZE;
+    U32 tileCount = tilesX * tilesY;
+
+    // Culled triangles sort last
+    RasterTriangle* setups = (RasterTriangle*) malloc(TC_MAX(count, 1u) * sizeof(RasterTriangle));
+    U64* keys = (U64*) malloc(TC_MAX(count, 1u) * sizeof(U64));
+    U64* scratchKeys = (U64*) malloc(TC_MAX(count, 1u) * sizeof(U64));
+    U32* order = (U32*) malloc(TC_MAX(count, 1u) * sizeof(U32));
+    U32* scratchOrder = (U32*) malloc(TC_MAX(count, 1u) * sizeof(U32));
+    ParallelFor(count, 4096, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            Triangle corners;
+            for (U32 k = 0; k < 3; ++k) {
+                U64 index = 3 * i + k;
+                (&corners.v0)[k] = positions[triangles ? triangles[index] : index];
+            }
+            keys[i] = TC_U32_MAX;
+            if (RasterSetup(camera, corners, U32(i), setups + i)) {
+                U32 bits;
+                memcpy(&bits, &setups[i].depth, sizeof(bits));
+                keys[i] = bits;
+            }
+            order[i] = U32(i);
+        }
+    });
+
+    // Nearest first, so pixels settle early and farther triangles fail the
+    // depth bound before the ray test
+    RadixSort(keys, order, scratchKeys, scratchOrder, count, 32);
+    U32 visible = 0;
+    while (visible < count && keys[visible] != TC_U32_MAX) {
+        visible++;
+    }
+
+    U32* binOffsets = (U32*) calloc(tileCount + 1, sizeof(U32));
+    for (U32 i = 0; i < visible; ++i) {
+        const RasterTriangle* triangle = setups + order[i];
+        for (U32 ty = U32(triangle->y0) / TC_RASTER_TILE_SIZE; ty <= U32(triangle->y1) / TC_RASTER_TILE_SIZE; ++ty) {
+            for (U32 tx = U32(triangle->x0) / TC_RASTER_TILE_SIZE; tx <= U32(triangle->x1) / TC_RASTER_TILE_SIZE; ++tx) {
+                binOffsets[ty * tilesX + tx + 1]++;
+            }
+        }
+    }
+    for (U32 t = 0; t < tileCount; ++t) {
+        binOffsets[t + 1] += binOffsets[t];
+    }
+    U32* bins = (U32*) malloc(TC_MAX(binOffsets[tileCount], 1u) * sizeof(U32));
+    U32* binEnds = (U32*) malloc(TC_MAX(tileCount, 1u) * sizeof(U32));
+    memcpy(binEnds, binOffsets, tileCount * sizeof(U32));
+    for (U32 i = 0; i < visible; ++i) {
+        const RasterTriangle* triangle = setups + order[i];
+        for (U32 ty = U32(triangle->y0) / TC_RASTER_TILE_SIZE; ty <= U32(triangle->y1) / TC_RASTER_TILE_SIZE; ++ty) {
+            for (U32 tx = U32(triangle->x0) / TC_RASTER_TILE_SIZE; tx <= U32(triangle->x1) / TC_RASTER_TILE_SIZE; ++tx) {
+                bins[binEnds[ty * tilesX + tx]++] = order[i];
+            }
+        }
+    }
+
+    ParallelFor(tileCount, 1, [&](U64 begin, U64 end) {
+        for (U64 t = begin; t < end; ++t) {
+            U32 tile = U32(t);
+            RasterTile(camera, setups, bins + binOffsets[tile], binOffsets[tile + 1] - binOffsets[tile], tile % tilesX, tile / tilesX, hits);
+        }
+    });
+
+    free(binEnds);
+    free(bins);
+    free(binOffsets);
+    free(scratchOrder);
+    free(order);
+    free(scratchKeys);
+    free(keys);
+    free(setups);
+}
@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_RASTER_HEADER_GUARD
+#define TC_RASTER_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+#include <teacup/ray.h>
+#include <teacup/triangle.h>
+#include <teacup/parallel.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Pinhole camera
+
+// Pixel (x, y) looks through its center, rows run top to bottom. Rays start
+// at the eye and their directions are forward plus offsets along right and
+// up, so t along a ray is the view depth of the point it reaches.
+// worldToClip projects the same way: x / w and y / w run from -1 to 1 over
+// the image, and z and w are both the view depth, there are no near or far
+// planes.
+struct Camera {
+    Mat4 worldToClip;
+    Vec3 eye;
+    Vec3 forward;
+    Vec3 right;
+    Vec3 up;
+    U32 width;
+    U32 height;
+};
+
+// verticalFov in radians
+Camera CameraLookAt(Vec3 eye, Vec3 target, Vec3 up, F32 verticalFov, U32 width, U32 height);
+
+inline Ray CameraRay(const Camera* camera, U32 x, U32 y) {
+    F32 nx = (F32(x) + 0.5f) * 2.0f / F32(camera->width) - 1.0f;
+    F32 ny = 1.0f - (F32(y) + 0.5f) * 2.0f / F32(camera->height);
+    return {camera->eye, camera->forward + camera->right * nx + camera->up * ny, 0.0f, F32Infinity()};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Primary visibility
+
+// Visibility buffers hold one TriangleHit per pixel, row by row. Pixels
+// whose ray hits nothing get t infinite and primitive TC_U32_MAX.
+
+// Traces every camera ray through the BVH
+template <int N>
+void TracePrimary(const Camera* camera, const TriangleBvh<N>* bvh, TriangleHit* hits) {
+    ParallelFor(camera->height, 1, [&](U64 begin, U64 end) {
+        for (U32 y = U32(begin); y < U32(end); ++y) {
+            for (U32 x = 0; x < camera->width; ++x) {
+                TriangleHit* hit = hits + U64(y) * camera->width + x;
+                if (!Intersect(bvh, CameraRay(camera, x, y), hit)) {
+                    *hit = {F32Infinity(), 0.0f, 0.0f, TC_U32_MAX};
+                }
+            }
+        }
+    });
+}
+
+#define TC_RASTER_TILE_SIZE 16
+
+// Hybrid alternative to TracePrimary for pinhole cameras, over the
+// triangles BvhBuildTriangles takes. Triangles are projected with
+// camera->worldToClip and binned into tiles by their Box2 screen bounds,
+// nearest first, and tiles are rasterized in parallel. Screen space only
+// selects the pixels a triangle may cover: bounds and edges are grown by a
+// bound on the rounding of the watertight test, and every selected pixel runs
+// that test on its camera ray. A pixel therefore gets the same t, u and v
+// as TracePrimary. Where two triangles hit at exactly the same t, as rays
+// through a shared edge do, the raster keeps the lower primitive while the
+// trace keeps the one it reached last.
+void RasterizePrimary(const Camera* camera, const Vec3* positions, const U32* triangles, U32 count, TriangleHit* hits);
+
+#endif // TC_RASTER_HEADER_GUARD
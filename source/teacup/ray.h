@@ -0,0 +1,125 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_RAY_HEADER_GUARD
+#define TC_RAY_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+#include <teacup/wide.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Rays
+
+// Points origin + t * direction for t in [tMin, tMax]
+struct Ray {
+    Vec3 origin;
+    Vec3 direction;
+    F32 tMin;
+    F32 tMax;
+};
+
+// Per-ray values shared by every box test of a traversal. Bit i of signMask
+// is set when the direction is negative along axis i, which selects the box
+// plane the ray enters through.
+struct RaySlab {
+    Vec3 origin;
+    Vec3 inverseDirection;
+    U32 signMask;
+    F32 tMin;
+    F32 tMax;
+};
+
+constexpr Vec3 PointAt(Ray ray, F32 t) {
+    return ray.origin + ray.direction * t;
+}
+
+// Zero components invert to an infinity of the same sign rather than relying
+// on the division, so axis-parallel rays keep their sign under any float mode.
+// An infinite tMax is clamped to the largest finite F32.
+inline RaySlab Precompute(Ray ray) {
+    RaySlab slab = {};
+    slab.origin = ray.origin;
+    for (int i = 0; i < 3; ++i) {
+        F32 d = ray.direction.raw[i];
+        bool negative = d < 0.0f || (d == 0.0f && AsS32(d) < 0);
+        slab.inverseDirection.raw[i] = d != 0.0f ? 1.0f / d : (negative ? -F32Infinity() : F32Infinity());
+        slab.signMask |= U32(negative) << i;
+    }
+    slab.tMin = ray.tMin;
+
+    // A ray parallel to a slab and outside it gets an entry of infinity, which
+    // must not pass entry <= exit for an unbounded ray
+    slab.tMax = Min(ray.tMax, 3.40282347e+38f);
+    return slab;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Ray box intersection
+
+// Far plane distances are scaled by 1 + 2 * gamma(3) so rounding in the slab
+// computation never misses a box the exact ray would hit, see pbrt 3.9.2
+#define TC_RAY_SLAB_FAR_SCALE 1.00000036f
+
+// Slab test of one ray against one box per lane of T. An axis-parallel ray
+// whose origin lies on a box plane computes 0 * infinity = NaN for that slab.
+// Min and Max return their second operand when the first is NaN, so such a
+// slab is skipped and the box counts as hit, erring on the side of a false
+// positive that the primitive test then rejects.
+template <typename T>
+inline auto Intersect(RaySlab ray, Box3Packet<T> box, T* tEntry, T* tExit) {
+    Vec3Packet<T> origin = Splat<T>(ray.origin);
+    Vec3Packet<T> inverse = Splat<T>(ray.inverseDirection);
+
+    T nearX = (ray.signMask & 1) ? box.max.x : box.min.x;
+    T nearY = (ray.signMask & 2) ? box.max.y : box.min.y;
+    T nearZ = (ray.signMask & 4) ? box.max.z : box.min.z;
+    T farX = (ray.signMask & 1) ? box.min.x : box.max.x;
+    T farY = (ray.signMask & 2) ? box.min.y : box.max.y;
+    T farZ = (ray.signMask & 4) ? box.min.z : box.max.z;
+
+    T scale = Splat<T>(TC_RAY_SLAB_FAR_SCALE);
+    T entry = Max((nearX - origin.x) * inverse.x, Splat<T>(ray.tMin));
+    entry = Max((nearY - origin.y) * inverse.y, entry);
+    entry = Max((nearZ - origin.z) * inverse.z, entry);
+    T exit = Min((farX - origin.x) * inverse.x * scale, Splat<T>(ray.tMax));
+    exit = Min((farY - origin.y) * inverse.y * scale, exit);
+    exit = Min((farZ - origin.z) * inverse.z * scale, exit);
+
+    *tEntry = entry;
+    *tExit = exit;
+    return entry <= exit;
+}
+
+// Returns whether the ray overlaps the box within [tMin, tMax], and the
+// parametric distances where it enters and leaves
+inline bool Intersect(RaySlab ray, Box3 box, F32* tEntry, F32* tExit) {
+    Box3Packet<F32> packet = {{box.min.x, box.min.y, box.min.z}, {box.max.x, box.max.y, box.max.z}};
+    return Intersect<F32>(ray, packet, tEntry, tExit);
+}
+
+inline bool Intersect(RaySlab ray, Box3 box) {
+    F32 tEntry, tExit;
+    return Intersect(ray, box, &tEntry, &tExit);
+}
+
+#endif // TC_RAY_HEADER_GUARD
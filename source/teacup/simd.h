@@ -0,0 +1,976 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_SIMD_HEADER_GUARD
+#define TC_SIMD_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <math.h>
+#include <string.h>
+
+#if TC_SIMD_AVX2
+#   include <immintrin.h>
+#elif TC_SIMD_SSE4
+#   include <smmintrin.h>
+#elif TC_SIMD_SSE
+#   include <emmintrin.h>
+#elif TC_SIMD_NEON
+#   include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// SIMD primitives
+
+// Four F32 lanes kept in a native register when the target has one. The
+// scalar fallback performs the same IEEE operations lane by lane, so results
+// are bit-identical whichever path is compiled.
+struct F32x4 {
+#if TC_SIMD_SSE
+    __m128 v;
+#elif TC_SIMD_NEON
+    float32x4_t v;
+#else
+    F32 v[4];
+#endif
+};
+
+// Lane mask produced by comparisons, each lane is either all zero or all one
+// bits.
+struct B32x4 {
+#if TC_SIMD_SSE
+    __m128 v;
+#elif TC_SIMD_NEON
+    uint32x4_t v;
+#else
+    U32 v[4];
+#endif
+};
+
+// Eight F32 lanes, a single register with AVX2 and a pair of 4-wide halves
+// everywhere else.
+struct F32x8 {
+#if TC_SIMD_AVX2
+    __m256 v;
+#else
+    F32x4 lo, hi;
+#endif
+};
+
+struct B32x8 {
+#if TC_SIMD_AVX2
+    __m256 v;
+#else
+    B32x4 lo, hi;
+#endif
+};
+
+// Integer lanes, used for bit manipulation of F32 values
+struct S32x4 {
+#if TC_SIMD_SSE
+    __m128i v;
+#elif TC_SIMD_NEON
+    int32x4_t v;
+#else
+    S32 v[4];
+#endif
+};
+
+struct S32x8 {
+#if TC_SIMD_AVX2
+    __m256i v;
+#else
+    S32x4 lo, hi;
+#endif
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// 4-wide functions
+
+inline F32x4 F32x4Zero() {
+#if TC_SIMD_SSE
+    return {_mm_setzero_ps()};
+#elif TC_SIMD_NEON
+    return {vdupq_n_f32(0.0f)};
+#else
+    return {{0.0f, 0.0f, 0.0f, 0.0f}};
+#endif
+}
+
+inline F32x4 F32x4Splat(F32 a) {
+#if TC_SIMD_SSE
+    return {_mm_set1_ps(a)};
+#elif TC_SIMD_NEON
+    return {vdupq_n_f32(a)};
+#else
+    return {{a, a, a, a}};
+#endif
+}
+
+inline F32x4 F32x4Set(F32 x, F32 y, F32 z, F32 w) {
+#if TC_SIMD_SSE
+    return {_mm_setr_ps(x, y, z, w)};
+#elif TC_SIMD_NEON
+    F32 raw[4] = {x, y, z, w};
+    return {vld1q_f32(raw)};
+#else
+    return {{x, y, z, w}};
+#endif
+}
+
+inline F32x4 F32x4Load(const F32* a) {
+#if TC_SIMD_SSE
+    return {_mm_loadu_ps(a)};
+#elif TC_SIMD_NEON
+    return {vld1q_f32(a)};
+#else
+    return {{a[0], a[1], a[2], a[3]}};
+#endif
+}
+
+// Converts four consecutive bytes to F32 lanes
+inline F32x4 F32x4LoadU8(const U8* a) {
+#if TC_SIMD_SSE
+    S32 bytes;
+    memcpy(&bytes, a, sizeof(bytes));
+    __m128i v = _mm_cvtsi32_si128(bytes);
+#if TC_SIMD_SSE4
+    v = _mm_cvtepu8_epi32(v);
+#else
+    v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+    v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+#endif
+    return {_mm_cvtepi32_ps(v)};
+#elif TC_SIMD_NEON
+    U32 bytes;
+    memcpy(&bytes, a, sizeof(bytes));
+    uint16x8_t v = vmovl_u8(vcreate_u8(bytes));
+    return {vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)))};
+#else
+    return {{F32(a[0]), F32(a[1]), F32(a[2]), F32(a[3])}};
+#endif
+}
+
+inline void F32x4Store(F32* a, F32x4 b) {
+#if TC_SIMD_SSE
+    _mm_storeu_ps(a, b.v);
+#elif TC_SIMD_NEON
+    vst1q_f32(a, b.v);
+#else
+    a[0] = b.v[0]; a[1] = b.v[1]; a[2] = b.v[2]; a[3] = b.v[3];
+#endif
+}
+
+// Non-temporal store that bypasses the caches, a must be 16 byte aligned.
+// Follow a run of these with StreamFence before the data is read elsewhere.
+inline void F32x4Stream(F32* a, F32x4 b) {
+#if TC_SIMD_SSE
+    _mm_stream_ps(a, b.v);
+#else
+    F32x4Store(a, b);
+#endif
+}
+
+inline void StreamFence() {
+#if TC_SIMD_SSE
+    _mm_sfence();
+#endif
+}
+
+inline F32x4 operator-(F32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))};
+#elif TC_SIMD_NEON
+    return {vnegq_f32(a.v)};
+#else
+    return {{-a.v[0], -a.v[1], -a.v[2], -a.v[3]}};
+#endif
+}
+
+inline F32x4 operator+(F32x4 a, F32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_add_ps(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vaddq_f32(a.v, b.v)};
+#else
+    return {{a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3]}};
+#endif
+}
+
+inline F32x4 operator-(F32x4 a, F32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_sub_ps(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vsubq_f32(a.v, b.v)};
+#else
+    return {{a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], a.v[3]-b.v[3]}};
+#endif
+}
+
+inline F32x4 operator*(F32x4 a, F32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_mul_ps(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vmulq_f32(a.v, b.v)};
+#else
+    return {{a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3]}};
+#endif
+}
+
+inline F32x4 operator/(F32x4 a, F32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_div_ps(a.v, b.v)};
+#elif TC_SIMD_NEON && TC_ARCH_64_BIT
+    return {vdivq_f32(a.v, b.v)};
+#else
+    F32 x[4], y[4];
+    F32x4Store(x, a);
+    F32x4Store(y, b);
+    return F32x4Set(x[0]/y[0], x[1]/y[1], x[2]/y[2], x[3]/y[3]);
+#endif
+}
+
+// Min and Max follow the SSE convention of returning the second operand when
+// the comparison is false, which is also what TC_MIN and TC_MAX do. NEON is
+// made to agree so NaN and signed zero handling is identical on every target.
+inline F32x4 Min(F32x4 a, F32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_min_ps(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vbslq_f32(vcltq_f32(a.v, b.v), a.v, b.v)};
+#else
+    return {{TC_MIN(a.v[0], b.v[0]), TC_MIN(a.v[1], b.v[1]), TC_MIN(a.v[2], b.v[2]), TC_MIN(a.v[3], b.v[3])}};
+#endif
+}
+
+inline F32x4 Max(F32x4 a, F32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_max_ps(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vbslq_f32(vcgtq_f32(a.v, b.v), a.v, b.v)};
+#else
+    return {{TC_MAX(a.v[0], b.v[0]), TC_MAX(a.v[1], b.v[1]), TC_MAX(a.v[2], b.v[2]), TC_MAX(a.v[3], b.v[3])}};
+#endif
+}
+
+inline F32x4 Sqrt(F32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_sqrt_ps(a.v)};
+#elif TC_SIMD_NEON && TC_ARCH_64_BIT
+    return {vsqrtq_f32(a.v)};
+#else
+    F32 x[4];
+    F32x4Store(x, a);
+    return F32x4Set(sqrtf(x[0]), sqrtf(x[1]), sqrtf(x[2]), sqrtf(x[3]));
+#endif
+}
+
+inline F32x4 Abs(F32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)};
+#elif TC_SIMD_NEON
+    return {vabsq_f32(a.v)};
+#else
+    return {{fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3])}};
+#endif
+}
+
+#if TC_SIMD_SSE && !TC_SIMD_SSE4
+// Rounds toward zero, then steps by one where that went the wrong way. Inputs
+// of 2^23 and above are already integral and pass through unchanged, and the
+// sign of the input is kept so -0.5 rounds up to -0 like ceilf.
+inline __m128 RoundSse2(__m128 a, bool up) {
+    __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    __m128 wrong = up ? _mm_cmplt_ps(t, a) : _mm_cmpgt_ps(t, a);
+    __m128 step = _mm_and_ps(wrong, _mm_set1_ps(up ? 1.0f : -1.0f));
+    t = _mm_or_ps(_mm_add_ps(t, step), _mm_and_ps(a, sign));
+    __m128 small = _mm_cmplt_ps(_mm_andnot_ps(sign, a), _mm_set1_ps(8388608.0f));
+    return _mm_or_ps(_mm_and_ps(small, t), _mm_andnot_ps(small, a));
+}
+#endif
+
+inline F32x4 Floor(F32x4 a) {
+#if TC_SIMD_SSE4
+    return {_mm_round_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)};
+#elif TC_SIMD_SSE
+    return {RoundSse2(a.v, false)};
+#elif TC_SIMD_NEON && TC_ARCH_64_BIT
+    return {vrndmq_f32(a.v)};
+#else
+    F32 x[4];
+    F32x4Store(x, a);
+    return F32x4Set(floorf(x[0]), floorf(x[1]), floorf(x[2]), floorf(x[3]));
+#endif
+}
+
+inline F32x4 Ceil(F32x4 a) {
+#if TC_SIMD_SSE4
+    return {_mm_round_ps(a.v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC)};
+#elif TC_SIMD_SSE
+    return {RoundSse2(a.v, true)};
+#elif TC_SIMD_NEON && TC_ARCH_64_BIT
+    return {vrndpq_f32(a.v)};
+#else
+    F32 x[4];
+    F32x4Store(x, a);
+    return F32x4Set(ceilf(x[0]), ceilf(x[1]), ceilf(x[2]), ceilf(x[3]));
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 4-wide mask functions
+
+#if TC_SIMD_SSE
+#   define TC_SIMD_COMPARE_4(OP, SSE, NEON) \
+    inline B32x4 operator OP(F32x4 a, F32x4 b) { return {SSE(a.v, b.v)}; }
+#elif TC_SIMD_NEON
+#   define TC_SIMD_COMPARE_4(OP, SSE, NEON) \
+    inline B32x4 operator OP(F32x4 a, F32x4 b) { return {NEON}; }
+#else
+#   define TC_SIMD_COMPARE_4(OP, SSE, NEON) \
+    inline B32x4 operator OP(F32x4 a, F32x4 b) { \
+        B32x4 m; \
+        for (int i = 0; i < 4; ++i) { m.v[i] = (a.v[i] OP b.v[i]) ? 0xffffffffu : 0u; } \
+        return m; \
+    }
+#endif
+
+TC_SIMD_COMPARE_4(<, _mm_cmplt_ps, vcltq_f32(a.v, b.v))
+TC_SIMD_COMPARE_4(<=, _mm_cmple_ps, vcleq_f32(a.v, b.v))
+TC_SIMD_COMPARE_4(>, _mm_cmpgt_ps, vcgtq_f32(a.v, b.v))
+TC_SIMD_COMPARE_4(>=, _mm_cmpge_ps, vcgeq_f32(a.v, b.v))
+TC_SIMD_COMPARE_4(==, _mm_cmpeq_ps, vceqq_f32(a.v, b.v))
+TC_SIMD_COMPARE_4(!=, _mm_cmpneq_ps, vmvnq_u32(vceqq_f32(a.v, b.v)))
+
+#undef TC_SIMD_COMPARE_4
+
+inline B32x4 operator&(B32x4 a, B32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_and_ps(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vandq_u32(a.v, b.v)};
+#else
+    return {{a.v[0] & b.v[0], a.v[1] & b.v[1], a.v[2] & b.v[2], a.v[3] & b.v[3]}};
+#endif
+}
+
+inline B32x4 operator|(B32x4 a, B32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_or_ps(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vorrq_u32(a.v, b.v)};
+#else
+    return {{a.v[0] | b.v[0], a.v[1] | b.v[1], a.v[2] | b.v[2], a.v[3] | b.v[3]}};
+#endif
+}
+
+inline B32x4 operator^(B32x4 a, B32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_xor_ps(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {veorq_u32(a.v, b.v)};
+#else
+    return {{a.v[0] ^ b.v[0], a.v[1] ^ b.v[1], a.v[2] ^ b.v[2], a.v[3] ^ b.v[3]}};
+#endif
+}
+
+inline B32x4 operator!(B32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_xor_ps(a.v, _mm_castsi128_ps(_mm_set1_epi32(-1)))};
+#elif TC_SIMD_NEON
+    return {vmvnq_u32(a.v)};
+#else
+    return {{~a.v[0], ~a.v[1], ~a.v[2], ~a.v[3]}};
+#endif
+}
+
+// One bit per lane, lane 0 in the lowest bit
+inline U32 MoveMask(B32x4 a) {
+#if TC_SIMD_SSE
+    return U32(_mm_movemask_ps(a.v));
+#elif TC_SIMD_NEON
+    uint32x4_t bits = vshrq_n_u32(a.v, 31);
+    return vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) | (vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3);
+#else
+    return (a.v[0] & 1) | ((a.v[1] & 1) << 1) | ((a.v[2] & 1) << 2) | ((a.v[3] & 1) << 3);
+#endif
+}
+
+inline bool Any(B32x4 a) {
+    return MoveMask(a) != 0;
+}
+
+inline bool All(B32x4 a) {
+    return MoveMask(a) == 0xf;
+}
+
+inline bool None(B32x4 a) {
+    return MoveMask(a) == 0;
+}
+
+// Lane-wise mask ? a : b
+inline F32x4 Select(B32x4 mask, F32x4 a, F32x4 b) {
+#if TC_SIMD_SSE4
+    return {_mm_blendv_ps(b.v, a.v, mask.v)};
+#elif TC_SIMD_SSE
+    return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+#elif TC_SIMD_NEON
+    return {vbslq_f32(mask.v, a.v, b.v)};
+#else
+    F32x4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = mask.v[i] ? a.v[i] : b.v[i];
+    }
+    return r;
+#endif
+}
+
+// Reorders the lanes of a, e.g. Shuffle<3, 2, 1, 0>(a) reverses them.
+template <int X, int Y, int Z, int W>
+inline F32x4 Shuffle(F32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(W, Z, Y, X))};
+#elif TC_SIMD_NEON
+    float32x4_t r = vdupq_n_f32(vgetq_lane_f32(a.v, X));
+    r = vsetq_lane_f32(vgetq_lane_f32(a.v, Y), r, 1);
+    r = vsetq_lane_f32(vgetq_lane_f32(a.v, Z), r, 2);
+    r = vsetq_lane_f32(vgetq_lane_f32(a.v, W), r, 3);
+    return {r};
+#else
+    return {{a.v[X], a.v[Y], a.v[Z], a.v[W]}};
+#endif
+}
+
+// Takes the first two lanes from a and the last two from b, e.g.
+// Shuffle<0, 1, 0, 1>(a, b) gives (a.x, a.y, b.x, b.y).
+template <int X, int Y, int Z, int W>
+inline F32x4 Shuffle(F32x4 a, F32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(W, Z, Y, X))};
+#elif TC_SIMD_NEON
+    float32x4_t r = vdupq_n_f32(vgetq_lane_f32(a.v, X));
+    r = vsetq_lane_f32(vgetq_lane_f32(a.v, Y), r, 1);
+    r = vsetq_lane_f32(vgetq_lane_f32(b.v, Z), r, 2);
+    r = vsetq_lane_f32(vgetq_lane_f32(b.v, W), r, 3);
+    return {r};
+#else
+    return {{a.v[X], a.v[Y], b.v[Z], b.v[W]}};
+#endif
+}
+
+template <int I>
+inline F32 Extract(F32x4 a) {
+#if TC_SIMD_SSE
+    return _mm_cvtss_f32(_mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(I, I, I, I)));
+#elif TC_SIMD_NEON
+    return vgetq_lane_f32(a.v, I);
+#else
+    return a.v[I];
+#endif
+}
+
+// Sum of all four lanes, broadcast to every lane. The pairwise order is the
+// same on every path.
+inline F32x4 HorizontalSum(F32x4 a) {
+    F32x4 s = a + Shuffle<1, 0, 3, 2>(a);
+    return s + Shuffle<2, 3, 0, 1>(s);
+}
+
+// Transposes the 4x4 matrix whose rows are r0..r3 in place.
+inline void Transpose(F32x4& r0, F32x4& r1, F32x4& r2, F32x4& r3) {
+#if TC_SIMD_SSE
+    _MM_TRANSPOSE4_PS(r0.v, r1.v, r2.v, r3.v);
+#elif TC_SIMD_NEON
+    float32x4x2_t t01 = vtrnq_f32(r0.v, r1.v);
+    float32x4x2_t t23 = vtrnq_f32(r2.v, r3.v);
+    r0.v = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r1.v = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r2.v = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3.v = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+#else
+    F32x4 a = r0, b = r1, c = r2, d = r3;
+    r0 = {{a.v[0], b.v[0], c.v[0], d.v[0]}};
+    r1 = {{a.v[1], b.v[1], c.v[1], d.v[1]}};
+    r2 = {{a.v[2], b.v[2], c.v[2], d.v[2]}};
+    r3 = {{a.v[3], b.v[3], c.v[3], d.v[3]}};
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 4-wide integer functions
+
+inline S32x4 S32x4Splat(S32 a) {
+#if TC_SIMD_SSE
+    return {_mm_set1_epi32(a)};
+#elif TC_SIMD_NEON
+    return {vdupq_n_s32(a)};
+#else
+    return {{a, a, a, a}};
+#endif
+}
+
+// Reinterprets the bits of each lane
+inline S32x4 AsS32(F32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_castps_si128(a.v)};
+#elif TC_SIMD_NEON
+    return {vreinterpretq_s32_f32(a.v)};
+#else
+    S32x4 r;
+    memcpy(r.v, a.v, sizeof(r.v));
+    return r;
+#endif
+}
+
+inline F32x4 AsF32(S32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_castsi128_ps(a.v)};
+#elif TC_SIMD_NEON
+    return {vreinterpretq_f32_s32(a.v)};
+#else
+    F32x4 r;
+    memcpy(r.v, a.v, sizeof(r.v));
+    return r;
+#endif
+}
+
+inline F32x4 ConvertToF32(S32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_cvtepi32_ps(a.v)};
+#elif TC_SIMD_NEON
+    return {vcvtq_f32_s32(a.v)};
+#else
+    return {{F32(a.v[0]), F32(a.v[1]), F32(a.v[2]), F32(a.v[3])}};
+#endif
+}
+
+// Rounds toward zero, lanes outside the S32 range are undefined
+inline S32x4 ConvertToS32(F32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_cvttps_epi32(a.v)};
+#elif TC_SIMD_NEON
+    return {vcvtq_s32_f32(a.v)};
+#else
+    return {{S32(a.v[0]), S32(a.v[1]), S32(a.v[2]), S32(a.v[3])}};
+#endif
+}
+
+inline S32x4 operator+(S32x4 a, S32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_add_epi32(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vaddq_s32(a.v, b.v)};
+#else
+    return {{S32(U32(a.v[0]) + U32(b.v[0])), S32(U32(a.v[1]) + U32(b.v[1])), S32(U32(a.v[2]) + U32(b.v[2])), S32(U32(a.v[3]) + U32(b.v[3]))}};
+#endif
+}
+
+inline S32x4 operator-(S32x4 a, S32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_sub_epi32(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vsubq_s32(a.v, b.v)};
+#else
+    return {{S32(U32(a.v[0]) - U32(b.v[0])), S32(U32(a.v[1]) - U32(b.v[1])), S32(U32(a.v[2]) - U32(b.v[2])), S32(U32(a.v[3]) - U32(b.v[3]))}};
+#endif
+}
+
+inline S32x4 operator&(S32x4 a, S32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_and_si128(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vandq_s32(a.v, b.v)};
+#else
+    return {{a.v[0] & b.v[0], a.v[1] & b.v[1], a.v[2] & b.v[2], a.v[3] & b.v[3]}};
+#endif
+}
+
+inline S32x4 operator|(S32x4 a, S32x4 b) {
+#if TC_SIMD_SSE
+    return {_mm_or_si128(a.v, b.v)};
+#elif TC_SIMD_NEON
+    return {vorrq_s32(a.v, b.v)};
+#else
+    return {{a.v[0] | b.v[0], a.v[1] | b.v[1], a.v[2] | b.v[2], a.v[3] | b.v[3]}};
+#endif
+}
+
+// Scalar operands are broadcast, so generic code can write bits & 0xff
+inline S32x4 operator+(S32x4 a, S32 b) { return a + S32x4Splat(b); }
+inline S32x4 operator-(S32x4 a, S32 b) { return a - S32x4Splat(b); }
+inline S32x4 operator-(S32 a, S32x4 b) { return S32x4Splat(a) - b; }
+inline S32x4 operator&(S32x4 a, S32 b) { return a & S32x4Splat(b); }
+inline S32x4 operator|(S32x4 a, S32 b) { return a | S32x4Splat(b); }
+
+template <int N>
+inline S32x4 ShiftLeft(S32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_slli_epi32(a.v, N)};
+#elif TC_SIMD_NEON
+    return {vshlq_n_s32(a.v, N)};
+#else
+    return {{S32(U32(a.v[0]) << N), S32(U32(a.v[1]) << N), S32(U32(a.v[2]) << N), S32(U32(a.v[3]) << N)}};
+#endif
+}
+
+template <int N>
+inline S32x4 ShiftRightLogical(S32x4 a) {
+#if TC_SIMD_SSE
+    return {_mm_srli_epi32(a.v, N)};
+#elif TC_SIMD_NEON
+    return {vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a.v), N))};
+#else
+    return {{S32(U32(a.v[0]) >> N), S32(U32(a.v[1]) >> N), S32(U32(a.v[2]) >> N), S32(U32(a.v[3]) >> N)}};
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 8-wide functions
+
+#if TC_SIMD_AVX2
+#   define TC_SIMD_UNARY_8(NAME, AVX) \
+    inline F32x8 NAME(F32x8 a) { return {AVX}; }
+#   define TC_SIMD_BINARY_8(NAME, AVX) \
+    inline F32x8 NAME(F32x8 a, F32x8 b) { return {AVX(a.v, b.v)}; }
+#   define TC_SIMD_COMPARE_8(OP, PREDICATE) \
+    inline B32x8 operator OP(F32x8 a, F32x8 b) { return {_mm256_cmp_ps(a.v, b.v, PREDICATE)}; }
+#   define TC_SIMD_LOGIC_8(OP, AVX) \
+    inline B32x8 operator OP(B32x8 a, B32x8 b) { return {AVX(a.v, b.v)}; }
+#else
+#   define TC_SIMD_UNARY_8(NAME, AVX) \
+    inline F32x8 NAME(F32x8 a) { return {NAME(a.lo), NAME(a.hi)}; }
+#   define TC_SIMD_BINARY_8(NAME, AVX) \
+    inline F32x8 NAME(F32x8 a, F32x8 b) { return {NAME(a.lo, b.lo), NAME(a.hi, b.hi)}; }
+#   define TC_SIMD_COMPARE_8(OP, PREDICATE) \
+    inline B32x8 operator OP(F32x8 a, F32x8 b) { return {a.lo OP b.lo, a.hi OP b.hi}; }
+#   define TC_SIMD_LOGIC_8(OP, AVX) \
+    inline B32x8 operator OP(B32x8 a, B32x8 b) { return {a.lo OP b.lo, a.hi OP b.hi}; }
+#endif
+
+inline F32x8 F32x8Zero() {
+#if TC_SIMD_AVX2
+    return {_mm256_setzero_ps()};
+#else
+    return {F32x4Zero(), F32x4Zero()};
+#endif
+}
+
+inline F32x8 F32x8Splat(F32 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_set1_ps(a)};
+#else
+    return {F32x4Splat(a), F32x4Splat(a)};
+#endif
+}
+
+inline F32x8 F32x8Set(F32 a, F32 b, F32 c, F32 d, F32 e, F32 f, F32 g, F32 h) {
+#if TC_SIMD_AVX2
+    return {_mm256_setr_ps(a, b, c, d, e, f, g, h)};
+#else
+    return {F32x4Set(a, b, c, d), F32x4Set(e, f, g, h)};
+#endif
+}
+
+inline F32x8 F32x8Load(const F32* a) {
+#if TC_SIMD_AVX2
+    return {_mm256_loadu_ps(a)};
+#else
+    return {F32x4Load(a), F32x4Load(a + 4)};
+#endif
+}
+
+inline F32x8 F32x8LoadU8(const U8* a) {
+#if TC_SIMD_AVX2
+    return {_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) a)))};
+#else
+    return {F32x4LoadU8(a), F32x4LoadU8(a + 4)};
+#endif
+}
+
+inline void F32x8Store(F32* a, F32x8 b) {
+#if TC_SIMD_AVX2
+    _mm256_storeu_ps(a, b.v);
+#else
+    F32x4Store(a, b.lo);
+    F32x4Store(a + 4, b.hi);
+#endif
+}
+
+inline F32x8 F32x8Combine(F32x4 lo, F32x4 hi) {
+#if TC_SIMD_AVX2
+    return {_mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1)};
+#else
+    return {lo, hi};
+#endif
+}
+
+inline F32x4 Low(F32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_castps256_ps128(a.v)};
+#else
+    return a.lo;
+#endif
+}
+
+inline F32x4 High(F32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_extractf128_ps(a.v, 1)};
+#else
+    return a.hi;
+#endif
+}
+
+inline F32x8 operator-(F32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))};
+#else
+    return {-a.lo, -a.hi};
+#endif
+}
+
+TC_SIMD_BINARY_8(operator+, _mm256_add_ps)
+TC_SIMD_BINARY_8(operator-, _mm256_sub_ps)
+TC_SIMD_BINARY_8(operator*, _mm256_mul_ps)
+TC_SIMD_BINARY_8(operator/, _mm256_div_ps)
+TC_SIMD_BINARY_8(Min, _mm256_min_ps)
+TC_SIMD_BINARY_8(Max, _mm256_max_ps)
+
+TC_SIMD_UNARY_8(Sqrt, _mm256_sqrt_ps(a.v))
+TC_SIMD_UNARY_8(Abs, _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v))
+TC_SIMD_UNARY_8(Floor, _mm256_round_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC))
+TC_SIMD_UNARY_8(Ceil, _mm256_round_ps(a.v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC))
+
+TC_SIMD_COMPARE_8(<, _CMP_LT_OQ)
+TC_SIMD_COMPARE_8(<=, _CMP_LE_OQ)
+TC_SIMD_COMPARE_8(>, _CMP_GT_OQ)
+TC_SIMD_COMPARE_8(>=, _CMP_GE_OQ)
+TC_SIMD_COMPARE_8(==, _CMP_EQ_OQ)
+TC_SIMD_COMPARE_8(!=, _CMP_NEQ_UQ)
+
+TC_SIMD_LOGIC_8(&, _mm256_and_ps)
+TC_SIMD_LOGIC_8(|, _mm256_or_ps)
+TC_SIMD_LOGIC_8(^, _mm256_xor_ps)
+
+#undef TC_SIMD_UNARY_8
+#undef TC_SIMD_BINARY_8
+#undef TC_SIMD_COMPARE_8
+#undef TC_SIMD_LOGIC_8
+
+inline B32x8 operator!(B32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))};
+#else
+    return {!a.lo, !a.hi};
+#endif
+}
+
+inline U32 MoveMask(B32x8 a) {
+#if TC_SIMD_AVX2
+    return U32(_mm256_movemask_ps(a.v));
+#else
+    return MoveMask(a.lo) | (MoveMask(a.hi) << 4);
+#endif
+}
+
+inline bool Any(B32x8 a) {
+    return MoveMask(a) != 0;
+}
+
+inline bool All(B32x8 a) {
+    return MoveMask(a) == 0xff;
+}
+
+inline bool None(B32x8 a) {
+    return MoveMask(a) == 0;
+}
+
+inline F32x8 Select(B32x8 mask, F32x8 a, F32x8 b) {
+#if TC_SIMD_AVX2
+    return {_mm256_blendv_ps(b.v, a.v, mask.v)};
+#else
+    return {Select(mask.lo, a.lo, b.lo), Select(mask.hi, a.hi, b.hi)};
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 8-wide integer functions
+
+inline S32x8 S32x8Splat(S32 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_set1_epi32(a)};
+#else
+    return {S32x4Splat(a), S32x4Splat(a)};
+#endif
+}
+
+inline S32x8 AsS32(F32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_castps_si256(a.v)};
+#else
+    return {AsS32(a.lo), AsS32(a.hi)};
+#endif
+}
+
+inline F32x8 AsF32(S32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_castsi256_ps(a.v)};
+#else
+    return {AsF32(a.lo), AsF32(a.hi)};
+#endif
+}
+
+inline F32x8 ConvertToF32(S32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_cvtepi32_ps(a.v)};
+#else
+    return {ConvertToF32(a.lo), ConvertToF32(a.hi)};
+#endif
+}
+
+inline S32x8 ConvertToS32(F32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_cvttps_epi32(a.v)};
+#else
+    return {ConvertToS32(a.lo), ConvertToS32(a.hi)};
+#endif
+}
+
+#if TC_SIMD_AVX2
+#   define TC_SIMD_INTEGER_8(OP, AVX) \
+    inline S32x8 operator OP(S32x8 a, S32x8 b) { return {AVX(a.v, b.v)}; } \
+    inline S32x8 operator OP(S32x8 a, S32 b) { return {AVX(a.v, _mm256_set1_epi32(b))}; }
+#else
+#   define TC_SIMD_INTEGER_8(OP, AVX) \
+    inline S32x8 operator OP(S32x8 a, S32x8 b) { return {a.lo OP b.lo, a.hi OP b.hi}; } \
+    inline S32x8 operator OP(S32x8 a, S32 b) { return {a.lo OP b, a.hi OP b}; }
+#endif
+
+TC_SIMD_INTEGER_8(+, _mm256_add_epi32)
+TC_SIMD_INTEGER_8(-, _mm256_sub_epi32)
+TC_SIMD_INTEGER_8(&, _mm256_and_si256)
+TC_SIMD_INTEGER_8(|, _mm256_or_si256)
+
+#undef TC_SIMD_INTEGER_8
+
+inline S32x8 operator-(S32 a, S32x8 b) { return S32x8Splat(a) - b; }
+
+template <int N>
+inline S32x8 ShiftLeft(S32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_slli_epi32(a.v, N)};
+#else
+    return {ShiftLeft<N>(a.lo), ShiftLeft<N>(a.hi)};
+#endif
+}
+
+template <int N>
+inline S32x8 ShiftRightLogical(S32x8 a) {
+#if TC_SIMD_AVX2
+    return {_mm256_srli_epi32(a.v, N)};
+#else
+    return {ShiftRightLogical<N>(a.lo), ShiftRightLogical<N>(a.hi)};
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Width-generic functions
+
+// Lets templates written against a lane type T construct values of that type,
+// e.g. Splat<F32x8>(1.0f).
+template <typename T> T Splat(F32 a);
+template <typename T> T Load(const F32* a);
+
+template <> inline F32 Splat<F32>(F32 a) { return a; }
+template <> inline F32x4 Splat<F32x4>(F32 a) { return F32x4Splat(a); }
+template <> inline F32x8 Splat<F32x8>(F32 a) { return F32x8Splat(a); }
+template <> inline F32 Load<F32>(const F32* a) { return *a; }
+template <> inline F32x4 Load<F32x4>(const F32* a) { return F32x4Load(a); }
+template <> inline F32x8 Load<F32x8>(const F32* a) { return F32x8Load(a); }
+
+// Bytes converted to F32 lanes
+template <typename T> T Load(const U8* a);
+
+template <> inline F32 Load<F32>(const U8* a) { return F32(*a); }
+template <> inline F32x4 Load<F32x4>(const U8* a) { return F32x4LoadU8(a); }
+template <> inline F32x8 Load<F32x8>(const U8* a) { return F32x8LoadU8(a); }
+
+inline void Store(F32* a, F32 b) {
+    *a = b;
+}
+
+inline void Store(F32* a, F32x4 b) {
+    F32x4Store(a, b);
+}
+
+inline void Store(F32* a, F32x8 b) {
+    F32x8Store(a, b);
+}
+
+// Scalar counterparts of the lane functions, so the same template can be
+// instantiated for F32 as well as F32x4 and F32x8
+
+inline F32 Select(bool mask, F32 a, F32 b) {
+    return mask ? a : b;
+}
+
+inline U32 MoveMask(bool a) {
+    return U32(a);
+}
+
+inline bool Any(bool a) {
+    return a;
+}
+
+inline S32 AsS32(F32 a) {
+    S32 r;
+    memcpy(&r, &a, sizeof(r));
+    return r;
+}
+
+inline F32 AsF32(S32 a) {
+    F32 r;
+    memcpy(&r, &a, sizeof(r));
+    return r;
+}
+
+inline F32 ConvertToF32(S32 a) {
+    return F32(a);
+}
+
+inline S32 ConvertToS32(F32 a) {
+    return S32(a);
+}
+
+template <int N>
+inline S32 ShiftLeft(S32 a) {
+    return S32(U32(a) << N);
+}
+
+template <int N>
+inline S32 ShiftRightLogical(S32 a) {
+    return S32(U32(a) >> N);
+}
+
+// Number of F32 lanes in T
+#define TC_LANES(T) int(sizeof(T) / sizeof(F32))
+
+#endif // TC_SIMD_HEADER_GUARD
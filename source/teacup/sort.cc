@@ -0,0 +1,117 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/sort.h>
+#include <teacup/parallel.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Radix sort
+
+#define TC_RADIX_BITS 8
+#define TC_RADIX_SIZE (1 << TC_RADIX_BITS)
+
+// Inputs below this size sort as a single chunk on the calling thread
+#define TC_RADIX_PARALLEL_COUNT (64 * 1024)
+
+// Each chunk counts its digits, chunks then scatter to offsets that follow
+// every smaller digit and the same digit in earlier chunks, which keeps the
+// sort stable
+template <typename K>
+static void RadixSortKeys(K* keys, U32* values, K* scratchKeys, U32* scratchValues, U64 count, U32 keyBits) {
+    U64 chunkCount = 1;
+    if (count >= TC_RADIX_PARALLEL_COUNT) {
+        chunkCount = TC_MIN(U64(ParallelThreadCount()) * 4, count / (TC_RADIX_PARALLEL_COUNT / 4));
+    }
+    U64 grain = (count + chunkCount - 1) / chunkCount;
+    chunkCount = (count + grain - 1) / grain;
+    U64* histograms = (U64*) malloc(chunkCount * TC_RADIX_SIZE * sizeof(U64));
+
+    K* sourceKeys = keys;
+    U32* sourceValues = values;
+    K* targetKeys = scratchKeys;
+    U32* targetValues = scratchValues;
+
+    for (U32 shift = 0; shift < keyBits; shift += TC_RADIX_BITS) {
+        ParallelFor(count, grain, [&](U64 begin, U64 end) {
+            U64* histogram = histograms + (begin / grain) * TC_RADIX_SIZE;
+            memset(histogram, 0, TC_RADIX_SIZE * sizeof(U64));
+            for (U64 i = begin; i < end; ++i) {
+                histogram[(sourceKeys[i] >> shift) & (TC_RADIX_SIZE - 1)]++;
+            }
+        });
+
+        // Turn the counts into scatter offsets, digit major then chunk
+        U64 offset = 0;
+        bool skip = false;
+        for (U32 digit = 0; digit < TC_RADIX_SIZE; ++digit) {
+            U64 digitCount = 0;
+            for (U64 chunk = 0; chunk < chunkCount; ++chunk) {
+                U64* slot = histograms + chunk * TC_RADIX_SIZE + digit;
+                U64 chunkDigitCount = *slot;
+                *slot = offset + digitCount;
+                digitCount += chunkDigitCount;
+            }
+            skip |= digitCount == count;
+            offset += digitCount;
+        }
+        if (skip) {
+            continue;
+        }
+
+        ParallelFor(count, grain, [&](U64 begin, U64 end) {
+            U64* offsets = histograms + (begin / grain) * TC_RADIX_SIZE;
+            for (U64 i = begin; i < end; ++i) {
+                U64 target = offsets[(sourceKeys[i] >> shift) & (TC_RADIX_SIZE - 1)]++;
+                targetKeys[target] = sourceKeys[i];
+                targetValues[target] = sourceValues[i];
+            }
+        });
+
+        K* swapKeys = sourceKeys;
+        sourceKeys = targetKeys;
+        targetKeys = swapKeys;
+        U32* swapValues = sourceValues;
+        sourceValues = targetValues;
+        targetValues = swapValues;
+    }
+
+    if (sourceKeys != keys) {
+        ParallelFor(count, grain, [&](U64 begin, U64 end) {
+            memcpy(keys + begin, sourceKeys + begin, (end - begin) * sizeof(K));
+            memcpy(values + begin, sourceValues + begin, (end - begin) * sizeof(U32));
+        });
+    }
+    free(histograms);
+}
+
+void RadixSort(U32* keys, U32* values, U32* scratchKeys, U32* scratchValues, U64 count, U32 keyBits) {
+    if (count > 1) {
+        RadixSortKeys(keys, values, scratchKeys, scratchValues, count, TC_MIN(keyBits, 32u));
+    }
+}
+
+void RadixSort(U64* keys, U32* values, U64* scratchKeys, U32* scratchValues, U64 count, U32 keyBits) {
+    if (count > 1) {
+        RadixSortKeys(keys, values, scratchKeys, scratchValues, count, TC_MIN(keyBits, 64u));
+    }
+}
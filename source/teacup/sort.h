@@ -0,0 +1,65 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_SORT_HEADER_GUARD
+#define TC_SORT_HEADER_GUARD
+
+#include <teacup/types.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Radix sort
+
+// Stable least significant digit first sort of count keys, carrying values
+// along. Only the low keyBits of each key are compared. Digits are 8 bits and
+// passes over digits that are the same for every key are skipped. The scratch
+// arrays hold count elements and are clobbered; the result is always left in
+// keys and values. Large inputs histogram and scatter in parallel.
+void RadixSort(U32* keys, U32* values, U32* scratchKeys, U32* scratchValues, U64 count, U32 keyBits = 32);
+void RadixSort(U64* keys, U32* values, U64* scratchKeys, U32* scratchValues, U64 count, U32 keyBits = 64);
+
+////////////////////////////////////////////////////////////////////////////////
+// Morton codes
+
+// Spreads the low 10 bits of a so two zero bits follow each of them. Three
+// expanded coordinates shifted by 2, 1 and 0 and or'ed together interleave
+// into a 30 bit Morton code.
+constexpr U32 MortonExpand(U32 a) {
+    a &= 0x3ff;
+    a = (a | (a << 16)) & 0x030000ff;
+    a = (a | (a << 8)) & 0x0300f00f;
+    a = (a | (a << 4)) & 0x030c30c3;
+    a = (a | (a << 2)) & 0x09249249;
+    return a;
+}
+
+// Same for the low 21 bits, for 63 bit codes
+constexpr U64 MortonExpand(U64 a) {
+    a &= 0x1fffff;
+    a = (a | (a << 32)) & 0x001f00000000ffffull;
+    a = (a | (a << 16)) & 0x001f0000ff0000ffull;
+    a = (a | (a << 8)) & 0x100f00f00f00f00full;
+    a = (a | (a << 4)) & 0x10c30c30c30c30c3ull;
+    a = (a | (a << 2)) & 0x1249249249249249ull;
+    return a;
+}
+
+#endif // TC_SORT_HEADER_GUARD
@@ -21,12 +21,25 @@
 // SOFTWARE.
 
 #include <teacup/types.h>
+#include <teacup/cpu.h>
+#include <teacup/kernels.h>
 #include <teacup/maths.h>
 
 int main(int argc, char** argv) {
     printf("Hello world from teacup\n");
 
     printf("Compiled using: %s\n", TC_COMPILER_NAME);
+    printf("SIMD instruction set: %s\n", TC_SIMD_NAME);
+
+    printf("CPU features:");
+    U32 features = CpuFeaturesDetect();
+    for (U32 bit = 1; bit <= CPU_FEATURE_NEON; bit <<= 1) {
+        if (features & bit) {
+            printf(" %s", CpuFeatureName(CpuFeatures(bit)));
+        }
+    }
+    printf("\n");
+    printf("Kernel tier: %s\n", CpuTierName(KernelsGet()->tier));
 
     if (TC_IS_DEF(TC_OS_MACOS)) {
         printf("Running on MacOS\n");
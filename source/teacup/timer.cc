@@ -0,0 +1,52 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/timer.h>
+
+#if TC_OS_WINDOWS
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <time.h>
+#endif
+
+U64 TimerNow() {
+#if TC_OS_WINDOWS
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return U64(counter.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return U64(ts.tv_sec) * 1000000000ull + U64(ts.tv_nsec);
+#endif
+}
+
+F64 TimerSeconds(U64 start, U64 end) {
+#if TC_OS_WINDOWS
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return F64(end - start) / F64(frequency.QuadPart);
+#else
+    return F64(end - start) * 1e-9;
+#endif
+}
@@ -0,0 +1,418 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/tlas.h>
+#include <teacup/parallel.h>
+#include <stdlib.h>
+#include <string.h>
+
+Box3 InstanceBounds(const Bvh* blases, const Instance* instance) {
+    const Bvh* blas = blases + instance->blas;
+    if (blas->nodeCount == 0) {
+        Vec3 origin = TransformPoint(instance->transform, Vec3{0, 0, 0});
+        return {origin, origin};
+    }
+    return TransformBox(instance->transform, blas->nodes[0].bounds);
+}
+
+void TlasBuild(Tlas* tlas, const Bvh* blases, U32 blasCount, const Instance* instances, U32 instanceCount, const BvhBuildOptions& options, BvhBuildStats* stats) {
+    *tlas = {};
+    tlas->blases = blases;
+    tlas->instances = instances;
+    tlas->blasCount = blasCount;
+    tlas->instanceCount = instanceCount;
+
+    Box3* bounds = (Box3*) malloc(TC_MAX(instanceCount, 1u) * sizeof(Box3));
+    ParallelFor(instanceCount, 4096, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            const Instance* instance = instances + i;
+            TC_ASSERT(instance->blas < blasCount, "Instance of a missing BVH");
+            TC_ASSERT(instance->transform.properties & TRANSFORM_PROPERTY_AFFINE, "Instance transform is projective");
+            bounds[i] = InstanceBounds(blases, instance);
+        }
+    });
+    BvhBuild(&tlas->bvh, bounds, 0, instanceCount, options, stats);
+    free(bounds);
+}
+
+void TlasFree(Tlas* tlas) {
+    BvhFree(&tlas->bvh);
+    *tlas = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Dynamic two-level acceleration structure
+
+static void ReserveNodes(DynamicTlas* tlas, U32 count) {
+    if (count <= tlas->nodeCapacity) {
+        return;
+    }
+    Bvh* bvh = &tlas->tlas.bvh;
+    U32 capacity = TC_MAX(count, 2 * tlas->nodeCapacity);
+    BvhNode* nodes = BvhAllocateNodes(capacity);
+    if (bvh->nodeCount > 0) {
+        memcpy(nodes, bvh->nodes, bvh->nodeCount * sizeof(BvhNode));
+    }
+    BvhFreeNodes(bvh->nodes);
+    bvh->nodes = nodes;
+    tlas->parents = (U32*) realloc(tlas->parents, capacity * sizeof(U32));
+    tlas->heights = (U32*) realloc(tlas->heights, capacity * sizeof(U32));
+    tlas->nodeCapacity = capacity;
+}
+
+// Leaves address instances through the identity map in bvh.indices, so a
+// leaf's offset is its instance handle
+static void ReserveInstances(DynamicTlas* tlas, U32 count) {
+    if (count <= tlas->instanceCapacity) {
+        return;
+    }
+    Bvh* bvh = &tlas->tlas.bvh;
+    U32 capacity = TC_MAX(count, 2 * tlas->instanceCapacity);
+    tlas->instances = (Instance*) realloc(tlas->instances, capacity * sizeof(Instance));
+    tlas->leaves = (U32*) realloc(tlas->leaves, capacity * sizeof(U32));
+    tlas->freeInstances = (U32*) realloc(tlas->freeInstances, capacity * sizeof(U32));
+    bvh->indices = (U32*) realloc(bvh->indices, capacity * sizeof(U32));
+    for (U32 i = tlas->instanceCapacity; i < capacity; ++i) {
+        tlas->leaves[i] = TC_U32_MAX;
+        bvh->indices[i] = i;
+    }
+    tlas->tlas.instances = tlas->instances;
+    tlas->instanceCapacity = capacity;
+}
+
+// Points whatever referred to the old slot of a moved node at its new slot
+static void Relink(DynamicTlas* tlas, U32 node) {
+    const BvhNode* moved = tlas->tlas.bvh.nodes + node;
+    if (moved->count == 0) {
+        tlas->parents[moved->offset] = node;
+        tlas->parents[moved->offset + 1] = node;
+    }
+    else {
+        tlas->leaves[moved->offset] = node;
+    }
+}
+
+static U32 AllocatePair(DynamicTlas* tlas) {
+    Bvh* bvh = &tlas->tlas.bvh;
+    if (tlas->freeNodes != TC_U32_MAX) {
+        U32 pair = tlas->freeNodes;
+        tlas->freeNodes = bvh->nodes[pair].offset;
+        return pair;
+    }
+    ReserveNodes(tlas, bvh->nodeCount + 2);
+    U32 pair = bvh->nodeCount;
+    bvh->nodeCount += 2;
+    return pair;
+}
+
+// Free pairs are single primitive leaves with empty boxes at the origin, so
+// passes over every node, like BvhSahCost, skip them without knowing
+static void FreePair(DynamicTlas* tlas, U32 pair) {
+    BvhNode* nodes = tlas->tlas.bvh.nodes;
+    nodes[pair] = {{}, tlas->freeNodes, 1};
+    nodes[pair + 1] = {{}, 0, 1};
+    tlas->parents[pair] = TC_U32_MAX;
+    tlas->parents[pair + 1] = TC_U32_MAX;
+    tlas->freeNodes = pair;
+}
+
+// Sibling heights may differ by this much. Strict AVL balance, one, blocks
+// too many of the rotations that lower the SAH cost.
+#define TC_DYNAMIC_TLAS_IMBALANCE 2
+
+static U32 ChildHeight(const DynamicTlas* tlas, U32 node) {
+    U32 first = tlas->tlas.bvh.nodes[node].offset;
+    return 1 + TC_MAX(tlas->heights[first], tlas->heights[first + 1]);
+}
+
+// Swaps a child of node with a grandchild under the other child. Children
+// whose heights differ by more than TC_DYNAMIC_TLAS_IMBALANCE are balanced
+// first: the shorter one swaps with the taller grandchild, as in the AVL
+// rotations of Box2D's dynamic tree. Otherwise a swap is taken when it
+// shrinks the other child, the only box that changes, and keeps both levels
+// balanced.
+static void Rotate(DynamicTlas* tlas, U32 node) {
+    BvhNode* nodes = tlas->tlas.bvh.nodes;
+    const U32* heights = tlas->heights;
+    U32 first = nodes[node].offset;
+    U32 from = 0, to = 0, middle = 0;
+    S32 imbalance = S32(heights[first + 1]) - S32(heights[first]);
+    if (imbalance > TC_DYNAMIC_TLAS_IMBALANCE || imbalance < -TC_DYNAMIC_TLAS_IMBALANCE) {
+        middle = first + (imbalance > 0);
+        from = 2 * first + 1 - middle;
+        U32 grandchild = nodes[middle].offset;
+        to = grandchild + (heights[grandchild + 1] > heights[grandchild]);
+    }
+    else {
+        F32 bestGain = 0;
+        for (U32 side = 0; side < 2; ++side) {
+            U32 child = first + side;
+            U32 other = first + 1 - side;
+            if (nodes[other].count > 0) {
+                continue;
+            }
+            U32 grandchild = nodes[other].offset;
+            F32 area = SurfaceArea(nodes[other].bounds);
+            for (U32 k = 0; k < 2; ++k) {
+                U32 kept = grandchild + 1 - k;
+                U32 moved = grandchild + k;
+                U32 middleHeight = 1 + TC_MAX(heights[child], heights[kept]);
+                if (TC_MAX(heights[child], heights[kept]) > TC_MIN(heights[child], heights[kept]) + TC_DYNAMIC_TLAS_IMBALANCE ||
+                    TC_MAX(heights[moved], middleHeight) > TC_MIN(heights[moved], middleHeight) + TC_DYNAMIC_TLAS_IMBALANCE) {
+                    continue;
+                }
+                F32 gain = area - SurfaceArea(Union(nodes[child].bounds, nodes[kept].bounds));
+                if (gain > bestGain) {
+                    bestGain = gain;
+                    from = child;
+                    to = moved;
+                    middle = other;
+                }
+            }
+        }
+        if (bestGain == 0) {
+            return;
+        }
+    }
+
+    BvhNode swapped = nodes[from];
+    nodes[from] = nodes[to];
+    nodes[to] = swapped;
+    U32 swappedHeight = tlas->heights[from];
+    tlas->heights[from] = tlas->heights[to];
+    tlas->heights[to] = swappedHeight;
+    Relink(tlas, from);
+    Relink(tlas, to);
+    U32 grandchild = nodes[middle].offset;
+    nodes[middle].bounds = Union(nodes[grandchild].bounds, nodes[grandchild + 1].bounds);
+    tlas->heights[middle] = ChildHeight(tlas, middle);
+}
+
+// Recomputes the boxes and heights from node up to the root, rotating on
+// the way
+static void Refit(DynamicTlas* tlas, U32 node) {
+    BvhNode* nodes = tlas->tlas.bvh.nodes;
+    while (node != TC_U32_MAX) {
+        Rotate(tlas, node);
+        U32 first = nodes[node].offset;
+        nodes[node].bounds = Union(nodes[first].bounds, nodes[first + 1].bounds);
+        tlas->heights[node] = ChildHeight(tlas, node);
+        node = tlas->parents[node];
+    }
+}
+
+// Walks down towards the cheaper child as long as that beats pairing the new
+// leaf with the node here. Pairing adds a parent with the combined area,
+// going down grows this node and at least the child's box, see Catto 2019.
+static U32 FindSibling(const Bvh* bvh, Box3 box) {
+    U32 sibling = 0;
+    while (bvh->nodes[sibling].count == 0) {
+        const BvhNode* node = bvh->nodes + sibling;
+        F32 here = SurfaceArea(Union(node->bounds, box));
+        F32 growth = here - SurfaceArea(node->bounds);
+        F32 costs[2];
+        for (U32 k = 0; k < 2; ++k) {
+            const BvhNode* child = bvh->nodes + node->offset + k;
+            costs[k] = growth + SurfaceArea(Union(child->bounds, box));
+            if (child->count == 0) {
+                costs[k] -= SurfaceArea(child->bounds);
+            }
+        }
+        if (here <= costs[0] && here <= costs[1]) {
+            break;
+        }
+        sibling = node->offset + (costs[1] < costs[0]);
+    }
+    return sibling;
+}
+
+static void InsertLeaf(DynamicTlas* tlas, U32 instance, Box3 box) {
+    Bvh* bvh = &tlas->tlas.bvh;
+    if (bvh->nodeCount == 0) {
+        ReserveNodes(tlas, 1);
+        bvh->nodes[0] = {box, instance, 1};
+        bvh->nodeCount = 1;
+        tlas->parents[0] = TC_U32_MAX;
+        tlas->heights[0] = 0;
+        tlas->leaves[instance] = 0;
+        return;
+    }
+
+    // The sibling's slot becomes the new parent, its contents move down into
+    // a new pair next to the new leaf
+    U32 sibling = FindSibling(bvh, box);
+    U32 pair = AllocatePair(tlas);
+    BvhNode* nodes = bvh->nodes;
+    nodes[pair] = nodes[sibling];
+    nodes[pair + 1] = {box, instance, 1};
+    tlas->heights[pair] = tlas->heights[sibling];
+    tlas->heights[pair + 1] = 0;
+    Relink(tlas, pair);
+    Relink(tlas, pair + 1);
+    tlas->parents[pair] = sibling;
+    tlas->parents[pair + 1] = sibling;
+    nodes[sibling] = {Union(nodes[pair].bounds, box), pair, 0};
+    Refit(tlas, sibling);
+}
+
+// The leaf's sibling moves up into the parent's slot and the pair is freed
+static void RemoveLeaf(DynamicTlas* tlas, U32 instance) {
+    Bvh* bvh = &tlas->tlas.bvh;
+    U32 leaf = tlas->leaves[instance];
+    tlas->leaves[instance] = TC_U32_MAX;
+    if (leaf == 0) {
+        bvh->nodeCount = 0;
+        tlas->freeNodes = TC_U32_MAX;
+        return;
+    }
+
+    U32 parent = tlas->parents[leaf];
+    U32 pair = bvh->nodes[parent].offset;
+    bvh->nodes[parent] = bvh->nodes[2 * pair + 1 - leaf];
+    tlas->heights[parent] = tlas->heights[2 * pair + 1 - leaf];
+    Relink(tlas, parent);
+    FreePair(tlas, pair);
+    Refit(tlas, tlas->parents[parent]);
+}
+
+static Box3 CheckedInstanceBounds(const DynamicTlas* tlas, const Instance* instance) {
+    TC_ASSERT(instance->blas < tlas->tlas.blasCount, "Instance of a missing BVH");
+    TC_ASSERT(instance->transform.properties & TRANSFORM_PROPERTY_AFFINE, "Instance transform is projective");
+    return InstanceBounds(tlas->tlas.blases, instance);
+}
+
+// Heights of a built tree, children before parents
+static void ComputeHeights(DynamicTlas* tlas) {
+    const Bvh* bvh = &tlas->tlas.bvh;
+    if (bvh->nodeCount == 0) {
+        return;
+    }
+    memset(tlas->heights, 0, bvh->nodeCount * sizeof(U32));
+    U32 stack[2 * TC_BVH_STACK_SIZE];
+    U32 stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        U32 node = stack[stackSize - 1];
+        U32 first = bvh->nodes[node].offset;
+        if (bvh->nodes[node].count > 0) {
+            tlas->heights[node] = 0;
+            stackSize--;
+        }
+        else if (tlas->heights[node] == TC_U32_MAX) {
+            tlas->heights[node] = ChildHeight(tlas, node);
+            stackSize--;
+        }
+        else {
+            // Visited once: children go first, then the node comes back
+            tlas->heights[node] = TC_U32_MAX;
+            TC_ASSERT(stackSize + 2 <= 2 * TC_BVH_STACK_SIZE);
+            stack[stackSize++] = first;
+            stack[stackSize++] = first + 1;
+        }
+    }
+}
+
+void DynamicTlasBuild(DynamicTlas* tlas, const Bvh* blases, U32 blasCount, const Instance* instances, U32 instanceCount, const BvhBuildOptions& options) {
+    *tlas = {};
+    BvhBuildOptions leafOptions = options;
+    leafOptions.maxLeafSize = 1;
+    TlasBuild(&tlas->tlas, blases, blasCount, instances, instanceCount, leafOptions);
+    tlas->freeNodes = TC_U32_MAX;
+    tlas->liveCount = instanceCount;
+
+    // The built tree's leaves point at their instance through bvh.indices,
+    // reserving resets those to the identity
+    Bvh* bvh = &tlas->tlas.bvh;
+    tlas->nodeCapacity = bvh->nodeCount;
+    tlas->parents = (U32*) malloc(TC_MAX(bvh->nodeCount, 1u) * sizeof(U32));
+    BvhParents(bvh, tlas->parents);
+    tlas->heights = (U32*) malloc(TC_MAX(bvh->nodeCount, 1u) * sizeof(U32));
+    ComputeHeights(tlas);
+    for (U32 i = 0; i < bvh->nodeCount; ++i) {
+        BvhNode* node = bvh->nodes + i;
+        if (node->count > 0) {
+            TC_ASSERT(node->count == 1);
+            node->offset = bvh->indices[node->offset];
+        }
+    }
+    free(bvh->indices);
+    bvh->indices = 0;
+    ReserveInstances(tlas, TC_MAX(instanceCount, 16u));
+    memcpy(tlas->instances, instances, instanceCount * sizeof(Instance));
+    for (U32 i = 0; i < bvh->nodeCount; ++i) {
+        if (bvh->nodes[i].count > 0) {
+            tlas->leaves[bvh->nodes[i].offset] = i;
+        }
+    }
+}
+
+void DynamicTlasFree(DynamicTlas* tlas) {
+    TlasFree(&tlas->tlas);
+    free(tlas->instances);
+    free(tlas->parents);
+    free(tlas->heights);
+    free(tlas->leaves);
+    free(tlas->freeInstances);
+    *tlas = {};
+}
+
+U32 DynamicTlasInsert(DynamicTlas* tlas, const Instance& instance) {
+    Box3 box = CheckedInstanceBounds(tlas, &instance);
+    U32 handle;
+    if (tlas->freeInstanceCount > 0) {
+        handle = tlas->freeInstances[--tlas->freeInstanceCount];
+    }
+    else {
+        ReserveInstances(tlas, tlas->tlas.instanceCount + 1);
+        handle = tlas->tlas.instanceCount++;
+        tlas->tlas.bvh.primitiveCount = tlas->tlas.instanceCount;
+        tlas->tlas.bvh.referenceCount = tlas->tlas.instanceCount;
+    }
+    tlas->instances[handle] = instance;
+    tlas->liveCount++;
+    InsertLeaf(tlas, handle, box);
+    return handle;
+}
+
+void DynamicTlasRemove(DynamicTlas* tlas, U32 instance) {
+    TC_ASSERT(instance < tlas->tlas.instanceCount && tlas->leaves[instance] != TC_U32_MAX, "Removing a missing instance");
+    RemoveLeaf(tlas, instance);
+    tlas->freeInstances[tlas->freeInstanceCount++] = instance;
+    tlas->liveCount--;
+}
+
+void DynamicTlasUpdate(DynamicTlas* tlas, U32 instance, const Transform& transform) {
+    TC_ASSERT(instance < tlas->tlas.instanceCount && tlas->leaves[instance] != TC_U32_MAX, "Moving a missing instance");
+    tlas->instances[instance].transform = transform;
+    Box3 box = CheckedInstanceBounds(tlas, tlas->instances + instance);
+
+    BvhNode* nodes = tlas->tlas.bvh.nodes;
+    U32 leaf = tlas->leaves[instance];
+    U32 parent = tlas->parents[leaf];
+    if (parent == TC_U32_MAX || (Inside(nodes[parent].bounds, box.min) && Inside(nodes[parent].bounds, box.max))) {
+        nodes[leaf].bounds = box;
+        Refit(tlas, parent);
+        return;
+    }
+    RemoveLeaf(tlas, instance);
+    InsertLeaf(tlas, instance, box);
+}
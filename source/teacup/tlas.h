@@ -0,0 +1,157 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_TLAS_HEADER_GUARD
+#define TC_TLAS_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/bvh.h>
+#include <teacup/transform.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Two-level acceleration structure
+
+// Places bottom level BVH blas in the world. The transform maps object space
+// to world space and must be affine.
+struct Instance {
+    Transform transform;
+    U32 blas;
+};
+
+// BVH over instances of shared bottom level BVHs. The structure only points
+// at the caller's bottom level BVHs and instances, which must outlive it, so
+// its size grows with the instance count and not with the primitives each
+// instance repeats.
+struct Tlas {
+    Bvh bvh;
+    const Bvh* blases;
+    const Instance* instances;
+    U32 blasCount;
+    U32 instanceCount;
+};
+
+// World space box of the root of the instance's bottom level BVH. Instances
+// of an empty BVH get an empty box at their origin.
+Box3 InstanceBounds(const Bvh* blases, const Instance* instance);
+
+// options and stats apply to the BVH over instances
+void TlasBuild(Tlas* tlas, const Bvh* blases, U32 blasCount, const Instance* instances, U32 instanceCount, const BvhBuildOptions& options = {}, BvhBuildStats* stats = 0);
+void TlasFree(Tlas* tlas);
+
+// Visits the primitives of every bottom level leaf the world space ray
+// reaches. intersector(instance, primitive, objectRay, &slab) gets the ray in
+// the instance's object space together with its slab, and may lower
+// slab.tMax on a hit. Object space keeps the unnormalized direction, so t
+// values and tMax carry over between instances and the world unchanged.
+template <typename F>
+void Traverse(const Tlas* tlas, Ray ray, F intersector) {
+    Traverse(&tlas->bvh, Precompute(ray), [&](U32 index, RaySlab* world) {
+        const Instance* instance = tlas->instances + index;
+        Ray objectRay = InverseTransformRay(instance->transform, Ray{ray.origin, ray.direction, world->tMin, world->tMax});
+        bool more = true;
+        Traverse(tlas->blases + instance->blas, Precompute(objectRay), [&](U32 primitive, RaySlab* slab) {
+            more = intersector(index, primitive, objectRay, slab);
+            world->tMax = slab->tMax;
+            return more;
+        });
+        return more;
+    });
+}
+
+// Whether anything in any instance blocks the world space ray, see
+// Occluded(const Bvh*). occluder(instance, primitive, objectRay, slab)
+// reports whether the primitive blocks the ray in the instance's object space.
+template <typename F>
+bool Occluded(const Tlas* tlas, Ray ray, F occluder) {
+    return Occluded(&tlas->bvh, Precompute(ray), [&](U32 index, const RaySlab&) {
+        const Instance* instance = tlas->instances + index;
+        Ray objectRay = InverseTransformRay(instance->transform, ray);
+        return Occluded(tlas->blases + instance->blas, Precompute(objectRay), [&](U32 primitive, const RaySlab& slab) {
+            return occluder(index, primitive, objectRay, slab);
+        });
+    });
+}
+
+// Batched Occluded(const Tlas*), with occluder(rayIndex, instance, primitive,
+// objectRay, slab)
+template <typename F>
+void Occluded(const Tlas* tlas, const Ray* rays, U32 count, bool* occluded, F occluder) {
+    ParallelFor(count, TC_OCCLUSION_BATCH_GRAIN, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            U32 rayIndex = U32(i);
+            occluded[i] = Occluded(tlas, rays[i], [&](U32 instance, U32 primitive, const Ray& objectRay, const RaySlab& slab) {
+                return occluder(rayIndex, instance, primitive, objectRay, slab);
+            });
+        }
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Dynamic two-level acceleration structure
+
+// Tlas for scenes edited between frames. Unlike Tlas it owns its instances,
+// keeps every instance alone in a leaf, and edits the BVH in place: an
+// insert, remove or move only touches the path from the instance's leaf to
+// the root, with tree rotations along the way that keep it balanced and hold
+// the SAH cost near that of a full build, see Kopta et al. 2012. tlas is
+// traversed like any Tlas, with instance handles as the instance indices.
+// Edits are not thread safe.
+struct DynamicTlas {
+    Tlas tlas;
+
+    // Owned copies, tlas.instances points here. Slots of removed instances
+    // are reused by later inserts.
+    Instance* instances;
+
+    // Parent of every node and leaf node of every instance slot, TC_U32_MAX
+    // for the root and free slots. Removed nodes leave holes in
+    // tlas.bvh.nodes, reachable only from the free list.
+    U32* parents;
+    U32* leaves;
+
+    // Height of the subtree under every node, leaves are 0. Rotations keep
+    // sibling heights close, so coincident or nested instances cannot pile
+    // up into a chain.
+    U32* heights;
+    U32* freeInstances;
+    U32 freeInstanceCount;
+    U32 freeNodes;
+    U32 nodeCapacity;
+    U32 instanceCapacity;
+    U32 liveCount;
+};
+
+// Starts from a full build over instances with options, whose maxLeafSize
+// is overridden to 1. Handles of these instances are their indices.
+void DynamicTlasBuild(DynamicTlas* tlas, const Bvh* blases, U32 blasCount, const Instance* instances, U32 instanceCount, const BvhBuildOptions& options = {});
+void DynamicTlasFree(DynamicTlas* tlas);
+
+// Returns the handle of the new instance
+U32 DynamicTlasInsert(DynamicTlas* tlas, const Instance& instance);
+void DynamicTlasRemove(DynamicTlas* tlas, U32 instance);
+
+// Moves an instance. Moves that stay inside the box of the leaf's parent
+// only refit the path to the root, others take the instance out and insert
+// it again where it now belongs.
+void DynamicTlasUpdate(DynamicTlas* tlas, U32 instance, const Transform& transform);
+
+#endif // TC_TLAS_HEADER_GUARD
@@ -0,0 +1,417 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/transform.h>
+#include <teacup/wide.h>
+#include <string.h>
+
+#if TC_SIMD_AVX2
+typedef F32x8 TransformLanes;
+#else
+typedef F32x4 TransformLanes;
+#endif
+
+#define TC_TRANSFORM_LANES TC_LANES(TransformLanes)
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernels
+
+enum TransformKind {
+    TRANSFORM_KIND_POINT,
+    TRANSFORM_KIND_PROJECTIVE_POINT,
+    TRANSFORM_KIND_VECTOR,
+};
+
+// Matrix coefficients broadcast across all lanes
+struct TransformCoefficients {
+    TransformLanes m[4][4];
+};
+
+static TransformCoefficients SplatCoefficients(Mat4 a) {
+    TransformCoefficients coefficients;
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            coefficients.m[r][c] = Splat<TransformLanes>(a.raw[r][c]);
+        }
+    }
+    return coefficients;
+}
+
+// Same operations in the same order as TransformPoint and TransformVector.
+// Lanes whose w is exactly one are multiplied by one, leaving them unchanged
+// just as the scalar early out does.
+template <TransformKind KIND>
+static inline Vec3Packet<TransformLanes> TransformPacket(const TransformCoefficients& a, Vec3Packet<TransformLanes> b) {
+    TransformLanes x = a.m[0][0]*b.x + a.m[0][1]*b.y + a.m[0][2]*b.z;
+    TransformLanes y = a.m[1][0]*b.x + a.m[1][1]*b.y + a.m[1][2]*b.z;
+    TransformLanes z = a.m[2][0]*b.x + a.m[2][1]*b.y + a.m[2][2]*b.z;
+
+    if (KIND != TRANSFORM_KIND_VECTOR) {
+        x = x + a.m[0][3];
+        y = y + a.m[1][3];
+        z = z + a.m[2][3];
+    }
+
+    if (KIND == TRANSFORM_KIND_PROJECTIVE_POINT) {
+        TransformLanes w = a.m[3][0]*b.x + a.m[3][1]*b.y + a.m[3][2]*b.z + a.m[3][3];
+        TransformLanes inv = Splat<TransformLanes>(1.0f) / w;
+        x = x * inv;
+        y = y * inv;
+        z = z * inv;
+    }
+
+    return {x, y, z};
+}
+
+template <TransformKind KIND>
+static inline Vec3 TransformScalar(Mat4 a, Vec3 b) {
+    return KIND == TRANSFORM_KIND_VECTOR ? TransformVector(a, b) : TransformPoint(a, b);
+}
+
+static inline void Stream(F32* a, F32x4 b) {
+    F32x4Stream(a, b);
+}
+
+static inline void Stream(F32* a, F32x8 b) {
+    F32x4Stream(a, Low(b));
+    F32x4Stream(a + 4, High(b));
+}
+
+// Same shuffles as Scatter, finishing with non-temporal stores
+static inline void ScatterStream(Vec3* a, Vec3x4 b) {
+    F32* raw = a[0].raw;
+    F32x4 m0 = Shuffle<0, 2, 0, 2>(Shuffle<0, 0, 0, 0>(b.x, b.y), Shuffle<0, 0, 1, 1>(b.z, b.x));
+    F32x4 m1 = Shuffle<0, 2, 0, 2>(Shuffle<1, 1, 1, 1>(b.y, b.z), Shuffle<2, 2, 2, 2>(b.x, b.y));
+    F32x4 m2 = Shuffle<0, 2, 0, 2>(Shuffle<2, 2, 3, 3>(b.z, b.x), Shuffle<3, 3, 3, 3>(b.y, b.z));
+    F32x4Stream(raw, m0);
+    F32x4Stream(raw + 4, m1);
+    F32x4Stream(raw + 8, m2);
+}
+
+static inline void ScatterStream(Vec3* a, Vec3x8 b) {
+    ScatterStream(a, Vec3x4{Low(b.x), Low(b.y), Low(b.z)});
+    ScatterStream(a + 4, Vec3x4{High(b.x), High(b.y), High(b.z)});
+}
+
+static inline bool IsAligned(const void* a) {
+    return (uintptr_t(a) & 15) == 0;
+}
+
+template <TransformKind KIND>
+static void TransformAos(Mat4 a, const Vec3* in, Vec3* out, U64 count, U32 flags) {
+    bool stream = (flags & TRANSFORM_FLAGS_STREAM) != 0;
+    U64 i = 0;
+
+    // A Vec3 is 12 bytes, so at most three elements are needed before out is
+    // 16 byte aligned. Every packet after that stays aligned.
+    if (stream) {
+        for (; i < count && !IsAligned(out + i); ++i) {
+            out[i] = TransformScalar<KIND>(a, in[i]);
+        }
+    }
+
+    TransformCoefficients coefficients = SplatCoefficients(a);
+    for (; i + TC_TRANSFORM_LANES <= count; i += TC_TRANSFORM_LANES) {
+        Vec3Packet<TransformLanes> p = TransformPacket<KIND>(coefficients, Gather<TransformLanes>(in + i));
+        if (stream) {
+            ScatterStream(out + i, p);
+        }
+        else {
+            Scatter(out + i, p);
+        }
+    }
+
+    if (stream) {
+        StreamFence();
+    }
+
+    for (; i < count; ++i) {
+        out[i] = TransformScalar<KIND>(a, in[i]);
+    }
+}
+
+template <TransformKind KIND>
+static void TransformSoa(Mat4 a, Vec3Soa in, Vec3Soa out, U64 count, U32 flags) {
+    bool stream = (flags & TRANSFORM_FLAGS_STREAM) != 0;
+    U64 i = 0;
+
+    // Streaming needs all three output arrays aligned at the same element,
+    // otherwise fall back to regular stores
+    if (stream) {
+        for (; i < count && !IsAligned(out.x + i); ++i) {
+            Vec3 v = TransformScalar<KIND>(a, Vec3{in.x[i], in.y[i], in.z[i]});
+            out.x[i] = v.x;
+            out.y[i] = v.y;
+            out.z[i] = v.z;
+        }
+        stream = IsAligned(out.y + i) && IsAligned(out.z + i);
+    }
+
+    TransformCoefficients coefficients = SplatCoefficients(a);
+    for (; i + TC_TRANSFORM_LANES <= count; i += TC_TRANSFORM_LANES) {
+        Vec3Packet<TransformLanes> p = {Load<TransformLanes>(in.x + i), Load<TransformLanes>(in.y + i), Load<TransformLanes>(in.z + i)};
+        p = TransformPacket<KIND>(coefficients, p);
+        if (stream) {
+            Stream(out.x + i, p.x);
+            Stream(out.y + i, p.y);
+            Stream(out.z + i, p.z);
+        }
+        else {
+            Store(out.x + i, p.x);
+            Store(out.y + i, p.y);
+            Store(out.z + i, p.z);
+        }
+    }
+
+    if (stream) {
+        StreamFence();
+    }
+
+    for (; i < count; ++i) {
+        Vec3 v = TransformScalar<KIND>(a, Vec3{in.x[i], in.y[i], in.z[i]});
+        out.x[i] = v.x;
+        out.y[i] = v.y;
+        out.z[i] = v.z;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Batched transforms
+
+void TransformPoints(Mat4 a, const Vec3* in, Vec3* out, U64 count, U32 flags) {
+    if (IsAffine(a)) {
+        TransformAos<TRANSFORM_KIND_POINT>(a, in, out, count, flags);
+    }
+    else {
+        TransformAos<TRANSFORM_KIND_PROJECTIVE_POINT>(a, in, out, count, flags);
+    }
+}
+
+void TransformVectors(Mat4 a, const Vec3* in, Vec3* out, U64 count, U32 flags) {
+    TransformAos<TRANSFORM_KIND_VECTOR>(a, in, out, count, flags);
+}
+
+void TransformNormals(Mat4 inverse, const Vec3* in, Vec3* out, U64 count, U32 flags) {
+    TransformAos<TRANSFORM_KIND_VECTOR>(Transpose(inverse), in, out, count, flags);
+}
+
+void TransformPoints(Mat4 a, Vec3Soa in, Vec3Soa out, U64 count, U32 flags) {
+    if (IsAffine(a)) {
+        TransformSoa<TRANSFORM_KIND_POINT>(a, in, out, count, flags);
+    }
+    else {
+        TransformSoa<TRANSFORM_KIND_PROJECTIVE_POINT>(a, in, out, count, flags);
+    }
+}
+
+void TransformVectors(Mat4 a, Vec3Soa in, Vec3Soa out, U64 count, U32 flags) {
+    TransformSoa<TRANSFORM_KIND_VECTOR>(a, in, out, count, flags);
+}
+
+void TransformNormals(Mat4 inverse, Vec3Soa in, Vec3Soa out, U64 count, U32 flags) {
+    TransformSoa<TRANSFORM_KIND_VECTOR>(Transpose(inverse), in, out, count, flags);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Transform
+
+#define TC_TRANSFORM_TOLERANCE 1e-5f
+
+static bool NearlyEqual(F32 a, F32 b, F32 scale) {
+    return Abs(a - b) <= TC_TRANSFORM_TOLERANCE * scale;
+}
+
+U32 TransformPropertiesOf(Mat4 a) {
+    U32 properties = TRANSFORM_PROPERTY_NONE;
+    if (!IsAffine(a)) {
+        return properties;
+    }
+    properties |= TRANSFORM_PROPERTY_AFFINE;
+
+    // The upper 3x3 is s * R exactly when its columns are orthogonal and share
+    // a length, i.e. M^T * M = s^2 * I
+    F32 gram[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            gram[i][j] = a.raw[0][i]*a.raw[0][j] + a.raw[1][i]*a.raw[1][j] + a.raw[2][i]*a.raw[2][j];
+        }
+    }
+    F32 scaleSquared = gram[0][0];
+    bool uniform = scaleSquared > 0.0f;
+    for (int i = 0; i < 3 && uniform; ++i) {
+        for (int j = 0; j < 3 && uniform; ++j) {
+            uniform = NearlyEqual(gram[i][j], i == j ? scaleSquared : 0.0f, scaleSquared);
+        }
+    }
+
+    // Reflections have a negative determinant and are not rotations
+    F32 determinant = Dot(Vec3{a.raw[0][0], a.raw[0][1], a.raw[0][2]},
+                          Cross(Vec3{a.raw[1][0], a.raw[1][1], a.raw[1][2]}, Vec3{a.raw[2][0], a.raw[2][1], a.raw[2][2]}));
+    if (uniform && determinant > 0.0f) {
+        properties |= TRANSFORM_PROPERTY_UNIFORM_SCALE;
+        if (NearlyEqual(scaleSquared, 1.0f, 1.0f)) {
+            properties |= TRANSFORM_PROPERTY_RIGID;
+        }
+    }
+
+    Mat4 identity = Mat4Identity();
+    if (memcmp(&a, &identity, sizeof(Mat4)) == 0) {
+        properties |= TRANSFORM_PROPERTY_IDENTITY;
+    }
+    return properties;
+}
+
+// Rigid inverses are the transposed rotation with the translation rotated
+// back, no division needed
+static Mat4 InverseRigid(Mat4 a) {
+    Mat4 mat = Mat4Identity();
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            mat.raw[r][c] = a.raw[c][r];
+        }
+        mat.raw[r][3] = -(a.raw[0][r]*a.raw[0][3] + a.raw[1][r]*a.raw[1][3] + a.raw[2][r]*a.raw[2][3]);
+    }
+    return mat;
+}
+
+Transform TransformFromMatrix(Mat4 a) {
+    Transform transform = {a, Mat4Identity(), TransformPropertiesOf(a)};
+    if (transform.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return transform;
+    }
+    if (transform.properties & TRANSFORM_PROPERTY_RIGID) {
+        transform.inverse = InverseRigid(a);
+    }
+    else if (transform.properties & TRANSFORM_PROPERTY_AFFINE) {
+        transform.inverse = InverseAffine(a);
+    }
+    else {
+        transform.inverse = Inverse(a);
+    }
+    return transform;
+}
+
+TransformAffine Compact(Transform a) {
+    TC_ASSERT(a.properties & TRANSFORM_PROPERTY_AFFINE, "Compact transforms must be affine");
+    TransformAffine affine;
+    memcpy(affine.matrix, a.matrix.raw, sizeof(affine.matrix));
+    memcpy(affine.inverse, a.inverse.raw, sizeof(affine.inverse));
+    affine.properties = a.properties;
+    return affine;
+}
+
+Transform Expand(TransformAffine a) {
+    Transform transform = {Mat4Identity(), Mat4Identity(), a.properties};
+    memcpy(transform.matrix.raw, a.matrix, sizeof(a.matrix));
+    memcpy(transform.inverse.raw, a.inverse, sizeof(a.inverse));
+    return transform;
+}
+
+// Each output axis is the translation plus, per input axis, the smaller and
+// larger of the two scaled extents, see Arvo in Graphics Gems
+Box3 TransformBox(Transform a, Box3 b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+
+    if (!(a.properties & TRANSFORM_PROPERTY_AFFINE)) {
+        Box3 box = {{F32Infinity(), F32Infinity(), F32Infinity()}, {F32NegInfinity(), F32NegInfinity(), F32NegInfinity()}};
+        for (int i = 0; i < 8; ++i) {
+            Vec3 corner = {(i & 1) ? b.max.x : b.min.x, (i & 2) ? b.max.y : b.min.y, (i & 4) ? b.max.z : b.min.z};
+            box = Union(box, TransformPoint(a.matrix, corner));
+        }
+        return box;
+    }
+
+    Box3 box;
+    for (int r = 0; r < 3; ++r) {
+        F32 min = a.matrix.raw[r][3];
+        F32 max = a.matrix.raw[r][3];
+        for (int c = 0; c < 3; ++c) {
+            F32 e = a.matrix.raw[r][c] * b.min.raw[c];
+            F32 f = a.matrix.raw[r][c] * b.max.raw[c];
+            min += TC_MIN(e, f);
+            max += TC_MAX(e, f);
+        }
+        box.min.raw[r] = min;
+        box.max.raw[r] = max;
+    }
+    return box;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Transform interpolation
+
+#define TC_POLAR_ITERATIONS 64
+
+// Averages the rotation estimate with its inverse transpose until it stops
+// changing, which converges to the orthonormal factor of a, see Higham 1986
+TransformDecomposition Decompose(Mat4 a) {
+    TC_ASSERT(IsAffine(a), "Only affine transforms decompose");
+    TransformDecomposition decomposition;
+    decomposition.translation = {a.raw[0][3], a.raw[1][3], a.raw[2][3]};
+
+    Mat4 linear = a;
+    linear.raw[0][3] = 0;
+    linear.raw[1][3] = 0;
+    linear.raw[2][3] = 0;
+
+    Mat4 rotation = linear;
+    for (int i = 0; i < TC_POLAR_ITERATIONS; ++i) {
+        Mat4 next = (rotation + Transpose(InverseAffine(rotation))) * 0.5f;
+        F32 change = 0;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                change = TC_MAX(change, Abs(next.raw[r][c] - rotation.raw[r][c]));
+            }
+        }
+        rotation = next;
+        if (change <= TC_TRANSFORM_TOLERANCE) {
+            break;
+        }
+    }
+    rotation.raw[3][3] = 1;
+
+    F32 determinant = Dot(Vec3{rotation.raw[0][0], rotation.raw[0][1], rotation.raw[0][2]},
+                          Cross(Vec3{rotation.raw[1][0], rotation.raw[1][1], rotation.raw[1][2]}, Vec3{rotation.raw[2][0], rotation.raw[2][1], rotation.raw[2][2]}));
+    if (determinant < 0.0f) {
+        rotation = rotation * -1.0f;
+        rotation.raw[3][3] = 1;
+    }
+
+    // R is orthonormal, so S = R^T * M
+    decomposition.rotation = QuatFromMat4(rotation);
+    decomposition.stretch = Transpose(rotation) * linear;
+    return decomposition;
+}
+
+Mat4 Recompose(const TransformDecomposition& a) {
+    Mat4 mat = Mat4FromQuat(a.rotation) * a.stretch;
+    mat.raw[0][3] = a.translation.x;
+    mat.raw[1][3] = a.translation.y;
+    mat.raw[2][3] = a.translation.z;
+    return mat;
+}
+
+TransformDecomposition Interpolate(const TransformDecomposition& a, const TransformDecomposition& b, F32 t) {
+    return {Lerp(a.translation, b.translation, t), Slerp(a.rotation, b.rotation, t), a.stretch * (1.0f - t) + b.stretch * t};
+}
@@ -0,0 +1,253 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_TRANSFORM_HEADER_GUARD
+#define TC_TRANSFORM_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+#include <teacup/ray.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Batched transforms
+
+// Structure of arrays view over count Vec3s
+struct Vec3Soa {
+    F32* x;
+    F32* y;
+    F32* z;
+};
+
+enum TransformFlags : U32 {
+    TRANSFORM_FLAGS_NONE = 0,
+
+    // Write results with non-temporal stores that bypass the caches. Use for
+    // outputs much larger than the last level cache that are not read again
+    // soon, e.g. when baking instance transforms into large meshes.
+    TRANSFORM_FLAGS_STREAM = 1 << 0,
+};
+
+// Each function applies the matrix to count elements of in and writes them to
+// out. in and out may be the same array for an in-place transform but must
+// not otherwise overlap. Results are bit-identical to calling TransformPoint,
+// TransformVector and TransformNormal on every element.
+
+void TransformPoints(Mat4 a, const Vec3* in, Vec3* out, U64 count, U32 flags = TRANSFORM_FLAGS_NONE);
+void TransformVectors(Mat4 a, const Vec3* in, Vec3* out, U64 count, U32 flags = TRANSFORM_FLAGS_NONE);
+void TransformNormals(Mat4 inverse, const Vec3* in, Vec3* out, U64 count, U32 flags = TRANSFORM_FLAGS_NONE);
+
+void TransformPoints(Mat4 a, Vec3Soa in, Vec3Soa out, U64 count, U32 flags = TRANSFORM_FLAGS_NONE);
+void TransformVectors(Mat4 a, Vec3Soa in, Vec3Soa out, U64 count, U32 flags = TRANSFORM_FLAGS_NONE);
+void TransformNormals(Mat4 inverse, Vec3Soa in, Vec3Soa out, U64 count, U32 flags = TRANSFORM_FLAGS_NONE);
+
+////////////////////////////////////////////////////////////////////////////////
+// Transform
+
+enum TransformProperties : U32 {
+    TRANSFORM_PROPERTY_NONE = 0,
+
+    // Exactly the identity matrix
+    TRANSFORM_PROPERTY_IDENTITY = 1 << 0,
+
+    // Last row is (0, 0, 0, 1), so points never need the divide by w
+    TRANSFORM_PROPERTY_AFFINE = 1 << 1,
+
+    // Affine with an upper 3x3 of the form s * R for a rotation R. Normals
+    // keep their direction under the matrix itself.
+    TRANSFORM_PROPERTY_UNIFORM_SCALE = 1 << 2,
+
+    // Uniform scale with s = 1, i.e. rotation and translation only. Lengths
+    // are preserved and the inverse is the transpose.
+    TRANSFORM_PROPERTY_RIGID = 1 << 3,
+};
+
+// A matrix with its inverse and properties computed once. Apply functions
+// skip work the properties make unnecessary.
+struct Transform {
+    Mat4 matrix;
+    Mat4 inverse;
+    U32 properties;
+};
+
+// Compact storage for affine transforms, keeping the top three rows of the
+// matrix and its inverse. Use for large instance arrays and expand to a
+// Transform when the full matrices are needed.
+struct TransformAffine {
+    F32 matrix[3][4];
+    F32 inverse[3][4];
+    U32 properties;
+};
+
+// Traps on a singular matrix
+Transform TransformFromMatrix(Mat4 a);
+U32 TransformPropertiesOf(Mat4 a);
+
+constexpr Transform TransformIdentity() {
+    return {Mat4Identity(), Mat4Identity(), TRANSFORM_PROPERTY_IDENTITY | TRANSFORM_PROPERTY_AFFINE | TRANSFORM_PROPERTY_UNIFORM_SCALE | TRANSFORM_PROPERTY_RIGID};
+}
+
+constexpr Transform Inverse(Transform a) {
+    return {a.inverse, a.matrix, a.properties};
+}
+
+// Applies b first and then a. Properties shared by both survive.
+inline Transform operator*(Transform a, Transform b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    if (b.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return a;
+    }
+    return {a.matrix * b.matrix, b.inverse * a.inverse, a.properties & b.properties};
+}
+
+TransformAffine Compact(Transform a);
+Transform Expand(TransformAffine a);
+
+// Apply functions for the top three rows of an affine matrix, which skip the
+// bottom row and the divide by w
+constexpr Vec3 TransformPoint(const F32 (&a)[3][4], Vec3 b) {
+    F32 x = a[0][0]*b.x + a[0][1]*b.y + a[0][2]*b.z + a[0][3];
+    F32 y = a[1][0]*b.x + a[1][1]*b.y + a[1][2]*b.z + a[1][3];
+    F32 z = a[2][0]*b.x + a[2][1]*b.y + a[2][2]*b.z + a[2][3];
+    return {x, y, z};
+}
+
+constexpr Vec3 TransformVector(const F32 (&a)[3][4], Vec3 b) {
+    F32 x = a[0][0]*b.x + a[0][1]*b.y + a[0][2]*b.z;
+    F32 y = a[1][0]*b.x + a[1][1]*b.y + a[1][2]*b.z;
+    F32 z = a[2][0]*b.x + a[2][1]*b.y + a[2][2]*b.z;
+    return {x, y, z};
+}
+
+constexpr Vec3 TransformNormal(const F32 (&inverse)[3][4], Vec3 b) {
+    F32 x = inverse[0][0]*b.x + inverse[1][0]*b.y + inverse[2][0]*b.z;
+    F32 y = inverse[0][1]*b.x + inverse[1][1]*b.y + inverse[2][1]*b.z;
+    F32 z = inverse[0][2]*b.x + inverse[1][2]*b.y + inverse[2][2]*b.z;
+    return {x, y, z};
+}
+
+// Top three rows of a matrix, for the functions above
+inline const F32 (&AffineRows(const Mat4& a))[3][4] {
+    return reinterpret_cast<const F32 (&)[3][4]>(a.raw);
+}
+
+inline Vec3 TransformPoint(Transform a, Vec3 b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    if (a.properties & TRANSFORM_PROPERTY_AFFINE) {
+        return TransformPoint(AffineRows(a.matrix), b);
+    }
+    return TransformPoint(a.matrix, b);
+}
+
+inline Vec3 TransformVector(Transform a, Vec3 b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    return TransformVector(a.matrix, b);
+}
+
+// Uniform scale transforms s * R have the inverse transpose R / s, so normals
+// go through the matrix itself. They come out parallel to the inverse
+// transpose result but s * s times as long, and unchanged in length for rigid
+// transforms.
+inline Vec3 TransformNormal(Transform a, Vec3 b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    if (a.properties & TRANSFORM_PROPERTY_UNIFORM_SCALE) {
+        return TransformVector(a.matrix, b);
+    }
+    return TransformNormal(a.inverse, b);
+}
+
+// Maps a world space ray into the space the transform maps from. The
+// direction is not renormalized so t values stay valid in both spaces.
+inline Ray InverseTransformRay(Transform a, Ray b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    Vec3 origin = a.properties & TRANSFORM_PROPERTY_AFFINE ? TransformPoint(AffineRows(a.inverse), b.origin) : TransformPoint(a.inverse, b.origin);
+    return {origin, TransformVector(a.inverse, b.direction), b.tMin, b.tMax};
+}
+
+// Box enclosing the transformed box, exact for affine transforms. Projective
+// ones transform all eight corners.
+Box3 TransformBox(Transform a, Box3 b);
+
+////////////////////////////////////////////////////////////////////////////////
+// Transform interpolation
+
+// Affine matrix split as translation * rotation * stretch by polar
+// decomposition. The stretch is symmetric and holds scale and shear, negated
+// together with the rotation for reflections so the rotation stays proper.
+// Interpolating the parts keeps rotating objects rigid where lerping the
+// matrices would shrink them halfway through a turn.
+struct TransformDecomposition {
+    Vec3 translation;
+    Quat rotation;
+    Mat4 stretch;
+};
+
+// Traps on projective or singular matrices
+TransformDecomposition Decompose(Mat4 a);
+Mat4 Recompose(const TransformDecomposition& a);
+
+// Lerps translation and stretch and slerps rotation
+TransformDecomposition Interpolate(const TransformDecomposition& a, const TransformDecomposition& b, F32 t);
+
+// Same results as the Transform versions of the expanded transform
+
+inline Vec3 TransformPoint(const TransformAffine& a, Vec3 b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    return TransformPoint(a.matrix, b);
+}
+
+inline Vec3 TransformVector(const TransformAffine& a, Vec3 b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    return TransformVector(a.matrix, b);
+}
+
+inline Vec3 TransformNormal(const TransformAffine& a, Vec3 b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    if (a.properties & TRANSFORM_PROPERTY_UNIFORM_SCALE) {
+        return TransformVector(a.matrix, b);
+    }
+    return TransformNormal(a.inverse, b);
+}
+
+inline Ray InverseTransformRay(const TransformAffine& a, Ray b) {
+    if (a.properties & TRANSFORM_PROPERTY_IDENTITY) {
+        return b;
+    }
+    return {TransformPoint(a.inverse, b.origin), TransformVector(a.inverse, b.direction), b.tMin, b.tMax};
+}
+
+#endif // TC_TRANSFORM_HEADER_GUARD
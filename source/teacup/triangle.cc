@@ -0,0 +1,87 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <teacup/triangle.h>
+#include <stdlib.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Triangle BVH
+
+template <int N>
+void TriangleBvhBuild(TriangleBvh<N>* bvh, const Vec3* positions, const U32* triangles, U32 count, const BvhBuildOptions& options, BvhBuildStats* stats) {
+    *bvh = {};
+    BvhBuildTriangles(&bvh->bvh, positions, triangles, count, options, stats);
+
+    BvhNode* nodes = bvh->bvh.nodes;
+    U32 packCount = 0;
+    for (U32 i = 0; i < bvh->bvh.nodeCount; ++i) {
+        packCount += (nodes[i].count + N - 1) / N;
+    }
+    bvh->packs = (TrianglePack<N>*) malloc(TC_MAX(packCount, 1u) * sizeof(TrianglePack<N>));
+    bvh->packCount = packCount;
+
+    U32* packIndices = (U32*) malloc(TC_MAX(packCount, 1u) * sizeof(U32));
+    U32 pack = 0;
+    for (U32 i = 0; i < bvh->bvh.nodeCount; ++i) {
+        BvhNode* node = nodes + i;
+        if (node->count == 0) {
+            continue;
+        }
+
+        const U32* references = bvh->bvh.indices + node->offset;
+        U32 leafPacks = (node->count + N - 1) / N;
+        for (U32 p = 0; p < leafPacks; ++p) {
+            TrianglePack<N>* target = bvh->packs + pack + p;
+            for (U32 lane = 0; lane < U32(N); ++lane) {
+                U32 slot = p * N + lane;
+                U32 primitive = references[slot < node->count ? slot : 0];
+                for (U32 k = 0; k < 3; ++k) {
+                    U32 vertex = triangles ? triangles[3 * primitive + k] : 3 * primitive + k;
+                    target->corners[k][0][lane] = positions[vertex].x;
+                    target->corners[k][1][lane] = positions[vertex].y;
+                    target->corners[k][2][lane] = positions[vertex].z;
+                }
+                target->primitive[lane] = primitive;
+            }
+            packIndices[pack + p] = pack + p;
+        }
+        node->offset = pack;
+        node->count = leafPacks;
+        pack += leafPacks;
+    }
+
+    free(bvh->bvh.indices);
+    bvh->bvh.indices = packIndices;
+    bvh->bvh.referenceCount = packCount;
+}
+
+template <int N>
+void TriangleBvhFree(TriangleBvh<N>* bvh) {
+    BvhFree(&bvh->bvh);
+    free(bvh->packs);
+    *bvh = {};
+}
+
+template void TriangleBvhBuild<4>(TriangleBvh<4>* bvh, const Vec3* positions, const U32* triangles, U32 count, const BvhBuildOptions& options, BvhBuildStats* stats);
+template void TriangleBvhBuild<8>(TriangleBvh<8>* bvh, const Vec3* positions, const U32* triangles, U32 count, const BvhBuildOptions& options, BvhBuildStats* stats);
+template void TriangleBvhFree<4>(TriangleBvh<4>* bvh);
+template void TriangleBvhFree<8>(TriangleBvh<8>* bvh);
@@ -0,0 +1,298 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_TRIANGLE_HEADER_GUARD
+#define TC_TRIANGLE_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+#include <teacup/bvh.h>
+#include <teacup/kernels.h>
+#include <teacup/ray.h>
+#include <teacup/wide.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Watertight ray triangle intersection
+
+// Per-ray values of the watertight test of Woop et al. 2013. Axes are
+// permuted so kz is the largest direction component, and triangles are
+// sheared so the ray runs along +z through the origin. The test then reduces
+// to the signs of three 2D edge functions, and a triangle sharing an edge
+// evaluates it from the same sheared corners with the opposite sign, so a ray
+// never slips between two triangles. origin is stored in permuted order.
+struct RayShear {
+    Vec3 origin;
+    U32 kx, ky, kz;
+    F32 sx, sy, sz;
+    F32 tMin;
+    F32 tMax;
+};
+
+// u and v weight the second and third corner, 1 - u - v the first
+struct TriangleHit {
+    F32 t;
+    F32 u;
+    F32 v;
+    U32 primitive;
+};
+
+inline RayShear PrecomputeShear(Ray ray) {
+    Vec3 d = ray.direction;
+    F32 x = Abs(d.x), y = Abs(d.y), z = Abs(d.z);
+    U32 kz = x > y ? (x > z ? 0 : 2) : (y > z ? 1 : 2);
+    U32 kx = kz == 2 ? 0 : kz + 1;
+    U32 ky = kx == 2 ? 0 : kx + 1;
+
+    // Swapping x and y keeps the winding of the edge functions when the ray
+    // points down the z axis
+    if (d.raw[kz] < 0.0f) {
+        U32 swap = kx;
+        kx = ky;
+        ky = swap;
+    }
+
+    RayShear shear = {};
+    shear.origin = {ray.origin.raw[kx], ray.origin.raw[ky], ray.origin.raw[kz]};
+    shear.kx = kx;
+    shear.ky = ky;
+    shear.kz = kz;
+    shear.sx = d.raw[kx] / d.raw[kz];
+    shear.sy = d.raw[ky] / d.raw[kz];
+    shear.sz = 1.0f / d.raw[kz];
+    shear.tMin = ray.tMin;
+    shear.tMax = ray.tMax;
+    return shear;
+}
+
+// Recomputes every lane that has an edge function of exactly zero in double
+// precision. Products of two floats are exact in doubles, so the sign comes
+// out right for rays passing through an edge or a corner.
+template <typename T>
+inline void ShearEdgesExact(T ax, T ay, T bx, T by, T cx, T cy, T* u, T* v, T* w) {
+    F32 raw[9][TC_LANES(T)];
+    Store(raw[0], ax);
+    Store(raw[1], ay);
+    Store(raw[2], bx);
+    Store(raw[3], by);
+    Store(raw[4], cx);
+    Store(raw[5], cy);
+    Store(raw[6], *u);
+    Store(raw[7], *v);
+    Store(raw[8], *w);
+    for (int i = 0; i < TC_LANES(T); ++i) {
+        if (raw[6][i] == 0.0f || raw[7][i] == 0.0f || raw[8][i] == 0.0f) {
+            F64 x[3] = {raw[0][i], raw[2][i], raw[4][i]};
+            F64 y[3] = {raw[1][i], raw[3][i], raw[5][i]};
+            raw[6][i] = F32(x[2] * y[1] - y[2] * x[1]);
+            raw[7][i] = F32(x[0] * y[2] - y[0] * x[2]);
+            raw[8][i] = F32(x[1] * y[0] - y[1] * x[0]);
+        }
+    }
+    *u = Load<T>(raw[6]);
+    *v = Load<T>(raw[7]);
+    *w = Load<T>(raw[8]);
+}
+
+// Tests the ray against one triangle per lane of T, with corners a, b and c
+// given in the permuted axes of the ray. Every lane runs the same operations
+// in the same order, so scalar and wide tests agree bit for bit. Returns the
+// lanes hit within [tMin, tMax], from either side.
+template <typename T>
+inline auto IntersectPermuted(const RayShear& ray, Vec3Packet<T> a, Vec3Packet<T> b, Vec3Packet<T> c, T* t, T* u, T* v) {
+    Vec3Packet<T> origin = Splat<T>(ray.origin);
+    a = a - origin;
+    b = b - origin;
+    c = c - origin;
+
+    T sx = Splat<T>(ray.sx);
+    T sy = Splat<T>(ray.sy);
+    T ax = a.x - sx * a.z;
+    T ay = a.y - sy * a.z;
+    T bx = b.x - sx * b.z;
+    T by = b.y - sy * b.z;
+    T cx = c.x - sx * c.z;
+    T cy = c.y - sy * c.z;
+
+    T zero = Splat<T>(0.0f);
+    T edgeU = cx * by - cy * bx;
+    T edgeV = ax * cy - ay * cx;
+    T edgeW = bx * ay - by * ax;
+    if (Any((edgeU == zero) | (edgeV == zero) | (edgeW == zero))) {
+        ShearEdgesExact(ax, ay, bx, by, cx, cy, &edgeU, &edgeV, &edgeW);
+    }
+
+    auto negative = (edgeU < zero) | (edgeV < zero) | (edgeW < zero);
+    auto positive = (edgeU > zero) | (edgeV > zero) | (edgeW > zero);
+    T det = edgeU + edgeV + edgeW;
+
+    T sz = Splat<T>(ray.sz);
+    T scaled = edgeU * (sz * a.z) + edgeV * (sz * b.z) + edgeW * (sz * c.z);
+    T inverse = Splat<T>(1.0f) / det;
+    *t = scaled * inverse;
+    *u = edgeV * inverse;
+    *v = edgeW * inverse;
+    auto inside = !(negative & positive);
+    return inside & (det != zero) & (*t >= Splat<T>(ray.tMin)) & (*t <= Splat<T>(ray.tMax));
+}
+
+// Scalar test, for single triangles and as a reference for the packs
+inline bool Intersect(const RayShear& ray, const Triangle& triangle, TriangleHit* hit) {
+    Vec3Packet<F32> a = {triangle.v0.raw[ray.kx], triangle.v0.raw[ray.ky], triangle.v0.raw[ray.kz]};
+    Vec3Packet<F32> b = {triangle.v1.raw[ray.kx], triangle.v1.raw[ray.ky], triangle.v1.raw[ray.kz]};
+    Vec3Packet<F32> c = {triangle.v2.raw[ray.kx], triangle.v2.raw[ray.ky], triangle.v2.raw[ray.kz]};
+    F32 t, u, v;
+    if (!IntersectPermuted<F32>(ray, a, b, c, &t, &u, &v)) {
+        return false;
+    }
+    hit->t = t;
+    hit->u = u;
+    hit->v = v;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Triangle packs
+
+// N triangles stored corner by corner and axis by axis, so one ray loads its
+// permuted axes directly and tests all of them at once. The corners are kept
+// rather than an edge per corner, since edges rounded per triangle would no
+// longer meet exactly on shared edges.
+template <int N>
+struct TrianglePack {
+    F32 corners[3][3][N];
+    U32 primitive[N];
+};
+
+typedef TrianglePack<4> TrianglePack4;
+typedef TrianglePack<8> TrianglePack8;
+
+// Nearest hit among the triangles of the pack within [tMin, tMax]. Lanes
+// tying on t resolve to the lowest one.
+template <int N>
+inline bool Intersect(const RayShear& ray, const TrianglePack<N>& pack, TriangleHit* hit) {
+    typedef typename WideBvhLanes<N>::Type T;
+
+    Vec3Packet<T> corners[3];
+    for (int k = 0; k < 3; ++k) {
+        corners[k] = {Load<T>(pack.corners[k][ray.kx]), Load<T>(pack.corners[k][ray.ky]), Load<T>(pack.corners[k][ray.kz])};
+    }
+    T t, u, v;
+    U32 mask = MoveMask(IntersectPermuted(ray, corners[0], corners[1], corners[2], &t, &u, &v));
+    if (mask == 0) {
+        return false;
+    }
+
+    F32 ts[N];
+    Store(ts, t);
+    U32 nearest = CountTrailingZeros(mask);
+    for (mask &= mask - 1; mask; mask &= mask - 1) {
+        U32 i = CountTrailingZeros(mask);
+        if (ts[i] < ts[nearest]) {
+            nearest = i;
+        }
+    }
+
+    F32 us[N], vs[N];
+    Store(us, u);
+    Store(vs, v);
+    *hit = {ts[nearest], us[nearest], vs[nearest], pack.primitive[nearest]};
+    return true;
+}
+
+// Whether any triangle of the pack blocks the ray within [tMin, tMax]
+template <int N>
+inline bool Occluded(const RayShear& ray, const TrianglePack<N>& pack) {
+    typedef typename WideBvhLanes<N>::Type T;
+
+    Vec3Packet<T> corners[3];
+    for (int k = 0; k < 3; ++k) {
+        corners[k] = {Load<T>(pack.corners[k][ray.kx]), Load<T>(pack.corners[k][ray.ky]), Load<T>(pack.corners[k][ray.kz])};
+    }
+    T t, u, v;
+    return Any(IntersectPermuted(ray, corners[0], corners[1], corners[2], &t, &u, &v));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Triangle BVH
+
+// Binary tree whose leaves hold packs of up to N triangles in place of
+// primitive indices. Leaf offsets and counts address packs, and bvh.indices
+// maps every pack to itself, so Traverse and Occluded on bvh hand packs to
+// their callbacks and BvhSahCost charges one test per pack. A leaf's last
+// pack fills its unused lanes with copies of its first triangle. The tree
+// cannot be refit, rebuild it when the triangles move.
+template <int N>
+struct TriangleBvh {
+    Bvh bvh;
+    TrianglePack<N>* packs;
+    U32 packCount;
+};
+
+typedef TriangleBvh<4> TriangleBvh4;
+typedef TriangleBvh<8> TriangleBvh8;
+
+// Builds with BvhBuildTriangles, see there for the layout of positions and
+// triangles, then packs every leaf. A maxLeafSize of N and an
+// intersectionCost of about 1 / N, since a pack costs little more than one
+// triangle, let the SAH fill the packs rather than split down to single
+// triangles.
+template <int N>
+void TriangleBvhBuild(TriangleBvh<N>* bvh, const Vec3* positions, const U32* triangles, U32 count, const BvhBuildOptions& options = {}, BvhBuildStats* stats = 0);
+
+template <int N>
+void TriangleBvhFree(TriangleBvh<N>* bvh);
+
+// Nearest hit along the ray, nearer children first as in Traverse. 8-wide
+// packs go through the dispatched kernel, so builds for older CPUs still test
+// them in one AVX2 register where the CPU has it.
+template <int N>
+bool Intersect(const TriangleBvh<N>* bvh, Ray ray, TriangleHit* hit) {
+    RayShear shear = PrecomputeShear(ray);
+    bool found = false;
+    const Kernels* kernels = KernelsGet();
+    Traverse(&bvh->bvh, Precompute(ray), [&](U32 pack, RaySlab* slab) {
+        shear.tMax = slab->tMax;
+        bool hitPack;
+        if constexpr (N == 8) {
+            hitPack = kernels->intersectTrianglePack8(shear, bvh->packs[pack], hit);
+        }
+        else {
+            hitPack = Intersect(shear, bvh->packs[pack], hit);
+        }
+        if (hitPack) {
+            slab->tMax = hit->t;
+            found = true;
+        }
+        return true;
+    });
+    return found;
+}
+
+template <int N>
+bool Occluded(const TriangleBvh<N>* bvh, Ray ray) {
+    RayShear shear = PrecomputeShear(ray);
+    return Occluded(&bvh->bvh, Precompute(ray), [&](U32 pack, const RaySlab&) {
+        return Occluded(shear, bvh->packs[pack]);
+    });
+}
+
+#endif // TC_TRIANGLE_HEADER_GUARD
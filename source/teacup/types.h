@@ -28,6 +28,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <bit>
 
 ////////////////////////////////////////////////////////////////////////////////
 // Helper macros
@@ -73,6 +74,29 @@
 #   error "Unknown instruction set"
 #endif
 
+#if TC_SIMD_FORCE_SCALAR
+#   define TC_SIMD_SCALAR 1
+#   define TC_SIMD_NAME "Scalar"
+#elif TC_ISA_X86 && defined(__AVX2__)
+#   define TC_SIMD_SSE 1
+#   define TC_SIMD_SSE4 1
+#   define TC_SIMD_AVX2 1
+#   define TC_SIMD_NAME "AVX2"
+#elif TC_ISA_X86 && (defined(__SSE4_1__) || defined(__AVX__))
+#   define TC_SIMD_SSE 1
+#   define TC_SIMD_SSE4 1
+#   define TC_SIMD_NAME "SSE4"
+#elif TC_ISA_X86 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#   define TC_SIMD_SSE 1
+#   define TC_SIMD_NAME "SSE2"
+#elif TC_ISA_ARM && (defined(__ARM_NEON) || defined(_M_ARM64))
+#   define TC_SIMD_NEON 1
+#   define TC_SIMD_NAME "NEON"
+#else
+#   define TC_SIMD_SCALAR 1
+#   define TC_SIMD_NAME "Scalar"
+#endif
+
 #if defined(__clang__)
 #   define TC_COMPILER_CLANG (__clang_major__ * 10000 + __clang_minor__ * 100 + __clang_patchlevel__)
 #   define TC_COMPILER_NAME "Clang " TC_STR(__clang_major__) "." TC_STR(__clang_minor__) "." TC_STR(__clang_patchlevel__)
@@ -129,6 +153,7 @@
 #   define TC_NO_RETURN __attribute__((noreturn))
 #   define TC_CONST_FUNC __attribute__((const))
 #   define TC_UNREACHABLE(...) __builtin_unreachable()
+#   define TC_TARGET(_isa) __attribute__((target(_isa)))
 #elif TC_COMPILER_MSVC
 #   define TC_FORCE_INLINE __forceinline
 #   define TC_FUNCTION __FUNCTION__
@@ -138,6 +163,7 @@
 #   define TC_NO_RETURN __declspec(noreturn)
 #   define TC_CONST_FUNC __declspec(noalias)
 #   define TC_UNREACHABLE(...) __assume(0);
+#   define TC_TARGET(_isa)
 #else
 #   error "Unknown TC_COMPILER"
 #endif
@@ -176,7 +202,7 @@
 #if TC_COMPILER_MSVC
 #   define TC_BREAK_POINT(...) __debugbreak();
 #elif TC_ISA_ARM
-    define TC_BREAK_POINT(...) __builtin_trap();
+#   define TC_BREAK_POINT(...) __builtin_trap();
 #elif TC_ISA_X86 && (TC_COMPILER_GCC || TC_COMPILER_CLANG)
 #   define TC_BREAK_POINT(...) __asm__ ("int $3");
 #else
@@ -247,4 +273,22 @@ inline F32 F32NegInfinity() {
     return(un.f);
 }
 
+// Index of the lowest set bit, 32 for zero
+inline U32 CountTrailingZeros(U32 a) {
+    return U32(std::countr_zero(a));
+}
+
+// Index of the highest set bit counted from the top, 32 or 64 for zero
+inline U32 CountLeadingZeros(U32 a) {
+    return U32(std::countl_zero(a));
+}
+
+inline U32 CountLeadingZeros(U64 a) {
+    return U32(std::countl_zero(a));
+}
+
+inline U32 PopCount(U32 a) {
+    return U32(std::popcount(a));
+}
+
 #endif // TC_TYPES_HEADER_GUARD
@@ -0,0 +1,293 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_WIDE_HEADER_GUARD
+#define TC_WIDE_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/simd.h>
+#include <teacup/maths.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Wide math primitives
+
+// Structure of arrays packets holding one Vec3 or Box3 per lane of T. The
+// functions mirror the scalar Vec3 and Box3 ones and perform the same
+// operations in the same order, so each lane matches the scalar result.
+template <typename T>
+struct Vec3Packet {
+    T x, y, z;
+};
+
+template <typename T>
+struct Box3Packet {
+    Vec3Packet<T> min, max;
+};
+
+typedef Vec3Packet<F32x4> Vec3x4;
+typedef Vec3Packet<F32x8> Vec3x8;
+typedef Box3Packet<F32x4> Box3x4;
+typedef Box3Packet<F32x8> Box3x8;
+
+////////////////////////////////////////////////////////////////////////////////
+// Vector 3D packet functions
+
+template <typename T>
+inline Vec3Packet<T> Splat(Vec3 a) {
+    return {Splat<T>(a.x), Splat<T>(a.y), Splat<T>(a.z)};
+}
+
+template <typename T>
+inline Vec3Packet<T> operator-(Vec3Packet<T> a) {
+    return {-a.x, -a.y, -a.z};
+}
+
+template <typename T>
+inline Vec3Packet<T> operator+(Vec3Packet<T> a, Vec3Packet<T> b) {
+    return {a.x+b.x, a.y+b.y, a.z+b.z};
+}
+
+template <typename T>
+inline Vec3Packet<T> operator-(Vec3Packet<T> a, Vec3Packet<T> b) {
+    return {a.x-b.x, a.y-b.y, a.z-b.z};
+}
+
+template <typename T>
+inline Vec3Packet<T> operator*(Vec3Packet<T> a, T b) {
+    return {a.x*b, a.y*b, a.z*b};
+}
+
+template <typename T>
+inline Vec3Packet<T> operator*(T a, Vec3Packet<T> b) {
+    return {a*b.x, a*b.y, a*b.z};
+}
+
+template <typename T>
+inline Vec3Packet<T> operator/(Vec3Packet<T> a, T b) {
+    T inv = Splat<T>(1.0f) / b;
+    return {a.x*inv, a.y*inv, a.z*inv};
+}
+
+template <typename T>
+inline Vec3Packet<T> operator/(T a, Vec3Packet<T> b) {
+    return {a/b.x, a/b.y, a/b.z};
+}
+
+template <typename T>
+inline T Dot(Vec3Packet<T> a, Vec3Packet<T> b) {
+    return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+template <typename T>
+inline Vec3Packet<T> Cross(Vec3Packet<T> a, Vec3Packet<T> b) {
+    T x = a.y*b.z - a.z*b.y;
+    T y = a.z*b.x - a.x*b.z;
+    T z = a.x*b.y - a.y*b.x;
+    return {x, y, z};
+}
+
+template <typename T>
+inline T LengthSquared(Vec3Packet<T> a) {
+    return Dot(a, a);
+}
+
+template <typename T>
+inline T Length(Vec3Packet<T> a) {
+    return Sqrt(LengthSquared(a));
+}
+
+template <typename T>
+inline Vec3Packet<T> Normalize(Vec3Packet<T> a) {
+    return a * (Splat<T>(1.0f) / Length(a));
+}
+
+template <typename T>
+inline Vec3Packet<T> Lerp(Vec3Packet<T> a, Vec3Packet<T> b, T t) {
+    return (Splat<T>(1.0f)-t)*a + t*b;
+}
+
+template <typename T>
+inline Vec3Packet<T> Min(Vec3Packet<T> a, Vec3Packet<T> b) {
+    return {Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z)};
+}
+
+template <typename T>
+inline Vec3Packet<T> Max(Vec3Packet<T> a, Vec3Packet<T> b) {
+    return {Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z)};
+}
+
+template <typename T, typename M>
+inline Vec3Packet<T> Select(M mask, Vec3Packet<T> a, Vec3Packet<T> b) {
+    return {Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z)};
+}
+
+// Loads TC_LANES(T) consecutive Vec3s
+template <typename T>
+inline Vec3Packet<T> Gather(const Vec3* a) {
+    F32 x[TC_LANES(T)], y[TC_LANES(T)], z[TC_LANES(T)];
+    for (int i = 0; i < TC_LANES(T); ++i) {
+        x[i] = a[i].x;
+        y[i] = a[i].y;
+        z[i] = a[i].z;
+    }
+    return {Load<T>(x), Load<T>(y), Load<T>(z)};
+}
+
+// Loads a[indices[0]], a[indices[1]], ...
+template <typename T>
+inline Vec3Packet<T> Gather(const Vec3* a, const U32* indices) {
+    F32 x[TC_LANES(T)], y[TC_LANES(T)], z[TC_LANES(T)];
+    for (int i = 0; i < TC_LANES(T); ++i) {
+        Vec3 v = a[indices[i]];
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+    return {Load<T>(x), Load<T>(y), Load<T>(z)};
+}
+
+// Transposes three registers holding four packed Vec3s into x, y and z lanes
+template <>
+inline Vec3x4 Gather<F32x4>(const Vec3* a) {
+    const F32* raw = a[0].raw;
+    F32x4 m0 = F32x4Load(raw);
+    F32x4 m1 = F32x4Load(raw + 4);
+    F32x4 m2 = F32x4Load(raw + 8);
+
+    F32x4 x = Shuffle<0, 3, 0, 2>(m0, Shuffle<2, 2, 1, 1>(m1, m2));
+    F32x4 y = Shuffle<0, 2, 0, 2>(Shuffle<1, 1, 0, 0>(m0, m1), Shuffle<3, 3, 2, 2>(m1, m2));
+    F32x4 z = Shuffle<0, 2, 0, 3>(Shuffle<2, 2, 1, 1>(m0, m1), m2);
+    return {x, y, z};
+}
+
+template <>
+inline Vec3x8 Gather<F32x8>(const Vec3* a) {
+    Vec3x4 lo = Gather<F32x4>(a);
+    Vec3x4 hi = Gather<F32x4>(a + 4);
+    return {F32x8Combine(lo.x, hi.x), F32x8Combine(lo.y, hi.y), F32x8Combine(lo.z, hi.z)};
+}
+
+inline void Scatter(Vec3* a, Vec3x4 b) {
+    F32* raw = a[0].raw;
+    F32x4 m0 = Shuffle<0, 2, 0, 2>(Shuffle<0, 0, 0, 0>(b.x, b.y), Shuffle<0, 0, 1, 1>(b.z, b.x));
+    F32x4 m1 = Shuffle<0, 2, 0, 2>(Shuffle<1, 1, 1, 1>(b.y, b.z), Shuffle<2, 2, 2, 2>(b.x, b.y));
+    F32x4 m2 = Shuffle<0, 2, 0, 2>(Shuffle<2, 2, 3, 3>(b.z, b.x), Shuffle<3, 3, 3, 3>(b.y, b.z));
+    F32x4Store(raw, m0);
+    F32x4Store(raw + 4, m1);
+    F32x4Store(raw + 8, m2);
+}
+
+inline void Scatter(Vec3* a, Vec3x8 b) {
+    Scatter(a, Vec3x4{Low(b.x), Low(b.y), Low(b.z)});
+    Scatter(a + 4, Vec3x4{High(b.x), High(b.y), High(b.z)});
+}
+
+// Stores each lane to a[indices[i]]
+template <typename T>
+inline void Scatter(Vec3* a, const U32* indices, Vec3Packet<T> b) {
+    F32 x[TC_LANES(T)], y[TC_LANES(T)], z[TC_LANES(T)];
+    Store(x, b.x);
+    Store(y, b.y);
+    Store(z, b.z);
+    for (int i = 0; i < TC_LANES(T); ++i) {
+        a[indices[i]] = {x[i], y[i], z[i]};
+    }
+}
+
+template <typename T>
+inline Vec3 Extract(Vec3Packet<T> a, int lane) {
+    F32 x[TC_LANES(T)], y[TC_LANES(T)], z[TC_LANES(T)];
+    Store(x, a.x);
+    Store(y, a.y);
+    Store(z, a.z);
+    return {x[lane], y[lane], z[lane]};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Box 3D packet functions
+
+template <typename T>
+inline Box3Packet<T> Splat(Box3 a) {
+    return {Splat<T>(a.min), Splat<T>(a.max)};
+}
+
+template <typename T>
+inline Box3Packet<T> Gather(const Box3* a) {
+    F32 raw[6][TC_LANES(T)];
+    for (int i = 0; i < TC_LANES(T); ++i) {
+        raw[0][i] = a[i].min.x;
+        raw[1][i] = a[i].min.y;
+        raw[2][i] = a[i].min.z;
+        raw[3][i] = a[i].max.x;
+        raw[4][i] = a[i].max.y;
+        raw[5][i] = a[i].max.z;
+    }
+    Vec3Packet<T> min = {Load<T>(raw[0]), Load<T>(raw[1]), Load<T>(raw[2])};
+    Vec3Packet<T> max = {Load<T>(raw[3]), Load<T>(raw[4]), Load<T>(raw[5])};
+    return {min, max};
+}
+
+template <typename T>
+inline Box3 Extract(Box3Packet<T> a, int lane) {
+    return {Extract(a.min, lane), Extract(a.max, lane)};
+}
+
+template <typename T>
+inline Box3Packet<T> Union(Box3Packet<T> a, Vec3Packet<T> b) {
+    return {Min(a.min, b), Max(a.max, b)};
+}
+
+template <typename T>
+inline Box3Packet<T> Union(Box3Packet<T> a, Box3Packet<T> b) {
+    return {Min(a.min, b.min), Max(a.max, b.max)};
+}
+
+template <typename T>
+inline Box3Packet<T> Intersect(Box3Packet<T> a, Box3Packet<T> b) {
+    return {Max(a.min, b.min), Min(a.max, b.max)};
+}
+
+template <typename T>
+inline auto Overlaps(Box3Packet<T> a, Box3Packet<T> b) {
+    auto x = (a.max.x >= b.min.x) & (a.min.x <= b.max.x);
+    auto y = (a.max.y >= b.min.y) & (a.min.y <= b.max.y);
+    auto z = (a.max.z >= b.min.z) & (a.min.z <= b.max.z);
+    return x & y & z;
+}
+
+template <typename T>
+inline auto Inside(Box3Packet<T> a, Vec3Packet<T> b) {
+    auto x = (b.x >= a.min.x) & (b.x <= a.max.x);
+    auto y = (b.y >= a.min.y) & (b.y <= a.max.y);
+    auto z = (b.z >= a.min.z) & (b.z <= a.max.z);
+    return x & y & z;
+}
+
+template <typename T>
+inline auto InsideExclusive(Box3Packet<T> a, Vec3Packet<T> b) {
+    auto x = (b.x >= a.min.x) & (b.x < a.max.x);
+    auto y = (b.y >= a.min.y) & (b.y < a.max.y);
+    auto z = (b.z >= a.min.z) & (b.z < a.max.z);
+    return x & y & z;
+}
+
+#endif // TC_WIDE_HEADER_GUARD
@@ -0,0 +1,766 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/bvh.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Small boxes in a unit cube, with clusters and some duplicates so the
+// builder meets degenerate centroid distributions
+static Box3* RandomBoxes(U32 count, U32 seed) {
+    Box3* boxes = (Box3*) malloc(count * sizeof(Box3));
+    U32 state = seed;
+    for (U32 i = 0; i < count; ++i) {
+        if (i > 0 && RandomF32(&state) < 0.05f) {
+            boxes[i] = boxes[i - 1];
+            continue;
+        }
+        Vec3 p = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        if (RandomF32(&state) < 0.3f) {
+            p = p * 0.01f + Vec3{0.5f, 0.5f, 0.5f};
+        }
+        Vec3 size = {RandomF32(&state) * 0.02f, RandomF32(&state) * 0.02f, RandomF32(&state) * 0.02f};
+        boxes[i] = {p, p + size};
+    }
+    return boxes;
+}
+
+static bool Contains(Box3 a, Box3 b) {
+    return Inside(a, b.min) && Inside(a, b.max);
+}
+
+static void CheckBvh(const Bvh* bvh, const Box3* boxes, U32 count, const BvhBuildOptions& options) {
+    REQUIRE(bvh->nodeCount > 0);
+    U8* seen = (U8*) calloc(count, 1);
+    U32 leaves = 0;
+    bool valid = true;
+
+    for (U32 i = 0; i < bvh->nodeCount; ++i) {
+        const BvhNode* node = bvh->nodes + i;
+        if (node->count > 0) {
+            leaves++;
+            valid &= node->count <= options.maxLeafSize;
+            valid &= node->offset + node->count <= count;
+            for (U32 k = 0; k < node->count; ++k) {
+                U32 primitive = bvh->indices[node->offset + k];
+                seen[primitive]++;
+                valid &= Contains(node->bounds, boxes[primitive]);
+            }
+        }
+        else {
+            valid &= node->offset + 1 < bvh->nodeCount && node->offset > i;
+            valid &= Contains(node->bounds, bvh->nodes[node->offset].bounds);
+            valid &= Contains(node->bounds, bvh->nodes[node->offset + 1].bounds);
+        }
+    }
+    CHECK(valid);
+    CHECK(bvh->nodeCount == 2 * leaves - 1);
+
+    U32 once = 0;
+    for (U32 i = 0; i < count; ++i) {
+        once += seen[i] == 1;
+    }
+    CHECK(once == count);
+    free(seen);
+}
+
+TEST_CASE("BVH build structure") {
+    const U32 counts[] = {1, 2, 7, 100, 5000};
+    for (U32 count : counts) {
+        Box3* boxes = RandomBoxes(count, count);
+        Bvh bvh;
+        BvhBuildOptions options;
+        BvhBuildStats stats;
+        BvhBuild(&bvh, boxes, 0, count, options, &stats);
+        CheckBvh(&bvh, boxes, count, options);
+        CHECK(stats.nodeCount == bvh.nodeCount);
+        CHECK(stats.leafCount * 2 - 1 == bvh.nodeCount);
+        CHECK(stats.sahCost > 0);
+        CHECK(stats.maxDepth < TC_BVH_STACK_SIZE);
+        BvhFree(&bvh);
+        free(boxes);
+    }
+
+    Bvh empty;
+    BvhBuild(&empty, 0, 0, 0);
+    CHECK(empty.nodeCount == 0);
+    BvhFree(&empty);
+}
+
+TEST_CASE("BVH build of identical boxes respects the leaf size") {
+    const U32 count = 1000;
+    Box3* boxes = (Box3*) malloc(count * sizeof(Box3));
+    for (U32 i = 0; i < count; ++i) {
+        boxes[i] = {{1, 2, 3}, {2, 3, 4}};
+    }
+    Bvh bvh;
+    BvhBuildOptions options;
+    options.maxLeafSize = 4;
+    BvhBuild(&bvh, boxes, 0, count, options);
+    CheckBvh(&bvh, boxes, count, options);
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+TEST_CASE("BVH parallel build matches serial build") {
+    const U32 count = 50000;
+    Box3* boxes = RandomBoxes(count, 3);
+
+    BvhBuildOptions serial;
+    serial.parallelThreshold = 0xffffffff;
+    BvhBuildOptions parallel;
+    parallel.parallelThreshold = 256;
+
+    Bvh a, b;
+    BvhBuildStats statsA, statsB;
+    BvhBuild(&a, boxes, 0, count, serial, &statsA);
+    BvhBuild(&b, boxes, 0, count, parallel, &statsB);
+    CheckBvh(&b, boxes, count, parallel);
+    CHECK(statsA.nodeCount == statsB.nodeCount);
+    CHECK(statsA.leafCount == statsB.leafCount);
+    CHECK(statsA.maxDepth == statsB.maxDepth);
+    CHECK(statsA.sahCost == doctest::Approx(statsB.sahCost).epsilon(1e-5));
+
+    // Binned SAH lands far below a tree that ignores the heuristic
+    CHECK(statsA.sahCost < 0.25f * F32(count));
+
+    BvhFree(&a);
+    BvhFree(&b);
+    free(boxes);
+}
+
+TEST_CASE("BVH traversal finds the same boxes as brute force") {
+    const U32 count = 3000;
+    Box3* boxes = RandomBoxes(count, 9);
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, count);
+
+    U32 state = 77;
+    U32 total = 0;
+    for (int i = 0; i < 200; ++i) {
+        Vec3 origin = {RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f};
+        Vec3 target = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        RaySlab ray = Precompute(Ray{origin, target - origin, 0.0f, F32Infinity()});
+
+        U32 expected = 0;
+        for (U32 k = 0; k < count; ++k) {
+            expected += Intersect(ray, boxes[k]);
+        }
+
+        U32 found = 0;
+        Traverse(&bvh, ray, [&](U32 primitive, RaySlab* r) {
+            found += Intersect(*r, boxes[primitive]);
+            return true;
+        });
+        CHECK(found == expected);
+        total += found;
+    }
+    CHECK(total > 20);
+
+    // Shrinking tMax on the first hit still finds the closest entry distance
+    RaySlab ray = Precompute(Ray{{-1, 0.5f, 0.5f}, {1, 0.01f, 0.02f}, 0.0f, F32Infinity()});
+    F32 closest = F32Infinity();
+    for (U32 k = 0; k < count; ++k) {
+        F32 entry, exit;
+        if (Intersect(ray, boxes[k], &entry, &exit)) {
+            closest = TC_MIN(closest, entry);
+        }
+    }
+    F32 nearest = F32Infinity();
+    Traverse(&bvh, ray, [&](U32 primitive, RaySlab* r) {
+        F32 entry, exit;
+        if (Intersect(*r, boxes[primitive], &entry, &exit) && entry < nearest) {
+            nearest = entry;
+            r->tMax = entry;
+        }
+        return true;
+    });
+    CHECK(nearest == closest);
+
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+TEST_CASE("Linear BVH build structure") {
+    const U32 counts[] = {1, 2, 7, 100, 5000, 70000};
+    const U32 bits[] = {30, 63};
+    for (U32 count : counts) {
+        Box3* boxes = RandomBoxes(count, count + 5);
+        for (U32 mortonBits : bits) {
+            BvhBuildOptions fast;
+            fast.quality = BVH_BUILD_QUALITY_FAST;
+            fast.mortonBits = mortonBits;
+            BvhBuildOptions medium = fast;
+            medium.quality = BVH_BUILD_QUALITY_MEDIUM;
+
+            Bvh a, b;
+            BvhBuildStats statsA, statsB;
+            BvhBuild(&a, boxes, 0, count, fast, &statsA);
+            BvhBuild(&b, boxes, 0, count, medium, &statsB);
+            CheckBvh(&a, boxes, count, fast);
+            CheckBvh(&b, boxes, count, medium);
+            CHECK(statsA.leafCount == count);
+            CHECK(statsB.leafCount == count);
+            CHECK(statsA.maxDepth < TC_BVH_STACK_SIZE);
+            CHECK(statsB.maxDepth < TC_BVH_STACK_SIZE);
+
+            // Restructuring only ever accepts cheaper treelets
+            CHECK(statsB.sahCost <= statsA.sahCost * 1.0001f);
+            if (count >= 5000) {
+                CHECK(statsB.sahCost < statsA.sahCost);
+            }
+            BvhFree(&a);
+            BvhFree(&b);
+        }
+        free(boxes);
+    }
+}
+
+TEST_CASE("Linear BVH traversal finds the same boxes as brute force") {
+    const U32 count = 3000;
+    Box3* boxes = RandomBoxes(count, 13);
+    BvhBuildOptions options;
+    options.quality = BVH_BUILD_QUALITY_MEDIUM;
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, count, options);
+
+    U32 state = 31;
+    bool same = true;
+    for (int i = 0; i < 200; ++i) {
+        Vec3 origin = {RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f};
+        Vec3 target = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        RaySlab ray = Precompute(Ray{origin, target - origin, 0.0f, F32Infinity()});
+
+        U32 expected = 0;
+        for (U32 k = 0; k < count; ++k) {
+            expected += Intersect(ray, boxes[k]);
+        }
+        U32 found = 0;
+        Traverse(&bvh, ray, [&](U32 primitive, RaySlab* r) {
+            found += Intersect(*r, boxes[primitive]);
+            return true;
+        });
+        same &= found == expected;
+    }
+    CHECK(same);
+
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+template <int N>
+static void CheckWideBvh(const Bvh* bvh, const Box3* boxes, U32 count) {
+    WideBvh<N> wide;
+    WideBvhBuild(&wide, bvh);
+    REQUIRE(wide.nodeCount > 0);
+    CHECK(wide.nodeCount <= bvh->nodeCount / 2 + 1);
+
+    // Every primitive reachable exactly once through the leaves
+    U8* seen = (U8*) calloc(count, 1);
+    bool valid = true;
+    for (U32 i = 0; i < wide.nodeCount; ++i) {
+        const WideBvhNode<N>* node = wide.nodes + i;
+        for (int k = 0; k < N; ++k) {
+            if (node->child[k] == TC_U32_MAX) {
+                valid &= node->minX[k] > node->maxX[k];
+                continue;
+            }
+            Box3 bounds = {{node->minX[k], node->minY[k], node->minZ[k]}, {node->maxX[k], node->maxY[k], node->maxZ[k]}};
+            if (node->count[k] == 0) {
+                valid &= node->child[k] > i && node->child[k] < wide.nodeCount;
+                continue;
+            }
+            for (U32 p = 0; p < node->count[k]; ++p) {
+                U32 primitive = wide.indices[node->child[k] + p];
+                seen[primitive]++;
+                valid &= Contains(bounds, boxes[primitive]);
+            }
+        }
+    }
+    CHECK(valid);
+    U32 once = 0;
+    for (U32 i = 0; i < count; ++i) {
+        once += seen[i] == 1;
+    }
+    CHECK(once == count);
+    free(seen);
+
+    // Same boxes found as the binary tree, and the same nearest entry when
+    // tMax shrinks on each hit
+    U32 state = 123;
+    for (int i = 0; i < 200; ++i) {
+        Vec3 origin = {RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f};
+        Vec3 target = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        RaySlab ray = Precompute(Ray{origin, target - origin, 0.0f, F32Infinity()});
+
+        U32 expected = 0, found = 0;
+        Traverse(bvh, ray, [&](U32 primitive, RaySlab* r) {
+            expected += Intersect(*r, boxes[primitive]);
+            return true;
+        });
+        Traverse(&wide, ray, [&](U32 primitive, RaySlab* r) {
+            found += Intersect(*r, boxes[primitive]);
+            return true;
+        });
+        CHECK(found == expected);
+
+        F32 nearestBinary = F32Infinity(), nearestWide = F32Infinity();
+        Traverse(bvh, ray, [&](U32 primitive, RaySlab* r) {
+            F32 entry, exit;
+            if (Intersect(*r, boxes[primitive], &entry, &exit) && entry < nearestBinary) {
+                nearestBinary = entry;
+                r->tMax = entry;
+            }
+            return true;
+        });
+        Traverse(&wide, ray, [&](U32 primitive, RaySlab* r) {
+            F32 entry, exit;
+            if (Intersect(*r, boxes[primitive], &entry, &exit) && entry < nearestWide) {
+                nearestWide = entry;
+                r->tMax = entry;
+            }
+            return true;
+        });
+        CHECK(nearestWide == nearestBinary);
+    }
+
+    WideBvhFree(&wide);
+}
+
+TEST_CASE("Wide BVH matches the binary BVH") {
+    const U32 counts[] = {1, 5, 3000};
+    for (U32 count : counts) {
+        Box3* boxes = RandomBoxes(count, 41 + count);
+        Bvh bvh;
+        BvhBuild(&bvh, boxes, 0, count);
+        CheckWideBvh<4>(&bvh, boxes, count);
+        CheckWideBvh<8>(&bvh, boxes, count);
+        BvhFree(&bvh);
+        free(boxes);
+    }
+}
+
+TEST_CASE("BVH occlusion queries match brute force") {
+    const U32 count = 3000;
+    const U32 rayCount = 300;
+    Box3* boxes = RandomBoxes(count, 23);
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, count);
+    WideBvh4 wide4;
+    WideBvh8 wide8;
+    WideBvhBuild(&wide4, &bvh);
+    WideBvhBuild(&wide8, &bvh);
+
+    // Segments between random points, like shadow rays towards lights
+    U32 state = 90;
+    RaySlab* rays = (RaySlab*) malloc(rayCount * sizeof(RaySlab));
+    bool* expected = (bool*) malloc(rayCount * sizeof(bool));
+    U32 blocked = 0;
+    for (U32 i = 0; i < rayCount; ++i) {
+        Vec3 origin = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        Vec3 target = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        rays[i] = Precompute(Ray{origin, target - origin, 0.0f, RandomF32(&state)});
+        expected[i] = false;
+        for (U32 k = 0; k < count && !expected[i]; ++k) {
+            expected[i] = Intersect(rays[i], boxes[k]);
+        }
+        blocked += expected[i];
+    }
+    CHECK(blocked > rayCount / 20);
+    CHECK(blocked < rayCount);
+
+    bool same = true;
+    U32 tests = 0;
+    for (U32 i = 0; i < rayCount; ++i) {
+        auto occluder = [&](U32 primitive, const RaySlab& ray) {
+            tests++;
+            return Intersect(ray, boxes[primitive]);
+        };
+        same &= Occluded(&bvh, rays[i], occluder) == expected[i];
+        same &= Occluded(&wide4, rays[i], occluder) == expected[i];
+        same &= Occluded(&wide8, rays[i], occluder) == expected[i];
+    }
+    CHECK(same);
+    CHECK(tests > 0);
+
+    bool* occluded = (bool*) malloc(rayCount * sizeof(bool));
+    Occluded(&bvh, rays, rayCount, occluded, [&](U32 ray, U32 primitive, const RaySlab& slab) {
+        return Intersect(slab, boxes[primitive]) && ray < rayCount;
+    });
+    CHECK(memcmp(occluded, expected, rayCount * sizeof(bool)) == 0);
+    memset(occluded, 0, rayCount * sizeof(bool));
+    Occluded(&wide8, rays, rayCount, occluded, [&](U32, U32 primitive, const RaySlab& slab) {
+        return Intersect(slab, boxes[primitive]);
+    });
+    CHECK(memcmp(occluded, expected, rayCount * sizeof(bool)) == 0);
+
+    free(occluded);
+    free(expected);
+    free(rays);
+    WideBvhFree(&wide4);
+    WideBvhFree(&wide8);
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+TEST_CASE("BVH layouts keep the tree") {
+    const U32 count = 20000;
+    Box3* boxes = RandomBoxes(count, 29);
+    Bvh original;
+    BvhBuild(&original, boxes, 0, count);
+    F32 cost = BvhSahCost(&original);
+
+    const BvhLayout layouts[] = {BVH_LAYOUT_DEPTH_FIRST, BVH_LAYOUT_BREADTH_FIRST, BVH_LAYOUT_CLUSTERED, BVH_LAYOUT_DEPTH_FIRST};
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, count);
+    for (BvhLayout layout : layouts) {
+        BvhReorder(&bvh, layout);
+        REQUIRE(bvh.nodeCount == original.nodeCount + 1);
+        CHECK(U64(bvh.nodes + 2) % TC_CACHE_LINE_SIZE == 0);
+        CHECK(memcmp(bvh.nodes + 0, bvh.nodes + 1, sizeof(BvhNode)) == 0);
+        CHECK(bvh.nodes[0].offset == 2);
+        CHECK(BvhSahCost(&bvh) == doctest::Approx(cost));
+
+        // Pairs stay on cache lines after their parents, and the leaves keep
+        // their primitives
+        bool valid = true;
+        U32 leaves = 0;
+        for (U32 i = 2; i < bvh.nodeCount; ++i) {
+            const BvhNode* node = bvh.nodes + i;
+            if (node->count == 0) {
+                valid &= node->offset % 2 == 0 && node->offset > i && node->offset + 1 < bvh.nodeCount;
+                valid &= Contains(node->bounds, bvh.nodes[node->offset].bounds);
+                valid &= Contains(node->bounds, bvh.nodes[node->offset + 1].bounds);
+            }
+            else {
+                leaves++;
+                for (U32 k = 0; k < node->count; ++k) {
+                    valid &= Contains(node->bounds, boxes[bvh.indices[node->offset + k]]);
+                }
+            }
+        }
+        CHECK(valid);
+        CHECK(bvh.nodeCount == 2 * leaves);
+
+        U32 state = 61;
+        for (int i = 0; i < 100; ++i) {
+            Vec3 origin = {RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f};
+            Vec3 target = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+            RaySlab ray = Precompute(Ray{origin, target - origin, 0.0f, F32Infinity()});
+            U32 expected = 0, found = 0;
+            Traverse(&original, ray, [&](U32 primitive, RaySlab* r) {
+                expected += Intersect(*r, boxes[primitive]);
+                return true;
+            });
+            Traverse(&bvh, ray, [&](U32 primitive, RaySlab* r) {
+                found += Intersect(*r, boxes[primitive]);
+                return true;
+            });
+            CHECK(found == expected);
+        }
+    }
+
+    // Refitting leaves the copy of the root in step with the root
+    BvhRefit(&bvh, boxes);
+    CHECK(memcmp(bvh.nodes + 0, bvh.nodes + 1, sizeof(BvhNode)) == 0);
+    CHECK(BvhSahCost(&bvh) == doctest::Approx(cost));
+
+    BvhFree(&original);
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+TEST_CASE("BVH refit follows moving boxes") {
+    const U32 count = 5000;
+    Box3* boxes = RandomBoxes(count, 17);
+    BvhBuildOptions options;
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, count, options);
+
+    // Unchanged boxes give back the same tree
+    BvhNode* before = (BvhNode*) malloc(bvh.nodeCount * sizeof(BvhNode));
+    memcpy(before, bvh.nodes, bvh.nodeCount * sizeof(BvhNode));
+    BvhRefit(&bvh, boxes);
+    CHECK(memcmp(before, bvh.nodes, bvh.nodeCount * sizeof(BvhNode)) == 0);
+    free(before);
+
+    U32 state = 3;
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 offset = {RandomF32(&state) * 0.1f, RandomF32(&state) * 0.1f, RandomF32(&state) * 0.1f};
+        boxes[i] = {boxes[i].min + offset, boxes[i].max + offset};
+    }
+    BvhRefit(&bvh, boxes);
+    CheckBvh(&bvh, boxes, count, options);
+
+    // Interior bounds are exactly the union of their children
+    bool tight = true;
+    for (U32 i = 0; i < bvh.nodeCount; ++i) {
+        const BvhNode* node = bvh.nodes + i;
+        if (node->count == 0) {
+            Box3 box = Union(bvh.nodes[node->offset].bounds, bvh.nodes[node->offset + 1].bounds);
+            tight &= memcmp(&box, &node->bounds, sizeof(Box3)) == 0;
+        }
+    }
+    CHECK(tight);
+
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+TEST_CASE("BVH quality monitor rebuilds after large motion") {
+    const U32 count = 5000;
+    Box3* boxes = RandomBoxes(count, 23);
+    BvhBuildOptions options;
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, count, options);
+
+    BvhQualityMonitor monitor;
+    U32 state = 8;
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 offset = {RandomF32(&state) * 0.001f, 0, 0};
+        boxes[i] = {boxes[i].min + offset, boxes[i].max + offset};
+    }
+    CHECK(!BvhUpdate(&bvh, boxes, 0, &monitor, options));
+    CHECK(monitor.refitCount == 1);
+    CHECK(monitor.cost <= monitor.threshold * monitor.buildCost);
+
+    // Swapping boxes around scatters every leaf across the scene
+    for (U32 i = 0; i < count; ++i) {
+        U32 k = U32(RandomF32(&state) * F32(count)) % count;
+        Box3 box = boxes[i];
+        boxes[i] = boxes[k];
+        boxes[k] = box;
+    }
+    F32 degraded = monitor.threshold * monitor.buildCost;
+    CHECK(BvhUpdate(&bvh, boxes, 0, &monitor, options));
+    CHECK(monitor.rebuildCount == 1);
+    CHECK(monitor.cost < degraded);
+    CheckBvh(&bvh, boxes, count, options);
+
+    BvhFree(&bvh);
+    free(boxes);
+}
+
+// Long thin triangles crossing the scene diagonally, as in architectural
+// models, plus an index buffer over shared corners
+static Vec3* DiagonalTriangles(U32 count, U32 seed) {
+    Vec3* positions = (Vec3*) malloc(3 * count * sizeof(Vec3));
+    U32 state = seed;
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 p = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        Vec3 along = Vec3{1, 1, 0.5f} * (0.2f + RandomF32(&state) * 0.5f);
+        Vec3 across = {RandomF32(&state) * 0.01f, RandomF32(&state) * 0.01f, RandomF32(&state) * 0.01f};
+        positions[3 * i + 0] = p;
+        positions[3 * i + 1] = p + along;
+        positions[3 * i + 2] = p + across;
+    }
+    return positions;
+}
+
+TEST_CASE("Spatial splits cover every triangle within the budget") {
+    const U32 count = 3000;
+    Vec3* positions = DiagonalTriangles(count, 4);
+    U32* triangles = (U32*) malloc(3 * count * sizeof(U32));
+    for (U32 i = 0; i < 3 * count; ++i) {
+        triangles[i] = 3 * count - 1 - i;
+    }
+
+    BvhBuildOptions high;
+    BvhBuildOptions spatial;
+    spatial.quality = BVH_BUILD_QUALITY_SPATIAL;
+    Bvh a, b;
+    BvhBuildStats statsA, statsB;
+    BvhBuildTriangles(&a, positions, 0, count, high, &statsA);
+    BvhBuildTriangles(&b, positions, 0, count, spatial, &statsB);
+    CHECK(statsA.spatialSplitCount == 0);
+    CHECK(statsA.referenceCount == count);
+    CHECK(statsB.spatialSplitCount > 0);
+    CHECK(statsB.referenceCount > count);
+    CHECK(statsB.referenceCount <= count + U32(F32(count) * spatial.spatialSplitBudget));
+    CHECK(statsB.referenceCount == b.referenceCount);
+    CHECK(statsB.sahCost < 0.9f * statsA.sahCost);
+    CHECK(statsB.maxDepth < TC_BVH_STACK_SIZE);
+
+    // Every point of every triangle lies in a leaf that references it
+    Box3* leafBounds = (Box3*) malloc(b.referenceCount * sizeof(Box3));
+    U32* leafStart = (U32*) calloc(count + 1, sizeof(U32));
+    U32* leafCursor = (U32*) calloc(count, sizeof(U32));
+    bool valid = true;
+    for (U32 i = 0; i < b.nodeCount; ++i) {
+        const BvhNode* node = b.nodes + i;
+        if (node->count == 0) {
+            valid &= node->offset > i && node->offset + 1 < b.nodeCount;
+            valid &= Inside(node->bounds, b.nodes[node->offset].bounds.min) && Inside(node->bounds, b.nodes[node->offset].bounds.max);
+            continue;
+        }
+        valid &= node->count <= spatial.maxLeafSize && node->offset + node->count <= b.referenceCount;
+        for (U32 k = 0; k < node->count; ++k) {
+            leafStart[b.indices[node->offset + k] + 1]++;
+        }
+    }
+    CHECK(valid);
+    for (U32 t = 0; t < count; ++t) {
+        leafStart[t + 1] += leafStart[t];
+    }
+    for (U32 i = 0; i < b.nodeCount; ++i) {
+        const BvhNode* node = b.nodes + i;
+        for (U32 k = 0; node->count > 0 && k < node->count; ++k) {
+            U32 t = b.indices[node->offset + k];
+            leafBounds[leafStart[t] + leafCursor[t]++] = node->bounds;
+        }
+    }
+
+    U32 state = 12;
+    bool covered = true;
+    for (U32 t = 0; t < count; ++t) {
+        for (int s = 0; s < 8; ++s) {
+            F32 u = RandomF32(&state);
+            F32 v = RandomF32(&state) * (1 - u);
+            const Vec3* c = positions + 3 * t;
+            Vec3 point = c[0] + (c[1] - c[0]) * u + (c[2] - c[0]) * v;
+            bool inside = false;
+            for (U32 k = leafStart[t]; k < leafStart[t + 1]; ++k) {
+                Box3 box = {leafBounds[k].min - Vec3{1e-5f, 1e-5f, 1e-5f}, leafBounds[k].max + Vec3{1e-5f, 1e-5f, 1e-5f}};
+                inside |= Inside(box, point);
+            }
+            covered &= inside;
+        }
+    }
+    CHECK(covered);
+    free(leafBounds);
+    free(leafStart);
+    free(leafCursor);
+
+    // Indexed triangles build the same tree as the soup they index
+    Vec3* reversed = (Vec3*) malloc(3 * count * sizeof(Vec3));
+    for (U32 i = 0; i < 3 * count; ++i) {
+        reversed[triangles[i]] = positions[i];
+    }
+    Bvh c;
+    BvhBuildStats statsC;
+    BvhBuildTriangles(&c, reversed, triangles, count, spatial, &statsC);
+    CHECK(statsC.referenceCount == statsB.referenceCount);
+    CHECK(statsC.sahCost == statsB.sahCost);
+
+    // Without a budget no triangle is split
+    spatial.spatialSplitBudget = 0;
+    Bvh d;
+    BvhBuildStats statsD;
+    BvhBuildTriangles(&d, positions, 0, count, spatial, &statsD);
+    CHECK(statsD.spatialSplitCount == 0);
+    CHECK(statsD.referenceCount == count);
+
+    BvhFree(&a);
+    BvhFree(&b);
+    BvhFree(&c);
+    BvhFree(&d);
+    free(reversed);
+    free(triangles);
+    free(positions);
+}
+
+TEST_CASE("Stackless traversal matches the stack traversal") {
+    const U32 count = 3000;
+    Box3* boxes = RandomBoxes(count, 21);
+    U32 state = 23;
+
+    for (int variant = 0; variant < 3; ++variant) {
+        BvhBuildOptions options;
+        options.quality = variant == 1 ? BVH_BUILD_QUALITY_FAST : BVH_BUILD_QUALITY_HIGH;
+        Bvh bvh;
+        BvhBuild(&bvh, boxes, 0, count, options);
+        if (variant == 2) {
+            BvhReorder(&bvh, BVH_LAYOUT_CLUSTERED);
+        }
+        U32* parents = (U32*) malloc(bvh.nodeCount * sizeof(U32));
+        BvhParents(&bvh, parents);
+        CHECK(parents[0] == TC_U32_MAX);
+
+        for (int i = 0; i < 200; ++i) {
+            Vec3 origin = {RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f};
+            Vec3 target = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+            RaySlab ray = Precompute(Ray{origin, target - origin, 0.0f, F32Infinity()});
+
+            U32 expected = 0;
+            Traverse(&bvh, ray, [&](U32 primitive, RaySlab* r) {
+                expected += Intersect(*r, boxes[primitive]);
+                return true;
+            });
+            U32 found = 0;
+            TraverseStackless(&bvh, parents, ray, [&](U32 primitive, RaySlab* r) {
+                found += Intersect(*r, boxes[primitive]);
+                return true;
+            });
+            REQUIRE(found == expected);
+
+            F32 closest = F32Infinity();
+            Traverse(&bvh, ray, [&](U32 primitive, RaySlab* r) {
+                F32 entry, exit;
+                if (Intersect(*r, boxes[primitive], &entry, &exit)) {
+                    closest = entry;
+                    r->tMax = entry;
+                }
+                return true;
+            });
+            F32 nearest = F32Infinity();
+            TraverseStackless(&bvh, parents, ray, [&](U32 primitive, RaySlab* r) {
+                F32 entry, exit;
+                if (Intersect(*r, boxes[primitive], &entry, &exit)) {
+                    nearest = entry;
+                    r->tMax = entry;
+                }
+                return true;
+            });
+            REQUIRE(nearest == closest);
+        }
+
+        // Two rays suspended after every leaf and resumed in turn visit the
+        // same leaves as when each runs on its own
+        RaySlab rays[2];
+        U32 states[2] = {TC_STACKLESS_START, TC_STACKLESS_START};
+        U32 leafCounts[2] = {};
+        for (int r = 0; r < 2; ++r) {
+            Vec3 origin = {-0.5f, RandomF32(&state), RandomF32(&state)};
+            rays[r] = Precompute(Ray{origin, Centroid(boxes[r * 100]) - origin, 0.0f, F32Infinity()});
+        }
+        while (states[0] != TC_STACKLESS_DONE || states[1] != TC_STACKLESS_DONE) {
+            for (int r = 0; r < 2; ++r) {
+                leafCounts[r] += StacklessNext(&bvh, parents, rays[r], states + r) != TC_U32_MAX;
+            }
+        }
+        for (int r = 0; r < 2; ++r) {
+            U32 leaves = 0;
+            U32 alone = TC_STACKLESS_START;
+            while (StacklessNext(&bvh, parents, rays[r], &alone) != TC_U32_MAX) {
+                ++leaves;
+            }
+            CHECK(leaves == leafCounts[r]);
+            CHECK(leaves > 0);
+        }
+
+        free(parents);
+        BvhFree(&bvh);
+    }
+    free(boxes);
+}
@@ -0,0 +1,169 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/cache.h>
+#include <teacup/parallel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Small triangles scattered through the unit cube, three vertices each
+static Vec3* RandomTriangles(U32 count, U32* state) {
+    Vec3* positions = (Vec3*) malloc(3 * count * sizeof(Vec3));
+    for (U32 i = 0; i < 3 * count; i += 3) {
+        Vec3 p = {RandomF32(state), RandomF32(state), RandomF32(state)};
+        positions[i + 0] = p;
+        positions[i + 1] = p + Vec3{RandomF32(state) * 0.05f, 0, 0};
+        positions[i + 2] = p + Vec3{0, RandomF32(state) * 0.05f, RandomF32(state) * 0.05f};
+    }
+    return positions;
+}
+
+static bool TriangleEqual(Triangle a, const Vec3* corners) {
+    return BitEqual(a.v0, corners[0])
+        && BitEqual(a.v1, corners[1])
+        && BitEqual(a.v2, corners[2]);
+}
+
+static void Truncate(const char* from, const char* to, long size) {
+    FILE* in = fopen(from, "rb");
+    FILE* out = fopen(to, "wb");
+    char* data = (char*) malloc(size_t(size));
+    REQUIRE(fread(data, 1, size_t(size), in) == size_t(size));
+    fwrite(data, 1, size_t(size), out);
+    free(data);
+    fclose(in);
+    fclose(out);
+}
+
+TEST_CASE("BVH cache round trip") {
+    const char* path = "teacup_test_bvh.cache";
+    const char* truncated = "teacup_test_bvh_truncated.cache";
+    const U32 count = 2000;
+    U32 state = 5;
+    Vec3* positions = RandomTriangles(count, &state);
+
+    BvhBuildOptions options;
+    options.quality = BVH_BUILD_QUALITY_SPATIAL;
+    Bvh bvh;
+    BvhBuildTriangles(&bvh, positions, 0, count, options);
+    U64 key = BvhCacheKey(positions, 3 * count, 0, count, options);
+    REQUIRE(BvhCacheWrite(path, key, &bvh, positions));
+
+    BvhCache cache;
+    REQUIRE(BvhCacheLoad(path, key, &cache));
+    CHECK(cache.bvh.nodeCount == bvh.nodeCount);
+    CHECK(cache.bvh.primitiveCount == bvh.primitiveCount);
+    CHECK(cache.bvh.referenceCount == bvh.referenceCount);
+    CHECK(memcmp(cache.bvh.nodes, bvh.nodes, bvh.nodeCount * sizeof(BvhNode)) == 0);
+    CHECK(memcmp(cache.bvh.indices, bvh.indices, bvh.referenceCount * sizeof(U32)) == 0);
+    CHECK((U64(cache.bvh.nodes) % TC_BVH_CACHE_ALIGNMENT) == 0);
+    REQUIRE(cache.triangles);
+    bool trianglesMatch = true;
+    for (U32 i = 0; i < bvh.referenceCount; ++i) {
+        trianglesMatch &= TriangleEqual(cache.triangles[i], positions + 3 * bvh.indices[i]);
+    }
+    CHECK(trianglesMatch);
+
+    // The loaded tree traverses like the original
+    Ray ray = {{0.5f, 0.5f, -1.0f}, {0.01f, 0.02f, 1.0f}, 0.0f, F32Infinity()};
+    U32 visitedA = 0, visitedB = 0;
+    Traverse(&bvh, Precompute(ray), [&](U32, RaySlab*) { visitedA++; return true; });
+    Traverse(&cache.bvh, Precompute(ray), [&](U32, RaySlab*) { visitedB++; return true; });
+    CHECK(visitedA == visitedB);
+    BvhCacheClose(&cache);
+    CHECK(cache.mapping == 0);
+
+    // Other input, other options, damaged and missing files all fail cleanly
+    positions[7].x += 1e-3f;
+    CHECK(BvhCacheKey(positions, 3 * count, 0, count, options) != key);
+    positions[7].x -= 1e-3f;
+    options.maxLeafSize = 4;
+    CHECK(BvhCacheKey(positions, 3 * count, 0, count, options) != key);
+    CHECK(!BvhCacheLoad(path, key + 1, &cache));
+    CHECK(cache.mapping == 0);
+    Truncate(path, truncated, long(sizeof(BvhCacheHeader) + 100));
+    CHECK(!BvhCacheLoad(truncated, key, &cache));
+    Truncate(path, truncated, 8);
+    CHECK(!BvhCacheLoad(truncated, key, &cache));
+    CHECK(!BvhCacheLoad("teacup_test_missing.cache", key, &cache));
+
+    // Without positions the triangle section is left out
+    REQUIRE(BvhCacheWrite(path, key, &bvh));
+    REQUIRE(BvhCacheLoad(path, key, &cache));
+    CHECK(cache.triangles == 0);
+    CHECK(memcmp(cache.bvh.indices, bvh.indices, bvh.referenceCount * sizeof(U32)) == 0);
+    BvhCacheClose(&cache);
+
+    remove(path);
+    remove(truncated);
+    BvhFree(&bvh);
+    free(positions);
+}
+
+TEST_CASE("BVH cache of an empty BVH") {
+    const char* path = "teacup_test_empty_bvh.cache";
+    Bvh bvh;
+    BvhBuildTriangles(&bvh, 0, 0, 0);
+    U64 key = BvhCacheKey(0, 0, 0, 0);
+    REQUIRE(BvhCacheWrite(path, key, &bvh, 0));
+    BvhCache cache;
+    REQUIRE(BvhCacheLoad(path, key, &cache));
+    CHECK(cache.bvh.nodeCount == bvh.nodeCount);
+    CHECK(cache.bvh.primitiveCount == 0);
+    BvhCacheClose(&cache);
+    remove(path);
+    BvhFree(&bvh);
+}
+
+TEST_CASE("BVH cache written concurrently to one path") {
+    const char* path = "teacup_test_concurrent_bvh.cache";
+    const U32 count = 500;
+    U32 state = 11;
+    Vec3* positions = RandomTriangles(count, &state);
+    Bvh bvh;
+    BvhBuildTriangles(&bvh, positions, 0, count);
+    U64 key = BvhCacheKey(positions, 3 * count, 0, count);
+
+    // Writers that all missed the cache race to fill it. Each builds its own
+    // temporary file, so every write succeeds and the winner is complete.
+    const U32 writers = 16;
+    bool written[writers] = {};
+    ParallelFor(writers, 1, [&](U64 begin, U64 end) {
+        for (U64 i = begin; i < end; ++i) {
+            written[i] = BvhCacheWrite(path, key, &bvh, positions);
+        }
+    });
+    for (U32 i = 0; i < writers; ++i) {
+        CHECK(written[i]);
+    }
+    BvhCache cache;
+    REQUIRE(BvhCacheLoad(path, key, &cache));
+    CHECK(memcmp(cache.bvh.nodes, bvh.nodes, bvh.nodeCount * sizeof(BvhNode)) == 0);
+    BvhCacheClose(&cache);
+
+    remove(path);
+    BvhFree(&bvh);
+    free(positions);
+}
@@ -0,0 +1,79 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <teacup/color.h>
+#include <math.h>
+
+static F64 ReferenceSrgbEncode(F64 linear) {
+    return linear <= 0.0031308 ? 12.92 * linear : 1.055 * pow(linear, 1.0 / 2.4) - 0.055;
+}
+
+static F64 ReferenceSrgbDecode(F64 encoded) {
+    return encoded <= 0.04045 ? encoded / 12.92 : pow((encoded + 0.055) / 1.055, 2.4);
+}
+
+TEST_CASE("sRGB tables built at compile time") {
+    static_assert(srgbEncodeTable.values[0] == 0);
+    static_assert(srgbEncodeTable.values[TC_SRGB_ENCODE_TABLE_SIZE - 1] == 255);
+    static_assert(srgbDecodeTable.values[255] == 1.0f);
+
+    for (int i = 0; i < TC_SRGB_ENCODE_TABLE_SIZE; ++i) {
+        F64 linear = F64(i) / F64(TC_SRGB_ENCODE_TABLE_SIZE - 1);
+        CHECK(srgbEncodeTable.values[i] == U8(ReferenceSrgbEncode(linear) * 255.0 + 0.5));
+    }
+
+    for (int i = 0; i < 256; ++i) {
+        CHECK(srgbDecodeTable.values[i] == F32(ReferenceSrgbDecode(F64(i) / 255.0)));
+    }
+}
+
+TEST_CASE("sRGB encode and decode") {
+    // Every 8-bit code survives decoding and encoding again
+    for (int i = 0; i < 256; ++i) {
+        CHECK(SrgbEncode8(SrgbDecode8(U8(i))) == i);
+        CHECK(SrgbDecode(SrgbEncode(SrgbDecode8(U8(i)))) == doctest::Approx(SrgbDecode8(U8(i))).epsilon(1e-5));
+    }
+
+    CHECK(SrgbEncode8(-1.0f) == 0);
+    CHECK(SrgbEncode8(2.0f) == 255);
+    CHECK(SrgbEncode8(0.5f) == 188);
+}
+
+TEST_CASE("sRGB encode picks the nearest code") {
+    // Evenly spaced linear values, then the floats on both sides of every
+    // boundary between codes, where a table alone goes wrong
+    U32 mismatches = 0;
+    const U32 steps = 1 << 20;
+    for (U32 i = 0; i <= steps; ++i) {
+        F32 linear = F32(i) / F32(steps);
+        mismatches += SrgbEncode8(linear) != U8(ReferenceSrgbEncode(linear) * 255.0 + 0.5);
+    }
+    for (int code = 0; code < 255; ++code) {
+        F32 boundary = F32(ReferenceSrgbDecode((F64(code) + 0.5) / 255.0));
+        F32 linear = nextafterf(boundary, 0.0f);
+        for (int i = 0; i < 3; ++i, linear = nextafterf(linear, 1.0f)) {
+            mismatches += SrgbEncode8(linear) != U8(ReferenceSrgbEncode(linear) * 255.0 + 0.5);
+        }
+    }
+    CHECK(mismatches == 0);
+}
@@ -0,0 +1,226 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/fastmath.h>
+#include <math.h>
+
+#define TC_TEST_SWEEP_COUNT 200000
+
+// Distance from the double precision reference in units of the F32 spacing
+// at the reference value
+static F64 UlpError(F32 a, F64 reference) {
+    F32 r = fabsf(F32(reference));
+    r = r < 1.17549435e-38f ? 1.17549435e-38f : r;
+    F64 ulp = F64(nextafterf(r, INFINITY) - r);
+    return fabs(F64(a) - reference) / ulp;
+}
+
+static F64 RelativeError(F32 a, F64 reference) {
+    return fabs(F64(a) - reference) / fabs(reference);
+}
+
+static F32 Sweep(F32 lo, F32 hi, int i) {
+    return lo + (hi - lo) * (F32(i) / F32(TC_TEST_SWEEP_COUNT));
+}
+
+// Positive normal and denormal values, 1000 mantissas per exponent
+static F32 SweepPositive(int i) {
+    return ldexpf(1.0f + F32(i % 1000) / 1000.0f, (i / 1000) % 276 - 149);
+}
+
+TEST_CASE("Fast sin, cos and tan") {
+    F64 sinUlp = 0, cosUlp = 0, tanUlp = 0;
+    F64 sinLow = 0, cosLow = 0, tanLow = 0;
+    for (int i = 0; i < TC_TEST_SWEEP_COUNT; ++i) {
+        F32 x = Sweep(-100.0f, 100.0f, i);
+        F64 s = sin(F64(x));
+        F64 c = cos(F64(x));
+
+        sinUlp = fmax(sinUlp, UlpError(FastSin(x), s));
+        cosUlp = fmax(cosUlp, UlpError(FastCos(x), c));
+        tanUlp = fmax(tanUlp, UlpError(FastTan(x), s / c));
+
+        // Near the zeros only the absolute error is meaningful
+        sinLow = fmax(sinLow, fabs(F64(FastSin<MATH_ACCURACY_LOW>(x)) - s));
+        cosLow = fmax(cosLow, fabs(F64(FastCos<MATH_ACCURACY_LOW>(x)) - c));
+        tanLow = fmax(tanLow, RelativeError(FastTan<MATH_ACCURACY_LOW>(x), s / c));
+    }
+
+    CHECK(sinUlp <= 2.0);
+    CHECK(cosUlp <= 2.0);
+    CHECK(tanUlp <= 4.0);
+    CHECK(sinLow <= 1e-3);
+    CHECK(cosLow <= 1e-3);
+    CHECK(tanLow <= 1e-3);
+
+    // Over the whole documented range the absolute error stays put, while
+    // the error in ulps near the zeros grows with the reduction error
+    F64 sinFar = 0, cosFar = 0, sinFarLow = 0, cosFarLow = 0;
+    for (int i = 0; i <= TC_TEST_SWEEP_COUNT; ++i) {
+        F32 x = Sweep(-8192.0f, 8192.0f, i);
+        F64 s = sin(F64(x));
+        F64 c = cos(F64(x));
+        sinFar = fmax(sinFar, fabs(F64(FastSin(x)) - s));
+        cosFar = fmax(cosFar, fabs(F64(FastCos(x)) - c));
+        sinFarLow = fmax(sinFarLow, fabs(F64(FastSin<MATH_ACCURACY_LOW>(x)) - s));
+        cosFarLow = fmax(cosFarLow, fabs(F64(FastCos<MATH_ACCURACY_LOW>(x)) - c));
+    }
+
+    CHECK(sinFar <= 1.5e-7);
+    CHECK(cosFar <= 1.5e-7);
+    CHECK(sinFarLow <= 1e-3);
+    CHECK(cosFarLow <= 1e-3);
+}
+
+TEST_CASE("Fast atan and atan2") {
+    F64 atanUlp = 0, atan2Ulp = 0;
+    F64 atanLow = 0, atan2Low = 0;
+    for (int i = 0; i < TC_TEST_SWEEP_COUNT; ++i) {
+        F32 x = Sweep(-1000.0f, 1000.0f, i);
+        x = i % 2 ? x * 1e-3f : x;
+        F32 y = Sweep(-10.0f, 10.0f, (i * 7919) % TC_TEST_SWEEP_COUNT);
+        F64 a = atan(F64(x));
+        F64 a2 = atan2(F64(x), F64(y));
+
+        atanUlp = fmax(atanUlp, UlpError(FastATan(x), a));
+        atan2Ulp = fmax(atan2Ulp, UlpError(FastATan2(x, y), a2));
+        atanLow = fmax(atanLow, RelativeError(FastATan<MATH_ACCURACY_LOW>(x), a));
+        atan2Low = fmax(atan2Low, RelativeError(FastATan2<MATH_ACCURACY_LOW>(x, y), a2));
+    }
+
+    CHECK(atanUlp <= 3.0);
+    CHECK(atan2Ulp <= 3.0);
+    CHECK(atanLow <= 1e-3);
+    CHECK(atan2Low <= 1e-3);
+
+    CHECK(FastATan2(0.0f, 1.0f) == 0.0f);
+    CHECK(FastATan2(0.0f, -0.0f) == ATan2(0.0f, -0.0f));
+    CHECK(FastATan2(-0.0f, -1.0f) == ATan2(-0.0f, -1.0f));
+    CHECK(FastATan2(1.0f, -0.0f) == ATan2(1.0f, -0.0f));
+    CHECK(FastATan(F32Infinity()) == ATan(F32Infinity()));
+}
+
+TEST_CASE("Fast log2, exp2 and pow") {
+    F64 logUlp = 0, expUlp = 0, powError = 0;
+    F64 logLow = 0, expLow = 0, powLow = 0;
+    for (int i = 0; i < TC_TEST_SWEEP_COUNT; ++i) {
+        F32 x = SweepPositive(i);
+        F64 l = log2(F64(x));
+        if (x != 1.0f) {
+            logUlp = fmax(logUlp, UlpError(FastLogBase2(x), l));
+            logLow = fmax(logLow, RelativeError(FastLogBase2<MATH_ACCURACY_LOW>(x), l));
+        }
+
+        F32 e = Sweep(-125.0f, 125.0f, i);
+        expUlp = fmax(expUlp, UlpError(FastExp2(e), exp2(F64(e))));
+        expLow = fmax(expLow, RelativeError(FastExp2<MATH_ACCURACY_LOW>(e), exp2(F64(e))));
+
+        F32 a = Sweep(0.01f, 10.0f, i);
+        F32 b = Sweep(-4.0f, 4.0f, (i * 31) % TC_TEST_SWEEP_COUNT);
+        F64 p = pow(F64(a), F64(b));
+        powError = fmax(powError, RelativeError(FastPow(a, b), p));
+        powLow = fmax(powLow, RelativeError(FastPow<MATH_ACCURACY_LOW>(a, b), p));
+    }
+
+    CHECK(logUlp <= 2.0);
+    CHECK(expUlp <= 2.0);
+    CHECK(powError <= 2e-6);
+    CHECK(logLow <= 1e-3);
+    CHECK(expLow <= 1e-3);
+    CHECK(powLow <= 1e-3);
+
+    CHECK(FastLogBase2(0.0f) == -F32Infinity());
+    CHECK(FastLogBase2(F32Infinity()) == F32Infinity());
+    CHECK(isnan(FastLogBase2(-1.0f)));
+    CHECK(FastExp2(200.0f) == F32Infinity());
+    CHECK(FastExp2(-200.0f) == 0.0f);
+    CHECK(FastExp2(-F32Infinity()) == 0.0f);
+    CHECK(FastExp2(0.0f) == 1.0f);
+    CHECK(FastPow(0.0f, 0.0f) == 1.0f);
+    CHECK(FastPow(0.0f, 2.0f) == 0.0f);
+}
+
+TEST_CASE("Fast sqrt") {
+    F64 highUlp = 0, lowError = 0;
+    for (int i = 0; i < TC_TEST_SWEEP_COUNT; ++i) {
+        F32 x = SweepPositive(i);
+        highUlp = fmax(highUlp, UlpError(FastSqrt(x), sqrt(F64(x))));
+        lowError = fmax(lowError, RelativeError(FastSqrt<MATH_ACCURACY_LOW>(x), sqrt(F64(x))));
+    }
+
+    CHECK(highUlp <= 0.5);
+    CHECK(lowError <= 1e-3);
+
+    CHECK(FastSqrt<MATH_ACCURACY_LOW>(0.0f) == 0.0f);
+    CHECK(FastSqrt<MATH_ACCURACY_LOW>(F32Infinity()) == F32Infinity());
+    CHECK(isnan(FastSqrt<MATH_ACCURACY_LOW>(-1.0f)));
+}
+
+// Every lane of the wide versions must match the scalar version bit for bit
+template <MathAccuracy A, typename T>
+static void CheckFastMathLanes() {
+    const int lanes = TC_LANES(T);
+    F32 a[8], b[8];
+    F32 out[9][8];
+
+    for (int iteration = 0; iteration < 256; ++iteration) {
+        for (int i = 0; i < lanes; ++i) {
+            a[i] = Sweep(-50.0f, 50.0f, (iteration * lanes + i) * 97 % TC_TEST_SWEEP_COUNT);
+            b[i] = SweepPositive((iteration * lanes + i) * 389 % TC_TEST_SWEEP_COUNT);
+        }
+        T x = Load<T>(a);
+        T y = Load<T>(b);
+
+        T s, c;
+        FastSinCos<A>(x, &s, &c);
+        Store(out[0], s);
+        Store(out[1], c);
+        Store(out[2], FastTan<A>(x));
+        Store(out[3], FastATan<A>(x));
+        Store(out[4], FastATan2<A>(x, y));
+        Store(out[5], FastLogBase2<A>(y));
+        Store(out[6], FastExp2<A>(x));
+        Store(out[7], FastPow<A>(y, x * Splat<T>(0.1f)));
+        Store(out[8], FastSqrt<A>(y));
+
+        for (int i = 0; i < lanes; ++i) {
+            CHECK(BitEqual(out[0][i], FastSin<A>(a[i])));
+            CHECK(BitEqual(out[1][i], FastCos<A>(a[i])));
+            CHECK(BitEqual(out[2][i], FastTan<A>(a[i])));
+            CHECK(BitEqual(out[3][i], FastATan<A>(a[i])));
+            CHECK(BitEqual(out[4][i], FastATan2<A>(a[i], b[i])));
+            CHECK(BitEqual(out[5][i], FastLogBase2<A>(b[i])));
+            CHECK(BitEqual(out[6][i], FastExp2<A>(a[i])));
+            CHECK(BitEqual(out[7][i], FastPow<A>(b[i], a[i] * 0.1f)));
+            CHECK(BitEqual(out[8][i], FastSqrt<A>(b[i])));
+        }
+    }
+}
+
+TEST_CASE("Fast math lanes match scalar") {
+    CheckFastMathLanes<MATH_ACCURACY_HIGH, F32x4>();
+    CheckFastMathLanes<MATH_ACCURACY_HIGH, F32x8>();
+    CheckFastMathLanes<MATH_ACCURACY_LOW, F32x4>();
+    CheckFastMathLanes<MATH_ACCURACY_LOW, F32x8>();
+}
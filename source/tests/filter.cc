@@ -0,0 +1,52 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <teacup/filter.h>
+
+TEST_CASE("Gaussian filter table built at compile time") {
+    constexpr FilterTable wide = FilterTableGaussian(2.0f, 1.0f);
+    static_assert(gaussianFilterTable.radius == 1.5f);
+    static_assert(wide.values[0][0] > wide.values[0][1]);
+    static_assert(wide.values[TC_FILTER_TABLE_SIZE - 1][TC_FILTER_TABLE_SIZE - 1] > 0.0f);
+
+    for (int y = 0; y < TC_FILTER_TABLE_SIZE; ++y) {
+        for (int x = 0; x < TC_FILTER_TABLE_SIZE; ++x) {
+            Vec2 p = {(F32(x) + 0.5f) * 1.5f, (F32(y) + 0.5f) * 1.5f};
+            F32 weight = GaussianFilter(p / F32(TC_FILTER_TABLE_SIZE), 1.5f, 0.5f);
+            CHECK(gaussianFilterTable.values[y][x] == doctest::Approx(weight).epsilon(1e-6));
+
+            // Symmetric and separable
+            CHECK(gaussianFilterTable.values[y][x] == gaussianFilterTable.values[x][y]);
+        }
+    }
+}
+
+TEST_CASE("Filter table evaluation") {
+    const FilterTable* table = &gaussianFilterTable;
+    CHECK(Evaluate(table, {0.0f, 0.0f}) == table->values[0][0]);
+    CHECK(Evaluate(table, {-0.3f, 0.3f}) == Evaluate(table, {0.3f, -0.3f}));
+    CHECK(Evaluate(table, {1.49f, 0.0f}) == table->values[0][TC_FILTER_TABLE_SIZE - 1]);
+    CHECK(Evaluate(table, {1.5f, 0.0f}) == 0.0f);
+    CHECK(Evaluate(table, {0.0f, -2.0f}) == 0.0f);
+    CHECK(Evaluate(table, {0.1f, 0.2f}) > Evaluate(table, {0.6f, 0.7f}));
+}
@@ -0,0 +1,195 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/kernels.h>
+#include <teacup/triangle.h>
+#include <string.h>
+
+#define TC_TEST_KERNEL_COUNT 259
+
+TEST_CASE("CPU detection") {
+    U32 features = CpuFeaturesDetect();
+    CHECK(CpuTierSupported(CPU_TIER_BASELINE));
+    CHECK(CpuTierSupported(CpuTierBest()));
+    CHECK(KernelsGet() == KernelsGet(CpuTierBest()));
+    CHECK(KernelsGet(CPU_TIER_COUNT) == nullptr);
+
+    // Whatever the build was compiled for the CPU must be able to run
+#if defined(__AVX2__)
+    CHECK((features & CPU_FEATURE_AVX2) != 0);
+#endif
+#if defined(__SSE4_2__)
+    CHECK((features & CPU_FEATURE_SSE42) != 0);
+#endif
+#if defined(__aarch64__)
+    CHECK((features & CPU_FEATURE_NEON) != 0);
+#endif
+    (void) features;
+}
+
+TEST_CASE("Kernel tiers match baseline") {
+    U32 state = 17;
+    Mat4 a[TC_TEST_KERNEL_COUNT];
+    Mat4 b[TC_TEST_KERNEL_COUNT];
+    Box3 boxes[TC_TEST_KERNEL_COUNT];
+    for (int i = 0; i < TC_TEST_KERNEL_COUNT; ++i) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                a[i].raw[r][c] = RandomSignedF32(&state);
+                b[i].raw[r][c] = RandomSignedF32(&state);
+            }
+        }
+        boxes[i] = RandomBox3(&state);
+    }
+
+    // NaN bounds never overlap
+    boxes[5].min.y = AsF32(S32(0x7fc00000));
+    boxes[40].max.z = AsF32(S32(0x7fc00000));
+
+    const Kernels* baseline = KernelsGet(CPU_TIER_BASELINE);
+    Mat4 expected[TC_TEST_KERNEL_COUNT];
+    baseline->multiplyMat4s(a, b, expected, TC_TEST_KERNEL_COUNT);
+    for (int i = 0; i < TC_TEST_KERNEL_COUNT; ++i) {
+        Mat4 product = a[i] * b[i];
+        CHECK(memcmp(&expected[i], &product, sizeof(Mat4)) == 0);
+    }
+
+    Box3 query = {{-1.0f, -2.0f, -1.0f}, {1.0f, 0.5f, 2.0f}};
+    U32 expectedHits[TC_TEST_KERNEL_COUNT];
+    U64 expectedCount = baseline->overlapBoxes(boxes, TC_TEST_KERNEL_COUNT, query, expectedHits);
+    CHECK(expectedCount > 0);
+    CHECK(expectedCount < TC_TEST_KERNEL_COUNT);
+
+    U64 reference = 0;
+    for (int i = 0; i < TC_TEST_KERNEL_COUNT; ++i) {
+        if (Overlaps(boxes[i], query)) {
+            CHECK(expectedHits[reference] == U32(i));
+            ++reference;
+        }
+    }
+    CHECK(reference == expectedCount);
+
+    for (U32 tier = 0; tier < CPU_TIER_COUNT; ++tier) {
+        const Kernels* kernels = KernelsGet(CpuTier(tier));
+        if (!kernels) {
+            continue;
+        }
+        CAPTURE(CpuTierName(CpuTier(tier)));
+        CHECK(kernels->tier == CpuTier(tier));
+
+        Mat4 out[TC_TEST_KERNEL_COUNT];
+        kernels->multiplyMat4s(a, b, out, TC_TEST_KERNEL_COUNT);
+        CHECK(memcmp(out, expected, sizeof(out)) == 0);
+
+        // In place
+        memcpy(out, a, sizeof(out));
+        kernels->multiplyMat4s(out, b, out, TC_TEST_KERNEL_COUNT);
+        CHECK(memcmp(out, expected, sizeof(out)) == 0);
+
+        // Every count around the vector widths, so each tail path runs
+        for (U64 count = 0; count <= 40; ++count) {
+            U32 hits[TC_TEST_KERNEL_COUNT];
+            U64 hitCount = kernels->overlapBoxes(boxes, count, query, hits);
+            U64 expectedPrefix = 0;
+            while (expectedPrefix < expectedCount && expectedHits[expectedPrefix] < count) {
+                ++expectedPrefix;
+            }
+            CHECK(hitCount == expectedPrefix);
+            CHECK(memcmp(hits, expectedHits, hitCount * sizeof(U32)) == 0);
+        }
+
+        U32 hits[TC_TEST_KERNEL_COUNT];
+        U64 hitCount = kernels->overlapBoxes(boxes, TC_TEST_KERNEL_COUNT, query, hits);
+        CHECK(hitCount == expectedCount);
+        CHECK(memcmp(hits, expectedHits, hitCount * sizeof(U32)) == 0);
+    }
+}
+
+TEST_CASE("Triangle pack kernel tiers match baseline") {
+    U32 state = 23;
+    const U32 packCount = 64;
+    TrianglePack8 packs[packCount];
+    for (U32 i = 0; i < packCount; ++i) {
+        for (int lane = 0; lane < 8; ++lane) {
+            for (int k = 0; k < 3; ++k) {
+                for (int axis = 0; axis < 3; ++axis) {
+                    packs[i].corners[k][axis][lane] = RandomSignedF32(&state);
+                }
+            }
+            packs[i].primitive[lane] = 8 * i + U32(lane);
+        }
+    }
+
+    // Integer corners in the z = 1 plane, hit straight on through shared
+    // edges and corners, take the exact edge path
+    for (int lane = 0; lane < 8; ++lane) {
+        F32 x = F32(lane % 4) - 2.0f;
+        F32 y = F32(lane / 4) - 1.0f;
+        F32 corners[3][3] = {{x, y, 1.0f}, {x + 1.0f, y, 1.0f}, {x, y + 1.0f, 1.0f}};
+        for (int k = 0; k < 3; ++k) {
+            for (int axis = 0; axis < 3; ++axis) {
+                packs[0].corners[k][axis][lane] = corners[k][axis];
+            }
+        }
+    }
+
+    const U32 rayCount = 64;
+    Ray rays[rayCount];
+    for (U32 i = 0; i < rayCount; ++i) {
+        Vec3 direction = {RandomSignedF32(&state), RandomSignedF32(&state), RandomSignedF32(&state)};
+        rays[i] = {{RandomSignedF32(&state), RandomSignedF32(&state), RandomSignedF32(&state)}, direction, 0.0f, F32Infinity()};
+    }
+    rays[0] = {{0.0f, 0.0f, -1.0f}, {0.0f, 0.0f, 1.0f}, 0.0f, F32Infinity()};
+    rays[1] = {{-1.0f, 0.0f, -1.0f}, {0.0f, 0.0f, 1.0f}, 0.0f, F32Infinity()};
+    rays[2] = {{0.5f, 0.0f, -1.0f}, {0.0f, 0.0f, 1.0f}, 0.0f, 1.5f};
+
+    const Kernels* baseline = KernelsGet(CPU_TIER_BASELINE);
+    for (U32 tier = 0; tier < CPU_TIER_COUNT; ++tier) {
+        const Kernels* kernels = KernelsGet(CpuTier(tier));
+        if (!kernels) {
+            continue;
+        }
+        CAPTURE(CpuTierName(CpuTier(tier)));
+        U32 hits = 0;
+        for (U32 r = 0; r < rayCount; ++r) {
+            RayShear shear = PrecomputeShear(rays[r]);
+            for (U32 i = 0; i < packCount; ++i) {
+                TriangleHit expected = {}, hit = {};
+                bool expectedFound = baseline->intersectTrianglePack8(shear, packs[i], &expected);
+                bool found = kernels->intersectTrianglePack8(shear, packs[i], &hit);
+                CHECK(found == expectedFound);
+                if (found && expectedFound) {
+                    CHECK(memcmp(&hit, &expected, sizeof(TriangleHit)) == 0);
+                }
+                hits += found;
+            }
+        }
+        CHECK(hits > 0);
+    }
+
+    // A ray through the shared corner at the origin hits the pack
+    TriangleHit hit;
+    CHECK(KernelsGet()->intersectTrianglePack8(PrecomputeShear(rays[0]), packs[0], &hit));
+    CHECK(hit.t == 2.0f);
+}
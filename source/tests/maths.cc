@@ -21,7 +21,186 @@
 // SOFTWARE.
 
 #include <doctest/doctest.h>
+#include <tests/tests.h>
 #include <teacup/maths.h>
+#include <string.h>
+
+static Vec4 RandomVec4(U32* state) {
+    F32 x = RandomSignedF32(state);
+    F32 y = RandomSignedF32(state);
+    F32 z = RandomSignedF32(state);
+    F32 w = RandomSignedF32(state);
+    return {x, y, z, w};
+}
+
+static Quat RandomQuat(U32* state) {
+    F32 x = RandomSignedF32(state);
+    F32 y = RandomSignedF32(state);
+    F32 z = RandomSignedF32(state);
+    F32 w = RandomSignedF32(state);
+    return {x, y, z, w};
+}
+
+static Mat4 RandomMat4(U32* state) {
+    Mat4 mat;
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            mat.raw[r][c] = RandomSignedF32(state);
+        }
+    }
+    return mat;
+}
+
+// Products and sums are kept in separate statements so the reference is never
+// contracted into fused multiply-adds.
+static F32 ReferenceSum4(F32 a, F32 b, F32 c, F32 d) {
+    F32 s = a + b;
+    s = s + c;
+    s = s + d;
+    return s;
+}
+
+static Mat4 ReferenceMultiply(Mat4 a, Mat4 b) {
+    Mat4 mat;
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            F32 p0 = a.raw[r][0] * b.raw[0][c];
+            F32 p1 = a.raw[r][1] * b.raw[1][c];
+            F32 p2 = a.raw[r][2] * b.raw[2][c];
+            F32 p3 = a.raw[r][3] * b.raw[3][c];
+            mat.raw[r][c] = ReferenceSum4(p0, p1, p2, p3);
+        }
+    }
+    return mat;
+}
+
+static Quat ReferenceMultiply(Quat a, Quat b) {
+    F32 x = ReferenceSum4(a.x*b.w, a.w*b.x, a.y*b.z, -(a.z*b.y));
+    F32 y = ReferenceSum4(a.y*b.w, a.w*b.y, a.z*b.x, -(a.x*b.z));
+    F32 z = ReferenceSum4(a.z*b.w, a.w*b.z, a.x*b.y, -(a.y*b.x));
+    F32 w = ReferenceSum4(a.w*b.w, -(a.x*b.x), -(a.y*b.y), -(a.z*b.z));
+    return {x, y, z, w};
+}
+
+TEST_CASE("Vec4 operators are bit-identical to scalar") {
+    U32 state = 1;
+    for (int i = 0; i < 256; ++i) {
+        Vec4 a = RandomVec4(&state);
+        Vec4 b = RandomVec4(&state);
+        F32 s = RandomSignedF32(&state);
+
+        Vec4 add = a + b;
+        Vec4 sub = a - b;
+        Vec4 neg = -a;
+        Vec4 mul = a * s;
+        Vec4 div = s / b;
+        F32 inv = 1.0f / s;
+
+        for (int k = 0; k < 4; ++k) {
+            F32 expected[5] = {a.raw[k] + b.raw[k], a.raw[k] - b.raw[k], -a.raw[k], a.raw[k] * s, s / b.raw[k]};
+            F32 actual[5] = {add.raw[k], sub.raw[k], neg.raw[k], mul.raw[k], div.raw[k]};
+            CHECK(memcmp(expected, actual, sizeof(expected)) == 0);
+
+            F32 scaled = (a / s).raw[k];
+            F32 reference = a.raw[k] * inv;
+            CHECK(BitEqual(scaled, reference));
+        }
+    }
+}
+
+TEST_CASE("Mat4 operators are bit-identical to scalar") {
+    U32 state = 7;
+    for (int i = 0; i < 256; ++i) {
+        Mat4 a = RandomMat4(&state);
+        Mat4 b = RandomMat4(&state);
+        F32 s = RandomSignedF32(&state);
+
+        Mat4 mul = a * b;
+        Mat4 expected = ReferenceMultiply(a, b);
+        CHECK(memcmp(&mul, &expected, sizeof(Mat4)) == 0);
+
+        Mat4 add = a + b;
+        Mat4 sub = a - b;
+        Mat4 scaled = a * s;
+        Mat4 transposed = Transpose(a);
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                F32 e[4] = {a.raw[r][c] + b.raw[r][c], a.raw[r][c] - b.raw[r][c], a.raw[r][c] * s, a.raw[c][r]};
+                F32 v[4] = {add.raw[r][c], sub.raw[r][c], scaled.raw[r][c], transposed.raw[r][c]};
+                CHECK(memcmp(e, v, sizeof(e)) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("Quat operators are bit-identical to scalar") {
+    U32 state = 13;
+    for (int i = 0; i < 256; ++i) {
+        Quat a = RandomQuat(&state);
+        Quat b = RandomQuat(&state);
+
+        Quat mul = a * b;
+        Quat expected = ReferenceMultiply(a, b);
+        CHECK(memcmp(&mul, &expected, sizeof(Quat)) == 0);
+
+        Quat conj = Conjugate(a);
+        Quat sum = a + b;
+        for (int k = 0; k < 4; ++k) {
+            F32 e[2] = {k < 3 ? -a.raw[k] : a.raw[k], a.raw[k] + b.raw[k]};
+            F32 v[2] = {conj.raw[k], sum.raw[k]};
+            CHECK(memcmp(e, v, sizeof(e)) == 0);
+        }
+    }
+}
+
+TEST_CASE("Quat multiplication") {
+    Quat i = {1, 0, 0, 0};
+    Quat j = {0, 1, 0, 0};
+    Quat k = {0, 0, 1, 0};
+
+    Quat ij = i * j;
+    Quat jk = j * k;
+    Quat ki = k * i;
+
+    CHECK(ij.x == 0); CHECK(ij.y == 0); CHECK(ij.z == 1); CHECK(ij.w == 0);
+    CHECK(jk.x == 1); CHECK(jk.y == 0); CHECK(jk.z == 0); CHECK(jk.w == 0);
+    CHECK(ki.x == 0); CHECK(ki.y == 1); CHECK(ki.z == 0); CHECK(ki.w == 0);
+
+    Quat ii = i * i;
+    CHECK(ii.w == -1);
+}
+
+TEST_CASE("Quat rotation matrices") {
+    U32 state = 19;
+    for (int i = 0; i < 64; ++i) {
+        Quat a = Normalize(RandomQuat(&state));
+        Quat b = Normalize(RandomQuat(&state));
+
+        // Composition order matches the matrices
+        Mat4 product = Mat4FromQuat(a * b);
+        Mat4 expected = Mat4FromQuat(a) * Mat4FromQuat(b);
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                CHECK(product.raw[r][c] == doctest::Approx(expected.raw[r][c]).epsilon(1e-4));
+            }
+        }
+
+        // Round trip up to the sign, which names the same rotation
+        Quat back = QuatFromMat4(Mat4FromQuat(a));
+        CHECK(Abs(Dot(back, a)) == doctest::Approx(1.0f).epsilon(1e-5));
+
+        // Slerp hits both ends and turns at a steady rate
+        Quat start = Slerp(a, b, 0.0f);
+        Quat end = Slerp(a, b, 1.0f);
+        Quat quarter = Slerp(a, b, 0.25f);
+        CHECK(Abs(Dot(start, a)) == doctest::Approx(1.0f).epsilon(1e-5));
+        CHECK(Abs(Dot(end, b)) == doctest::Approx(1.0f).epsilon(1e-5));
+        CHECK(Length(quarter) == doctest::Approx(1.0f).epsilon(1e-5));
+        F32 total = ACos(Min(Abs(Dot(a, b)), 1.0f));
+        F32 part = ACos(Min(Abs(Dot(a, quarter)), 1.0f));
+        CHECK(part == doctest::Approx(0.25f * total).epsilon(1e-3));
+    }
+}
 
 TEST_CASE("Mat4 multiplication") {
     Mat4 a = {
@@ -91,3 +270,131 @@ TEST_CASE("Mat4 Inverse") {
     CHECK(inv.raw[3][2] == doctest::Approx(-1));
     CHECK(inv.raw[3][3] == doctest::Approx(-0.5));
 }
+
+static void CheckIdentity(Mat4 a) {
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            CHECK(a.raw[r][c] == doctest::Approx(r == c ? 1.0f : 0.0f).epsilon(1e-4).scale(1.0f));
+        }
+    }
+}
+
+TEST_CASE("Mat4 Inverse of random matrices") {
+    U32 state = 21;
+    for (int i = 0; i < 64; ++i) {
+        Mat4 a = RandomMat4(&state);
+        Mat4 inv = {};
+        if (TryInverse(a, &inv)) {
+            CheckIdentity(a * inv);
+            CheckIdentity(inv * a);
+        }
+    }
+}
+
+TEST_CASE("Mat4 InverseAffine") {
+    U32 state = 33;
+    for (int i = 0; i < 64; ++i) {
+        Mat4 a = RandomMat4(&state);
+        a.raw[3][0] = 0;
+        a.raw[3][1] = 0;
+        a.raw[3][2] = 0;
+        a.raw[3][3] = 1;
+
+        Mat4 inv = {};
+        Mat4 general = {};
+        REQUIRE(TryInverseAffine(a, &inv));
+        REQUIRE(TryInverse(a, &general));
+        CheckIdentity(a * inv);
+
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                CHECK(inv.raw[r][c] == doctest::Approx(general.raw[r][c]).epsilon(1e-3));
+            }
+        }
+
+        CHECK(inv.raw[3][0] == 0);
+        CHECK(inv.raw[3][1] == 0);
+        CHECK(inv.raw[3][2] == 0);
+        CHECK(inv.raw[3][3] == 1);
+    }
+}
+
+TEST_CASE("Mat4 TryInverse of singular matrices") {
+    Mat4 zero = {};
+    Mat4 rank3 = {
+        1, 2, 3, 4,
+        2, 4, 6, 8,
+        0, 1, 0, 1,
+        0, 0, 0, 1
+    };
+
+    Mat4 untouched = Mat4Identity();
+    CHECK(!TryInverse(zero, &untouched));
+    CHECK(!TryInverse(rank3, &untouched));
+    CHECK(!TryInverseAffine(zero, &untouched));
+    CHECK(!TryInverseAffine(rank3, &untouched));
+    Mat4 identity = Mat4Identity();
+    CHECK(memcmp(&untouched, &identity, sizeof(Mat4)) == 0);
+}
+
+// Forces evaluation at runtime so the SIMD paths are compared against the
+// scalar ones taken during constant evaluation
+template <typename T>
+static T Runtime(T a) {
+    volatile U8 bytes[sizeof(T)];
+    memcpy((void*) bytes, &a, sizeof(T));
+    T result;
+    memcpy(&result, (const void*) bytes, sizeof(T));
+    return result;
+}
+
+TEST_CASE("Constant evaluation matches runtime") {
+    constexpr Mat4 a = {
+        0.5f, 2, 6, 1,
+        0, 6.25f, 2, 0,
+        3, 8, 1.125f, 4,
+        1, 8, 5, 6
+    };
+    constexpr Mat4 b = {
+        7, 5, 8, 0,
+        1, 0.3f, 2, 6,
+        9, 4, 3, 8,
+        5, 3, 7, 0.7f
+    };
+    constexpr Quat p = {0.1f, 0.2f, 0.3f, 0.9f};
+    constexpr Quat q = {-0.4f, 0.5f, 0.25f, 0.6f};
+    constexpr Vec4 u = {1.5f, -2.0f, 0.1f, 3.0f};
+    constexpr Vec3 v = {0.3f, -0.7f, 2.0f};
+    constexpr Box3 box = {{-1, -1, -1}, {1, 1, 1}};
+
+    constexpr Mat4 product = a * b;
+    constexpr Mat4 sum = a + b * 0.5f - Transpose(a);
+    constexpr Quat rotation = Normalize(p * Conjugate(q) + q / 3.0f);
+    constexpr Vec4 scaled = (u * 3.0f - u / 7.0f) + 2.0f / u;
+    constexpr Vec3 point = TransformPoint(product, Normalize(Cross(v, Vec3{1, 0, 0})));
+    static_assert(product.raw[0][0] == 0.5f*7 + 2*1 + 6*9 + 1*5);
+    static_assert(IsAffine(Mat4Identity()));
+    static_assert(Overlaps(box, Union(box, v)) && Inside(box, Vec3{0.5f, 0.5f, 0.5f}));
+    static_assert(Sqrt(4.0f) == 2.0f && Floor(-1.5f) == -2.0f && Ceil(1.25f) == 2.0f);
+
+    Mat4 ra = Runtime(a);
+    Mat4 rb = Runtime(b);
+    Quat rp = Runtime(p);
+    Quat rq = Runtime(q);
+    Vec4 ru = Runtime(u);
+    Mat4 runtimeProduct = ra * rb;
+    Mat4 runtimeSum = ra + rb * 0.5f - Transpose(ra);
+    Quat runtimeRotation = Normalize(rp * Conjugate(rq) + rq / 3.0f);
+    Vec4 runtimeScaled = (ru * 3.0f - ru / 7.0f) + 2.0f / ru;
+    Vec3 runtimePoint = TransformPoint(runtimeProduct, Normalize(Cross(Runtime(v), Vec3{1, 0, 0})));
+
+    CHECK(memcmp(&product, &runtimeProduct, sizeof(Mat4)) == 0);
+    CHECK(memcmp(&sum, &runtimeSum, sizeof(Mat4)) == 0);
+    CHECK(memcmp(&rotation, &runtimeRotation, sizeof(Quat)) == 0);
+    CHECK(memcmp(&scaled, &runtimeScaled, sizeof(Vec4)) == 0);
+    CHECK(BitEqual(point, runtimePoint));
+
+    for (F32 x = 0.01f; x < 100.0f; x *= 1.37f) {
+        CHECK(Runtime(Sqrt(x)) == sqrtf(Runtime(x)));
+    }
+}
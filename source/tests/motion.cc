@@ -0,0 +1,197 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/motion.h>
+#include <stdlib.h>
+#include <string.h>
+
+static Quat RandomRotation(U32* state) {
+    Quat quat = {RandomF32(state) - 0.5f, RandomF32(state) - 0.5f, RandomF32(state) - 0.5f, RandomF32(state) - 0.5f};
+    return Normalize(quat);
+}
+
+static Box3 LerpBox(Box3 a, Box3 b, F32 t) {
+    return {Lerp(a.min, b.min, t), Lerp(a.max, b.max, t)};
+}
+
+TEST_CASE("Motion BVH finds the boxes at the ray time") {
+    const U32 count = 2000;
+    const U32 segmentCount = 3;
+    const U32 keyCount = segmentCount + 1;
+
+    // Small boxes moving along random polylines
+    U32 state = 3;
+    Box3* bounds = (Box3*) malloc(count * keyCount * sizeof(Box3));
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 p = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        for (U32 k = 0; k < keyCount; ++k) {
+            Vec3 size = {0.01f + RandomF32(&state) * 0.01f, 0.01f, 0.01f};
+            bounds[i * keyCount + k] = {p, p + size};
+            p = p + Vec3{RandomF32(&state) - 0.5f, RandomF32(&state) - 0.5f, RandomF32(&state) - 0.5f} * 0.2f;
+        }
+    }
+
+    MotionBvh bvh;
+    MotionBvhBuild(&bvh, bounds, count, segmentCount);
+    REQUIRE(bvh.segmentCount == segmentCount);
+
+    U32 total = 0;
+    for (int i = 0; i < 300; ++i) {
+        F32 time = i == 0 ? 0.0f : i == 1 ? 1.0f : RandomF32(&state);
+        Vec3 origin = {RandomF32(&state) * 2 - 0.5f, RandomF32(&state) * 2 - 0.5f, -1.0f};
+        Vec3 target = {RandomF32(&state), RandomF32(&state), RandomF32(&state)};
+        RaySlab ray = Precompute(Ray{origin, target - origin, 0.0f, F32Infinity()});
+
+        F32 fraction;
+        U32 segment = MotionSegment(segmentCount, time, &fraction);
+        U32 expected = 0;
+        for (U32 p = 0; p < count; ++p) {
+            expected += Intersect(ray, LerpBox(bounds[p * keyCount + segment], bounds[p * keyCount + segment + 1], fraction));
+        }
+        U32 found = 0;
+        Traverse(&bvh, ray, time, [&](U32 primitive, RaySlab* r) {
+            found += Intersect(*r, LerpBox(bounds[primitive * keyCount + segment], bounds[primitive * keyCount + segment + 1], fraction));
+            return true;
+        });
+        CHECK(found == expected);
+        total += found;
+    }
+    CHECK(total > 50);
+
+    // Refitting follows moved bounds, with the root keys exactly enclosing
+    // the primitive keys
+    Box3 lastKey = Box3Empty();
+    for (U32 i = 0; i < count * keyCount; ++i) {
+        bounds[i].min.z += 0.3f;
+        bounds[i].max.z += 0.3f;
+        if (i % keyCount == segmentCount) {
+            lastKey = Union(lastKey, bounds[i]);
+        }
+    }
+    MotionBvhRefit(&bvh, bounds);
+    CHECK(memcmp(&bvh.keyBounds[segmentCount], &lastKey, sizeof(Box3)) == 0);
+    CHECK(Inside(bvh.bvh.nodes[0].bounds, lastKey.min));
+    CHECK(Inside(bvh.bvh.nodes[0].bounds, lastKey.max));
+
+    MotionBvhFree(&bvh);
+    free(bounds);
+}
+
+TEST_CASE("Motion instance bounds enclose the swept object") {
+    Box3 boxes[2] = {{{-1, -2, -0.5f}, {3, 1, 0.5f}}, {{0, 0, 0}, {1, 1, 1}}};
+    Bvh blas;
+    BvhBuild(&blas, boxes, 0, 2);
+
+    U32 state = 8;
+    for (int i = 0; i < 50; ++i) {
+        TransformDecomposition keys[3];
+        for (U32 k = 0; k < 3; ++k) {
+            keys[k].translation = {RandomF32(&state) * 10, RandomF32(&state) * 10, RandomF32(&state) * 10};
+            keys[k].rotation = RandomRotation(&state);
+            keys[k].stretch = Mat4Identity();
+            keys[k].stretch.raw[0][0] = 0.5f + RandomF32(&state);
+            keys[k].stretch.raw[1][1] = 0.5f + RandomF32(&state);
+            keys[k].stretch.raw[0][1] = keys[k].stretch.raw[1][0] = RandomF32(&state) * 0.2f;
+        }
+        MotionInstance instance = {keys, 3, 0};
+        F32 t0 = RandomF32(&state) * 0.5f;
+        F32 t1 = t0 + RandomF32(&state) * 0.5f;
+        Box3 swept = MotionInstanceBounds(&blas, &instance, t0, t1);
+
+        bool inside = true;
+        for (int s = 0; s <= 200; ++s) {
+            Mat4 mat = MotionTransformAt(&instance, t0 + (t1 - t0) * F32(s) / 200.0f);
+            for (int c = 0; c < 8; ++c) {
+                Box3 root = blas.nodes[0].bounds;
+                Vec3 corner = {(c & 1) ? root.max.x : root.min.x, (c & 2) ? root.max.y : root.min.y, (c & 4) ? root.max.z : root.min.z};
+                inside &= Inside(swept, TransformPoint(mat, corner));
+            }
+        }
+        CHECK(inside);
+
+        // Still objects get the plain transformed box
+        MotionInstance still = {keys, 1, 0};
+        Box3 box = MotionInstanceBounds(&blas, &still, t0, t1);
+        Box3 expected = TransformBox(TransformFromMatrix(Recompose(keys[0])), blas.nodes[0].bounds);
+        CHECK(memcmp(&box, &expected, sizeof(Box3)) == 0);
+    }
+    BvhFree(&blas);
+}
+
+TEST_CASE("Motion TLAS matches instances transformed at the ray time") {
+    Box3 boxes[64];
+    U32 state = 44;
+    for (U32 i = 0; i < 64; ++i) {
+        Vec3 p = {RandomF32(&state) * 2 - 1, RandomF32(&state) * 2 - 1, RandomF32(&state) * 2 - 1};
+        boxes[i] = {p, p + Vec3{0.1f, 0.1f, 0.1f}};
+    }
+    Bvh blas;
+    BvhBuild(&blas, boxes, 0, 64);
+
+    const U32 instanceCount = 200;
+    TransformDecomposition* keys = (TransformDecomposition*) malloc(instanceCount * 2 * sizeof(TransformDecomposition));
+    MotionInstance* instances = (MotionInstance*) malloc(instanceCount * sizeof(MotionInstance));
+    for (U32 i = 0; i < instanceCount; ++i) {
+        for (U32 k = 0; k < 2; ++k) {
+            keys[2 * i + k].translation = {RandomF32(&state) * 20, RandomF32(&state) * 20, RandomF32(&state) * 20};
+            keys[2 * i + k].rotation = RandomRotation(&state);
+            keys[2 * i + k].stretch = Mat4Identity() * (0.5f + RandomF32(&state));
+            keys[2 * i + k].stretch.raw[3][3] = 1;
+        }
+        instances[i] = {keys + 2 * i, i % 5 == 0 ? 1u : 2u, 0};
+    }
+
+    MotionTlas tlas;
+    MotionTlasBuild(&tlas, &blas, 1, instances, instanceCount, 4);
+
+    U32 total = 0;
+    for (int r = 0; r < 200; ++r) {
+        F32 time = RandomF32(&state);
+        Vec3 origin = {RandomF32(&state) * 20, RandomF32(&state) * 20, -10};
+        Vec3 target = {RandomF32(&state) * 20, RandomF32(&state) * 20, RandomF32(&state) * 20};
+        Ray ray = {origin, target - origin, 0.0f, F32Infinity()};
+
+        U32 expected = 0;
+        for (U32 i = 0; i < instanceCount; ++i) {
+            Mat4 inverse = InverseAffine(MotionTransformAt(instances + i, time));
+            RaySlab slab = Precompute(Ray{TransformPoint(inverse, ray.origin), TransformVector(inverse, ray.direction), 0.0f, F32Infinity()});
+            for (U32 b = 0; b < 64; ++b) {
+                expected += Intersect(slab, boxes[b]);
+            }
+        }
+        U32 found = 0;
+        Traverse(&tlas, ray, time, [&](U32, U32 primitive, const Ray&, RaySlab* slab) {
+            found += Intersect(*slab, boxes[primitive]);
+            return true;
+        });
+        CHECK(found == expected);
+        total += found;
+    }
+    CHECK(total > 20);
+
+    MotionTlasFree(&tlas);
+    free(instances);
+    free(keys);
+    BvhFree(&blas);
+}
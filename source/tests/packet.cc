@@ -0,0 +1,188 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/packet.h>
+#include <stdlib.h>
+
+// Rays through a small window from one point, like a tile of camera rays
+static void CameraRays(Ray* rays, U32 count, U32* state) {
+    Vec3 eye = {-0.5f, -0.5f, -1.0f};
+    Vec3 corner = RandomVec3(state) * 0.8f;
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 target = {corner.x + RandomF32(state) * 0.1f, corner.y + RandomF32(state) * 0.1f, 0.0f};
+        rays[i] = {eye, target - eye, 0.0f, F32Infinity()};
+    }
+}
+
+static void RandomRays(Ray* rays, U32 count, U32* state) {
+    for (U32 i = 0; i < count; ++i) {
+        rays[i] = {RandomVec3(state), RandomVec3(state) - Vec3{0.5f, 0.5f, 0.5f}, 0.0f, F32Infinity()};
+    }
+}
+
+TEST_CASE("Packet frustum never culls a box a ray hits") {
+    U32 state = 3;
+    Ray rays[TC_RAY_PACKET_SIZE];
+    U32 culled = 0;
+    for (int i = 0; i < 200; ++i) {
+        U32 count = 1 + U32(RandomF32(&state) * TC_RAY_PACKET_SIZE);
+        CameraRays(rays, count, &state);
+        RayPacket<F32x4> packet;
+        RayPacketInit(&packet, rays, count);
+        REQUIRE(packet.frustum);
+        CHECK(packet.coherence > 0.9f);
+
+        for (int b = 0; b < 50; ++b) {
+            Vec3 p = RandomVec3(&state);
+            Box3 box = {p, p + RandomVec3(&state) * 0.05f};
+            if (!FrustumMisses(packet, box)) {
+                continue;
+            }
+            ++culled;
+            for (U32 r = 0; r < count; ++r) {
+                REQUIRE(!Intersect(Precompute(rays[r]), box));
+            }
+        }
+    }
+    CHECK(culled > 1000);
+
+    RandomRays(rays, TC_RAY_PACKET_SIZE, &state);
+    RayPacket<F32x8> packet;
+    RayPacketInit(&packet, rays, TC_RAY_PACKET_SIZE);
+    CHECK(!packet.frustum);
+    CHECK(packet.coherence < 0.5f);
+}
+
+TEST_CASE("Ray stream sort groups rays by octant") {
+    const U32 count = 5000;
+    U32 state = 5;
+    Ray* rays = (Ray*) malloc(count * sizeof(Ray));
+    RandomRays(rays, count, &state);
+    U32* order = (U32*) malloc(count * sizeof(U32));
+    RayStreamSort(rays, count, order);
+
+    bool* seen = (bool*) calloc(count, sizeof(bool));
+    U32 octantChanges = 0;
+    U32 last = 0;
+    for (U32 i = 0; i < count; ++i) {
+        REQUIRE(order[i] < count);
+        REQUIRE(!seen[order[i]]);
+        seen[order[i]] = true;
+        Vec3 d = rays[order[i]].direction;
+        U32 octant = U32(d.x < 0) | U32(d.y < 0) << 1 | U32(d.z < 0) << 2;
+        CHECK(octant >= last);
+        octantChanges += i > 0 && octant != last;
+        last = octant;
+    }
+    CHECK(octantChanges == 7);
+
+    free(seen);
+    free(order);
+    free(rays);
+}
+
+template <int N>
+static void CheckStream(const Bvh* bvh, const Box3* boxes, const Ray* rays, U32 count, RayStreamMode mode, const F32* expected) {
+    F32* nearest = (F32*) malloc(count * sizeof(F32));
+    for (U32 i = 0; i < count; ++i) {
+        nearest[i] = F32Infinity();
+    }
+    RayStreamOptions options;
+    options.mode = mode;
+    U32 packets = TraverseStream<N>(bvh, rays, count, [&](U32 ray, U32 primitive, F32* tMax) {
+        RaySlab slab = Precompute(rays[ray]);
+        slab.tMax = *tMax;
+        F32 entry, exit;
+        if (Intersect(slab, boxes[primitive], &entry, &exit)) {
+            *tMax = entry;
+            nearest[ray] = entry;
+        }
+    }, options);
+    U32 packetCount = (count + TC_RAY_PACKET_SIZE - 1) / TC_RAY_PACKET_SIZE;
+    if (mode == RAY_STREAM_PACKETS) {
+        CHECK(packets == packetCount);
+    }
+    if (mode == RAY_STREAM_SINGLE) {
+        CHECK(packets == 0);
+    }
+
+    for (U32 i = 0; i < count; ++i) {
+        REQUIRE(nearest[i] == expected[i]);
+    }
+    free(nearest);
+}
+
+TEST_CASE("Ray streams find the same hits as single rays") {
+    const U32 boxCount = 4000;
+    const U32 rayCount = 3000;
+    U32 state = 7;
+    Box3* boxes = RandomBoxes(boxCount, 0.02f, &state);
+    Bvh bvh;
+    BvhBuild(&bvh, boxes, 0, boxCount);
+
+    Ray* rays = (Ray*) malloc(rayCount * sizeof(Ray));
+    F32* expected = (F32*) malloc(rayCount * sizeof(F32));
+    for (int scene = 0; scene < 2; ++scene) {
+        for (U32 i = 0; i < rayCount; i += TC_RAY_PACKET_SIZE) {
+            U32 size = TC_MIN(rayCount - i, U32(TC_RAY_PACKET_SIZE));
+            if (scene == 0) {
+                CameraRays(rays + i, size, &state);
+            }
+            else {
+                RandomRays(rays + i, size, &state);
+            }
+        }
+
+        for (U32 i = 0; i < rayCount; ++i) {
+            expected[i] = F32Infinity();
+            Traverse(&bvh, Precompute(rays[i]), [&](U32 primitive, RaySlab* ray) {
+                F32 entry, exit;
+                if (Intersect(*ray, boxes[primitive], &entry, &exit)) {
+                    ray->tMax = entry;
+                    expected[i] = entry;
+                }
+                return true;
+            });
+        }
+
+        for (RayStreamMode mode : {RAY_STREAM_AUTO, RAY_STREAM_PACKETS, RAY_STREAM_SINGLE}) {
+            CheckStream<4>(&bvh, boxes, rays, rayCount, mode, expected);
+            CheckStream<8>(&bvh, boxes, rays, rayCount, mode, expected);
+        }
+
+        // Camera rays are traced as packets, scattered rays one at a time
+        U32 packets = TraverseStream<4>(&bvh, rays, rayCount, [](U32, U32, F32*) {});
+        if (scene == 0) {
+            CHECK(packets > rayCount / TC_RAY_PACKET_SIZE / 2);
+        }
+        else {
+            CHECK(packets == 0);
+        }
+    }
+
+    free(expected);
+    free(rays);
+    BvhFree(&bvh);
+    free(boxes);
+}
@@ -0,0 +1,81 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <teacup/parallel.h>
+
+TEST_CASE("ParallelFor covers every element once") {
+    const U64 count = 100003;
+    std::atomic<U32>* visits = new std::atomic<U32>[count];
+    for (U64 i = 0; i < count; ++i) {
+        visits[i] = 0;
+    }
+
+    std::atomic<U64> sum = {0};
+    ParallelFor(count, 1000, [&](U64 begin, U64 end) {
+        U64 local = 0;
+        for (U64 i = begin; i < end; ++i) {
+            visits[i]++;
+            local += i;
+        }
+        sum += local;
+    });
+
+    U64 once = 0;
+    for (U64 i = 0; i < count; ++i) {
+        once += visits[i] == 1;
+    }
+    CHECK(once == count);
+    CHECK(sum == count * (count - 1) / 2);
+    delete[] visits;
+}
+
+struct TestTask {
+    TaskGroup* group;
+    std::atomic<U32>* counter;
+    U32 depth;
+};
+
+// Each task spawns two children and waits on them, as recursive builds do
+static void TestTaskRun(void* context) {
+    TestTask* task = (TestTask*) context;
+    task->counter->fetch_add(1);
+    if (task->depth == 0) {
+        return;
+    }
+    TaskGroup group = {{0}};
+    TestTask children[2] = {{&group, task->counter, task->depth - 1}, {&group, task->counter, task->depth - 1}};
+    TaskRun(&group, TestTaskRun, children + 0);
+    TaskRun(&group, TestTaskRun, children + 1);
+    TaskWait(&group);
+}
+
+TEST_CASE("Nested tasks all complete") {
+    CHECK(ParallelThreadCount() >= 1);
+    std::atomic<U32> counter = {0};
+    TaskGroup group = {{0}};
+    TestTask root = {&group, &counter, 10};
+    TaskRun(&group, TestTaskRun, &root);
+    TaskWait(&group);
+    CHECK(counter == 2047);
+    CHECK(group.pending == 0);
+}
@@ -0,0 +1,155 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/quantized.h>
+
+// Random parent box with extents over several orders of magnitude and
+// children inside it, some of them flat or touching the parent planes
+static Box3 RandomChildren(U32* state, Box3* children, U32 count) {
+    Vec3 origin, extent;
+    for (int axis = 0; axis < 3; ++axis) {
+        origin.raw[axis] = (RandomF32(state) - 0.5f) * 2000.0f;
+        extent.raw[axis] = Pow(10.0f, RandomF32(state) * 6.0f - 3.0f);
+    }
+    Box3 parent = {origin, origin + extent};
+    for (U32 i = 0; i < count; ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            F32 a = origin.raw[axis] + RandomF32(state) * extent.raw[axis];
+            F32 b = origin.raw[axis] + RandomF32(state) * extent.raw[axis];
+            F32 roll = RandomF32(state);
+            if (roll < 0.1f) {
+                b = a;
+            }
+            else if (roll < 0.2f) {
+                a = parent.min.raw[axis];
+                b = parent.max.raw[axis];
+            }
+            children[i].min.raw[axis] = TC_MIN(TC_MIN(a, b), parent.max.raw[axis]);
+            children[i].max.raw[axis] = TC_MIN(TC_MAX(a, b), parent.max.raw[axis]);
+        }
+    }
+    return parent;
+}
+
+TEST_CASE("Quantized boxes contain the originals") {
+    TC_STATIC_ASSERT(sizeof(QuantizedBoxes8) == 64);
+    U32 state = 5;
+    for (int iteration = 0; iteration < 2000; ++iteration) {
+        Box3 children[8];
+        U32 count = 1 + iteration % 8;
+        Box3 parent = RandomChildren(&state, children, count);
+        QuantizedBoxes8 boxes;
+        Quantize(parent, children, count, &boxes);
+        CHECK(boxes.count == count);
+
+        for (U32 i = 0; i < count; ++i) {
+            Box3 decoded = Dequantize(&boxes, i);
+            for (int axis = 0; axis < 3; ++axis) {
+                F32 step = QuantizedStep(boxes.exponent[axis]);
+                CHECK(decoded.min.raw[axis] <= children[i].min.raw[axis]);
+                CHECK(decoded.max.raw[axis] >= children[i].max.raw[axis]);
+
+                // Conservative by at most one step plus rounding
+                CHECK(children[i].min.raw[axis] - decoded.min.raw[axis] <= step * 1.01f);
+                CHECK(decoded.max.raw[axis] - children[i].max.raw[axis] <= step * 1.01f);
+            }
+        }
+
+        // The step is no coarser than twice what the parent extent needs
+        for (int axis = 0; axis < 3; ++axis) {
+            F32 extent = parent.max.raw[axis] - parent.min.raw[axis];
+            CHECK(QuantizedStep(boxes.exponent[axis]) * 255.0f <= TC_MAX(extent * 2.01f, 1e-30f));
+        }
+    }
+}
+
+TEST_CASE("Quantized boxes of a degenerate parent") {
+    Box3 parent = {{1, 2, 3}, {1, 2, 3}};
+    QuantizedBoxes4 boxes;
+    Quantize(parent, &parent, 1, &boxes);
+    Box3 decoded = Dequantize(&boxes, 0);
+    CHECK(decoded.min.x <= 1.0f);
+    CHECK(decoded.max.x >= 1.0f);
+    CHECK(decoded.min.z <= 3.0f);
+    CHECK(decoded.max.z >= 3.0f);
+}
+
+template <typename T, int N>
+static void CheckQuantizedPacket() {
+    const int lanes = TC_LANES(T);
+    U32 state = 17;
+    int hits = 0;
+
+    for (int iteration = 0; iteration < 512; ++iteration) {
+        Box3 children[N];
+        U32 count = 1 + iteration % N;
+        Box3 parent = RandomChildren(&state, children, count);
+        QuantizedBoxes<N> boxes;
+        Quantize(parent, children, count, &boxes);
+
+        // Rays from around the parent towards points inside it
+        Vec3 from, to;
+        for (int axis = 0; axis < 3; ++axis) {
+            F32 extent = parent.max.raw[axis] - parent.min.raw[axis];
+            from.raw[axis] = parent.min.raw[axis] + extent * (RandomF32(&state) * 3.0f - 1.0f);
+            to.raw[axis] = parent.min.raw[axis] + extent * RandomF32(&state);
+        }
+        RaySlab ray = Precompute(Ray{from, to - from, 0.0f, F32Infinity()});
+
+        for (U32 first = 0; first < U32(N); first += lanes) {
+            Box3Packet<T> packet = Dequantize<T>(&boxes, first);
+            T tEntry, tExit;
+            U32 mask = MoveMask(Intersect(ray, &boxes, first, &tEntry, &tExit));
+            F32 minX[8], maxZ[8];
+            Store(minX, packet.min.x);
+            Store(maxZ, packet.max.z);
+
+            for (int i = 0; i < lanes; ++i) {
+                U32 index = first + i;
+                bool hit = (mask >> i) & 1;
+                if (index >= count) {
+                    CHECK(!hit);
+                    continue;
+                }
+                Box3 decoded = Dequantize(&boxes, index);
+                CHECK(BitEqual(decoded.min.x, minX[i]));
+                CHECK(BitEqual(decoded.max.z, maxZ[i]));
+                CHECK(hit == Intersect(ray, decoded));
+
+                // A hit on the original box is always a hit on the decoded one
+                if (Intersect(ray, children[index])) {
+                    CHECK(hit);
+                }
+                hits += hit;
+            }
+        }
+    }
+    CHECK(hits > 100);
+}
+
+TEST_CASE("Quantized box packets") {
+    CheckQuantizedPacket<F32x4, 4>();
+    CheckQuantizedPacket<F32x4, 8>();
+    CheckQuantizedPacket<F32x8, 8>();
+}
@@ -0,0 +1,215 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/raster.h>
+#include <stdlib.h>
+
+// A bumpy grid sharing its edges, a soup of loose triangles, a ground plane
+// reaching behind the eye and a triangle behind the camera, as an indexed
+// mesh
+struct RasterScene {
+    Vec3* positions;
+    U32* triangles;
+    U32 vertexCount;
+    U32 triangleCount;
+};
+
+#define TC_TEST_GRID 24
+#define TC_TEST_SOUP 300
+
+static void RasterSceneCreate(RasterScene* scene) {
+    U32 gridVertices = (TC_TEST_GRID + 1) * (TC_TEST_GRID + 1);
+    scene->vertexCount = gridVertices + 3 * TC_TEST_SOUP + 4 + 3;
+    scene->triangleCount = 2 * TC_TEST_GRID * TC_TEST_GRID + TC_TEST_SOUP + 2 + 1;
+    scene->positions = (Vec3*) malloc(scene->vertexCount * sizeof(Vec3));
+    scene->triangles = (U32*) malloc(3 * scene->triangleCount * sizeof(U32));
+
+    U32 state = 3;
+    Vec3* vertex = scene->positions;
+    U32* index = scene->triangles;
+    for (U32 j = 0; j <= TC_TEST_GRID; ++j) {
+        for (U32 i = 0; i <= TC_TEST_GRID; ++i) {
+            *vertex++ = {F32(i) * 0.25f - 3.0f, RandomF32(&state) * 0.2f, F32(j) * 0.25f - 1.0f};
+        }
+    }
+    for (U32 j = 0; j < TC_TEST_GRID; ++j) {
+        for (U32 i = 0; i < TC_TEST_GRID; ++i) {
+            U32 a = j * (TC_TEST_GRID + 1) + i;
+            U32 quad[6] = {a, a + 1, a + TC_TEST_GRID + 2, a, a + TC_TEST_GRID + 2, a + TC_TEST_GRID + 1};
+            for (U32 k = 0; k < 6; ++k) {
+                *index++ = quad[k];
+            }
+        }
+    }
+
+    for (U32 t = 0; t < TC_TEST_SOUP; ++t) {
+        Vec3 center = {RandomF32(&state) * 6 - 3, RandomF32(&state) * 3, RandomF32(&state) * 6 - 2};
+        for (U32 k = 0; k < 3; ++k) {
+            *index++ = U32(vertex - scene->positions);
+            *vertex++ = center + Vec3{RandomF32(&state) - 0.5f, RandomF32(&state) - 0.5f, RandomF32(&state) - 0.5f} * 0.6f;
+        }
+    }
+
+    U32 ground = U32(vertex - scene->positions);
+    *vertex++ = {-1000, -0.5f, -1000};
+    *vertex++ = {1000, -0.5f, -1000};
+    *vertex++ = {1000, -0.5f, 1000};
+    *vertex++ = {-1000, -0.5f, 1000};
+    U32 groundQuad[6] = {ground, ground + 1, ground + 2, ground, ground + 2, ground + 3};
+    for (U32 k = 0; k < 6; ++k) {
+        *index++ = groundQuad[k];
+    }
+
+    U32 behind = U32(vertex - scene->positions);
+    *vertex++ = {-1, 1, -20};
+    *vertex++ = {1, 1, -20};
+    *vertex++ = {0, 3, -20};
+    for (U32 k = 0; k < 3; ++k) {
+        *index++ = behind + k;
+    }
+}
+
+static void RasterSceneFree(RasterScene* scene) {
+    free(scene->positions);
+    free(scene->triangles);
+}
+
+TEST_CASE("Camera rays and the camera matrix agree") {
+    Camera camera = CameraLookAt({1, 2, -6}, {0, 0.5f, 0}, {0, 1, 0}, 0.9f, 160, 120);
+    bool projected = true;
+    bool depth = true;
+    for (U32 y = 0; y < camera.height; y += 7) {
+        for (U32 x = 0; x < camera.width; x += 5) {
+            Ray ray = CameraRay(&camera, x, y);
+            Vec3 point = ray.origin + ray.direction * 3.0f;
+            Vec3 ndc = TransformPoint(camera.worldToClip, point);
+            F32 px = (ndc.x + 1.0f) * 0.5f * F32(camera.width);
+            F32 py = (1.0f - ndc.y) * 0.5f * F32(camera.height);
+            projected &= Abs(px - (F32(x) + 0.5f)) < 1e-3f && Abs(py - (F32(y) + 0.5f)) < 1e-3f;
+            depth &= Abs(Dot(point - camera.eye, camera.forward) - 3.0f) < 1e-5f;
+        }
+    }
+    CHECK(projected);
+    CHECK(depth);
+}
+
+// Returns the number of pixels that hit
+template <int N>
+static U32 CheckRasterMatchesTrace(const RasterScene* scene, const Camera* camera) {
+    TriangleBvh<N> bvh;
+    BvhBuildOptions options;
+    options.maxLeafSize = N;
+    TriangleBvhBuild(&bvh, scene->positions, scene->triangles, scene->triangleCount, options);
+
+    U32 pixelCount = camera->width * camera->height;
+    TriangleHit* traced = (TriangleHit*) malloc(pixelCount * sizeof(TriangleHit));
+    TriangleHit* rasterized = (TriangleHit*) malloc(pixelCount * sizeof(TriangleHit));
+    TracePrimary(camera, &bvh, traced);
+    RasterizePrimary(camera, scene->positions, scene->triangles, scene->triangleCount, rasterized);
+
+    // Pixels only differ in primitive where two triangles tie on t
+    U32 hitCount = 0;
+    U32 tieCount = 0;
+    bool same = true;
+    for (U32 i = 0; i < pixelCount; ++i) {
+        const TriangleHit& a = traced[i];
+        const TriangleHit& b = rasterized[i];
+        hitCount += a.primitive != TC_U32_MAX;
+        if (a.primitive == b.primitive) {
+            same &= (a.primitive == TC_U32_MAX) ? b.t == F32Infinity() : a.t == b.t && a.u == b.u && a.v == b.v;
+        }
+        else {
+            same &= a.primitive != TC_U32_MAX && b.primitive != TC_U32_MAX && a.t == b.t;
+            tieCount++;
+        }
+    }
+    CHECK(same);
+    CHECK(tieCount < pixelCount / 100);
+
+    free(traced);
+    free(rasterized);
+    TriangleBvhFree(&bvh);
+    return hitCount;
+}
+
+TEST_CASE("Rasterized primary hits match traced ones") {
+    RasterScene scene;
+    RasterSceneCreate(&scene);
+
+    // Looking down at the grid, up over the horizon from close to the
+    // ground, and at a narrow field of view
+    Camera cameras[3] = {
+        CameraLookAt({1, 2, -6}, {0, 0.5f, 0}, {0, 1, 0}, 0.9f, 160, 120),
+        CameraLookAt({0.3f, -0.4f, -2.5f}, {0, 0.6f, 4}, {0, 1, 0}, 1.4f, 97, 61),
+        CameraLookAt({-0.5f, 1, -4}, {-0.6f, 0.2f, 0}, {0.2f, 1, 0}, 0.2f, 128, 128),
+    };
+    U32 pixelCount = 0;
+    U32 hitCount = 0;
+    for (const Camera& camera : cameras) {
+        pixelCount += camera.width * camera.height;
+        hitCount += CheckRasterMatchesTrace<4>(&scene, &camera);
+        CheckRasterMatchesTrace<8>(&scene, &camera);
+    }
+    CHECK(hitCount > pixelCount / 2);
+    CHECK(hitCount < pixelCount);
+
+    // Anywhere around the scene, down to grazing the ground
+    U32 state = 99;
+    for (int c = 0; c < 20; ++c) {
+        Vec3 eye = {RandomF32(&state) * 8 - 4, RandomF32(&state) * 3 - 0.45f, RandomF32(&state) * 8 - 5};
+        Vec3 target = {RandomF32(&state) * 6 - 3, RandomF32(&state) * 2, RandomF32(&state) * 6 - 2};
+        F32 fov = 0.1f + RandomF32(&state) * 2.5f;
+        Camera camera = CameraLookAt(eye, target, {0, 1, 0}, fov, 40 + U32(RandomF32(&state) * 100), 30 + U32(RandomF32(&state) * 100));
+        CheckRasterMatchesTrace<4>(&scene, &camera);
+    }
+    RasterSceneFree(&scene);
+}
+
+TEST_CASE("Rasterizing triangles far off screen") {
+    // One triangle covering the view, and past its edge triangles whose
+    // screen bounds lie far outside the range of S32, in front of the eye and
+    // reaching behind it
+    Vec3 positions[] = {
+        {-3, -3, 2}, {3, -3, 2}, {0, 3, 2},
+        {1e30f, 0, 1}, {2e30f, 0, 1}, {1e30f, 1e29f, 1},
+        {-1e30f, 0, 1}, {-1e30f, -1e29f, 1}, {-2e30f, 0, 1},
+        {1e30f, 0, -5}, {2e30f, 1, 5}, {1e30f, 1e29f, 5},
+        {0, 1e30f, -5}, {1, 1e30f, 5}, {0, 2e30f, 5},
+    };
+    U32 triangles[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14};
+    RasterScene scene = {positions, triangles, 15, 5};
+    Camera camera = CameraLookAt({0, 0, -1}, {0, 0, 0}, {0, 1, 0}, 1.0f, 48, 32);
+    CHECK(CheckRasterMatchesTrace<4>(&scene, &camera) > 0);
+}
+
+TEST_CASE("Rasterizing nothing leaves every pixel empty") {
+    Camera camera = CameraLookAt({0, 0, -1}, {0, 0, 0}, {0, 1, 0}, 1.0f, 33, 17);
+    TriangleHit hits[33 * 17];
+    RasterizePrimary(&camera, 0, 0, 0, hits);
+    bool empty = true;
+    for (const TriangleHit& hit : hits) {
+        empty &= hit.primitive == TC_U32_MAX && hit.t == F32Infinity();
+    }
+    CHECK(empty);
+}
@@ -0,0 +1,158 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/ray.h>
+
+// Some rays have zero direction components to exercise the infinite slabs
+static Ray RandomRay(U32* state) {
+    Ray ray = {RandomSignedVec3(state), RandomSignedVec3(state), 0.0f, F32Infinity()};
+    for (int i = 0; i < 3; ++i) {
+        if (RandomSignedF32(state) > 2.0f) {
+            ray.direction.raw[i] = 0.0f;
+        }
+    }
+    return ray;
+}
+
+// Slab test in double precision without precomputed inverses
+static bool ReferenceIntersect(Ray ray, Box3 box, F64* tEntry, F64* tExit) {
+    F64 entry = ray.tMin;
+    F64 exit = ray.tMax;
+    for (int i = 0; i < 3; ++i) {
+        F64 o = ray.origin.raw[i];
+        F64 d = ray.direction.raw[i];
+        if (d == 0) {
+            if (o < box.min.raw[i] || o > box.max.raw[i]) {
+                return false;
+            }
+            continue;
+        }
+        F64 t0 = (box.min.raw[i] - o) / d;
+        F64 t1 = (box.max.raw[i] - o) / d;
+        entry = TC_MAX(entry, TC_MIN(t0, t1));
+        exit = TC_MIN(exit, TC_MAX(t0, t1));
+    }
+    *tEntry = entry;
+    *tExit = exit;
+    return entry <= exit;
+}
+
+TEST_CASE("Ray box slab test") {
+    Box3 box = {{-1, -1, -1}, {1, 1, 1}};
+    F32 tEntry, tExit;
+
+    RaySlab through = Precompute(Ray{{-3, 0, 0}, {1, 0, 0}, 0.0f, F32Infinity()});
+    CHECK(through.signMask == 0);
+    CHECK(Intersect(through, box, &tEntry, &tExit));
+    CHECK(tEntry == 2.0f);
+    CHECK(tExit == doctest::Approx(4.0f));
+
+    RaySlab backward = Precompute(Ray{{3, 0.5f, 0}, {-2, 0, -0.0f}, 0.0f, F32Infinity()});
+    CHECK(backward.signMask == 5);
+    CHECK(Intersect(backward, box, &tEntry, &tExit));
+    CHECK(tEntry == 1.0f);
+    CHECK(tExit == doctest::Approx(2.0f));
+
+    // Inside the box the entry is clamped to tMin
+    CHECK(Intersect(Precompute(Ray{{0, 0, 0}, {0, 1, 0}, 0.0f, 10.0f}), box, &tEntry, &tExit));
+    CHECK(tEntry == 0.0f);
+
+    // Limited by tMax and missing altogether
+    CHECK(!Intersect(Precompute(Ray{{-3, 0, 0}, {1, 0, 0}, 0.0f, 1.5f}), box));
+    CHECK(!Intersect(Precompute(Ray{{-3, 2, 0}, {1, 0, 0}, 0.0f, F32Infinity()}), box));
+
+    // Axis-parallel rays outside a slab miss, and those on a box plane hit
+    // instead of producing NaN
+    CHECK(!Intersect(Precompute(Ray{{-3, 1.5f, 0}, {1, 0, 0}, 0.0f, F32Infinity()}), box));
+    CHECK(!Intersect(Precompute(Ray{{-3, -1.5f, 0}, {1, 0, 0}, 0.0f, F32Infinity()}), box));
+    CHECK(Intersect(Precompute(Ray{{-3, 1, 0}, {1, 0, 0}, 0.0f, F32Infinity()}), box, &tEntry, &tExit));
+    CHECK(tEntry == 2.0f);
+    CHECK(Intersect(Precompute(Ray{{-1, -1, -3}, {0, 0, 1}, 0.0f, F32Infinity()}), box));
+
+    // A flat box is still hit by a ray crossing it
+    Box3 flat = {{-1, 0, -1}, {1, 0, 1}};
+    CHECK(Intersect(Precompute(Ray{{0.5f, 2, 0.5f}, {0, -1, 0}, 0.0f, F32Infinity()}), flat, &tEntry, &tExit));
+    CHECK(tEntry == 2.0f);
+}
+
+TEST_CASE("Ray box slab test against reference") {
+    U32 state = 23;
+    int hits = 0;
+    for (int i = 0; i < 20000; ++i) {
+        Ray ray = RandomRay(&state);
+        Box3 box = RandomBox3(&state);
+        F32 tEntry, tExit;
+        F64 entry, exit;
+        bool hit = Intersect(Precompute(ray), box, &tEntry, &tExit);
+        bool reference = ReferenceIntersect(ray, box, &entry, &exit);
+
+        // Never a false miss, false hits only within rounding of a graze
+        if (reference) {
+            CHECK(hit);
+            if (exit - entry > 1e-4 && exit < 1e30) {
+                CHECK(tEntry == doctest::Approx(entry).epsilon(1e-5));
+                CHECK(tExit == doctest::Approx(exit).epsilon(1e-5));
+            }
+        }
+        else if (hit) {
+            CHECK(tExit - tEntry <= 1e-4f * TC_MAX(1.0f, Abs(tExit)));
+        }
+        hits += hit;
+    }
+    CHECK(hits > 1000);
+    CHECK(hits < 18000);
+}
+
+template <typename T>
+static void CheckRayPacket() {
+    const int lanes = TC_LANES(T);
+    U32 state = 31;
+
+    for (int iteration = 0; iteration < 256; ++iteration) {
+        RaySlab ray = Precompute(RandomRay(&state));
+        Box3 boxes[8];
+        for (int i = 0; i < lanes; ++i) {
+            boxes[i] = RandomBox3(&state);
+        }
+
+        T tEntry, tExit;
+        U32 mask = MoveMask(Intersect(ray, Gather<T>(boxes), &tEntry, &tExit));
+        F32 entry[8], exit[8];
+        Store(entry, tEntry);
+        Store(exit, tExit);
+
+        for (int i = 0; i < lanes; ++i) {
+            F32 e, x;
+            bool hit = Intersect(ray, boxes[i], &e, &x);
+            CHECK(hit == bool((mask >> i) & 1));
+            CHECK(BitEqual(e, entry[i]));
+            CHECK(BitEqual(x, exit[i]));
+        }
+    }
+}
+
+TEST_CASE("Ray box packets match scalar") {
+    CheckRayPacket<F32x4>();
+    CheckRayPacket<F32x8>();
+}
@@ -0,0 +1,126 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <teacup/sort.h>
+#include <algorithm>
+#include <stdlib.h>
+
+template <typename K>
+static void CheckRadixSort(U64 count, U32 keyBits, U64 seed) {
+    K* keys = (K*) malloc(count * sizeof(K));
+    K* scratchKeys = (K*) malloc(count * sizeof(K));
+    U32* values = (U32*) malloc(count * sizeof(U32));
+    U32* scratchValues = (U32*) malloc(count * sizeof(U32));
+    U64 state = seed;
+    for (U64 i = 0; i < count; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        K key = K(state >> 17) ^ K(state << 13);
+        // Short keys leave many duplicates, which tests stability
+        keys[i] = keyBits < sizeof(K) * 8 ? key & ((K(1) << keyBits) - 1) : key;
+        values[i] = U32(i);
+    }
+
+    U32* expected = (U32*) malloc(count * sizeof(U32));
+    for (U64 i = 0; i < count; ++i) {
+        expected[i] = U32(i);
+    }
+    std::stable_sort(expected, expected + count, [&](U32 a, U32 b) {
+        return keys[a] < keys[b];
+    });
+
+    K* original = (K*) malloc(count * sizeof(K));
+    std::copy(keys, keys + count, original);
+    RadixSort(keys, values, scratchKeys, scratchValues, count, keyBits);
+
+    bool sorted = true;
+    for (U64 i = 0; i < count; ++i) {
+        sorted &= values[i] == expected[i];
+        sorted &= keys[i] == original[expected[i]];
+    }
+    CHECK(sorted);
+
+    free(keys);
+    free(scratchKeys);
+    free(values);
+    free(scratchValues);
+    free(expected);
+    free(original);
+}
+
+TEST_CASE("RadixSort matches a stable sort") {
+    CheckRadixSort<U32>(0, 32, 1);
+    CheckRadixSort<U32>(1, 32, 1);
+    CheckRadixSort<U32>(1000, 32, 2);
+    CheckRadixSort<U32>(1000, 4, 3);
+    CheckRadixSort<U32>(1000, 30, 4);
+    CheckRadixSort<U64>(1000, 64, 5);
+    CheckRadixSort<U64>(1000, 63, 6);
+    CheckRadixSort<U64>(1000, 12, 7);
+
+    // Large enough to histogram and scatter in parallel
+    CheckRadixSort<U32>(300001, 32, 8);
+    CheckRadixSort<U64>(300001, 63, 9);
+}
+
+TEST_CASE("RadixSort skips digits every key shares") {
+    const U64 count = 5000;
+    U32* keys = (U32*) malloc(count * sizeof(U32));
+    U32* scratchKeys = (U32*) malloc(count * sizeof(U32));
+    U32* values = (U32*) malloc(count * sizeof(U32));
+    U32* scratchValues = (U32*) malloc(count * sizeof(U32));
+    for (U64 i = 0; i < count; ++i) {
+        keys[i] = 0xab000000u | U32((count - i) / 3) << 8;
+        values[i] = U32(i);
+    }
+    RadixSort(keys, values, scratchKeys, scratchValues, count);
+
+    bool sorted = true;
+    for (U64 i = 1; i < count; ++i) {
+        sorted &= keys[i - 1] <= keys[i];
+        sorted &= keys[i - 1] < keys[i] || values[i - 1] < values[i];
+    }
+    CHECK(sorted);
+    CHECK(keys[0] == 0xab000000u);
+
+    free(keys);
+    free(scratchKeys);
+    free(values);
+    free(scratchValues);
+}
+
+TEST_CASE("MortonExpand interleaves bits") {
+    static_assert(MortonExpand(0x3ffu) == 0x09249249u);
+    static_assert(MortonExpand(U64(0x1fffff)) == 0x1249249249249249ull);
+
+    // Bit i moves to bit 3i and bits above the coordinate width are dropped
+    bool spread = true;
+    for (U32 i = 0; i < 10; ++i) {
+        spread &= MortonExpand(1u << i) == 1u << (3 * i);
+    }
+    for (U32 i = 0; i < 21; ++i) {
+        spread &= MortonExpand(U64(1) << i) == U64(1) << (3 * i);
+    }
+    CHECK(spread);
+    CHECK(MortonExpand(0x400u) == 0);
+    CHECK(MortonExpand(U64(0x200000)) == 0);
+}
@@ -0,0 +1,108 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TC_TESTS_HEADER_GUARD
+#define TC_TESTS_HEADER_GUARD
+
+#include <teacup/types.h>
+#include <teacup/maths.h>
+#include <teacup/ray.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Random inputs
+
+// Linear congruential generator, so every test and benchmark draws the same
+// values from a seed on every platform
+
+// In [0, 1)
+inline F32 RandomF32(U32* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return F32(*state >> 8) / 16777216.0f;
+}
+
+// In [-4, 4), for comparing SIMD paths against plain scalar definitions bit
+// for bit over both signs
+inline F32 RandomSignedF32(U32* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return F32(*state >> 8) * (8.0f / 16777216.0f) - 4.0f;
+}
+
+inline Vec3 RandomVec3(U32* state) {
+    return {RandomF32(state), RandomF32(state), RandomF32(state)};
+}
+
+inline Vec3 RandomSignedVec3(U32* state) {
+    return {RandomSignedF32(state), RandomSignedF32(state), RandomSignedF32(state)};
+}
+
+inline Box3 RandomBox3(U32* state) {
+    Vec3 a = RandomSignedVec3(state);
+    Vec3 b = RandomSignedVec3(state);
+    return {Min(a, b), Max(a, b)};
+}
+
+// count boxes in the unit cube with sides up to size, freed with free
+inline Box3* RandomBoxes(U32 count, F32 size, U32* state) {
+    Box3* boxes = (Box3*) malloc(count * sizeof(Box3));
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 p = RandomVec3(state);
+        boxes[i] = {p, p + RandomVec3(state) * size};
+    }
+    return boxes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Comparisons
+
+// Exact equality that also holds for matching NaNs and tells -0 from 0
+inline bool BitEqual(F32 a, F32 b) {
+    return memcmp(&a, &b, sizeof(F32)) == 0;
+}
+
+inline bool BitEqual(Vec3 a, Vec3 b) {
+    return memcmp(&a, &b, sizeof(Vec3)) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reference intersection
+
+// Moller-Trumbore ray triangle test, independent of the watertight one and
+// the scalar baseline the triangle benchmarks measure against
+inline bool MollerTrumbore(Ray ray, const Triangle& triangle, F32* t, F32* u, F32* v) {
+    Vec3 e1 = triangle.v1 - triangle.v0;
+    Vec3 e2 = triangle.v2 - triangle.v0;
+    Vec3 p = Cross(ray.direction, e2);
+    F32 det = Dot(e1, p);
+    if (det == 0.0f) {
+        return false;
+    }
+    F32 inverse = 1.0f / det;
+    Vec3 s = ray.origin - triangle.v0;
+    *u = Dot(s, p) * inverse;
+    Vec3 q = Cross(s, e1);
+    *v = Dot(ray.direction, q) * inverse;
+    *t = Dot(e2, q) * inverse;
+    return *u >= 0 && *v >= 0 && *u + *v <= 1 && *t >= ray.tMin && *t <= ray.tMax;
+}
+
+#endif // TC_TESTS_HEADER_GUARD
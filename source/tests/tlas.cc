@@ -0,0 +1,473 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/tlas.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rotation about a random axis, uniform scale and translation
+static Transform RandomTransform(U32* state) {
+    Vec3 axis = Normalize(Vec3{RandomF32(state) - 0.5f, RandomF32(state) - 0.5f, RandomF32(state) - 0.5f});
+    F32 angle = RandomF32(state) * 6.0f;
+    F32 s = 0.5f + RandomF32(state);
+    Vec3 t = {RandomF32(state) * 8, RandomF32(state) * 8, RandomF32(state) * 8};
+    F32 c = Cos(angle);
+    F32 n = Sin(angle);
+    F32 k = 1.0f - c;
+    Mat4 mat = {
+        s*(c + axis.x*axis.x*k),        s*(axis.x*axis.y*k - axis.z*n), s*(axis.x*axis.z*k + axis.y*n), t.x,
+        s*(axis.y*axis.x*k + axis.z*n), s*(c + axis.y*axis.y*k),        s*(axis.y*axis.z*k - axis.x*n), t.y,
+        s*(axis.z*axis.x*k - axis.y*n), s*(axis.z*axis.y*k + axis.x*n), s*(c + axis.z*axis.z*k),        t.z,
+        0, 0, 0, 1
+    };
+    return TransformFromMatrix(mat);
+}
+
+struct TestScene {
+    Box3* boxes[3];
+    U32 boxCounts[3];
+    Bvh blases[3];
+    Instance* instances;
+    U32 instanceCount;
+    Tlas tlas;
+};
+
+static void TestSceneCreate(TestScene* scene, U32 instanceCount) {
+    U32 state = 21;
+    const U32 counts[3] = {500, 1, 0};
+    for (int b = 0; b < 3; ++b) {
+        scene->boxCounts[b] = counts[b];
+        scene->boxes[b] = RandomBoxes(counts[b], 0.05f, &state);
+        BvhBuild(scene->blases + b, scene->boxes[b], 0, counts[b]);
+    }
+    scene->instanceCount = instanceCount;
+    scene->instances = (Instance*) malloc(instanceCount * sizeof(Instance));
+    for (U32 i = 0; i < instanceCount; ++i) {
+        scene->instances[i] = {i == 0 ? TransformIdentity() : RandomTransform(&state), i % 7 == 6 ? 2u : i % 7 == 5 ? 1u : 0u};
+    }
+    TlasBuild(&scene->tlas, scene->blases, 3, scene->instances, instanceCount);
+}
+
+static void TestSceneFree(TestScene* scene) {
+    TlasFree(&scene->tlas);
+    for (int b = 0; b < 3; ++b) {
+        BvhFree(scene->blases + b);
+        free(scene->boxes[b]);
+    }
+    free(scene->instances);
+}
+
+TEST_CASE("Instance bounds contain the transformed primitives") {
+    TestScene scene;
+    TestSceneCreate(&scene, 50);
+    bool contained = true;
+    for (U32 i = 0; i < scene.instanceCount; ++i) {
+        const Instance* instance = scene.instances + i;
+        Box3 bounds = InstanceBounds(scene.blases, instance);
+        for (U32 k = 0; k < scene.boxCounts[instance->blas]; ++k) {
+            Box3 box = TransformBox(instance->transform, scene.boxes[instance->blas][k]);
+            contained &= Inside(bounds, box.min) && Inside(bounds, box.max);
+        }
+    }
+    CHECK(contained);
+    CHECK(scene.tlas.bvh.primitiveCount == scene.instanceCount);
+    TestSceneFree(&scene);
+}
+
+TEST_CASE("TLAS traversal matches brute force over every instance") {
+    TestScene scene;
+    TestSceneCreate(&scene, 200);
+
+    U32 state = 5;
+    U32 total = 0;
+    bool same = true;
+    bool closest = true;
+    for (int r = 0; r < 200; ++r) {
+        Vec3 origin = {RandomF32(&state) * 12 - 2, RandomF32(&state) * 12 - 2, -4};
+        Vec3 target = {RandomF32(&state) * 8, RandomF32(&state) * 8, RandomF32(&state) * 8};
+        Ray ray = {origin, target - origin, 0.0f, F32Infinity()};
+
+        U32 expected = 0;
+        F32 nearestExpected = F32Infinity();
+        for (U32 i = 0; i < scene.instanceCount; ++i) {
+            const Instance* instance = scene.instances + i;
+            RaySlab object = Precompute(InverseTransformRay(instance->transform, ray));
+            for (U32 k = 0; k < scene.boxCounts[instance->blas]; ++k) {
+                F32 entry, exit;
+                if (Intersect(object, scene.boxes[instance->blas][k], &entry, &exit)) {
+                    expected++;
+                    nearestExpected = TC_MIN(nearestExpected, entry);
+                }
+            }
+        }
+
+        U32 found = 0;
+        Traverse(&scene.tlas, ray, [&](U32 instance, U32 primitive, const Ray&, RaySlab* slab) {
+            found += Intersect(*slab, scene.boxes[scene.instances[instance].blas][primitive]);
+            return true;
+        });
+        same &= found == expected;
+        total += found;
+
+        F32 nearest = F32Infinity();
+        Traverse(&scene.tlas, ray, [&](U32 instance, U32 primitive, const Ray&, RaySlab* slab) {
+            F32 entry, exit;
+            if (Intersect(*slab, scene.boxes[scene.instances[instance].blas][primitive], &entry, &exit) && entry < nearest) {
+                nearest = entry;
+                slab->tMax = entry;
+            }
+            return true;
+        });
+        closest &= nearest == nearestExpected;
+    }
+    CHECK(same);
+    CHECK(closest);
+    CHECK(total > 20);
+
+    // Returning false stops the traversal across instances too
+    U32 calls = 0;
+    Traverse(&scene.tlas, Ray{{-2, -2, -2}, {1, 1, 1}, 0.0f, F32Infinity()}, [&](U32, U32, const Ray&, RaySlab*) {
+        calls++;
+        return false;
+    });
+    CHECK(calls <= 1);
+
+    TestSceneFree(&scene);
+}
+
+TEST_CASE("TLAS occlusion matches brute force over every instance") {
+    TestScene scene;
+    TestSceneCreate(&scene, 200);
+
+    const U32 rayCount = 200;
+    Ray rays[rayCount];
+    bool expected[rayCount];
+    U32 state = 15;
+    U32 blocked = 0;
+    for (U32 r = 0; r < rayCount; ++r) {
+        Vec3 origin = {RandomF32(&state) * 8, RandomF32(&state) * 8, RandomF32(&state) * 8};
+        Vec3 target = {RandomF32(&state) * 8, RandomF32(&state) * 8, RandomF32(&state) * 8};
+        rays[r] = {origin, target - origin, 0.0f, 1.0f};
+        expected[r] = false;
+        for (U32 i = 0; i < scene.instanceCount && !expected[r]; ++i) {
+            const Instance* instance = scene.instances + i;
+            RaySlab object = Precompute(InverseTransformRay(instance->transform, rays[r]));
+            for (U32 k = 0; k < scene.boxCounts[instance->blas] && !expected[r]; ++k) {
+                expected[r] = Intersect(object, scene.boxes[instance->blas][k]);
+            }
+        }
+        blocked += expected[r];
+    }
+    CHECK(blocked > 0);
+    CHECK(blocked < rayCount);
+
+    bool same = true;
+    for (U32 r = 0; r < rayCount; ++r) {
+        same &= Occluded(&scene.tlas, rays[r], [&](U32 instance, U32 primitive, const Ray&, const RaySlab& slab) {
+            return Intersect(slab, scene.boxes[scene.instances[instance].blas][primitive]);
+        }) == expected[r];
+    }
+    CHECK(same);
+
+    bool occluded[rayCount];
+    Occluded(&scene.tlas, rays, rayCount, occluded, [&](U32, U32 instance, U32 primitive, const Ray&, const RaySlab& slab) {
+        return Intersect(slab, scene.boxes[scene.instances[instance].blas][primitive]);
+    });
+    CHECK(memcmp(occluded, expected, sizeof(expected)) == 0);
+
+    TestSceneFree(&scene);
+}
+
+// Walks the tree from the root, checking that boxes contain their children,
+// parent and leaf links agree, and every live instance sits in one leaf
+static bool DynamicTlasValid(const DynamicTlas* tlas, const bool* live, U32* depth) {
+    const Bvh* bvh = &tlas->tlas.bvh;
+    U32 reached = 0;
+    U32 liveCount = 0;
+    for (U32 i = 0; i < tlas->tlas.instanceCount; ++i) {
+        liveCount += live[i];
+        if (live[i] != (tlas->leaves[i] != TC_U32_MAX)) {
+            return false;
+        }
+    }
+    *depth = 0;
+    if (bvh->nodeCount == 0) {
+        return liveCount == 0 && tlas->liveCount == 0;
+    }
+
+    bool valid = tlas->parents[0] == TC_U32_MAX;
+    U32 stack[TC_BVH_STACK_SIZE][2];
+    U32 stackSize = 0;
+    stack[stackSize][0] = 0;
+    stack[stackSize++][1] = 1;
+    while (stackSize > 0 && valid) {
+        stackSize--;
+        U32 index = stack[stackSize][0];
+        U32 level = stack[stackSize][1];
+        *depth = TC_MAX(*depth, level);
+        const BvhNode* node = bvh->nodes + index;
+        if (node->count > 0) {
+            valid &= node->count == 1 && node->offset < tlas->tlas.instanceCount && live[node->offset];
+            valid &= tlas->leaves[node->offset] == index && bvh->indices[node->offset] == node->offset;
+            Box3 box = InstanceBounds(tlas->tlas.blases, tlas->instances + node->offset);
+            valid &= Inside(node->bounds, box.min) && Inside(node->bounds, box.max);
+            reached++;
+            continue;
+        }
+        for (U32 k = 0; k < 2; ++k) {
+            const BvhNode* child = bvh->nodes + node->offset + k;
+            valid &= tlas->parents[node->offset + k] == index;
+            valid &= Inside(node->bounds, child->bounds.min) && Inside(node->bounds, child->bounds.max);
+            valid &= stackSize < TC_BVH_STACK_SIZE;
+            if (valid) {
+                stack[stackSize][0] = node->offset + k;
+                stack[stackSize++][1] = level + 1;
+            }
+        }
+    }
+    return valid && reached == liveCount && tlas->liveCount == liveCount;
+}
+
+// Number of boxes the ray hits over the live instances, and the nearest
+static U32 BruteForceHits(const TestScene* scene, const DynamicTlas* tlas, const bool* live, Ray ray, F32* nearest) {
+    U32 hits = 0;
+    *nearest = F32Infinity();
+    for (U32 i = 0; i < tlas->tlas.instanceCount; ++i) {
+        if (!live[i]) {
+            continue;
+        }
+        const Instance* instance = tlas->instances + i;
+        RaySlab object = Precompute(InverseTransformRay(instance->transform, ray));
+        for (U32 k = 0; k < scene->boxCounts[instance->blas]; ++k) {
+            F32 entry, exit;
+            if (Intersect(object, scene->boxes[instance->blas][k], &entry, &exit)) {
+                hits++;
+                *nearest = TC_MIN(*nearest, entry);
+            }
+        }
+    }
+    return hits;
+}
+
+TEST_CASE("Dynamic TLAS edits match brute force over the live instances") {
+    TestScene scene;
+    TestSceneCreate(&scene, 200);
+    DynamicTlas tlas;
+    DynamicTlasBuild(&tlas, scene.blases, 3, scene.instances, scene.instanceCount);
+
+    const U32 maxInstances = 1024;
+    bool live[maxInstances] = {};
+    for (U32 i = 0; i < scene.instanceCount; ++i) {
+        live[i] = true;
+    }
+    U32 depth = 0;
+    CHECK(DynamicTlasValid(&tlas, live, &depth));
+
+    U32 state = 33;
+    bool valid = true;
+    bool same = true;
+    bool closest = true;
+    bool reused = true;
+    U32 total = 0;
+    for (int round = 0; round < 20; ++round) {
+        for (int edit = 0; edit < 40; ++edit) {
+            U32 pick = U32(RandomF32(&state) * tlas.tlas.instanceCount);
+            F32 kind = RandomF32(&state);
+            if (kind < 0.3f && tlas.tlas.instanceCount < maxInstances) {
+                U32 freeCount = tlas.freeInstanceCount;
+                U32 handle = DynamicTlasInsert(&tlas, {RandomTransform(&state), pick % 3});
+                reused &= freeCount == 0 || !live[handle];
+                live[handle] = true;
+            }
+            else if (!live[pick]) {
+                continue;
+            }
+            else if (kind < 0.5f) {
+                DynamicTlasRemove(&tlas, pick);
+                live[pick] = false;
+            }
+            else if (kind < 0.8f) {
+                // Small moves mostly stay inside the parent's box
+                Transform transform = tlas.instances[pick].transform;
+                Mat4 mat = transform.matrix;
+                mat.raw[0][3] += (RandomF32(&state) - 0.5f) * 0.1f;
+                mat.raw[1][3] += (RandomF32(&state) - 0.5f) * 0.1f;
+                DynamicTlasUpdate(&tlas, pick, TransformFromMatrix(mat));
+            }
+            else {
+                DynamicTlasUpdate(&tlas, pick, RandomTransform(&state));
+            }
+        }
+        valid &= DynamicTlasValid(&tlas, live, &depth);
+
+        for (int r = 0; r < 20; ++r) {
+            Vec3 origin = {RandomF32(&state) * 12 - 2, RandomF32(&state) * 12 - 2, -4};
+            Vec3 target = {RandomF32(&state) * 8, RandomF32(&state) * 8, RandomF32(&state) * 8};
+            Ray ray = {origin, target - origin, 0.0f, F32Infinity()};
+            F32 nearestExpected;
+            U32 expected = BruteForceHits(&scene, &tlas, live, ray, &nearestExpected);
+
+            U32 found = 0;
+            F32 nearest = F32Infinity();
+            Traverse(&tlas.tlas, ray, [&](U32 instance, U32 primitive, const Ray&, RaySlab* slab) {
+                F32 entry, exit;
+                if (Intersect(*slab, scene.boxes[tlas.instances[instance].blas][primitive], &entry, &exit)) {
+                    found++;
+                    nearest = TC_MIN(nearest, entry);
+                }
+                return true;
+            });
+            same &= found == expected;
+            closest &= nearest == nearestExpected;
+            total += found;
+        }
+    }
+    CHECK(valid);
+    CHECK(same);
+    CHECK(closest);
+    CHECK(reused);
+    CHECK(total > 20);
+
+    // Emptied out and filled again
+    for (U32 i = 0; i < tlas.tlas.instanceCount; ++i) {
+        if (live[i]) {
+            DynamicTlasRemove(&tlas, i);
+            live[i] = false;
+        }
+    }
+    CHECK(DynamicTlasValid(&tlas, live, &depth));
+    CHECK(tlas.tlas.bvh.nodeCount == 0);
+    for (U32 i = 0; i < 300; ++i) {
+        live[DynamicTlasInsert(&tlas, scene.instances[i % scene.instanceCount])] = true;
+    }
+    CHECK(DynamicTlasValid(&tlas, live, &depth));
+
+    DynamicTlasFree(&tlas);
+    TestSceneFree(&scene);
+}
+
+TEST_CASE("Dynamic TLAS stays close to a full build") {
+    TestScene scene;
+    TestSceneCreate(&scene, 2);
+    DynamicTlas tlas;
+    DynamicTlasBuild(&tlas, scene.blases, 3, 0, 0);
+
+    // Inserted in order along a line, the worst case for a tree without
+    // rotations
+    const U32 count = 4000;
+    Instance* instances = (Instance*) malloc(count * sizeof(Instance));
+    bool* live = (bool*) malloc(count * sizeof(bool));
+    U32 state = 8;
+    bool handles = true;
+    for (U32 i = 0; i < count; ++i) {
+        Transform transform = RandomTransform(&state);
+        Mat4 mat = transform.matrix;
+        mat.raw[0][3] = F32(i) * 0.25f;
+        instances[i] = {TransformFromMatrix(mat), 0};
+        live[i] = true;
+        handles &= DynamicTlasInsert(&tlas, instances[i]) == i;
+    }
+    CHECK(handles);
+
+    U32 depth = 0;
+    CHECK(DynamicTlasValid(&tlas, live, &depth));
+    CHECK(depth < 64);
+
+    BvhBuildOptions options;
+    options.maxLeafSize = 1;
+    Tlas built;
+    TlasBuild(&built, scene.blases, 3, instances, count, options);
+    F32 builtCost = BvhSahCost(&built.bvh, options);
+    F32 dynamicCost = BvhSahCost(&tlas.tlas.bvh, options);
+    CHECK(dynamicCost < builtCost * 1.5f);
+
+    // Shuffled around, the tree does not degrade
+    for (U32 i = 0; i < 4 * count; ++i) {
+        U32 pick = U32(RandomF32(&state) * count);
+        Transform transform = RandomTransform(&state);
+        Mat4 mat = transform.matrix;
+        mat.raw[0][3] = RandomF32(&state) * count * 0.25f;
+        instances[pick] = {TransformFromMatrix(mat), 0};
+        DynamicTlasUpdate(&tlas, pick, instances[pick].transform);
+    }
+    CHECK(DynamicTlasValid(&tlas, live, &depth));
+    TlasFree(&built);
+    TlasBuild(&built, scene.blases, 3, instances, count, options);
+    builtCost = BvhSahCost(&built.bvh, options);
+    dynamicCost = BvhSahCost(&tlas.tlas.bvh, options);
+    CHECK(dynamicCost < builtCost * 1.5f);
+
+    TlasFree(&built);
+    DynamicTlasFree(&tlas);
+    free(instances);
+    free(live);
+    TestSceneFree(&scene);
+}
+
+TEST_CASE("Dynamic TLAS stays balanced over coincident and nested instances") {
+    Box3 unit = {{-1, -1, -1}, {1, 1, 1}};
+    Bvh blas;
+    BvhBuild(&blas, &unit, 0, 1);
+    DynamicTlas tlas;
+    DynamicTlasBuild(&tlas, &blas, 1, 0, 0);
+
+    // All on top of each other, then shells around the same center growing
+    // and shrinking
+    const U32 count = 900;
+    bool live[count];
+    for (U32 i = 0; i < count; ++i) {
+        Mat4 mat = Mat4Identity();
+        if (i >= 300) {
+            F32 s = i < 600 ? 1.0f + F32(i - 300) : 1.0f / F32(i - 598);
+            mat = Mat4{s, 0, 0, 2, 0, s, 0, 3, 0, 0, s, 4, 0, 0, 0, 1};
+        }
+        else {
+            mat.raw[0][3] = 2;
+            mat.raw[1][3] = 3;
+            mat.raw[2][3] = 4;
+        }
+        live[DynamicTlasInsert(&tlas, {TransformFromMatrix(mat), 0})] = true;
+    }
+    U32 depth = 0;
+    CHECK(DynamicTlasValid(&tlas, live, &depth));
+    CHECK(depth <= 16);
+
+    // A ray from the shared center passes through every instance
+    U32 found = 0;
+    Traverse(&tlas.tlas, Ray{{2, 3, 4}, {1, 0.5f, 0.25f}, 0.0f, F32Infinity()}, [&](U32, U32, const Ray&, RaySlab*) {
+        found++;
+        return true;
+    });
+    CHECK(found == count);
+
+    for (U32 i = 0; i < count; i += 2) {
+        DynamicTlasRemove(&tlas, i);
+        live[i] = false;
+    }
+    CHECK(DynamicTlasValid(&tlas, live, &depth));
+    CHECK(depth <= 16);
+
+    DynamicTlasFree(&tlas);
+    BvhFree(&blas);
+}
@@ -0,0 +1,317 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/transform.h>
+#include <string.h>
+
+#define TC_TEST_POINT_COUNT 103
+
+static Mat4 RandomMat4(U32* state, bool affine) {
+    Mat4 mat;
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            mat.raw[r][c] = RandomSignedF32(state);
+        }
+    }
+    if (affine) {
+        mat.raw[3][0] = 0;
+        mat.raw[3][1] = 0;
+        mat.raw[3][2] = 0;
+        mat.raw[3][3] = 1;
+    }
+    return mat;
+}
+
+TEST_CASE("TransformPoint") {
+    Mat4 translate = {
+        1, 0, 0, 5,
+        0, 1, 0, 6,
+        0, 0, 1, 7,
+        0, 0, 0, 1
+    };
+    Mat4 project = {
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 1, 0,
+        0, 0, 1, 0
+    };
+
+    Vec3 p = TransformPoint(translate, {1, 2, 3});
+    Vec3 v = TransformVector(translate, {1, 2, 3});
+    Vec3 q = TransformPoint(project, {2, 4, 2});
+
+    CHECK(p.x == 6); CHECK(p.y == 8); CHECK(p.z == 10);
+    CHECK(v.x == 1); CHECK(v.y == 2); CHECK(v.z == 3);
+    CHECK(q.x == 1); CHECK(q.y == 2); CHECK(q.z == 1);
+}
+
+TEST_CASE("TransformNormal keeps normals perpendicular") {
+    Mat4 shear = {
+        1, 2, 0, 1,
+        0, 1, 0, 2,
+        0, 0, 3, 3,
+        0, 0, 0, 1
+    };
+
+    Vec3 tangent = {1, -1, 0};
+    Vec3 normal = {1, 1, 0};
+    Vec3 t = TransformVector(shear, tangent);
+    Vec3 n = TransformNormal(Inverse(shear), normal);
+    CHECK(Dot(t, n) == doctest::Approx(0));
+}
+
+TEST_CASE("Batched transforms match scalar") {
+    U32 state = 3;
+    Vec3 in[TC_TEST_POINT_COUNT];
+    for (int i = 0; i < TC_TEST_POINT_COUNT; ++i) {
+        F32 x = RandomSignedF32(&state);
+        F32 y = RandomSignedF32(&state);
+        F32 z = RandomSignedF32(&state);
+        in[i] = {x, y, z};
+    }
+
+    for (int affine = 0; affine < 2; ++affine) {
+        for (U32 flags = 0; flags <= TRANSFORM_FLAGS_STREAM; ++flags) {
+            Mat4 a = RandomMat4(&state, affine != 0);
+            Mat4 inverse = Inverse(a);
+
+            // Offset by one element so streaming has to align the output
+            Vec3 points[TC_TEST_POINT_COUNT + 1];
+            Vec3 vectors[TC_TEST_POINT_COUNT + 1];
+            Vec3 normals[TC_TEST_POINT_COUNT + 1];
+            TransformPoints(a, in, points + 1, TC_TEST_POINT_COUNT, flags);
+            TransformVectors(a, in, vectors + 1, TC_TEST_POINT_COUNT, flags);
+            TransformNormals(inverse, in, normals + 1, TC_TEST_POINT_COUNT, flags);
+
+            Vec3 inPlace[TC_TEST_POINT_COUNT];
+            memcpy(inPlace, in, sizeof(in));
+            TransformPoints(a, inPlace, inPlace, TC_TEST_POINT_COUNT, flags);
+
+            F32 x[TC_TEST_POINT_COUNT], y[TC_TEST_POINT_COUNT], z[TC_TEST_POINT_COUNT];
+            for (int i = 0; i < TC_TEST_POINT_COUNT; ++i) {
+                x[i] = in[i].x;
+                y[i] = in[i].y;
+                z[i] = in[i].z;
+            }
+            Vec3Soa soa = {x, y, z};
+            TransformNormals(inverse, soa, soa, TC_TEST_POINT_COUNT, flags);
+
+            for (int i = 0; i < TC_TEST_POINT_COUNT; ++i) {
+                CHECK(BitEqual(points[i + 1], TransformPoint(a, in[i])));
+                CHECK(BitEqual(vectors[i + 1], TransformVector(a, in[i])));
+                CHECK(BitEqual(normals[i + 1], TransformNormal(inverse, in[i])));
+                CHECK(BitEqual(inPlace[i], TransformPoint(a, in[i])));
+                CHECK(BitEqual(Vec3{x[i], y[i], z[i]}, TransformNormal(inverse, in[i])));
+            }
+        }
+    }
+}
+
+// Rotation by angle about the unit axis, scaled by s and translated by t
+static Mat4 SimilarityMat4(Vec3 axis, F32 angle, F32 s, Vec3 t) {
+    F32 c = Cos(angle);
+    F32 n = Sin(angle);
+    F32 k = 1.0f - c;
+    Mat4 mat = {
+        s*(c + axis.x*axis.x*k),        s*(axis.x*axis.y*k - axis.z*n), s*(axis.x*axis.z*k + axis.y*n), t.x,
+        s*(axis.y*axis.x*k + axis.z*n), s*(c + axis.y*axis.y*k),        s*(axis.y*axis.z*k - axis.x*n), t.y,
+        s*(axis.z*axis.x*k - axis.y*n), s*(axis.z*axis.y*k + axis.x*n), s*(c + axis.z*axis.z*k),        t.z,
+        0, 0, 0, 1
+    };
+    return mat;
+}
+
+TEST_CASE("Transform properties") {
+    Vec3 axis = Normalize(Vec3{1, 2, 3});
+    U32 all = TRANSFORM_PROPERTY_IDENTITY | TRANSFORM_PROPERTY_AFFINE | TRANSFORM_PROPERTY_UNIFORM_SCALE | TRANSFORM_PROPERTY_RIGID;
+    U32 rigid = TRANSFORM_PROPERTY_AFFINE | TRANSFORM_PROPERTY_UNIFORM_SCALE | TRANSFORM_PROPERTY_RIGID;
+    Mat4 mirror = Mat4Identity();
+    mirror.raw[0][0] = -1;
+    Mat4 project = Mat4Identity();
+    project.raw[3][2] = 1;
+
+    CHECK(TransformPropertiesOf(Mat4Identity()) == all);
+    CHECK(TransformIdentity().properties == all);
+    CHECK(TransformPropertiesOf(SimilarityMat4(axis, 0.7f, 1.0f, {1, 2, 3})) == rigid);
+    CHECK(TransformPropertiesOf(SimilarityMat4(axis, 0.7f, 2.5f, {1, 2, 3})) == (TRANSFORM_PROPERTY_AFFINE | TRANSFORM_PROPERTY_UNIFORM_SCALE));
+    CHECK(TransformPropertiesOf(mirror) == TRANSFORM_PROPERTY_AFFINE);
+    CHECK(TransformPropertiesOf(project) == TRANSFORM_PROPERTY_NONE);
+
+    U32 state = 11;
+    CHECK(TransformPropertiesOf(RandomMat4(&state, true)) == TRANSFORM_PROPERTY_AFFINE);
+}
+
+TEST_CASE("Transform caches the inverse") {
+    U32 state = 13;
+    Vec3 axis = Normalize(Vec3{-1, 0.5f, 2});
+    Mat4 matrices[] = {
+        Mat4Identity(),
+        SimilarityMat4(axis, 2.1f, 1.0f, {4, -2, 1}),
+        SimilarityMat4(axis, -0.3f, 0.25f, {0, 3, -1}),
+        RandomMat4(&state, true),
+        RandomMat4(&state, false),
+    };
+
+    for (Mat4 a : matrices) {
+        Transform transform = TransformFromMatrix(a);
+        Mat4 product = transform.matrix * transform.inverse;
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                CHECK(product.raw[r][c] == doctest::Approx(r == c ? 1.0f : 0.0f).epsilon(1e-4).scale(1));
+            }
+        }
+
+        Mat4 general = Inverse(a);
+        for (int i = 0; i < 8; ++i) {
+            Vec3 p = {RandomSignedF32(&state), RandomSignedF32(&state), RandomSignedF32(&state)};
+            Vec3 expected = TransformNormal(general, p);
+            Vec3 normal = TransformNormal(transform, p);
+
+            // Uniform scale keeps the direction of the inverse transpose
+            if (transform.properties & TRANSFORM_PROPERTY_UNIFORM_SCALE) {
+                expected = Normalize(expected);
+                normal = Normalize(normal);
+            }
+            CHECK(normal.x == doctest::Approx(expected.x).epsilon(1e-4).scale(1));
+            CHECK(normal.y == doctest::Approx(expected.y).epsilon(1e-4).scale(1));
+            CHECK(normal.z == doctest::Approx(expected.z).epsilon(1e-4).scale(1));
+
+            // Affine transforms skip the bottom row
+            if (transform.properties & TRANSFORM_PROPERTY_AFFINE) {
+                CHECK(BitEqual(TransformPoint(transform, p), TransformPoint(AffineRows(a), p)));
+                Ray ray = InverseTransformRay(transform, {p, {1, 2, 3}, 0.0f, 10.0f});
+                CHECK(BitEqual(ray.origin, TransformPoint(AffineRows(transform.inverse), p)));
+            }
+
+            Vec3 back = TransformPoint(Inverse(transform), TransformPoint(transform, p));
+            CHECK(back.x == doctest::Approx(p.x).epsilon(1e-3).scale(1));
+            CHECK(back.y == doctest::Approx(p.y).epsilon(1e-3).scale(1));
+            CHECK(back.z == doctest::Approx(p.z).epsilon(1e-3).scale(1));
+        }
+    }
+
+    // Without the divide by w an infinite coordinate stays infinite
+    Transform scale = TransformFromMatrix(SimilarityMat4(axis, 0.0f, 2.0f, {0, 0, 0}));
+    CHECK(TransformPoint(scale, Vec3{F32Infinity(), 0, 0}).x == F32Infinity());
+}
+
+TEST_CASE("Transform composition and compact storage") {
+    U32 state = 17;
+    Vec3 axis = Normalize(Vec3{0, 1, 1});
+    Transform rotate = TransformFromMatrix(SimilarityMat4(axis, 1.2f, 1.0f, {1, 0, 0}));
+    Transform scale = TransformFromMatrix(SimilarityMat4(axis, 0.0f, 3.0f, {0, 0, 0}));
+    Transform shear = TransformFromMatrix(RandomMat4(&state, true));
+
+    CHECK((rotate * rotate).properties == rotate.properties);
+    CHECK((rotate * scale).properties == (TRANSFORM_PROPERTY_AFFINE | TRANSFORM_PROPERTY_UNIFORM_SCALE));
+    CHECK((rotate * shear).properties == TRANSFORM_PROPERTY_AFFINE);
+    Transform unchanged = TransformIdentity() * shear;
+    CHECK(memcmp(&unchanged, &shear, sizeof(Transform)) == 0);
+
+    TC_STATIC_ASSERT(sizeof(TransformAffine) < sizeof(Transform));
+    Transform composed = rotate * scale * shear;
+    TransformAffine affine = Compact(composed);
+    Transform expanded = Expand(affine);
+    CHECK(memcmp(&expanded, &composed, sizeof(Transform)) == 0);
+
+    for (int i = 0; i < 16; ++i) {
+        Vec3 p = {RandomSignedF32(&state), RandomSignedF32(&state), RandomSignedF32(&state)};
+        CHECK(BitEqual(TransformPoint(affine, p), TransformPoint(composed, p)));
+        CHECK(BitEqual(TransformVector(affine, p), TransformVector(composed, p)));
+        CHECK(BitEqual(TransformNormal(affine, p), TransformNormal(composed, p)));
+
+        Ray ray = {p, {1, 2, 3}, 0.0f, 10.0f};
+        Ray a = InverseTransformRay(affine, ray);
+        Ray b = InverseTransformRay(composed, ray);
+        CHECK(BitEqual(a.origin, b.origin));
+        CHECK(BitEqual(a.direction, b.direction));
+        CHECK(PointAt(b, 2.0f).x == doctest::Approx(TransformPoint(Inverse(composed), PointAt(ray, 2.0f)).x).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("TransformBox encloses the transformed corners") {
+    U32 state = 19;
+    Box3 box = {{-1, 0, 2}, {1, 3, 2.5f}};
+    for (int i = 0; i < 16; ++i) {
+        Transform transform = TransformFromMatrix(RandomMat4(&state, i < 8));
+        Box3 bounds = TransformBox(transform, box);
+        for (int corner = 0; corner < 8; ++corner) {
+            Vec3 p = {(corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z};
+            Vec3 q = TransformPoint(transform, p);
+            for (int axis = 0; axis < 3; ++axis) {
+                F32 slack = 1e-5f * (1.0f + Abs(q.raw[axis]));
+                CHECK(q.raw[axis] >= bounds.min.raw[axis] - slack);
+                CHECK(q.raw[axis] <= bounds.max.raw[axis] + slack);
+            }
+        }
+    }
+}
+
+TEST_CASE("Transform decomposition") {
+    U32 state = 31;
+    for (int i = 0; i < 64; ++i) {
+        Mat4 a = RandomMat4(&state, true);
+        Mat4 inverse;
+        if (!TryInverseAffine(a, &inverse)) {
+            continue;
+        }
+        TransformDecomposition parts = Decompose(a);
+        CHECK(Length(parts.rotation) == doctest::Approx(1.0f).epsilon(1e-4));
+
+        // Recomposes to the input, reflections included, with a symmetric
+        // stretch
+        Mat4 b = Recompose(parts);
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                CHECK(b.raw[r][c] == doctest::Approx(a.raw[r][c]).epsilon(1e-3).scale(1.0));
+                CHECK(parts.stretch.raw[r][c] == doctest::Approx(parts.stretch.raw[c][r]).epsilon(1e-3).scale(1.0));
+            }
+        }
+    }
+
+    // Halfway between two rotations of a scaled object is another rotation
+    // of it, not the shrunken matrix lerp
+    F32 s = 2.0f;
+    Mat4 start = {
+        s, 0, 0, 1,
+        0, s, 0, 2,
+        0, 0, s, 3,
+        0, 0, 0, 1
+    };
+    Mat4 end = {
+        0, -s, 0, 5,
+        s, 0, 0, 6,
+        0, 0, s, 7,
+        0, 0, 0, 1
+    };
+    Mat4 middle = Recompose(Interpolate(Decompose(start), Decompose(end), 0.5f));
+    Vec3 x = TransformVector(middle, Vec3{1, 0, 0});
+    CHECK(Length(x) == doctest::Approx(s));
+    CHECK(x.x == doctest::Approx(s * 0.70710678f));
+    CHECK(x.y == doctest::Approx(s * 0.70710678f));
+    Vec3 t = TransformPoint(middle, Vec3{0, 0, 0});
+    CHECK(t.x == doctest::Approx(3));
+    CHECK(t.z == doctest::Approx(5));
+    CHECK((TransformPropertiesOf(middle) & TRANSFORM_PROPERTY_UNIFORM_SCALE) != 0);
+}
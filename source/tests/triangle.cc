@@ -0,0 +1,214 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/triangle.h>
+#include <stdlib.h>
+
+// Jittered, slightly bumpy grid of size x size quads split into triangles
+// sharing every inner edge and corner
+static Vec3* CrackGrid(U32 size, U32** triangles, U32* triangleCount, U32* state) {
+    U32 side = size + 1;
+    Vec3* positions = (Vec3*) malloc(side * side * sizeof(Vec3));
+    for (U32 y = 0; y < side; ++y) {
+        for (U32 x = 0; x < side; ++x) {
+            bool inner = x > 0 && y > 0 && x < size && y < size;
+            F32 jitterX = inner ? (RandomF32(state) - 0.5f) * 0.4f : 0.0f;
+            F32 jitterY = inner ? (RandomF32(state) - 0.5f) * 0.4f : 0.0f;
+            positions[y * side + x] = {(F32(x) + jitterX) / F32(size), (F32(y) + jitterY) / F32(size), RandomF32(state) * 0.01f};
+        }
+    }
+
+    *triangleCount = 2 * size * size;
+    *triangles = (U32*) malloc(*triangleCount * 3 * sizeof(U32));
+    U32* index = *triangles;
+    for (U32 y = 0; y < size; ++y) {
+        for (U32 x = 0; x < size; ++x) {
+            U32 a = y * side + x;
+            U32 b = a + 1;
+            U32 c = a + side;
+            U32 d = c + 1;
+            bool flip = (x + y) & 1;
+            U32 quad[6] = {a, b, flip ? c : d, flip ? b : a, d, c};
+            for (U32 k = 0; k < 6; ++k) {
+                *index++ = quad[k];
+            }
+        }
+    }
+    return positions;
+}
+
+static Triangle TriangleAt(const Vec3* positions, const U32* triangles, U32 i) {
+    return {positions[triangles[3 * i]], positions[triangles[3 * i + 1]], positions[triangles[3 * i + 2]]};
+}
+
+TEST_CASE("Watertight triangle test agrees with Moller-Trumbore") {
+    U32 state = 5;
+    U32 hits = 0;
+    for (int i = 0; i < 20000; ++i) {
+        Triangle triangle = {RandomVec3(&state), RandomVec3(&state), RandomVec3(&state)};
+        Vec3 origin = RandomVec3(&state) * 4.0f - Vec3{1.5f, 1.5f, 1.5f};
+        Vec3 target = RandomVec3(&state);
+        Ray ray = {origin, target - origin, 0.0f, i % 2 ? 1.0f : F32Infinity()};
+
+        F32 t = 0, u = 0, v = 0;
+        bool expected = MollerTrumbore(ray, triangle, &t, &u, &v);
+        TriangleHit hit;
+        bool found = Intersect(PrecomputeShear(ray), triangle, &hit);
+
+        // Rays grazing an edge may go either way
+        if (expected && Min(Min(u, v), 1 - u - v) < 1e-3f) {
+            continue;
+        }
+        REQUIRE(found == expected);
+        if (found) {
+            ++hits;
+            CHECK(hit.t == doctest::Approx(t).epsilon(1e-4));
+            CHECK(hit.u == doctest::Approx(u).epsilon(1e-3));
+            CHECK(hit.v == doctest::Approx(v).epsilon(1e-3));
+        }
+    }
+    CHECK(hits > 1000);
+}
+
+TEST_CASE("Watertight triangle test leaves no cracks") {
+    U32 state = 7;
+    U32 triangleCount;
+    U32* triangles;
+    Vec3* positions = CrackGrid(16, &triangles, &triangleCount, &state);
+
+    BvhBuildOptions options;
+    options.maxLeafSize = 4;
+    TriangleBvh4 bvh4;
+    TriangleBvhBuild(&bvh4, positions, triangles, triangleCount, options);
+    options.maxLeafSize = 8;
+    TriangleBvh8 bvh8;
+    TriangleBvhBuild(&bvh8, positions, triangles, triangleCount, options);
+
+    // Rays aimed right at inner corners and edges, from above and below.
+    // Rays too close to grazing could pass the silhouette of a bump.
+    U32 rayCount = 0;
+    U32 misses[3] = {};
+    for (U32 i = 0; i < triangleCount * 3; ++i) {
+        U32 corner = triangles[i];
+        U32 next = triangles[i - i % 3 + (i + 1) % 3];
+        for (int k = 0; k < 2; ++k) {
+            Vec3 target = positions[corner];
+            if (k == 1) {
+                F32 s = RandomF32(&state);
+                target = positions[corner] * s + positions[next] * (1 - s);
+            }
+            if (target.x <= 0 || target.y <= 0 || target.x >= 1 || target.y >= 1) {
+                continue;
+            }
+            F32 height = (1.0f + RandomF32(&state)) * (RandomF32(&state) < 0.5f ? -1.0f : 1.0f);
+            Vec3 origin = target + Vec3{RandomF32(&state) * 2 - 1, RandomF32(&state) * 2 - 1, height};
+            Ray ray = {origin, target - origin, 0.0f, F32Infinity()};
+            ++rayCount;
+
+            RayShear shear = PrecomputeShear(ray);
+            bool found = false;
+            TriangleHit hit;
+            for (U32 p = 0; p < triangleCount && !found; ++p) {
+                found = Intersect(shear, TriangleAt(positions, triangles, p), &hit);
+            }
+            misses[0] += !found;
+            misses[1] += !Intersect(&bvh4, ray, &hit);
+            misses[2] += !Intersect(&bvh8, ray, &hit);
+        }
+    }
+    CHECK(rayCount > 1000);
+    CHECK(misses[0] == 0);
+    CHECK(misses[1] == 0);
+    CHECK(misses[2] == 0);
+
+    TriangleBvhFree(&bvh4);
+    TriangleBvhFree(&bvh8);
+    free(triangles);
+    free(positions);
+}
+
+template <int N>
+static void CheckTriangleBvh(BvhBuildQuality quality, U32 maxLeafSize) {
+    const U32 count = 3000;
+    U32 state = 11 + U32(N);
+    Vec3* positions = (Vec3*) malloc(3 * count * sizeof(Vec3));
+    for (U32 i = 0; i < count; ++i) {
+        Vec3 p = RandomVec3(&state);
+        for (U32 k = 0; k < 3; ++k) {
+            positions[3 * i + k] = p + (RandomVec3(&state) - Vec3{0.5f, 0.5f, 0.5f}) * 0.1f;
+        }
+    }
+
+    BvhBuildOptions options;
+    options.quality = quality;
+    options.maxLeafSize = maxLeafSize;
+    TriangleBvh<N> bvh;
+    TriangleBvhBuild(&bvh, positions, 0, count, options);
+    REQUIRE(bvh.bvh.referenceCount == bvh.packCount);
+    for (U32 i = 0; i < bvh.packCount; ++i) {
+        REQUIRE(bvh.packs[i].primitive[0] < count);
+    }
+
+    for (int i = 0; i < 300; ++i) {
+        Vec3 origin = RandomVec3(&state) * 2.0f - Vec3{0.5f, 0.5f, 0.5f};
+        Vec3 target = RandomVec3(&state);
+        Ray ray = {origin, target - origin, 0.0f, i % 3 ? F32Infinity() : 0.8f};
+        RayShear shear = PrecomputeShear(ray);
+
+        bool expected = false;
+        TriangleHit nearest = {ray.tMax, 0, 0, TC_U32_MAX};
+        for (U32 p = 0; p < count; ++p) {
+            TriangleHit hit;
+            shear.tMax = nearest.t;
+            if (Intersect(shear, Triangle{positions[3 * p], positions[3 * p + 1], positions[3 * p + 2]}, &hit) && (!expected || hit.t < nearest.t)) {
+                nearest = {hit.t, hit.u, hit.v, p};
+                expected = true;
+            }
+        }
+
+        TriangleHit hit;
+        bool found = Intersect(&bvh, ray, &hit);
+        REQUIRE(found == expected);
+        CHECK(Occluded(&bvh, ray) == expected);
+        if (found) {
+            // Bit-identical to the scalar test, up to which of two triangles
+            // at the same distance is reported
+            CHECK(hit.t == nearest.t);
+            if (hit.primitive == nearest.primitive) {
+                CHECK(hit.u == nearest.u);
+                CHECK(hit.v == nearest.v);
+            }
+        }
+    }
+
+    TriangleBvhFree(&bvh);
+    free(positions);
+}
+
+TEST_CASE("Triangle BVH finds the nearest triangle") {
+    CheckTriangleBvh<4>(BVH_BUILD_QUALITY_HIGH, 4);
+    CheckTriangleBvh<4>(BVH_BUILD_QUALITY_SPATIAL, 8);
+    CheckTriangleBvh<8>(BVH_BUILD_QUALITY_HIGH, 8);
+    CheckTriangleBvh<8>(BVH_BUILD_QUALITY_FAST, 8);
+}
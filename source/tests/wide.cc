@@ -0,0 +1,177 @@
+// MIT License
+//
+// Copyright (c) 2021 Aaron M. Roller
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <doctest/doctest.h>
+#include <tests/tests.h>
+#include <teacup/wide.h>
+#include <string.h>
+
+template <typename T>
+static void CheckVec3Packet() {
+    const int lanes = TC_LANES(T);
+    U32 state = 5;
+
+    for (int iteration = 0; iteration < 64; ++iteration) {
+        Vec3 a[8], b[8];
+        F32 t[8];
+        for (int i = 0; i < lanes; ++i) {
+            a[i] = RandomSignedVec3(&state);
+            b[i] = RandomSignedVec3(&state);
+            t[i] = RandomSignedF32(&state);
+        }
+
+        Vec3Packet<T> pa = Gather<T>(a);
+        Vec3Packet<T> pb = Gather<T>(b);
+        T pt = Load<T>(t);
+
+        F32 dot[8], length[8];
+        Store(dot, Dot(pa, pb));
+        Store(length, Length(pa));
+
+        for (int i = 0; i < lanes; ++i) {
+            CHECK(BitEqual(Extract(pa, i), a[i]));
+            CHECK(BitEqual(Extract(pa + pb, i), a[i] + b[i]));
+            CHECK(BitEqual(Extract(pa - pb, i), a[i] - b[i]));
+            CHECK(BitEqual(Extract(-pa, i), -a[i]));
+            CHECK(BitEqual(Extract(pa * pt, i), a[i] * t[i]));
+            CHECK(BitEqual(Extract(pa / pt, i), a[i] / t[i]));
+            CHECK(BitEqual(Extract(Cross(pa, pb), i), Cross(a[i], b[i])));
+            CHECK(BitEqual(Extract(Normalize(pa), i), Normalize(a[i])));
+            CHECK(BitEqual(Extract(Lerp(pa, pb, pt), i), Lerp(a[i], b[i], t[i])));
+            CHECK(BitEqual(Extract(Min(pa, pb), i), Min(a[i], b[i])));
+            CHECK(BitEqual(Extract(Max(pa, pb), i), Max(a[i], b[i])));
+            CHECK(BitEqual(dot[i], Dot(a[i], b[i])));
+            CHECK(BitEqual(length[i], Length(a[i])));
+        }
+
+        Vec3 out[8];
+        Scatter(out, pa + pb);
+        for (int i = 0; i < lanes; ++i) {
+            CHECK(BitEqual(out[i], a[i] + b[i]));
+        }
+
+        U32 indices[8];
+        for (int i = 0; i < lanes; ++i) {
+            indices[i] = U32(lanes - 1 - i);
+        }
+        Vec3Packet<T> reversed = Gather<T>(a, indices);
+        Scatter(out, indices, reversed);
+        for (int i = 0; i < lanes; ++i) {
+            CHECK(BitEqual(Extract(reversed, i), a[lanes - 1 - i]));
+            CHECK(BitEqual(out[i], a[i]));
+        }
+    }
+}
+
+template <typename T>
+static void CheckBox3Packet() {
+    const int lanes = TC_LANES(T);
+    U32 state = 9;
+
+    for (int iteration = 0; iteration < 64; ++iteration) {
+        Box3 a[8], b[8];
+        Vec3 p[8];
+        for (int i = 0; i < lanes; ++i) {
+            Vec3 c0 = RandomSignedVec3(&state);
+            Vec3 c1 = RandomSignedVec3(&state);
+            Vec3 c2 = RandomSignedVec3(&state);
+            Vec3 c3 = RandomSignedVec3(&state);
+            a[i] = {Min(c0, c1), Max(c0, c1)};
+            b[i] = {Min(c2, c3), Max(c2, c3)};
+            p[i] = RandomSignedVec3(&state);
+        }
+
+        Box3Packet<T> pa = Gather<T>(a);
+        Box3Packet<T> pb = Gather<T>(b);
+        Vec3Packet<T> pp = Gather<T>(p);
+
+        U32 overlaps = MoveMask(Overlaps(pa, pb));
+        U32 inside = MoveMask(Inside(pa, pp));
+        U32 insideExclusive = MoveMask(InsideExclusive(pa, pp));
+
+        for (int i = 0; i < lanes; ++i) {
+            Box3 u = Extract(Union(pa, pb), i);
+            Box3 v = Union(a[i], b[i]);
+            Box3 w = Extract(Intersect(pa, pb), i);
+            Box3 x = Intersect(a[i], b[i]);
+            Box3 y = Extract(Union(pa, pp), i);
+            Box3 z = Union(a[i], p[i]);
+            CHECK(memcmp(&u, &v, sizeof(Box3)) == 0);
+            CHECK(memcmp(&w, &x, sizeof(Box3)) == 0);
+            CHECK(memcmp(&y, &z, sizeof(Box3)) == 0);
+
+            CHECK(((overlaps >> i) & 1) == U32(Overlaps(a[i], b[i])));
+            CHECK(((inside >> i) & 1) == U32(Inside(a[i], p[i])));
+            CHECK(((insideExclusive >> i) & 1) == U32(InsideExclusive(a[i], p[i])));
+        }
+    }
+}
+
+TEST_CASE("Vec3x4 matches scalar Vec3") {
+    CheckVec3Packet<F32x4>();
+}
+
+TEST_CASE("Vec3x8 matches scalar Vec3") {
+    CheckVec3Packet<F32x8>();
+}
+
+TEST_CASE("Box3x4 matches scalar Box3") {
+    CheckBox3Packet<F32x4>();
+}
+
+TEST_CASE("Box3x8 matches scalar Box3") {
+    CheckBox3Packet<F32x8>();
+}
+
+TEST_CASE("F32x4 masks and rounding") {
+    F32x4 a = F32x4Set(-1.5f, -0.5f, 0.5f, 1.5f);
+    F32x4 b = F32x4Set(-0.0f, 3e9f, -3e9f, 2.0f);
+    F32x4 zero = F32x4Zero();
+
+    CHECK(MoveMask(a < zero) == 0x3);
+    CHECK(MoveMask(a >= zero) == 0xc);
+    CHECK(MoveMask(!(a < zero)) == 0xc);
+    CHECK(All((a < zero) | (a > zero)));
+    CHECK(None((a < zero) & (a > zero)));
+    CHECK(Any(a == F32x4Splat(0.5f)));
+
+    F32 s[4];
+    F32x4Store(s, Select(a < zero, a, b));
+    CHECK(s[0] == -1.5f);
+    CHECK(s[1] == -0.5f);
+    CHECK(s[2] == -3e9f);
+    CHECK(s[3] == 2.0f);
+
+    F32 in[8] = {-1.5f, -0.5f, 0.5f, 1.5f, -0.0f, 3e9f, -3e9f, 2.0f};
+    F32 floors[8], ceils[8];
+    F32x4Store(floors, Floor(a));
+    F32x4Store(floors + 4, Floor(b));
+    F32x4Store(ceils, Ceil(a));
+    F32x4Store(ceils + 4, Ceil(b));
+    for (int i = 0; i < 8; ++i) {
+        CHECK(BitEqual(floors[i], floorf(in[i])));
+        CHECK(BitEqual(ceils[i], ceilf(in[i])));
+    }
+
+    F32x8 c = F32x8Load(in);
+    CHECK(MoveMask(c < F32x8Zero()) == 0x43);
+}